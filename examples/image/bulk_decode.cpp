@@ -21,6 +21,55 @@ struct State
     FileIndex index;
 
     ConcurrentQueue queue;
+    AsyncFileReader reader;
+
+    // the async reads are throttled so that the files which have been read but not
+    // yet decoded don't exceed this many bytes
+    size_t buffer_limit = 256 << 20;
+    size_t buffered_bytes = 0;
+    std::mutex buffer_mutex;
+    std::condition_variable buffer_condition;
+
+    void acquireBuffer(size_t bytes)
+    {
+        std::unique_lock lock(buffer_mutex);
+
+        // a file larger than the limit is read when nothing else is buffered
+        buffer_condition.wait(lock, [this, bytes]
+        {
+            return !buffered_bytes || buffered_bytes + bytes <= buffer_limit;
+        });
+
+        buffered_bytes += bytes;
+    }
+
+    void releaseBuffer(size_t bytes)
+    {
+        {
+            std::lock_guard lock(buffer_mutex);
+            buffered_bytes -= bytes;
+        }
+
+        buffer_condition.notify_all();
+    }
+
+    // releases the buffered bytes even when the decoding task throws
+    struct BufferGuard
+    {
+        State& state;
+        size_t bytes;
+
+        BufferGuard(State& state, size_t bytes)
+            : state(state)
+            , bytes(bytes)
+        {
+        }
+
+        ~BufferGuard()
+        {
+            state.releaseBuffer(bytes);
+        }
+    };
 
     void decode(ConstMemory memory, const std::string& filename, bool multithread)
     {
@@ -99,7 +148,7 @@ struct State
         }
     }
 
-    void process(bool mmap, bool multithread)
+    void process(bool mmap, bool async, bool multithread)
     {
         // sort files by size; the largest decoding tasks should start first
         std::sort(index.begin(), index.end(), [] (const FileInfo& a, const FileInfo& b)
@@ -107,6 +156,39 @@ struct State
             return a.size > b.size;
         });
 
+        if (async)
+        {
+            // the reads are in flight while the decoders work on the completed files
+            for (size_t i = 0; i < index.files.size(); ++i)
+            {
+                const std::string& filename = index.files[i].name;
+                const size_t bytes = size_t(index.files[i].size);
+
+                acquireBuffer(bytes);
+
+                reader.read({ { filename } }, [this, filename, bytes, multithread] (FileReadResult result)
+                {
+                    queue.enqueue([this, filename, bytes, multithread, result = std::move(result)]
+                    {
+                        BufferGuard guard(*this, bytes);
+
+                        if (result.status)
+                        {
+                            decode(result.memory, filename, multithread);
+                        }
+                        else
+                        {
+                            // not a native file, for example inside a container
+                            File file(filename);
+                            decode(file, filename, multithread);
+                        }
+                    });
+                });
+            }
+
+            return;
+        }
+
         for (auto node : index)
         {
             const std::string& filename = node.name;
@@ -133,15 +215,17 @@ struct State
 
     void wait()
     {
+        reader.wait();
         queue.wait();
     }
 };
 
-void test(const std::string& folder, const std::string& format, bool mmap, bool multithread)
+void test(const std::string& folder, const std::string& format, bool mmap, bool async, size_t async_limit, bool multithread)
 {
     u64 time0 = Time::ms();
 
     State state;
+    state.buffer_limit = async_limit << 20;
 
     Path path(folder);
     state.scan(path, format);
@@ -150,15 +234,16 @@ void test(const std::string& folder, const std::string& format, bool mmap, bool
     printLine("Scanning: {} ms", time1 - time0);
     printLine("");
 
-    state.process(mmap, multithread);
+    state.process(mmap, async, multithread);
     state.wait();
 
     u64 time2 = Time::ms();
 
     printLine("");
     printLine("{}", getSystemInfo());
-    printLine("MMAP: {}", mmap);
-    printLine("MT:   {}", multithread);
+    printLine("MMAP:  {}", mmap);
+    printLine("ASYNC: {} ({})", async, state.reader.backend());
+    printLine("MT:    {}", multithread);
     printLine("");
 
     printLine("Decoded {} files in {} ms ({} MB -> {} MB).",
@@ -181,6 +266,8 @@ namespace
         std::string pathname;
         std::string format;
         bool mmap = false;
+        bool async = false;
+        size_t async_limit = 256;
         bool multithread = false;
         bool tracing = false;
     };
@@ -213,6 +300,18 @@ namespace
                 args.mmap = true;
             });
 
+        parser.flag("--async", "read the files with AsyncFileReader",
+            [&]()
+            {
+                args.async = true;
+            });
+
+        parser.optionInt("--async-limit", "megabytes of read but not yet decoded files (default: 256)",
+            [&](int value)
+            {
+                args.async_limit = size_t(std::max(1, value));
+            });
+
         parser.flag("--mt", "enable multi-threaded decoding",
             [&]()
             {
@@ -259,7 +358,7 @@ int main(int argc, const char* argv[])
         startTrace(output.get());
     }
 
-    test(args.pathname, args.format, args.mmap, args.multithread);
+    test(args.pathname, args.format, args.mmap, args.async, args.async_limit, args.multithread);
 
     if (args.tracing)
     {
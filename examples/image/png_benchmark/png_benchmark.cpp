@@ -695,6 +695,23 @@ size_t save_mango(const Bitmap& bitmap)
     return getFileSize(filename);
 }
 
+size_t save_mango_filter(const Bitmap& bitmap)
+{
+    if (!g_option_save)
+    {
+        return 0;
+    }
+
+    const char* filename = "output-mango-filter.png";
+
+    ImageEncodeOptions options;
+    options.compression = g_option_compression;
+    options.adaptive_filter = true;
+    bitmap.save(filename, options);
+
+    return getFileSize(filename);
+}
+
 #endif
 
 // ----------------------------------------------------------------------
@@ -747,6 +764,7 @@ void test_file(const std::string& filename)
 
 #if defined(ENABLE_MANGO)
     test("mango:   ", load_mango, save_mango, buffer, bitmap);
+    test("mango(f):", load_none, save_mango_filter, buffer, bitmap);
 #endif
 }
 
@@ -0,0 +1,184 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <mango/mango.hpp>
+
+#if defined(MANGO_PLATFORM_LINUX)
+#include <unistd.h>
+#endif
+
+using namespace mango;
+using namespace mango::filesystem;
+
+/*
+    Archive index benchmark: creates a synthetic ZIP archive with a large number of
+    empty files in memory and measures how long it takes to open it, how much the
+    resident memory grows while the index is built and how fast the lookups are.
+*/
+
+static
+u64 getResidentMemory()
+{
+#if defined(MANGO_PLATFORM_LINUX)
+    u64 pages = 0;
+    u64 resident = 0;
+
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (file)
+    {
+        if (std::fscanf(file, "%llu %llu", (unsigned long long*)&pages, (unsigned long long*)&resident) != 2)
+        {
+            resident = 0;
+        }
+        std::fclose(file);
+    }
+
+    return resident * u64(sysconf(_SC_PAGESIZE));
+#else
+    return 0;
+#endif
+}
+
+static
+std::string getFilename(u32 index, u32 folders)
+{
+    return fmt::format("folder{:05}/file{:07}.dat", index % folders, index);
+}
+
+static
+void createArchive(Buffer& buffer, u32 files, u32 folders)
+{
+    MemoryStream central;
+    LittleEndianStream directory = central;
+
+    MemoryStream output;
+    LittleEndianStream stream = output;
+
+    for (u32 i = 0; i < files; ++i)
+    {
+        const std::string name = getFilename(i, folders);
+        const u32 offset = u32(output.size());
+
+        stream.write32(0x04034b50);
+        stream.write16(20); // version needed
+        stream.write16(0);  // flags
+        stream.write16(0);  // stored
+        stream.write16(0);  // time
+        stream.write16(0);  // date
+        stream.write32(0);  // crc
+        stream.write32(0);  // compressed size
+        stream.write32(0);  // uncompressed size
+        stream.write16(u16(name.length()));
+        stream.write16(0);
+        stream.write(name.data(), name.length());
+
+        directory.write32(0x02014b50);
+        directory.write16(20); // version used
+        directory.write16(20); // version needed
+        directory.write16(0);  // flags
+        directory.write16(0);  // stored
+        directory.write16(0);  // time
+        directory.write16(0);  // date
+        directory.write32(0);  // crc
+        directory.write32(0);  // compressed size
+        directory.write32(0);  // uncompressed size
+        directory.write16(u16(name.length()));
+        directory.write16(0); // extra field
+        directory.write16(0); // comment
+        directory.write16(0); // disk start
+        directory.write16(0); // internal attributes
+        directory.write32(0); // external attributes
+        directory.write32(offset);
+        directory.write(name.data(), name.length());
+    }
+
+    const u64 dirOffset = output.size();
+    const u64 dirSize = central.size();
+
+    stream.write(central.data(), central.size());
+
+    // the entry count doesn't fit in the end record; use the ZIP64 end record
+    const u64 zip64Offset = output.size();
+
+    stream.write32(0x06064b50);
+    stream.write64(44); // size of the remaining record
+    stream.write16(45); // version used
+    stream.write16(45); // version needed
+    stream.write32(0);  // this disk
+    stream.write32(0);  // directory start disk
+    stream.write64(files);
+    stream.write64(files);
+    stream.write64(dirSize);
+    stream.write64(dirOffset);
+
+    stream.write32(0x07064b50);
+    stream.write32(0);
+    stream.write64(zip64Offset);
+    stream.write32(1);
+
+    stream.write32(0x06054b50);
+    stream.write16(0);
+    stream.write16(0);
+    stream.write16(0xffff);
+    stream.write16(0xffff);
+    stream.write32(0xffffffff);
+    stream.write32(0xffffffff);
+    stream.write16(0);
+
+    buffer.reset(output.size());
+    std::memcpy(buffer.data(), output.data(), output.size());
+}
+
+int main(int argc, char *argv[])
+{
+    u32 files = 1000000;
+    u32 folders = 10000;
+
+    if (argc > 1)
+    {
+        files = std::max(1, std::atoi(argv[1]));
+    }
+
+    if (argc > 2)
+    {
+        folders = std::max(1, std::atoi(argv[2]));
+    }
+
+    Buffer buffer;
+    createArchive(buffer, files, folders);
+
+    printLine("archive: {} files in {} folders, {} MB", files, folders, buffer.size() >> 20);
+
+    const u64 memory0 = getResidentMemory();
+
+    u64 time0 = Time::us();
+
+    Path path(buffer, ".zip");
+
+    u64 time1 = Time::us();
+
+    const u64 memory1 = getResidentMemory();
+
+    const u32 lookups = 100000;
+    u32 found = 0;
+    u32 seed = 1;
+
+    for (u32 i = 0; i < lookups; ++i)
+    {
+        seed = seed * 1664525 + 1013904223;
+        found += path.isFile(getFilename(seed % files, folders));
+    }
+
+    u64 time2 = Time::us();
+
+    printLine("open:    {:>8.1f} ms", (time1 - time0) / 1000.0);
+    printLine("lookups: {:>8.1f} ms ({} of {} found)", (time2 - time1) / 1000.0, found, lookups);
+
+    if (memory1 > memory0)
+    {
+        printLine("resident memory growth: {} MB", (memory1 - memory0) >> 20);
+    }
+
+    return found == lookups ? 0 : 1;
+}
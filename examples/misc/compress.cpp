@@ -54,9 +54,10 @@ static void load_folder(const std::string& folder, Buffer& buffer)
 static void print_help(const char* program)
 {
     printLine("help");
-    printLine("Usage: {} <folder> [level]", program);
+    printLine("Usage: {} <folder> [level] [block]", program);
     printLine("  folder  Directory whose files are loaded and compressed (recursive).");
     printLine("  level   Compression level (default: 4).");
+    printLine("  block   Block size in bytes for the small block test (default: 4096).");
 }
 
 void test_compression(ConstMemory input, int level)
@@ -109,6 +110,76 @@ void test_compression(ConstMemory input, int level)
     }
 }
 
+void test_small_blocks(ConstMemory input, int level, size_t block_size)
+{
+    // Compress the input as independent small blocks; this is dominated by the
+    // compressor setup cost unless the state is reused between calls.
+
+    const size_t size = input.size;
+    const size_t count = block_size ? (size + block_size - 1) / block_size : 0;
+
+    if (!size || !block_size)
+    {
+        return;
+    }
+
+    printLine("");
+    printLine("Small blocks: {} x {} bytes", count, block_size);
+    printLine("------------------------------------------------------------");
+    printLine("Method      Ratio        Compress       Decompress    Status");
+    printLine("------------------------------------------------------------");
+
+    std::vector<Compressor> compressors = getCompressors();
+
+    for (const auto& compressor : compressors)
+    {
+        if (compressor.name.find('.') != std::string::npos)
+        {
+            continue;
+        }
+
+        auto context = compressor.createContext();
+
+        size_t bound = compressor.bound(block_size);
+        Buffer compressed(bound * count);
+        Buffer output(size);
+
+        std::vector<size_t> sizes(count);
+        size_t bytes = 0;
+
+        u64 time0 = Time::us();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t offset = i * block_size;
+            ConstMemory block(input.address + offset, std::min(block_size, size - offset));
+            Memory dest(compressed.data() + i * bound, bound);
+            sizes[i] = context->compress(dest, block, level);
+            bytes += sizes[i];
+        }
+
+        u64 time1 = Time::us();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t offset = i * block_size;
+            Memory dest(output.data() + offset, std::min(block_size, size - offset));
+            context->decompress(dest, ConstMemory(compressed.data() + i * bound, sizes[i]));
+        }
+
+        u64 time2 = Time::us();
+
+        bool correct = std::memcmp(input.address, output, size) == 0;
+        const char* status = correct ? "PASSED" : "FAILED";
+
+        float ratio = bytes * 100.0f / size;
+        float rate0 = size / float(time1 - time0 + 1);
+        float rate1 = size / float(time2 - time1 + 1);
+
+        printLine("{:<9} {:>6.1f}% {:>10.1f} MB/s {:>11.1f} MB/s    {}", compressor.name, ratio, rate0, rate1, status);
+    }
+}
+
 int main(int argc, const char* argv[])
 {
     if (argc < 2)
@@ -119,17 +190,24 @@ int main(int argc, const char* argv[])
 
     const std::string folder = argv[1];
     int level = 4;
+    size_t block_size = 4096;
 
     if (argc >= 3)
     {
         level = std::atoi(argv[2]);
     }
 
+    if (argc >= 4)
+    {
+        block_size = std::atoi(argv[3]);
+    }
+
     try
     {
         Buffer buffer;
         load_folder(folder, buffer);
         test_compression(buffer, level);
+        test_small_blocks(buffer, level, block_size);
     }
     catch (const std::exception& e)
     {
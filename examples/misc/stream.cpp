@@ -0,0 +1,86 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <mango/core/core.hpp>
+#include <mango/filesystem/filesystem.hpp>
+
+using namespace mango;
+using namespace mango::filesystem;
+
+/*
+    Small field I/O through the endian stream adapters; every field is one
+    read() or write() call into the FileStream. Without a buffer each call
+    is a system call.
+*/
+
+static void print_help(const char* program)
+{
+    printLine("help");
+    printLine("Usage: {} <filename> [fields]", program);
+    printLine("  filename  Temporary file which is written and read back.");
+    printLine("  fields    Number of 16 bit and 32 bit field pairs (default: 1000000).");
+}
+
+void test_stream(const std::string& filename, size_t fields, size_t buffer_size)
+{
+    u64 time0 = Time::us();
+
+    {
+        OutputFileStream file(filename, buffer_size);
+        LittleEndianStream s(file);
+
+        for (size_t i = 0; i < fields; ++i)
+        {
+            s.write16(u16(i));
+            s.write32(u32(i));
+        }
+    }
+
+    u64 time1 = Time::us();
+
+    bool correct = true;
+
+    {
+        InputFileStream file(filename, buffer_size);
+        LittleEndianStream s(file);
+
+        for (size_t i = 0; i < fields; ++i)
+        {
+            u16 a = s.read16();
+            u32 b = s.read32();
+            correct &= (a == u16(i)) && (b == u32(i));
+        }
+    }
+
+    u64 time2 = Time::us();
+
+    const char* status = correct ? "PASSED" : "FAILED";
+
+    printLine("{:>10} {:>10.1f} ms {:>10.1f} ms    {}", buffer_size,
+        (time1 - time0) / 1000.0, (time2 - time1) / 1000.0, status);
+}
+
+int main(int argc, const char* argv[])
+{
+    if (argc < 2)
+    {
+        print_help(argv[0]);
+        return 0;
+    }
+
+    const std::string filename = argv[1];
+    const size_t fields = argc > 2 ? std::stoul(argv[2]) : 1000000;
+
+    printLine("Fields: {}", fields * 2);
+    printLine("------------------------------------------------");
+    printLine("    Buffer        Write           Read    Status");
+    printLine("------------------------------------------------");
+
+    const size_t buffer_sizes [] = { 0, 4096, BufferedStream::default_buffer_size, 1024 * 1024 };
+
+    for (size_t buffer_size : buffer_sizes)
+    {
+        test_stream(filename, fields, buffer_size);
+    }
+}
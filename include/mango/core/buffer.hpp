@@ -102,4 +102,51 @@ namespace mango
         u64 write(const void* data, u64 bytes) override;
     };
 
+    /*
+        BufferedStream collects small reads and writes into a buffer so that the
+        endian stream adapters don't issue a system call for every field. Derived
+        classes implement the unbuffered interface; reads and writes larger than the
+        buffer go directly into it. A buffer size of zero disables buffering.
+
+        Buffered writes are reported as written and committed by flush(), seek() or
+        read(). The base class can't flush in its destructor; derived classes must call
+        flush() in theirs.
+    */
+
+    class BufferedStream : public Stream
+    {
+    private:
+        Buffer m_buffer;
+        size_t m_read_offset = 0; // next byte to read from the buffer
+        size_t m_read_size = 0;   // bytes read ahead into the buffer
+        size_t m_write_size = 0;  // bytes waiting to be written
+
+        void discard();
+
+    protected:
+        virtual u64 unbufferedSize() const = 0;
+        virtual u64 unbufferedOffset() const = 0;
+        virtual u64 unbufferedSeek(s64 distance, SeekMode mode) = 0;
+        virtual u64 unbufferedRead(void* dest, u64 bytes) = 0;
+        virtual u64 unbufferedWrite(const void* data, u64 bytes) = 0;
+
+    public:
+        static constexpr size_t default_buffer_size = 64 * 1024;
+
+        BufferedStream(size_t buffer_size = default_buffer_size);
+        ~BufferedStream();
+
+        size_t bufferSize() const;
+
+        // write the buffered data; returns false if the write failed
+        bool flush();
+
+        // interface
+        u64 size() const override;
+        u64 offset() const override;
+        u64 seek(s64 distance, SeekMode mode) override;
+        u64 read(void* dest, u64 bytes) override;
+        u64 write(const void* data, u64 bytes) override;
+    };
+
 } // namespace mango
@@ -88,6 +88,21 @@ namespace mango
         }
     };
 
+    // The compression functions keep their compressor state in thread-local storage
+    // so that it can be reused between calls. The CompressionContext owns the state
+    // explicitly; this is useful when compressing a lot of small blocks on a thread
+    // which does not live long enough to amortize the thread-local state. A context
+    // must not be used from more than one thread at a time.
+
+    class CompressionContext
+    {
+    public:
+        CompressionContext() {}
+        virtual ~CompressionContext() {}
+        virtual CompressionStatus compress(Memory dest, ConstMemory source, int level) = 0;
+        virtual CompressionStatus decompress(Memory dest, ConstMemory source) = 0;
+    };
+
     namespace nocompress
     {
         size_t bound(size_t size);
@@ -100,6 +115,7 @@ namespace mango
         size_t bound(size_t size);
         CompressionStatus compress(Memory dest, ConstMemory source, int level = 6);
         CompressionStatus decompress(Memory dest, ConstMemory source);
+        std::shared_ptr<CompressionContext> createContext();
     }
 
     namespace zstd
@@ -107,6 +123,70 @@ namespace mango
         size_t bound(size_t size);
         CompressionStatus compress(Memory dest, ConstMemory source, int level = 6);
         CompressionStatus decompress(Memory dest, ConstMemory source);
+        std::shared_ptr<CompressionContext> createContext();
+
+        // Seekable format: the source is split into independent frames which are
+        // compressed in parallel. The frame sizes are stored in a seek table in a
+        // skippable frame at the end, so the result is also a valid zstd stream for
+        // decompress(). The frame_size is the uncompressed size of each frame
+        // (0: default of 1 MB).
+
+        size_t bound_seekable(size_t size, size_t frame_size = 0);
+        CompressionStatus compress_seekable(Memory dest, ConstMemory source, int level = 6, size_t frame_size = 0);
+        CompressionStatus decompress_seekable(Memory dest, ConstMemory source);
+
+        class SeekableDecoder : protected NonCopyable
+        {
+        protected:
+            struct Frame
+            {
+                u64 compressed_offset;
+                u64 offset;
+                u32 compressed_size;
+                u32 size;
+            };
+
+            ConstMemory m_memory;
+            std::vector<Frame> m_frames;
+            u64 m_size = 0;
+            bool m_valid = false;
+
+        public:
+            SeekableDecoder(ConstMemory memory);
+            ~SeekableDecoder();
+
+            bool isSeekable() const;
+            u64 size() const;
+
+            // decompress dest.size bytes starting at uncompressed offset; only the
+            // frames which overlap the range are decompressed (in parallel).
+            CompressionStatus read(Memory dest, u64 offset) const;
+        };
+
+        // Dictionary: small inputs which share structure (JSON, shaders, meshes, ..)
+        // compress much better when compressed individually with a dictionary trained
+        // from samples of similar data. The compression level is fixed when the
+        // dictionary is created. The dictionary can be shared between threads.
+
+        // train a dictionary from samples concatenated in one buffer; the size of the
+        // trained dictionary is returned in status.size.
+        CompressionStatus train(Memory dictionary, ConstMemory samples, const std::vector<size_t>& sample_sizes);
+
+        class Dictionary : protected NonCopyable
+        {
+        protected:
+            struct State;
+            std::unique_ptr<State> m_state;
+
+        public:
+            Dictionary(ConstMemory memory, int level = 6);
+            ~Dictionary();
+
+            ConstMemory memory() const;
+
+            CompressionStatus compress(Memory dest, ConstMemory source) const;
+            CompressionStatus decompress(Memory dest, ConstMemory source) const;
+        };
     }
 
     namespace zlib
@@ -156,6 +236,7 @@ namespace mango
         size_t bound(size_t size);
         CompressionStatus compress(Memory dest, ConstMemory source, int level = 6);
         CompressionStatus decompress(Memory dest, ConstMemory source);
+        std::shared_ptr<CompressionContext> createContext();
     }
 
     namespace deflate_zlib
@@ -163,6 +244,7 @@ namespace mango
         size_t bound(size_t size);
         CompressionStatus compress(Memory dest, ConstMemory source, int level = 6);
         CompressionStatus decompress(Memory dest, ConstMemory source);
+        std::shared_ptr<CompressionContext> createContext();
     }
 
     namespace deflate_gzip
@@ -170,6 +252,7 @@ namespace mango
         size_t bound(size_t size);
         CompressionStatus compress(Memory dest, ConstMemory source, int level = 6);
         CompressionStatus decompress(Memory dest, ConstMemory source);
+        std::shared_ptr<CompressionContext> createContext();
     }
 
     namespace deflate64
@@ -217,6 +300,7 @@ namespace mango
         size_t (*bound)(size_t size) = nullptr;
         CompressionStatus (*compress)(Memory dest, ConstMemory source, int level) = nullptr;
         CompressionStatus (*decompress)(Memory dest, ConstMemory source) = nullptr;
+        std::shared_ptr<CompressionContext> (*createContext)() = nullptr;
     };
 
     std::vector<Compressor> getCompressors();
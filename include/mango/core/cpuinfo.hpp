@@ -4,6 +4,7 @@
 */
 #pragma once
 
+#include <vector>
 #include <mango/core/configure.hpp>
 
 namespace mango
@@ -69,5 +70,33 @@ namespace mango
         u64 getFlags();
         bool isLittleEndian();
 
+        // ------------------------------------------------------------------------
+        // cpu::getTopology()
+        // ------------------------------------------------------------------------
+
+        // All indices except id are dense, starting from zero.
+        struct Processor
+        {
+            u32 id;       // logical processor number used by the OS (affinity)
+            u32 core;     // physical core; SMT siblings have the same core
+            u32 package;  // socket
+            u32 node;     // NUMA node
+            u32 cache;    // last level (L3) cache domain
+        };
+
+        struct Topology
+        {
+            std::vector<Processor> processors;
+
+            u32 cores = 0;
+            u32 packages = 0;
+            u32 nodes = 0;
+            u32 caches = 0;
+        };
+
+        // Queried once; platforms without topology information report every
+        // logical processor as a separate core in one package, node and cache domain.
+        const Topology& getTopology();
+
     } // namespace cpu
 } // namespace mango
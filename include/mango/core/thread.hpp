@@ -4,6 +4,8 @@
 */
 #pragma once
 
+#include <algorithm>
+#include <deque>
 #include <queue>
 #include <vector>
 #include <memory>
@@ -13,6 +15,8 @@
 #include <functional>
 #include <condition_variable>
 #include <future>
+#include <new>
+#include <type_traits>
 #include <mango/core/exception.hpp>
 #include <mango/core/memory.hpp>
 #include <mango/core/atomic.hpp>
@@ -20,17 +24,193 @@
 namespace mango
 {
 
+    // ----------------------------------------------------------------------------------
+    // TaskFunction
+    // ----------------------------------------------------------------------------------
+
+    /*
+        Move-only void() callable for the task queues. Closures up to capacity bytes
+        are stored inline; larger closures go to a per-thread slab pool, so submitting
+        a task does not call the general purpose allocator in the common case. Blocks
+        freed on another thread (the usual case: the producer allocates, a worker
+        runs the task) are handed back to the owning thread's pool.
+    */
+
+    class TaskFunction
+    {
+    public:
+        static constexpr size_t capacity = 64;
+        static constexpr size_t alignment = 16;
+
+        TaskFunction() noexcept = default;
+
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, TaskFunction>>>
+        TaskFunction(F&& func)
+        {
+            using T = std::decay_t<F>;
+
+            if constexpr (sizeof(T) <= capacity && alignof(T) <= alignment && std::is_nothrow_move_constructible_v<T>)
+            {
+                new (m_storage) T(std::forward<F>(func));
+                m_ops = &inline_ops<T>;
+            }
+            else
+            {
+                static_assert(alignof(T) <= alignment, "TaskFunction: over-aligned closure.");
+
+                void* ptr = allocate(sizeof(T));
+                new (ptr) T(std::forward<F>(func));
+                new (m_storage) void*(ptr);
+                m_ops = &pooled_ops<T>;
+            }
+        }
+
+        TaskFunction(TaskFunction&& other) noexcept
+        {
+            if (other.m_ops)
+            {
+                other.m_ops->move(m_storage, other.m_storage);
+                m_ops = other.m_ops;
+                other.m_ops = nullptr;
+            }
+        }
+
+        TaskFunction& operator = (TaskFunction&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+
+                if (other.m_ops)
+                {
+                    other.m_ops->move(m_storage, other.m_storage);
+                    m_ops = other.m_ops;
+                    other.m_ops = nullptr;
+                }
+            }
+
+            return *this;
+        }
+
+        TaskFunction(const TaskFunction&) = delete;
+        TaskFunction& operator = (const TaskFunction&) = delete;
+
+        ~TaskFunction()
+        {
+            reset();
+        }
+
+        void operator () ()
+        {
+            m_ops->invoke(m_storage);
+        }
+
+        explicit operator bool () const
+        {
+            return m_ops != nullptr;
+        }
+
+        void reset()
+        {
+            if (m_ops)
+            {
+                m_ops->destroy(m_storage);
+                m_ops = nullptr;
+            }
+        }
+
+        // slab pool used for closures that do not fit inline (and by the ThreadPool)
+        static void* allocate(size_t size);
+        static void deallocate(void* ptr);
+
+    protected:
+        struct Operations
+        {
+            void (*invoke)(void* storage);
+            void (*move)(void* dest, void* source);
+            void (*destroy)(void* storage);
+        };
+
+        template <typename T>
+        static constexpr Operations inline_ops =
+        {
+            [] (void* storage)
+            {
+                (*std::launder(reinterpret_cast<T*>(storage)))();
+            },
+            [] (void* dest, void* source)
+            {
+                T* object = std::launder(reinterpret_cast<T*>(source));
+                new (dest) T(std::move(*object));
+                object->~T();
+            },
+            [] (void* storage)
+            {
+                std::launder(reinterpret_cast<T*>(storage))->~T();
+            }
+        };
+
+        template <typename T>
+        static constexpr Operations pooled_ops =
+        {
+            [] (void* storage)
+            {
+                (**std::launder(reinterpret_cast<T**>(storage)))();
+            },
+            [] (void* dest, void* source)
+            {
+                new (dest) void*(*std::launder(reinterpret_cast<void**>(source)));
+            },
+            [] (void* storage)
+            {
+                T* object = *std::launder(reinterpret_cast<T**>(storage));
+                object->~T();
+                TaskFunction::deallocate(object);
+            }
+        };
+
+        alignas(alignment) u8 m_storage[capacity];
+        const Operations* m_ops = nullptr;
+    };
+
     // ----------------------------------------------------------------------------------
     // ThreadPool
     // ----------------------------------------------------------------------------------
 
+    // Scheduling class of a ConcurrentQueue. Workers always pick up Interactive work
+    // before Normal, and Normal before Background.
+    enum class TaskPriority
+    {
+        Interactive,
+        Normal,
+        Background,
+    };
+
     /*
         Bounded thread pool shared by all ConcurrentQueue instances. Worker count is
         fixed; each running task occupies one slot until it returns.
 
         The pool is for parallelizing independent work units, not for building flow
         graphs where tasks wait on other tasks. An unbounded worker model would suit
-        the latter; this one does not.
+        the latter; this one does not. Use TaskGraph for dependent work: it never
+        blocks a worker on another task.
+
+        Scheduling: every worker owns a work-stealing deque. Tasks submitted from a
+        worker go to its own deque, tasks submitted from other threads go to a shared
+        queue. An idle worker drains its own deque (newest first), then the shared
+        queue, then steals the oldest task from a randomly selected worker. This is
+        done per priority lane, highest priority first.
+
+        A queue can cap the number of its tasks running at the same time; tasks over
+        the cap are held back and released to the pool as running tasks complete, so
+        a bulk job cannot occupy more than its share of the workers.
+
+        Placement: by default the OS scheduler places the workers. A pool created with
+        affinity pins each worker to a processor, spreading them over the NUMA nodes
+        (physical cores before SMT siblings). Queues can then target a node with
+        setNode(); their tasks only run on the workers of that node, so memory the
+        tasks allocate and touch first stays local. Set MANGO_THREAD_AFFINITY=1 to pin
+        the workers of the default pool.
     */
 
     class ThreadPool : private NonCopyable
@@ -38,17 +218,31 @@ namespace mango
     private:
         friend class ConcurrentQueue;
 
+        static constexpr int lane_count = 3;
+
+        struct Task;
+
         struct Queue
         {
             ThreadPool* pool;
             std::string name;
+            TaskPriority priority;
+            size_t max_in_flight; // 0: no limit
+            int node = -1; // NUMA node the tasks run on, -1 for any
 
             alignas(64) std::atomic<size_t> task_counter { 0 };
             alignas(64) std::atomic<bool> cancelled { false };
 
-            Queue(ThreadPool* pool, const std::string& name)
+            // tasks held back by the max_in_flight limit
+            std::mutex held_mutex;
+            std::deque<Task*> held;
+            size_t in_flight = 0;
+
+            Queue(ThreadPool* pool, const std::string& name, TaskPriority priority, size_t max_in_flight)
                 : pool(pool)
                 , name(name)
+                , priority(priority)
+                , max_in_flight(max_in_flight)
             {
             }
         };
@@ -56,7 +250,17 @@ namespace mango
         struct Task
         {
             Queue* queue;
-            std::function<void()> func;
+            TaskFunction func;
+
+            static void* operator new (size_t size)
+            {
+                return TaskFunction::allocate(size);
+            }
+
+            static void operator delete (void* ptr)
+            {
+                TaskFunction::deallocate(ptr);
+            }
         };
 
         // One cache line per worker; only that worker writes.
@@ -65,10 +269,13 @@ namespace mango
         {
             std::atomic<u64> busy_ns { 0 };
             std::atomic<u64> busy_stamp_ns { 0 };
+            std::atomic<u64> lane_busy_ns [lane_count] { };
+            std::atomic<int> busy_lane { 0 };
         };
 
     public:
         ThreadPool(size_t size);
+        ThreadPool(size_t size, bool affinity);
         ~ThreadPool();
 
         static size_t getHardwareConcurrency();
@@ -76,18 +283,30 @@ namespace mango
 
         int size() const;
 
+        // Number of NUMA nodes the workers are spread over (1 unless pinned) and the
+        // node of the calling worker (-1 when not called from a worker of this pool).
+        int getNodeCount() const;
+        int getCurrentNode() const;
+
         // Per-worker busy fraction in [0, 1] since the previous call (zeros on the
         // first call). Cheap pulse for HUDs — not a trace. Calling this updates the
         // sampling window; ~10 Hz is plenty for a graph.
         std::vector<float> utilization();
 
+        // Per-lane occupancy in [0, 1]: the share of the pool's worker time spent on
+        // each TaskPriority (indexed by the enum value) since the previous call.
+        // Sampled independently of utilization().
+        std::vector<float> laneUtilization();
+
     protected:
         struct Consumer;
 
         void thread(size_t threadID);
 
-        void enqueue(Queue* queue, std::function<void()>&& func);
+        void enqueue(Queue* queue, TaskFunction&& func);
         void enqueue_bulk(Queue* queue, const std::vector<std::function<void()>>& functions);
+        void submit(Task* task);
+        bool admit(Task* task);
         void process(Task& task);
         bool dequeue_and_process();
         void cancel(Queue* queue);
@@ -109,6 +328,9 @@ namespace mango
         std::mutex m_utilization_mutex;
         std::vector<u64> m_utilization_busy_ns;
         u64 m_utilization_stamp_ns = 0;
+
+        std::vector<u64> m_lane_busy_ns;
+        u64 m_lane_stamp_ns = 0;
     };
 
     // ----------------------------------------------------------------------------------
@@ -129,6 +351,15 @@ namespace mango
         on the current thread without using the shared pool. This avoids pool deadlock
         and thread explosion from nested parallel fan-out.
 
+        A queue has a TaskPriority (Normal by default) and an optional limit on how
+        many of its tasks may run concurrently (max_in_flight, 0 is unlimited):
+
+            // latency sensitive work is picked up first
+            ConcurrentQueue thumbnails("thumbnail", TaskPriority::Interactive);
+
+            // bulk work never occupies more than 4 workers
+            ConcurrentQueue archive("archive", TaskPriority::Background, 4);
+
         Usage example:
 
             // create queue
@@ -154,7 +385,7 @@ namespace mango
         struct NestedQueue;
         std::unique_ptr<NestedQueue> m_nested;
 
-        void enqueue_task(std::function<void()>&& func);
+        void enqueue_task(TaskFunction&& func);
         void run_nested_task();
 
     public:
@@ -162,13 +393,21 @@ namespace mango
         ConcurrentQueue(const std::string& name);
         ConcurrentQueue(ThreadPool& pool);
         ConcurrentQueue(ThreadPool& pool, const std::string& name);
+        ConcurrentQueue(const std::string& name, TaskPriority priority, size_t max_in_flight = 0);
+        ConcurrentQueue(ThreadPool& pool, const std::string& name, TaskPriority priority, size_t max_in_flight = 0);
         ~ConcurrentQueue();
 
         template <class F, class... Args>
         void enqueue(F&& f, Args&&... args)
         {
-            auto func = std::bind_front(std::forward<F>(f), std::forward<Args>(args)...);
-            enqueue_task(std::move(func));
+            if constexpr (sizeof...(Args) == 0)
+            {
+                enqueue_task(TaskFunction(std::forward<F>(f)));
+            }
+            else
+            {
+                enqueue_task(TaskFunction(std::bind_front(std::forward<F>(f), std::forward<Args>(args)...)));
+            }
         }
 
         void enqueue_bulk(const std::vector<std::function<void()>>& functions);
@@ -178,6 +417,13 @@ namespace mango
             return m_queue.cancelled;
         }
 
+        // Run the tasks only on the workers of a NUMA node (-1: any worker).
+        // Has effect on pools created with affinity; set before enqueueing.
+        void setNode(int node)
+        {
+            m_queue.node = node;
+        }
+
         void steal();
         void cancel();
         void wait();
@@ -195,6 +441,10 @@ namespace mango
         SerialQueue and ConcurrentQueue can be freely mixed can can enqueue work to other
         queues from their tasks.
 
+        Enqueue is lock-free (one atomic exchange into an intrusive list) and the
+        execution thread parks on an atomic wait only when the queue is empty, so
+        producers do not pay for a mutex or a condition variable on every task.
+
         Usage example:
 
             // create queue
@@ -214,21 +464,17 @@ namespace mango
     class SerialQueue : private NonCopyable
     {
     protected:
-        using Task = std::function<void()>;
-
         std::string m_name;
         std::thread m_thread;
 
         alignas(64) std::atomic<bool> m_stop { false };
         alignas(64) std::atomic<size_t> m_task_counter { 0 };
 
-        std::deque<Task> m_task_queue;
-        std::mutex m_queue_mutex;
-        std::mutex m_wait_mutex;
-        std::condition_variable m_task_condition;
-        std::condition_variable m_wait_condition;
+        struct TaskQueue;
+        TaskQueue* m_queue;
 
         void thread();
+        void enqueue_task(TaskFunction&& func);
 
     public:
         SerialQueue();
@@ -238,10 +484,14 @@ namespace mango
         template <class F, class... Args>
         void enqueue(F&& f, Args&&... args)
         {
-            std::lock_guard<std::mutex> lock(m_queue_mutex);
-            m_task_queue.emplace_back(f, (args)...);
-            ++m_task_counter;
-            m_task_condition.notify_one();
+            if constexpr (sizeof...(Args) == 0)
+            {
+                enqueue_task(TaskFunction(std::forward<F>(f)));
+            }
+            else
+            {
+                enqueue_task(TaskFunction(std::bind_front(std::forward<F>(f), std::forward<Args>(args)...)));
+            }
         }
 
         void cancel();
@@ -284,6 +534,10 @@ namespace mango
             // now we wait until ticket queue is finished
             tk.wait();
 
+        A ticket is a single pooled node linked into a lock-free list; the consumer
+        thread parks on the node's state with an atomic wait until it is consumed.
+        A ticket which is released without consume() is skipped.
+
     */
 
     class TicketQueue : private NonCopyable
@@ -291,20 +545,36 @@ namespace mango
     protected:
         struct Task
         {
-            std::atomic<int> count { 1 };
-            std::function<void()> func;
-            std::promise<void> promise;
+            enum : u32 { Pending, Waiting, Ready };
+
+            std::atomic<Task*> next { nullptr };
+            std::atomic<u32> state { Pending };
+            std::atomic<int> holders { 0 }; // Ticket objects referring to the task
+            std::atomic<int> refs { 1 };    // holders + the queue
+            TaskFunction func;
+
+            static void* operator new (size_t size)
+            {
+                return TaskFunction::allocate(size);
+            }
+
+            static void operator delete (void* ptr)
+            {
+                TaskFunction::deallocate(ptr);
+            }
         };
 
     public:
-        using SharedTask = std::shared_ptr<Task>;
-
         class Ticket
         {
         protected:
             friend class TicketQueue;
 
-            SharedTask task;
+            Task* task = nullptr;
+
+            void attach(Task* task);
+            void release();
+            void signal() const;
 
         public:
             Ticket();
@@ -316,8 +586,16 @@ namespace mango
             template <class F, class... Args>
             void consume(F&& f, Args&&... args) const
             {
-                task->func = std::bind_front(std::forward<F>(f), std::forward<Args>(args)...);
-                task->promise.set_value();
+                if constexpr (sizeof...(Args) == 0)
+                {
+                    task->func = TaskFunction(std::forward<F>(f));
+                }
+                else
+                {
+                    task->func = TaskFunction(std::bind_front(std::forward<F>(f), std::forward<Args>(args)...));
+                }
+
+                signal();
             }
         };
 
@@ -334,15 +612,339 @@ namespace mango
         alignas(64) std::atomic<bool> m_stop { false };
         alignas(64) std::atomic<size_t> m_ticket_counter { 0 };
 
-        std::mutex m_wait_mutex;
-        std::mutex m_consume_mutex;
-        std::condition_variable m_wait_condition;
-        std::condition_variable m_consume_condition;
-
         struct TaskQueue;
         alignas(64) TaskQueue* m_queue;
 
         bool dequeue_and_process();
     };
 
+    // ----------------------------------------------------------------------------------
+    // TaskGraph
+    // ----------------------------------------------------------------------------------
+
+    /*
+        TaskGraph executes a directed acyclic graph of tasks in the ThreadPool. Each node
+        declares the nodes it depends on and becomes ready when all of them have
+        completed. Nothing in the graph blocks a worker: the task that completes the
+        last dependency schedules the node, and one of the ready successors is run as a
+        continuation on the same worker instead of going through the queue.
+
+        A node function returns void or bool; returning false cancels the node's
+        successors. Cancellation propagates: a cancelled node is completed without
+        running its function and cancels its own successors. cancel() on the graph
+        skips every node that has not started yet; a cancel() before run() skips
+        the whole run.
+
+        The graph can be run again after wait(), which also clears the cancellations;
+        nodes cannot be added while it runs.
+
+        Usage example:
+
+            TaskGraph graph;
+
+            auto read = graph.add([&]
+            {
+                // read file..
+            });
+
+            auto decode = graph.add([&]
+            {
+                // decode image..
+                return success; // false cancels mipmaps and everything after it
+            }, { read });
+
+            auto mipmaps = graph.add([&] { }, { decode });
+            auto compress = graph.add([&] { }, { mipmaps });
+            auto write = graph.add([&] { }, { compress });
+
+            graph.run();
+            graph.wait(); // cooperative, blocking (helps pool until the graph is complete)
+
+    */
+
+    class TaskGraph : private NonCopyable
+    {
+    public:
+        class Node : private NonCopyable
+        {
+        protected:
+            friend class TaskGraph;
+
+            TaskFunction func;
+            std::vector<Node*> successors;
+            int predecessors = 0;
+
+            alignas(64) std::atomic<int> pending { 0 };
+            std::atomic<bool> cancelled { false };
+
+        public:
+            Node() = default;
+
+            bool isCancelled() const
+            {
+                return cancelled.load(std::memory_order_acquire);
+            }
+        };
+
+        TaskGraph();
+        TaskGraph(const std::string& name);
+        TaskGraph(ThreadPool& pool);
+        TaskGraph(ThreadPool& pool, const std::string& name);
+        ~TaskGraph();
+
+        template <class F>
+        Node* add(F&& func, std::initializer_list<Node*> dependencies = {})
+        {
+            Node* node = create();
+
+            if constexpr (std::is_same_v<std::invoke_result_t<F&>, bool>)
+            {
+                node->func = [node, f = std::forward<F>(func)] () mutable
+                {
+                    if (!f())
+                    {
+                        node->cancelled.store(true, std::memory_order_release);
+                    }
+                };
+            }
+            else
+            {
+                node->func = std::forward<F>(func);
+            }
+
+            for (Node* dependency : dependencies)
+            {
+                precede(dependency, node);
+            }
+
+            return node;
+        }
+
+        // "after" will not start before "before" has completed
+        void precede(Node* before, Node* after);
+
+        void run();
+        void wait();
+        void cancel();
+        void cancel(Node* node);
+
+        bool isCancelled() const
+        {
+            return m_cancelled.load(std::memory_order_acquire);
+        }
+
+    protected:
+        ConcurrentQueue m_queue;
+        std::vector<std::unique_ptr<Node>> m_nodes;
+
+        alignas(64) std::atomic<bool> m_cancelled { false };
+
+        Node* create();
+        void schedule(Node* node);
+        void execute(Node* node);
+    };
+
+    // ----------------------------------------------------------------------------------
+    // parallel_for / parallel_reduce
+    // ----------------------------------------------------------------------------------
+
+    /*
+        Data-parallel loops over the index range [begin, end). The range is handed out
+        in chunks from a shared cursor (guided self-scheduling): early chunks are large,
+        they shrink as the range drains but never below the grain size. One task per
+        pool worker is enqueued into a ConcurrentQueue and the calling thread joins in,
+        so the cost is a handful of tasks per call instead of one task per chunk.
+
+        The function receives a sub-range; the grain is the smallest sub-range worth
+        the scheduling overhead (e.g. "16 scanlines"). Inside a pool task the queue is
+        pinned to the current worker (see ConcurrentQueue) and the loop simply runs
+        on the calling thread.
+
+        Usage example:
+
+            parallel_for(0, height, 16, [&] (size_t y0, size_t y1)
+            {
+                for (size_t y = y0; y < y1; ++y)
+                {
+                    // process scanline y..
+                }
+            });
+
+            u64 sum = parallel_reduce(0, count, 4096, u64(0),
+                [&] (size_t i0, size_t i1)
+                {
+                    u64 s = 0;
+                    for (size_t i = i0; i < i1; ++i)
+                        s += values[i];
+                    return s;
+                },
+                [] (u64 a, u64 b)
+                {
+                    return a + b;
+                });
+
+        The reduction operator must be associative and commutative; the partial
+        results are combined in unspecified order.
+    */
+
+    class ParallelRange : private NonCopyable
+    {
+    protected:
+        alignas(64) std::atomic<size_t> m_next;
+        size_t m_end;
+        size_t m_grain;
+        size_t m_divisor;
+
+    public:
+        ParallelRange(size_t begin, size_t end, size_t grain, size_t workers)
+            : m_next(begin)
+            , m_end(end)
+            , m_grain(std::max(grain, size_t(1)))
+            , m_divisor(std::max(workers, size_t(1)) * 2)
+        {
+        }
+
+        // Claim the next chunk; returns false when the range is exhausted.
+        bool next(size_t& begin, size_t& end)
+        {
+            size_t current = m_next.load(std::memory_order_relaxed);
+
+            for (;;)
+            {
+                if (current >= m_end)
+                {
+                    return false;
+                }
+
+                const size_t remaining = m_end - current;
+                const size_t size = std::min(remaining, std::max(m_grain, remaining / m_divisor));
+
+                if (m_next.compare_exchange_weak(current, current + size, std::memory_order_relaxed))
+                {
+                    begin = current;
+                    end = current + size;
+                    return true;
+                }
+            }
+        }
+    };
+
+    template <typename Function>
+    void parallel_for(ThreadPool& pool, size_t begin, size_t end, size_t grain, Function&& func)
+    {
+        grain = std::max<size_t>(grain, 1);
+
+        if (begin >= end)
+        {
+            return;
+        }
+
+        const size_t workers = size_t(pool.size());
+
+        if (end - begin <= grain || workers < 1)
+        {
+            func(begin, end);
+            return;
+        }
+
+        ParallelRange range(begin, end, grain, workers + 1);
+
+        auto runner = [&range, &func]
+        {
+            size_t b;
+            size_t e;
+
+            while (range.next(b, e))
+            {
+                func(b, e);
+            }
+        };
+
+        ConcurrentQueue q(pool);
+
+        const size_t tasks = std::min(workers, (end - begin + grain - 1) / grain - 1);
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            q.enqueue(runner);
+        }
+
+        runner();
+        q.wait();
+    }
+
+    template <typename Function>
+    void parallel_for(size_t begin, size_t end, size_t grain, Function&& func)
+    {
+        parallel_for(ThreadPool::getInstance(), begin, end, grain, std::forward<Function>(func));
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    T parallel_reduce(ThreadPool& pool, size_t begin, size_t end, size_t grain, const T& identity, Map&& map, Reduce&& reduce)
+    {
+        grain = std::max<size_t>(grain, 1);
+
+        if (begin >= end)
+        {
+            return identity;
+        }
+
+        const size_t workers = size_t(pool.size());
+
+        if (end - begin <= grain || workers < 1)
+        {
+            return reduce(identity, map(begin, end));
+        }
+
+        ParallelRange range(begin, end, grain, workers + 1);
+
+        // one partial result per participant, each on its own cache line
+        struct alignas(64) Partial
+        {
+            T value;
+        };
+
+        const size_t tasks = std::min(workers, (end - begin + grain - 1) / grain - 1);
+        std::vector<Partial> partials(tasks + 1, Partial { identity });
+
+        auto runner = [&range, &map, &reduce] (Partial* partial)
+        {
+            size_t b;
+            size_t e;
+
+            while (range.next(b, e))
+            {
+                partial->value = reduce(partial->value, map(b, e));
+            }
+        };
+
+        ConcurrentQueue q(pool);
+
+        for (size_t i = 0; i < tasks; ++i)
+        {
+            Partial* partial = &partials[i + 1];
+            q.enqueue([&runner, partial]
+            {
+                runner(partial);
+            });
+        }
+
+        runner(&partials[0]);
+        q.wait();
+
+        T result = partials[0].value;
+        for (size_t i = 1; i < partials.size(); ++i)
+        {
+            result = reduce(result, partials[i].value);
+        }
+
+        return result;
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    T parallel_reduce(size_t begin, size_t end, size_t grain, const T& identity, Map&& map, Reduce&& reduce)
+    {
+        return parallel_reduce(ThreadPool::getInstance(), begin, end, grain, identity,
+            std::forward<Map>(map), std::forward<Reduce>(reduce));
+    }
+
 } // namespace mango
@@ -9,6 +9,7 @@
 #include <vector>
 #include <mango/core/configure.hpp>
 #include <mango/core/stream.hpp>
+#include <mango/core/buffer.hpp>
 #include <mango/filesystem/mapper.hpp>
 #include <mango/filesystem/path.hpp>
 
@@ -27,11 +28,12 @@ namespace mango::filesystem
         std::unique_ptr<VirtualMemory> m_virtual_memory;
         ConstMemory m_memory;
 
-        void initMemory(Mapper& mapper);
+        void initMemory(Mapper& mapper, u32 hints);
 
     public:
-        File(const std::string& filename);
-        File(const Path& path, const std::string& filename);
+        // hints: MapHint flags for files on the native filesystem
+        File(const std::string& filename, u32 hints = 0);
+        File(const Path& path, const std::string& filename, u32 hints = 0);
         File(ConstMemory memory, const std::string& extension, const std::string& filename);
         ~File();
 
@@ -52,30 +54,36 @@ namespace mango::filesystem
     // FileStream
     // -----------------------------------------------------------------------
 
-    class FileStream : public Stream
+    // FileStream is buffered; use zero buffer_size for direct system calls. The destructor
+    // writes the buffered data but can't report a failure; call close() to check it.
+
+    class FileStream : public BufferedStream
     {
     protected:
         struct FileHandle* m_handle;
 
+        // unbuffered interface
+        u64 unbufferedSize() const override;
+        u64 unbufferedOffset() const override;
+        u64 unbufferedSeek(s64 distance, SeekMode mode) override;
+        u64 unbufferedRead(void* dest, u64 size) override;
+        u64 unbufferedWrite(const void* data, u64 size) override;
+
     public:
-        FileStream(const std::string& filename, OpenMode mode);
+        FileStream(const std::string& filename, OpenMode mode, size_t buffer_size = default_buffer_size);
         ~FileStream();
 
         const std::string& filename() const;
 
-        // interface
-        u64 size() const override;
-        u64 offset() const override;
-        u64 seek(s64 distance, SeekMode mode) override;
-        u64 read(void* dest, u64 size) override;
-        u64 write(const void* data, u64 size) override;
+        // write the buffered data and close the file; returns false if either failed
+        bool close();
     };
 
     class InputFileStream : public FileStream
     {
     public:
-        InputFileStream(const std::string& filename)
-            : FileStream(filename, Stream::OpenMode::Read)
+        InputFileStream(const std::string& filename, size_t buffer_size = default_buffer_size)
+            : FileStream(filename, Stream::OpenMode::Read, buffer_size)
         {
         }
     };
@@ -83,8 +91,8 @@ namespace mango::filesystem
     class OutputFileStream : public FileStream
     {
     public:
-        OutputFileStream(const std::string& filename)
-            : FileStream(filename, Stream::OpenMode::Write)
+        OutputFileStream(const std::string& filename, size_t buffer_size = default_buffer_size)
+            : FileStream(filename, Stream::OpenMode::Write, buffer_size)
         {
         }
     };
@@ -0,0 +1,80 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <mango/core/configure.hpp>
+#include <mango/core/memory.hpp>
+#include <mango/core/buffer.hpp>
+
+namespace mango::filesystem
+{
+
+    struct FileReadRequest
+    {
+        std::string filename;   // native filesystem path
+        u64 offset = 0;
+        u64 size = 0;           // 0: read to the end of the file into a buffer the reader allocates
+        u8* dest = nullptr;     // caller buffer for size bytes, nullptr: the reader allocates
+    };
+
+    struct FileReadResult
+    {
+        size_t index = 0;                   // index of the request in the batch
+        ConstMemory memory;                 // shorter than requested when the file ends early
+        std::unique_ptr<Buffer> buffer;     // owns the memory when the request had no dest
+        bool status = false;                // false if the file could not be opened or read
+    };
+
+    using FileReadCallback = std::function<void(FileReadResult result)>;
+
+    /*
+        AsyncFileReader keeps a batch of reads in flight so that the I/O is done
+        before the data is decoded instead of page faulting inside the decoding
+        tasks. On Linux the reads are submitted into an io_uring when the kernel
+        supports it; otherwise a set of I/O threads read the files with blocking
+        calls. The callback is called from an I/O thread as each read completes;
+        it should hand the data to the decoding tasks and return quickly.
+
+        AsyncFileReader reader;
+        ConcurrentQueue queue;
+
+        reader.read(requests, [&] (FileReadResult result)
+        {
+            queue.enqueue([result = std::move(result)]
+            {
+                decode(result.memory);
+            });
+        });
+
+        reader.wait();
+        queue.wait();
+    */
+
+    class AsyncFileReader : protected NonCopyable
+    {
+    protected:
+        struct FileReaderState* m_state;
+
+    public:
+        // queue_depth is the number of reads in flight; uring = false forces the I/O threads
+        AsyncFileReader(u32 queue_depth = 64, bool uring = true);
+        ~AsyncFileReader();
+
+        // "io_uring" or "threads"
+        const char* backend() const;
+
+        // Queue a batch of reads. The caller buffers must stay valid until the reads have
+        // completed. The callback is optional when reading into caller buffers.
+        void read(const std::vector<FileReadRequest>& requests, FileReadCallback callback = nullptr);
+
+        // Wait until all queued reads have completed; returns the number of failed reads.
+        size_t wait();
+    };
+
+} // namespace mango::filesystem
@@ -27,6 +27,11 @@ namespace mango::filesystem
         u64         compressed
         u64         uncompressed
         u32         compression method
+        u32         dictionary (0: none, N: dictionaries[N - 1]) (version 2.0)
+
+    Dictionary:
+        u32         size
+        u8[size]    data
 
     Segment:
         u32         block index
@@ -47,6 +52,11 @@ namespace mango::filesystem
         u32         magic: hbs0
         u8[]        data     <-- written by the compressor, a raw binary blob w/o specific size or structure
 
+    Dictionary Array: (version 2.0, optional)
+        u32         magic: hbs4
+        u32         version
+        Dictionary[] dictionaries (zstd)
+
     Block Info Array:
         u32         magic: hbs1
         u32         version
@@ -60,14 +70,18 @@ namespace mango::filesystem
         File[]      files (compressed with zstd)
 
     Index:
+        u64         offset to dictionary array, 0 if there is none (version 2.0)
         u32         magic: hbs3
         u32         version
         u64         offset to block info array
         u64         offset to file info array
+
+    The last 24 bytes of the index are the same in every version so the version
+    can be read before the size of the index is known.
     */
 
     // major = high byte, minor = low byte (1.0 -> 0x0100)
-    constexpr u32 HBS_VERSION = 0x0100;
+    constexpr u32 HBS_VERSION = 0x0200;
 
     enum : u32
     {
@@ -75,6 +89,7 @@ namespace mango::filesystem
         HBS_MAGIC1 = u32_mask('h', 'b', 's', '1'),
         HBS_MAGIC2 = u32_mask('h', 'b', 's', '2'),
         HBS_MAGIC3 = u32_mask('h', 'b', 's', '3'),
+        HBS_MAGIC4 = u32_mask('h', 'b', 's', '4'),
     };
 
     namespace hbs
@@ -85,6 +100,7 @@ namespace mango::filesystem
             u64 compressed;
             u64 uncompressed;
             u32 method;
+            u32 dictionary;
         };
 
         struct File
@@ -102,12 +118,41 @@ namespace mango::filesystem
             std::vector<Segment> segments;
         };
 
+        struct Index
+        {
+            u32 version;
+            u64 dictionary_offset; // 0 if the archive has no dictionaries
+            u64 block_offset;
+            u64 file_offset;
+            u64 index_offset;
+        };
+
+        void writeDictionaryArray(LittleEndianStream& output, const std::vector<ConstMemory>& dictionaries);
         void writeBlockArray(LittleEndianStream& output, const std::vector<Block>& blocks);
         void writeFileArray(LittleEndianStream& output, const std::vector<File>& files);
-        void writeIndex(LittleEndianStream& output, u64 block_offset, u64 file_offset);
+        void writeIndex(LittleEndianStream& output, u64 block_offset, u64 file_offset, u64 dictionary_offset = 0);
+
+        // parses the index at the end of the archive; the returned offsets are validated
+        Index readIndex(ConstMemory archive);
 
+        // the dictionaries point to the memory
+        std::vector<ConstMemory> readDictionaryArray(ConstMemory memory);
         std::vector<Block> readBlockArray(ConstMemory memory);
         std::vector<File> readFileArray(ConstMemory memory);
+
+        // Counters of the decompressed block cache shared by the .hbs mappers. Blocks
+        // holding several small files are decompressed once and cached (bounded by
+        // bytes); a thread waiting for a block another thread is decompressing counts
+        // as a hit.
+        struct CacheStatistics
+        {
+            u64 hits;
+            u64 misses;
+            u64 evictions;
+            u64 bytes; // decompressed bytes currently cached
+        };
+
+        CacheStatistics getCacheStatistics();
     }
 
 } // namespace mango::filesystem
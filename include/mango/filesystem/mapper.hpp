@@ -9,6 +9,7 @@
 #include <vector>
 #include <mango/core/configure.hpp>
 #include <mango/core/memory.hpp>
+#include <mango/core/stream.hpp>
 #include <mango/core/bits.hpp>
 #include <mango/filesystem/hbs.hpp>
 
@@ -99,6 +100,22 @@ namespace mango::filesystem
         std::vector<std::string> matchFilenames(std::string_view pattern, bool case_sensitive = false) const;
     };
 
+    // Access hints for mapping files from the native filesystem. The hints are
+    // advisory; mappers for containers and platforms without support ignore them.
+    struct MapHint
+    {
+        enum Flags : u32
+        {
+            Sequential = 0x00000001, // read front to back; aggressive readahead
+            Random     = 0x00000002, // scattered reads; no readahead
+            WillNeed   = 0x00000004, // populate the mapping before it is returned
+            HugePages  = 0x00000008, // transparent huge pages where the kernel supports them
+            ReadSmall  = 0x00000010, // read files up to small_file_size into memory instead of mapping
+        };
+
+        static constexpr u64 small_file_size = 64 * 1024;
+    };
+
     class AbstractMapper : protected NonCopyable
     {
     public:
@@ -109,7 +126,14 @@ namespace mango::filesystem
         virtual u64 getSize(const std::string& filename) const = 0;
         virtual bool isFile(const std::string& filename) const = 0;
         virtual void getIndex(FileIndex& index, const std::string& pathname) = 0;
-        virtual std::unique_ptr<VirtualMemory> map(const std::string& filename) = 0;
+
+        // hints: MapHint flags
+        virtual std::unique_ptr<VirtualMemory> map(const std::string& filename, u32 hints) = 0;
+
+        // Sequential read access to a file. The default maps the whole file; mappers
+        // which can decompress a file in pieces return a stream that decompresses on
+        // demand as it is read. The stream must not outlive the mapper.
+        virtual std::unique_ptr<Stream> stream(const std::string& filename);
     };
 
     class Mapper : public AbstractMapper
@@ -123,6 +147,8 @@ namespace mango::filesystem
         std::string m_basepath;
         std::string m_pathname;
 
+        bool m_current_is_native { false };
+
         mutable FileIndex m_index;
         mutable bool m_index_is_dirty = true;
 
@@ -146,7 +172,14 @@ namespace mango::filesystem
         u64 getSize(const std::string& filename) const override;
         bool isFile(const std::string& filename) const override;
         void getIndex(FileIndex& index, const std::string& pathname) override;
-        std::unique_ptr<VirtualMemory> map(const std::string& filename) override;
+        std::unique_ptr<VirtualMemory> map(const std::string& filename, u32 hints = 0) override;
+        std::unique_ptr<Stream> stream(const std::string& filename) override;
     };
 
+    // Persistent index cache for ZIP, 7z and RAR archives on the native filesystem.
+    // The parsed index of an archive is stored in the folder and reused by later opens
+    // while the archive's path, size and modification time are unchanged. The cache
+    // is disabled by default; an empty folder disables it.
+    void setIndexCacheFolder(const std::string& folder);
+
 } // namespace mango::filesystem
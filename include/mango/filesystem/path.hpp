@@ -47,6 +47,13 @@ namespace mango::filesystem
             return m_mapper->isFile(filename);
         }
 
+        // Sequential read access (see AbstractMapper::stream); the stream must not
+        // outlive the path.
+        std::unique_ptr<Stream> stream(const std::string& filename) const
+        {
+            return m_mapper->stream(filename);
+        }
+
         const FileIndex& getIndex() const
         {
             return m_mapper->index();
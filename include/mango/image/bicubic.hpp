@@ -12,6 +12,7 @@ namespace mango::image
 
     // NOTE: Experimental function - name could change until this notice is removed.
     // NOTE: The surfaces MUST be 32 bit UNORM RGBA or BGRA
+    // NOTE: See resample() for a general purpose scaler which supports all formats
 
     void u32_bicubic_blit(const Surface& dest, const Surface& source, float x, float y, float xsize, float ysize);
 
@@ -99,6 +99,11 @@ namespace mango::image
         bool simd = true;
         bool multithread = true;
         bool jpeg_colorspace_rgb = false; // assumes channel data is RGB instead of YCbCr
+
+        // Decode at 1/scale of the full resolution (1, 2, 4 or 8) when the codec can do it
+        // cheaper than decoding and resampling, e.g. JPEG with a reduced-size IDCT. Other
+        // codecs decode at full size; header(options) reports the dimensions of the result.
+        int scale = 1;
     };
 
     struct ImageDecodeRect
@@ -110,6 +115,15 @@ namespace mango::image
         float progress;
     };
 
+    // Region of the decoded image (after options.scale) to write into the destination
+    struct ImageDecodeRegion
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
     using ImageDecodeCallback = std::function<void(const ImageDecodeRect& rect)>;
     using ImageDecodeFuture = std::future<ImageDecodeStatus>;
 
@@ -125,21 +139,34 @@ namespace mango::image
         ConstMemory exif;
 
         std::string filename; // not available for memory-only sources
+        std::string codec; // extension of the selected decoder, e.g. ".png"
         std::function<ConstMemory(const std::string& extension)> acquireCompanion;
 
         ImageDecodeInterface() = default;
         virtual ~ImageDecodeInterface() = default;
 
+        virtual ImageHeader getScaledHeader(const ImageDecodeOptions& options) const;
         virtual ImageDecodeStatus decode(const Surface& dest, const ImageDecodeOptions& options, int level, int depth, int face);
+        virtual ImageDecodeStatus decodeRegion(const Surface& dest, const ImageDecodeRegion& region, const ImageDecodeOptions& options, int level, int depth, int face);
         virtual ConstMemory memory(int level, int depth, int face);
         virtual void populateInspect(ImageInspect& report) const;
 
         void clipAndDispatch(const Surface& dest, ImageDecodeRect rect);
     };
 
+    /*
+        The decoder is selected from the content: fixed header signatures are matched
+        first, then the strong probes registered by the codecs. The filename extension
+        is used when the content is not recognized; weak probes (a few plausible header
+        fields) decide only when the extension has no decoder, so the memory-only
+        constructor works for blobs without a (reliable) name. codec() reports the
+        decoder which was selected.
+    */
+
     class ImageDecoder : protected NonCopyable
     {
     public:
+        explicit ImageDecoder(ConstMemory memory);
         ImageDecoder(ConstMemory memory, const std::string& filename);
         ImageDecoder(ConstMemory memory, const filesystem::Path& path, const std::string& filename);
 
@@ -147,9 +174,17 @@ namespace mango::image
 
         bool isDecoder() const;
         bool isAsyncDecoder() const;
+        std::string codec() const;
 
         ImageHeader header();
+        ImageHeader header(const ImageDecodeOptions& options);
         ImageDecodeStatus decode(const Surface& dest, const ImageDecodeOptions& options = ImageDecodeOptions(), int level = 0, int depth = 0, int face = 0);
+
+        // Decode a rectangle of the image into dest (top-left corner). The region is clipped
+        // to the image and the destination. Codecs which can skip the work outside the region
+        // do so (JPEG); the others decode the whole image and copy the region.
+        ImageDecodeStatus decode(const Surface& dest, const ImageDecodeRegion& region, const ImageDecodeOptions& options = ImageDecodeOptions(), int level = 0, int depth = 0, int face = 0);
+
         ImageDecodeFuture launch(ImageDecodeCallback callback, const Surface& dest, const ImageDecodeOptions& options = ImageDecodeOptions(), int level = 0, int depth = 0, int face = 0);
         void cancel();
 
@@ -160,11 +195,24 @@ namespace mango::image
 
         using CreateDecodeFunc = ImageDecodeInterface* (*)(ConstMemory memory);
 
+        // Cheap content check: looks at the first few hundred bytes (or a fixed
+        // trailer) and returns true when the memory is in the codec's format.
+        using ProbeFunc = bool (*)(ConstMemory memory);
+
+        // Strong: a magic number or trailer which overrides the filename extension.
+        // Weak: only plausible field values; used when the extension is unknown.
+        enum class ProbeStrength
+        {
+            Weak,
+            Strong
+        };
+
     protected:
         std::shared_ptr<ImageDecodeInterface> m_interface;
     };
 
     void registerImageDecoder(ImageDecoder::CreateDecodeFunc func, const std::string& extension);
+    void registerImageDecoder(ImageDecoder::CreateDecodeFunc func, ImageDecoder::ProbeFunc probe, ImageDecoder::ProbeStrength strength, const std::string& extension);
     bool isImageDecoder(const std::string& extension);
 
 } // namespace mango::image
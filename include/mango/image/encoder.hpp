@@ -21,6 +21,13 @@ namespace mango::image
         bool direct = false;
     };
 
+    enum class ChromaSubsampling : u8
+    {
+        S444, // full resolution chroma
+        S422, // half horizontal chroma resolution
+        S420, // half horizontal and vertical chroma resolution
+    };
+
     struct ImageEncodeOptions
     {
         ConstMemory icc;          // jpg, png, jp2, jxl
@@ -28,14 +35,19 @@ namespace mango::image
         float quality = 0.90f;    // jpg, jp2, wp2, heif, jxl: [0.0, 1.0]
         int compression = 5;      // png, wp2, jxl: [0, 10]
         bool parallel = true;     // png
+        bool adaptive_filter = false; // png: select scanline filter per row (default: SUB)
+        bool reduce = false;      // png: store in the smallest exact color type and bit depth
         bool dithering = true;    // gif
         bool lossless = false;    // webp, wp2, jp2, heif, jxl
+        ChromaSubsampling subsampling = ChromaSubsampling::S444; // jpg
 
         int astc_block_width = 4;
         int astc_block_height = 4;
 
         bool simd = true;         // jpg
         bool multithread = true;  // jpg, jp2
+        bool optimize = false;    // jpg: two-pass optimized huffman tables
+        bool progressive = false; // jpg: implies optimized huffman tables
     };
 
     class ImageEncoder : protected NonCopyable
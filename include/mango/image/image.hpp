@@ -16,3 +16,4 @@
 #include <mango/image/surface.hpp>
 #include <mango/image/quantize.hpp>
 #include <mango/image/bicubic.hpp>
+#include <mango/image/resample.hpp>
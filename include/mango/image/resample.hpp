@@ -0,0 +1,32 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <mango/core/configure.hpp>
+#include <mango/image/surface.hpp>
+
+namespace mango::image
+{
+
+    enum class ResampleFilter
+    {
+        BOX,        // area average when minifying, nearest when magnifying
+        TRIANGLE,   // bilinear
+        MITCHELL,   // Mitchell-Netravali cubic (B = C = 1/3)
+        LANCZOS,    // Lanczos-3 windowed sinc
+    };
+
+    /*
+        Resample the source surface into the dimensions of the dest surface with a
+        separable filter. Formats where every component has the same size and type
+        (8 or 16 bit UNORM, FLOAT16, FLOAT32 - including luminance formats) are filtered
+        directly when the source and dest formats match; other formats are converted
+        through a temporary bitmap. The color components of sRGB encoded UNORM formats
+        are filtered in linear light when linear is true; alpha is always filtered as is.
+    */
+
+    void resample(const Surface& dest, const Surface& source, ResampleFilter filter = ResampleFilter::LANCZOS, bool linear = false);
+
+} // namespace mango::image
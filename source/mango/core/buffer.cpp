@@ -389,4 +389,167 @@ namespace mango
         return 0;
     }
 
+    // ----------------------------------------------------------------------------
+    // BufferedStream
+    // ----------------------------------------------------------------------------
+
+    BufferedStream::BufferedStream(size_t buffer_size)
+        : m_buffer(buffer_size)
+    {
+    }
+
+    BufferedStream::~BufferedStream()
+    {
+    }
+
+    size_t BufferedStream::bufferSize() const
+    {
+        return m_buffer.size();
+    }
+
+    void BufferedStream::discard()
+    {
+        // move the unbuffered stream back to the logical position
+        const size_t unread = m_read_size - m_read_offset;
+        if (unread)
+        {
+            unbufferedSeek(-s64(unread), SeekMode::Current);
+        }
+
+        m_read_offset = 0;
+        m_read_size = 0;
+    }
+
+    bool BufferedStream::flush()
+    {
+        if (m_read_size)
+        {
+            discard();
+        }
+
+        if (!m_write_size)
+        {
+            return true;
+        }
+
+        const size_t bytes = m_write_size;
+        m_write_size = 0;
+
+        return unbufferedWrite(m_buffer.data(), bytes) == bytes;
+    }
+
+    u64 BufferedStream::size() const
+    {
+        u64 size = unbufferedSize();
+
+        if (m_write_size)
+        {
+            // pending writes can extend the stream
+            size = std::max(size, unbufferedOffset() + m_write_size);
+        }
+
+        return size;
+    }
+
+    u64 BufferedStream::offset() const
+    {
+        return unbufferedOffset() + m_write_size - (m_read_size - m_read_offset);
+    }
+
+    u64 BufferedStream::seek(s64 distance, SeekMode mode)
+    {
+        if (m_write_size)
+        {
+            flush();
+        }
+
+        if (m_read_size)
+        {
+            if (mode == SeekMode::Current)
+            {
+                // seek inside the read buffer without touching the unbuffered stream
+                const s64 position = s64(m_read_offset) + distance;
+                if (position >= 0 && position <= s64(m_read_size))
+                {
+                    m_read_offset = size_t(position);
+                    return offset();
+                }
+
+                distance -= s64(m_read_size - m_read_offset);
+            }
+
+            m_read_offset = 0;
+            m_read_size = 0;
+        }
+
+        return unbufferedSeek(distance, mode);
+    }
+
+    u64 BufferedStream::read(void* dest, u64 bytes)
+    {
+        if (m_write_size && !flush())
+        {
+            return 0;
+        }
+
+        u8* output = reinterpret_cast<u8*>(dest);
+
+        const u64 available = std::min(bytes, u64(m_read_size - m_read_offset));
+        if (available)
+        {
+            std::memcpy(output, m_buffer.data() + m_read_offset, size_t(available));
+            m_read_offset += size_t(available);
+        }
+
+        if (available == bytes)
+        {
+            return bytes;
+        }
+
+        output += available;
+        bytes -= available;
+
+        m_read_offset = 0;
+        m_read_size = 0;
+
+        const size_t capacity = m_buffer.size();
+        if (bytes >= capacity)
+        {
+            return available + unbufferedRead(output, bytes);
+        }
+
+        m_read_size = size_t(unbufferedRead(m_buffer.data(), capacity));
+
+        const size_t n = std::min(size_t(bytes), m_read_size);
+        std::memcpy(output, m_buffer.data(), n);
+        m_read_offset = n;
+
+        return available + n;
+    }
+
+    u64 BufferedStream::write(const void* data, u64 bytes)
+    {
+        if (m_read_size)
+        {
+            discard();
+        }
+
+        const size_t capacity = m_buffer.size();
+
+        if (m_write_size + bytes > capacity && !flush())
+        {
+            return 0;
+        }
+
+        if (bytes >= capacity)
+        {
+            return unbufferedWrite(data, bytes);
+        }
+
+        std::memcpy(m_buffer.data() + m_write_size, data, size_t(bytes));
+        m_write_size += size_t(bytes);
+
+        return bytes;
+    }
+
 } // namespace mango
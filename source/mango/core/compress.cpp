@@ -4,6 +4,7 @@
 */
 
 #include <vector>
+#include <mutex>
 
 #include <mango/core/compress.hpp>
 #include <mango/core/exception.hpp>
@@ -11,6 +12,7 @@
 #include <mango/core/bits.hpp>
 #include <mango/core/endian.hpp>
 #include <mango/core/pointer.hpp>
+#include <mango/core/thread.hpp>
 #include <mango/math/math.hpp>
 
 #include <zlib.h>
@@ -22,6 +24,7 @@
 
 #define ZSTD_DISABLE_DEPRECATE_WARNINGS
 #include <zstd.h>
+#include <zdict.h>
 
 #if defined(MANGO_ENABLE_LZ4)
     #include <lz4.h>
@@ -106,49 +109,98 @@ namespace lz4
         return LZ4_compressBound(s);
     }
 
-    CompressionStatus compress(Memory dest, ConstMemory source, int level)
+    class ContextLZ4 : public CompressionContext
     {
-        const int source_size = int(source.size);
-        const int dest_size = int(dest.size);
-
-        CompressionStatus status;
+    protected:
+        // the compression state is allocated on first use and reused after that
+        Buffer m_state;
+        Buffer m_state_hc;
 
-        level = math::clamp(level, 0, 10);
+    public:
+        ContextLZ4()
+        {
+        }
 
-        if (level > 6)
+        ~ContextLZ4()
         {
-            const int compression_level = 1 + (level - 7) * 5;
-            status.size = LZ4_compress_HC(source.cast<const char>(), dest.cast<char>(), source_size, dest_size, compression_level);
         }
-        else
+
+        CompressionStatus compress(Memory dest, ConstMemory source, int level) override
         {
-            const int acceleration = 19 - level * 3;
-            status.size = LZ4_compress_fast(source.cast<const char>(), dest.cast<char>(), source_size, dest_size, acceleration);
+            const int source_size = int(source.size);
+            const int dest_size = int(dest.size);
+
+            CompressionStatus status;
+
+            level = math::clamp(level, 0, 10);
+
+            if (level > 6)
+            {
+                if (!m_state_hc.size())
+                {
+                    m_state_hc.resize(LZ4_sizeofStateHC());
+                }
+
+                const int compression_level = 1 + (level - 7) * 5;
+                status.size = LZ4_compress_HC_extStateHC(m_state_hc.data(), source.cast<const char>(), dest.cast<char>(), source_size, dest_size, compression_level);
+            }
+            else
+            {
+                if (!m_state.size())
+                {
+                    m_state.resize(LZ4_sizeofState());
+                }
+
+                const int acceleration = 19 - level * 3;
+                status.size = LZ4_compress_fast_extState(m_state.data(), source.cast<const char>(), dest.cast<char>(), source_size, dest_size, acceleration);
+            }
+
+            if (status.size > dest.size)
+            {
+                status.setError("[lz4] compression failed.");
+            }
+
+            return status;
         }
 
-	    if (status.size > dest.size)
+        CompressionStatus decompress(Memory dest, ConstMemory source) override
         {
-            status.setError("[lz4] compression failed.");
+            CompressionStatus status;
+
+            int result = LZ4_decompress_safe(source.cast<const char>(), dest.cast<char>(), int(source.size), int(dest.size));
+            if (result < 0)
+            {
+                status.setError("[lz4] decompression failed.");
+            }
+            else
+            {
+                status.size = size_t(result);
+            }
+
+            return status;
         }
+    };
 
-        return status;
+    static
+    ContextLZ4& getThreadContext()
+    {
+        thread_local ContextLZ4 context;
+        return context;
     }
 
-    CompressionStatus decompress(Memory dest, ConstMemory source)
+    CompressionStatus compress(Memory dest, ConstMemory source, int level)
     {
-        CompressionStatus status;
+        return getThreadContext().compress(dest, source, level);
+    }
 
-        int result = LZ4_decompress_safe(source.cast<const char>(), dest.cast<char>(), int(source.size), int(dest.size));
-        if (result < 0)
-        {
-            status.setError("[lz4] decompression failed.");
-        }
-        else
-        {
-            status.size = size_t(result);
-        }
+    CompressionStatus decompress(Memory dest, ConstMemory source)
+    {
+        return getThreadContext().decompress(dest, source);
+    }
 
-        return status;
+    std::shared_ptr<CompressionContext> createContext()
+    {
+        return std::make_shared<ContextLZ4>();
     }
 
     // stream
@@ -293,46 +345,180 @@ namespace zstd
         return ZSTD_compressBound(size) + turbo;
     }
 
-    CompressionStatus compress(Memory dest, ConstMemory source, int level)
+    class ContextZSTD : public CompressionContext
     {
-        CompressionStatus status;
+    protected:
+        // the contexts are allocated on first use and reused after that
+        ZSTD_CCtx* m_cctx = nullptr;
+        ZSTD_DCtx* m_dctx = nullptr;
+
+        // workspace size that is kept for reuse between compress calls
+        static constexpr size_t max_cached_workspace = 16 * 1024 * 1024;
 
-        // zstd compress does not support encoding of empty source
-        if (source.size)
+    public:
+        ContextZSTD()
         {
-            level = math::clamp(level * 2, 1, 20);
+        }
+
+        ~ContextZSTD()
+        {
+            ZSTD_freeCCtx(m_cctx);
+            ZSTD_freeDCtx(m_dctx);
+        }
+
+        CompressionStatus compress(Memory dest, ConstMemory source, int level) override
+        {
+            CompressionStatus status;
+
+            // zstd compress does not support encoding of empty source
+            if (source.size)
+            {
+                if (!m_cctx)
+                {
+                    m_cctx = ZSTD_createCCtx();
+                    if (!m_cctx)
+                    {
+                        status.setError("[zstd] ZSTD_createCCtx() failed.");
+                        return status;
+                    }
+                }
 
-            const size_t x = ZSTD_compress(dest.address, dest.size,
-                                        source.address, source.size, level);
+                level = math::clamp(level * 2, 1, 20);
+
+                const size_t x = ZSTD_compressCCtx(m_cctx, dest.address, dest.size,
+                                                   source.address, source.size, level);
+
+                if (ZSTD_isError(x))
+                {
+                    status.setError("[zstd] {}", ZSTD_getErrorName(x));
+                }
+
+                status.size = x;
+
+                // the high levels grow the workspace to tens of megabytes; don't let every
+                // thread keep the largest one it has ever used
+                if (ZSTD_sizeof_CCtx(m_cctx) > max_cached_workspace)
+                {
+                    ZSTD_freeCCtx(m_cctx);
+                    m_cctx = nullptr;
+                }
+            }
+
+            return status;
+        }
+
+        CompressionStatus decompress(Memory dest, ConstMemory source) override
+        {
+            CompressionStatus status;
+
+            if (!m_dctx)
+            {
+                m_dctx = ZSTD_createDCtx();
+                if (!m_dctx)
+                {
+                    status.setError("[zstd] ZSTD_createDCtx() failed.");
+                    return status;
+                }
+            }
+
+            size_t x = ZSTD_decompressDCtx(m_dctx, (void*)dest.address, dest.size,
+                                           source.address, source.size);
 
             if (ZSTD_isError(x))
             {
                 status.setError("[zstd] {}", ZSTD_getErrorName(x));
             }
+            else
+            {
+                status.size = x;
+            }
 
-            status.size = x;
+            return status;
         }
 
-        return status;
-    }
+        CompressionStatus compress(Memory dest, ConstMemory source, const ZSTD_CDict* dictionary)
+        {
+            CompressionStatus status;
 
-    CompressionStatus decompress(Memory dest, ConstMemory source)
-    {
-        size_t x = ZSTD_decompress((void*)dest.address, dest.size,
-                                   source.address, source.size);
+            if (!m_cctx)
+            {
+                m_cctx = ZSTD_createCCtx();
+                if (!m_cctx)
+                {
+                    status.setError("[zstd] ZSTD_createCCtx() failed.");
+                    return status;
+                }
+            }
 
-        CompressionStatus status;
+            const size_t x = ZSTD_compress_usingCDict(m_cctx, dest.address, dest.size,
+                                                      source.address, source.size, dictionary);
 
-        if (ZSTD_isError(x))
-        {
-            status.setError("[zstd] {}", ZSTD_getErrorName(x));
+            if (ZSTD_isError(x))
+            {
+                status.setError("[zstd] {}", ZSTD_getErrorName(x));
+            }
+            else
+            {
+                status.size = x;
+            }
+
+            return status;
         }
-        else
+
+        CompressionStatus decompress(Memory dest, ConstMemory source, const ZSTD_DDict* dictionary)
         {
-            status.size = x;
+            CompressionStatus status;
+
+            if (!m_dctx)
+            {
+                m_dctx = ZSTD_createDCtx();
+                if (!m_dctx)
+                {
+                    status.setError("[zstd] ZSTD_createDCtx() failed.");
+                    return status;
+                }
+            }
+
+            const size_t x = ZSTD_decompress_usingDDict(m_dctx, dest.address, dest.size,
+                                                        source.address, source.size, dictionary);
+
+            if (ZSTD_isError(x))
+            {
+                status.setError("[zstd] {}", ZSTD_getErrorName(x));
+            }
+            else
+            {
+                status.size = x;
+            }
+
+            return status;
         }
+    };
 
-        return status;
+    // Each thread keeps its contexts until the thread exits; the thread_local destructor
+    // frees them. The compression workspace is only kept when it is small enough, so the
+    // long-lived pool workers don't each hold on to a high-level workspace.
+
+    static
+    ContextZSTD& getThreadContext()
+    {
+        thread_local ContextZSTD context;
+        return context;
+    }
+
+    CompressionStatus compress(Memory dest, ConstMemory source, int level)
+    {
+        return getThreadContext().compress(dest, source, level);
+    }
+
+    CompressionStatus decompress(Memory dest, ConstMemory source)
+    {
+        return getThreadContext().decompress(dest, source);
+    }
+
+    std::shared_ptr<CompressionContext> createContext()
+    {
+        return std::make_shared<ContextZSTD>();
     }
 
     // stream
@@ -437,6 +623,387 @@ namespace zstd
         return std::make_shared<StreamDecoderZSTD>();
     }
 
+    // seekable
+
+    // https://github.com/facebook/zstd/blob/dev/contrib/seekable_format/zstd_seekable_compression_format.md
+
+    constexpr u32 SKIPPABLE_MAGIC = 0x184d2a5e;
+    constexpr u32 SEEKABLE_MAGIC = 0x8f92eab1;
+    constexpr size_t SEEKABLE_FOOTER_SIZE = 9;
+    constexpr size_t SEEKABLE_DEFAULT_FRAME = 1024 * 1024;
+
+    // a zstd block of 4 bytes (header + RLE byte) decodes to at most 128 KB
+    constexpr u64 ZSTD_MAX_EXPANSION = 32768;
+
+    static
+    size_t get_frame_size(size_t frame_size)
+    {
+        // the seek table stores sizes with 32 bits
+        return frame_size ? std::min<size_t>(frame_size, 1u << 30) : SEEKABLE_DEFAULT_FRAME;
+    }
+
+    static
+    size_t get_seek_table_size(size_t frames)
+    {
+        return 8 + frames * 8 + SEEKABLE_FOOTER_SIZE;
+    }
+
+    size_t bound_seekable(size_t size, size_t frame_size)
+    {
+        frame_size = get_frame_size(frame_size);
+        const size_t frames = (size + frame_size - 1) / frame_size;
+        return frames * ZSTD_compressBound(frame_size) + get_seek_table_size(frames);
+    }
+
+    CompressionStatus compress_seekable(Memory dest, ConstMemory source, int level, size_t frame_size)
+    {
+        CompressionStatus status;
+
+        frame_size = get_frame_size(frame_size);
+
+        const size_t frames = (source.size + frame_size - 1) / frame_size;
+        const size_t frame_bound = ZSTD_compressBound(frame_size);
+
+        if (dest.size < bound_seekable(source.size, frame_size))
+        {
+            status.setError("[zstd] Insufficient space.");
+            return status;
+        }
+
+        // compress each frame into its own slot of the destination buffer
+        std::vector<size_t> sizes(frames);
+        std::atomic<bool> failure { false };
+
+        ConcurrentQueue q("zstd.compress");
+
+        for (size_t i = 0; i < frames; ++i)
+        {
+            q.enqueue([=, &sizes, &failure]
+            {
+                const size_t offset = i * frame_size;
+                ConstMemory input(source.address + offset, std::min(frame_size, source.size - offset));
+                Memory output(dest.address + i * frame_bound, frame_bound);
+
+                CompressionStatus result = getThreadContext().compress(output, input, level);
+                if (!result)
+                {
+                    failure = true;
+                }
+
+                sizes[i] = result.size;
+            });
+        }
+
+        q.wait();
+
+        if (failure)
+        {
+            status.setError("[zstd] Frame compression failed.");
+            return status;
+        }
+
+        // compact the frames; the slots are traversed in order so the moves never overlap
+        // data which has not been moved yet
+        LittleEndianPointer p = dest.address;
+
+        for (size_t i = 0; i < frames; ++i)
+        {
+            std::memmove(p, dest.address + i * frame_bound, sizes[i]);
+            p += sizes[i];
+        }
+
+        // seek table
+        p.write32(SKIPPABLE_MAGIC);
+        p.write32(u32(get_seek_table_size(frames) - 8));
+
+        for (size_t i = 0; i < frames; ++i)
+        {
+            p.write32(u32(sizes[i]));
+            p.write32(u32(std::min(frame_size, source.size - i * frame_size)));
+        }
+
+        p.write32(u32(frames));
+        p.write8(0); // descriptor: no checksums
+        p.write32(SEEKABLE_MAGIC);
+
+        status.size = p - dest.address;
+        return status;
+    }
+
+    CompressionStatus decompress_seekable(Memory dest, ConstMemory source)
+    {
+        SeekableDecoder decoder(source);
+
+        if (!decoder.isSeekable())
+        {
+            // regular zstd stream
+            return decompress(dest, source);
+        }
+
+        // the destination can be larger than the decompressed data
+        return decoder.read(Memory(dest.address, size_t(std::min<u64>(dest.size, decoder.size()))), 0);
+    }
+
+    SeekableDecoder::SeekableDecoder(ConstMemory memory)
+        : m_memory(memory)
+    {
+        if (memory.size < get_seek_table_size(0))
+        {
+            return;
+        }
+
+        LittleEndianConstPointer p = memory.end() - SEEKABLE_FOOTER_SIZE;
+
+        const u32 frames = p.read32();
+        const u8 descriptor = p.read8();
+        const u32 magic = p.read32();
+
+        if (magic != SEEKABLE_MAGIC || (descriptor & 0x7c))
+        {
+            return;
+        }
+
+        const size_t entry_size = (descriptor & 0x80) ? 12 : 8;
+        const u64 table_size = 8 + u64(frames) * entry_size + SEEKABLE_FOOTER_SIZE;
+
+        if (table_size > memory.size)
+        {
+            return;
+        }
+
+        p = memory.end() - table_size;
+
+        const u32 skippable = p.read32();
+        const u32 skippable_size = p.read32();
+
+        if (skippable != SKIPPABLE_MAGIC || skippable_size != table_size - 8)
+        {
+            return;
+        }
+
+        const u64 data_size = memory.size - table_size;
+
+        std::vector<Frame> table(frames);
+
+        u64 compressed_offset = 0;
+        u64 offset = 0;
+
+        for (Frame& frame : table)
+        {
+            frame.compressed_offset = compressed_offset;
+            frame.offset = offset;
+            frame.compressed_size = p.read32();
+            frame.size = p.read32();
+            p += entry_size - 8; // skip checksum
+
+            compressed_offset += frame.compressed_size;
+            offset += frame.size;
+        }
+
+        if (compressed_offset != data_size)
+        {
+            return;
+        }
+
+        m_frames = std::move(table);
+        m_size = offset;
+        m_valid = true;
+    }
+
+    SeekableDecoder::~SeekableDecoder()
+    {
+    }
+
+    bool SeekableDecoder::isSeekable() const
+    {
+        return m_valid;
+    }
+
+    u64 SeekableDecoder::size() const
+    {
+        return m_size;
+    }
+
+    CompressionStatus SeekableDecoder::read(Memory dest, u64 offset) const
+    {
+        CompressionStatus status;
+
+        if (!isSeekable())
+        {
+            status.setError("[zstd] Missing seek table.");
+            return status;
+        }
+
+        if (offset > m_size || dest.size > m_size - offset)
+        {
+            status.setError("[zstd] Read out of range.");
+            return status;
+        }
+
+        const u64 end = offset + dest.size;
+
+        // first frame which ends after the offset
+        auto first = std::upper_bound(m_frames.begin(), m_frames.end(), offset, [] (u64 value, const Frame& frame)
+        {
+            return value < frame.offset + frame.size;
+        });
+
+        std::atomic<bool> failure { false };
+
+        ConcurrentQueue q("zstd.decompress");
+
+        for (auto i = first; i != m_frames.end() && i->offset < end; ++i)
+        {
+            const Frame& frame = *i;
+
+            q.enqueue([=, this, &frame, &failure]
+            {
+                ConstMemory input(m_memory.address + frame.compressed_offset, frame.compressed_size);
+
+                // the seek table is not trusted: the frame header must agree with it
+                const unsigned long long content = ZSTD_getFrameContentSize(input.address, input.size);
+                if (content == ZSTD_CONTENTSIZE_ERROR ||
+                    (content != ZSTD_CONTENTSIZE_UNKNOWN && content != frame.size) ||
+                    frame.size > u64(frame.compressed_size) * ZSTD_MAX_EXPANSION)
+                {
+                    failure = true;
+                    return;
+                }
+
+                const u64 x0 = std::max(offset, frame.offset);
+                const u64 x1 = std::min(end, frame.offset + frame.size);
+                u8* output = dest.address + (x0 - offset);
+
+                CompressionStatus result;
+
+                if (x0 == frame.offset && x1 == frame.offset + frame.size)
+                {
+                    // the whole frame is inside the range
+                    result = getThreadContext().decompress(Memory(output, frame.size), input);
+                }
+                else
+                {
+                    Buffer temp(frame.size);
+                    result = getThreadContext().decompress(temp, input);
+                    std::memcpy(output, temp.data() + (x0 - frame.offset), size_t(x1 - x0));
+                }
+
+                if (!result || result.size != frame.size)
+                {
+                    failure = true;
+                }
+            });
+        }
+
+        q.wait();
+
+        if (failure)
+        {
+            status.setError("[zstd] Frame decompression failed.");
+            return status;
+        }
+
+        status.size = dest.size;
+        return status;
+    }
+
+    // dictionary
+
+    CompressionStatus train(Memory dictionary, ConstMemory samples, const std::vector<size_t>& sample_sizes)
+    {
+        CompressionStatus status;
+
+        const size_t x = ZDICT_trainFromBuffer(dictionary.address, dictionary.size, samples.address,
+                                               sample_sizes.data(), unsigned(sample_sizes.size()));
+
+        if (ZDICT_isError(x))
+        {
+            status.setError("[zstd] {}", ZDICT_getErrorName(x));
+        }
+        else
+        {
+            status.size = x;
+        }
+
+        return status;
+    }
+
+    struct Dictionary::State
+    {
+        Buffer memory;
+        int level;
+
+        // the digested dictionaries are created on first use
+        std::once_flag cdict_once;
+        std::once_flag ddict_once;
+        ZSTD_CDict* cdict = nullptr;
+        ZSTD_DDict* ddict = nullptr;
+
+        State(ConstMemory memory, int level)
+            : memory(memory)
+            , level(level)
+        {
+        }
+
+        ~State()
+        {
+            ZSTD_freeCDict(cdict);
+            ZSTD_freeDDict(ddict);
+        }
+    };
+
+    Dictionary::Dictionary(ConstMemory memory, int level)
+        : m_state(std::make_unique<State>(memory, math::clamp(level * 2, 1, 20)))
+    {
+    }
+
+    Dictionary::~Dictionary()
+    {
+    }
+
+    ConstMemory Dictionary::memory() const
+    {
+        return m_state->memory;
+    }
+
+    CompressionStatus Dictionary::compress(Memory dest, ConstMemory source) const
+    {
+        State& state = *m_state;
+
+        std::call_once(state.cdict_once, [&state]
+        {
+            state.cdict = ZSTD_createCDict(state.memory.data(), state.memory.size(), state.level);
+        });
+
+        if (!state.cdict)
+        {
+            CompressionStatus status;
+            status.setError("[zstd] Incorrect dictionary.");
+            return status;
+        }
+
+        return getThreadContext().compress(dest, source, state.cdict);
+    }
+
+    CompressionStatus Dictionary::decompress(Memory dest, ConstMemory source) const
+    {
+        State& state = *m_state;
+
+        std::call_once(state.ddict_once, [&state]
+        {
+            state.ddict = ZSTD_createDDict(state.memory.data(), state.memory.size());
+        });
+
+        if (!state.ddict)
+        {
+            CompressionStatus status;
+            status.setError("[zstd] Incorrect dictionary.");
+            return status;
+        }
+
+        return getThreadContext().decompress(dest, source, state.ddict);
+    }
+
 } // namespace zstd
 
 // ----------------------------------------------------------------------------
@@ -719,7 +1286,7 @@ namespace lzma
         props.lp = 0; // [0, 4] (default: 0)
         props.pb = 2; // [0, 4] (default: 2)
         props.fb = 32; // [5, 273] (default: 32)
-        props.numThreads = 1;
+        props.numThreads = 2; // multi-threaded match finder; does not change the output
 
         u8* start = dest.address;
 
@@ -1053,43 +1620,140 @@ namespace deflate
         return error;
     }
 
-    size_t bound(size_t size)
+    // The raw deflate, zlib and gzip wrappers share the same libdeflate state; the
+    // compressor is allocated for one compression level at a time and re-allocated
+    // only when the level changes.
+
+    enum class Wrapper
     {
-        return libdeflate_deflate_compress_bound(nullptr, size);
-    }
+        DEFLATE,
+        ZLIB,
+        GZIP,
+    };
 
-    CompressionStatus compress(Memory dest, ConstMemory source, int level)
+    class ContextDeflate : public CompressionContext
     {
-        level = math::clamp(level, 1, 10);
-        if (level >= 8) level = (level * 12) / 10;
+    protected:
+        Wrapper m_wrapper;
+        libdeflate_compressor* m_compressor = nullptr;
+        libdeflate_decompressor* m_decompressor = nullptr;
+        int m_level = 0;
+
+    public:
+        ContextDeflate(Wrapper wrapper)
+            : m_wrapper(wrapper)
+        {
+        }
 
-        libdeflate_compressor* compressor = libdeflate_alloc_compressor(level);
-        size_t bytes_out = libdeflate_deflate_compress(compressor, source, source.size, dest, dest.size);
-        libdeflate_free_compressor(compressor);
+        ~ContextDeflate()
+        {
+            libdeflate_free_compressor(m_compressor);
+            libdeflate_free_decompressor(m_decompressor);
+        }
 
-        CompressionStatus status;
-        status.size = bytes_out;
-        return status;
-    }
+        void setWrapper(Wrapper wrapper)
+        {
+            m_wrapper = wrapper;
+        }
 
-    CompressionStatus decompress(Memory dest, ConstMemory source)
-    {
-        libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
+        CompressionStatus compress(Memory dest, ConstMemory source, int level) override
+        {
+            level = math::clamp(level, 1, 10);
+            if (level >= 8) level = (level * 12) / 10;
 
-        size_t bytes_out = 0;
-        libdeflate_result result = libdeflate_deflate_decompress(decompressor, source, source.size, dest, dest.size, &bytes_out);
-        libdeflate_free_decompressor(decompressor);
+            if (!m_compressor || m_level != level)
+            {
+                libdeflate_free_compressor(m_compressor);
+                m_compressor = libdeflate_alloc_compressor(level);
+                m_level = level;
+            }
 
-        CompressionStatus status;
+            size_t bytes_out = 0;
 
-        const char* error = deflate::get_error_string(result);
-        if (error)
+            switch (m_wrapper)
+            {
+                case Wrapper::DEFLATE:
+                    bytes_out = libdeflate_deflate_compress(m_compressor, source, source.size, dest, dest.size);
+                    break;
+                case Wrapper::ZLIB:
+                    bytes_out = libdeflate_zlib_compress(m_compressor, source, source.size, dest, dest.size);
+                    break;
+                case Wrapper::GZIP:
+                    bytes_out = libdeflate_gzip_compress(m_compressor, source, source.size, dest, dest.size);
+                    break;
+            }
+
+            CompressionStatus status;
+            status.size = bytes_out;
+            return status;
+        }
+
+        CompressionStatus decompress(Memory dest, ConstMemory source) override
         {
-            status.setError("[deflate] {}.", error);
+            if (!m_decompressor)
+            {
+                m_decompressor = libdeflate_alloc_decompressor();
+            }
+
+            size_t bytes_out = 0;
+            libdeflate_result result = LIBDEFLATE_SUCCESS;
+            const char* name = nullptr;
+
+            switch (m_wrapper)
+            {
+                case Wrapper::DEFLATE:
+                    result = libdeflate_deflate_decompress(m_decompressor, source, source.size, dest, dest.size, &bytes_out);
+                    name = "deflate";
+                    break;
+                case Wrapper::ZLIB:
+                    result = libdeflate_zlib_decompress(m_decompressor, source, source.size, dest, dest.size, &bytes_out);
+                    name = "deflate.zlib";
+                    break;
+                case Wrapper::GZIP:
+                    result = libdeflate_gzip_decompress(m_decompressor, source, source.size, dest, dest.size, &bytes_out);
+                    name = "deflate.gzip";
+                    break;
+            }
+
+            CompressionStatus status;
+
+            const char* error = get_error_string(result);
+            if (error)
+            {
+                status.setError("[{}] {}.", name, error);
+            }
+
+            status.size = bytes_out;
+            return status;
         }
+    };
 
-        status.size = bytes_out;
-        return status;
+    static
+    ContextDeflate& getThreadContext(Wrapper wrapper)
+    {
+        thread_local ContextDeflate context(Wrapper::DEFLATE);
+        context.setWrapper(wrapper);
+        return context;
+    }
+
+    size_t bound(size_t size)
+    {
+        return libdeflate_deflate_compress_bound(nullptr, size);
+    }
+
+    CompressionStatus compress(Memory dest, ConstMemory source, int level)
+    {
+        return getThreadContext(Wrapper::DEFLATE).compress(dest, source, level);
+    }
+
+    CompressionStatus decompress(Memory dest, ConstMemory source)
+    {
+        return getThreadContext(Wrapper::DEFLATE).decompress(dest, source);
+    }
+
+    std::shared_ptr<CompressionContext> createContext()
+    {
+        return std::make_shared<ContextDeflate>(Wrapper::DEFLATE);
     }
 
 } // namespace deflate
@@ -1108,36 +1772,17 @@ namespace deflate_zlib
 
     CompressionStatus compress(Memory dest, ConstMemory source, int level)
     {
-        level = math::clamp(level, 1, 10);
-        if (level >= 8) level = (level * 12) / 10;
-
-        libdeflate_compressor* compressor = libdeflate_alloc_compressor(level);
-        size_t bytes_out = libdeflate_zlib_compress(compressor, source, source.size, dest, dest.size);
-        libdeflate_free_compressor(compressor);
-
-        CompressionStatus status;
-        status.size = bytes_out;
-        return status;
+        return deflate::getThreadContext(deflate::Wrapper::ZLIB).compress(dest, source, level);
     }
 
     CompressionStatus decompress(Memory dest, ConstMemory source)
     {
-        libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
-
-        size_t bytes_out = 0;
-        libdeflate_result result = libdeflate_zlib_decompress(decompressor, source, source.size, dest, dest.size, &bytes_out);
-        libdeflate_free_decompressor(decompressor);
-
-        CompressionStatus status;
-
-        const char* error = deflate::get_error_string(result);
-        if (error)
-        {
-            status.setError("[deflate.zlib] {}.", error);
-        }
+        return deflate::getThreadContext(deflate::Wrapper::ZLIB).decompress(dest, source);
+    }
 
-        status.size = bytes_out;
-        return status;
+    std::shared_ptr<CompressionContext> createContext()
+    {
+        return std::make_shared<deflate::ContextDeflate>(deflate::Wrapper::ZLIB);
     }
 
 } // namespace deflate_zlib
@@ -1156,36 +1801,17 @@ namespace deflate_gzip
 
     CompressionStatus compress(Memory dest, ConstMemory source, int level)
     {
-        level = math::clamp(level, 1, 10);
-        if (level >= 8) level = (level * 12) / 10;
-
-        libdeflate_compressor* compressor = libdeflate_alloc_compressor(level);
-        size_t bytes_out = libdeflate_gzip_compress(compressor, source, source.size, dest, dest.size);
-        libdeflate_free_compressor(compressor);
-
-        CompressionStatus status;
-        status.size = bytes_out;
-        return status;
+        return deflate::getThreadContext(deflate::Wrapper::GZIP).compress(dest, source, level);
     }
 
     CompressionStatus decompress(Memory dest, ConstMemory source)
     {
-        libdeflate_decompressor* decompressor = libdeflate_alloc_decompressor();
-
-        size_t bytes_out = 0;
-        libdeflate_result result = libdeflate_gzip_decompress(decompressor, source, source.size, dest, dest.size, &bytes_out);
-        libdeflate_free_decompressor(decompressor);
-
-        CompressionStatus status;
-
-        const char* error = deflate::get_error_string(result);
-        if (error)
-        {
-            status.setError("[deflate.gzip] {}.", error);
-        }
+        return deflate::getThreadContext(deflate::Wrapper::GZIP).decompress(dest, source);
+    }
 
-        status.size = bytes_out;
-        return status;
+    std::shared_ptr<CompressionContext> createContext()
+    {
+        return std::make_shared<deflate::ContextDeflate>(deflate::Wrapper::GZIP);
     }
 
 } // namespace deflate_gzip
@@ -1451,35 +2077,66 @@ namespace isal
 
 } // namespace isal
 
+    // ----------------------------------------------------------------------------
+    // CompressionContext
+    // ----------------------------------------------------------------------------
+
+    // The compressors which do not have reusable state use the compression functions as-is.
+
+    template <auto Compress, auto Decompress>
+    class ContextStateless : public CompressionContext
+    {
+    public:
+        CompressionStatus compress(Memory dest, ConstMemory source, int level) override
+        {
+            return Compress(dest, source, level);
+        }
+
+        CompressionStatus decompress(Memory dest, ConstMemory source) override
+        {
+            return Decompress(dest, source);
+        }
+    };
+
+    template <auto Compress, auto Decompress>
+    std::shared_ptr<CompressionContext> createStatelessContext()
+    {
+        return std::make_shared<ContextStateless<Compress, Decompress>>();
+    }
+
+    // ----------------------------------------------------------------------------
+    // Compressor
+    // ----------------------------------------------------------------------------
+
     const std::vector<Compressor> g_compressors =
     {
-        { Compressor::NONE,         "none",         nocompress::bound,   nocompress::compress,   nocompress::decompress },
+        { Compressor::NONE,         "none",         nocompress::bound,   nocompress::compress,   nocompress::decompress,   createStatelessContext<nocompress::compress, nocompress::decompress> },
         // required
-        { Compressor::ZSTD,         "zstd",         zstd::bound,         zstd::compress,         zstd::decompress },
-        { Compressor::ZLIB,         "zlib",         zlib::bound,         zlib::compress,         zlib::decompress },
-        { Compressor::DEFLATE,      "deflate",      deflate::bound,      deflate::compress,      deflate::decompress },
+        { Compressor::ZSTD,         "zstd",         zstd::bound,         zstd::compress,         zstd::decompress,         zstd::createContext },
+        { Compressor::ZLIB,         "zlib",         zlib::bound,         zlib::compress,         zlib::decompress,         createStatelessContext<zlib::compress, zlib::decompress> },
+        { Compressor::DEFLATE,      "deflate",      deflate::bound,      deflate::compress,      deflate::decompress,      deflate::createContext },
         /* These are not listed on purpose; they exist for zlib compatibility but not for public API usage
-        { Compressor::DEFLATE_ZLIB, "deflate.zlib", deflate_zlib::bound, deflate_zlib::compress, deflate_zlib::decompress },
-        { Compressor::DEFLATE_GZIP, "deflate.gzip", deflate_gzip::bound, deflate_gzip::compress, deflate_gzip::decompress },
+        { Compressor::DEFLATE_ZLIB, "deflate.zlib", deflate_zlib::bound, deflate_zlib::compress, deflate_zlib::decompress, deflate_zlib::createContext },
+        { Compressor::DEFLATE_GZIP, "deflate.gzip", deflate_gzip::bound, deflate_gzip::compress, deflate_gzip::decompress, deflate_gzip::createContext },
         */
-        { Compressor::LZAV,         "lzav",         lzav::bound,         lzav::compress,         lzav::decompress },
+        { Compressor::LZAV,         "lzav",         lzav::bound,         lzav::compress,         lzav::decompress,         createStatelessContext<lzav::compress, lzav::decompress> },
         // optional
 #if defined(MANGO_ENABLE_BZIP2)
-        { Compressor::BZIP2,        "bzip2",        bzip2::bound,        bzip2::compress,        bzip2::decompress },
+        { Compressor::BZIP2,        "bzip2",        bzip2::bound,        bzip2::compress,        bzip2::decompress,        createStatelessContext<bzip2::compress, bzip2::decompress> },
 #endif
 #if defined(MANGO_ENABLE_LZ4)
-        { Compressor::LZ4,          "lz4",          lz4::bound,          lz4::compress,          lz4::decompress },
+        { Compressor::LZ4,          "lz4",          lz4::bound,          lz4::compress,          lz4::decompress,          lz4::createContext },
 #endif
 #if defined(MANGO_ENABLE_LZFSE)
-        { Compressor::LZFSE,        "lzfse",        lzfse::bound,        lzfse::compress,        lzfse::decompress },
+        { Compressor::LZFSE,        "lzfse",        lzfse::bound,        lzfse::compress,        lzfse::decompress,        createStatelessContext<lzfse::compress, lzfse::decompress> },
 #endif
 #if defined(MANGO_ENABLE_LZMA)
-        { Compressor::LZMA,         "lzma",         lzma::bound,         lzma::compress,         lzma::decompress },
-        { Compressor::LZMA2,        "lzma2",        lzma2::bound,        lzma2::compress,        lzma2::decompress },
-        { Compressor::PPMD8,        "ppmd8",        ppmd8::bound,        ppmd8::compress,        ppmd8::decompress },
+        { Compressor::LZMA,         "lzma",         lzma::bound,         lzma::compress,         lzma::decompress,         createStatelessContext<lzma::compress, lzma::decompress> },
+        { Compressor::LZMA2,        "lzma2",        lzma2::bound,        lzma2::compress,        lzma2::decompress,        createStatelessContext<lzma2::compress, lzma2::decompress> },
+        { Compressor::PPMD8,        "ppmd8",        ppmd8::bound,        ppmd8::compress,        ppmd8::decompress,        createStatelessContext<ppmd8::compress, ppmd8::decompress> },
 #endif
 #if defined(MANGO_ENABLE_ISAL)
-        { Compressor::ISAL,          "isal",        isal::bound,         isal::compress,         isal::decompress },
+        { Compressor::ISAL,          "isal",        isal::bound,         isal::compress,         isal::decompress,         createStatelessContext<isal::compress, isal::decompress> },
 #endif
     };
 
@@ -3,8 +3,18 @@
     Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
 */
 #include <algorithm>
+#include <map>
+#include <thread>
 #include <mango/core/cpuinfo.hpp>
 
+#if defined(MANGO_PLATFORM_LINUX) || defined(MANGO_PLATFORM_ANDROID)
+    #include <cstdio>
+    #include <fstream>
+    #include <string>
+    #include <dirent.h>
+    #include <sched.h>
+#endif
+
 namespace
 {
     using namespace mango;
@@ -347,6 +357,379 @@ namespace
     // cache the flags
     static u64 g_cpu_flags = getCPUFlagsInternal();
 
+    // ------------------------------------------------------------------------
+    // topology
+    // ------------------------------------------------------------------------
+
+    // Raw (platform numbered) topology keys of one logical processor
+    struct ProcessorKey
+    {
+        u32 id;
+        u64 core;
+        u64 package;
+        u64 node;
+        u64 cache;
+    };
+
+    cpu::Topology buildTopology(std::vector<ProcessorKey> keys)
+    {
+        std::sort(keys.begin(), keys.end(), [] (const ProcessorKey& a, const ProcessorKey& b)
+        {
+            return a.id < b.id;
+        });
+
+        std::map<u64, u32> cores;
+        std::map<u64, u32> packages;
+        std::map<u64, u32> nodes;
+        std::map<u64, u32> caches;
+
+        // dense index in the order of first appearance
+        auto dense = [] (std::map<u64, u32>& map, u64 key)
+        {
+            auto it = map.find(key);
+            if (it != map.end())
+                return it->second;
+            u32 index = u32(map.size());
+            map[key] = index;
+            return index;
+        };
+
+        cpu::Topology topology;
+
+        for (const ProcessorKey& key : keys)
+        {
+            cpu::Processor processor;
+
+            processor.id = key.id;
+            processor.package = dense(packages, key.package);
+            processor.core = dense(cores, (key.package << 32) | key.core);
+            processor.node = dense(nodes, key.node);
+            processor.cache = dense(caches, (key.package << 32) | key.cache);
+
+            topology.processors.push_back(processor);
+        }
+
+        topology.cores = u32(cores.size());
+        topology.packages = u32(packages.size());
+        topology.nodes = u32(nodes.size());
+        topology.caches = u32(caches.size());
+
+        return topology;
+    }
+
+    std::vector<ProcessorKey> getGenericProcessors()
+    {
+        std::vector<ProcessorKey> keys;
+
+        u32 count = std::max(std::thread::hardware_concurrency(), 1u);
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            keys.push_back({ i, i, 0, 0, 0 });
+        }
+
+        return keys;
+    }
+
+#if defined(MANGO_PLATFORM_LINUX) || defined(MANGO_PLATFORM_ANDROID)
+
+    bool readSysfs(const std::string& filename, std::string& value)
+    {
+        std::ifstream file(filename);
+        if (!file)
+        {
+            return false;
+        }
+
+        std::getline(file, value);
+        return true;
+    }
+
+    bool readSysfs(const std::string& filename, u64& value)
+    {
+        std::string text;
+        if (!readSysfs(filename, text) || text.empty())
+        {
+            return false;
+        }
+
+        long long number = std::strtoll(text.c_str(), nullptr, 10);
+        if (number < 0)
+        {
+            return false;
+        }
+
+        value = u64(number);
+        return true;
+    }
+
+    // kernel cpu list format: "0-3,8,10-11"
+    std::vector<u32> parseCpuList(const std::string& text)
+    {
+        std::vector<u32> list;
+
+        const char* p = text.c_str();
+        while (*p)
+        {
+            char* end;
+            unsigned long first = std::strtoul(p, &end, 10);
+            if (end == p)
+            {
+                break;
+            }
+
+            unsigned long last = first;
+            p = end;
+
+            if (*p == '-')
+            {
+                last = std::strtoul(p + 1, &end, 10);
+                p = end;
+            }
+
+            for (unsigned long i = first; i <= last; ++i)
+            {
+                list.push_back(u32(i));
+            }
+
+            if (*p == ',')
+            {
+                ++p;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        return list;
+    }
+
+    std::vector<ProcessorKey> getPlatformProcessors()
+    {
+        std::vector<ProcessorKey> keys;
+
+        std::string online;
+        if (!readSysfs("/sys/devices/system/cpu/online", online))
+        {
+            return keys;
+        }
+
+        // cpu -> node
+        std::map<u32, u64> cpu_node;
+
+        if (DIR* dir = opendir("/sys/devices/system/node"))
+        {
+            while (dirent* entry = readdir(dir))
+            {
+                unsigned int node;
+                if (std::sscanf(entry->d_name, "node%u", &node) == 1)
+                {
+                    std::string cpulist;
+                    std::string filename = "/sys/devices/system/node/" + std::string(entry->d_name) + "/cpulist";
+                    if (readSysfs(filename, cpulist))
+                    {
+                        for (u32 cpu : parseCpuList(cpulist))
+                        {
+                            cpu_node[cpu] = node;
+                        }
+                    }
+                }
+            }
+
+            closedir(dir);
+        }
+
+        const std::vector<u32> cpus = parseCpuList(online);
+        if (cpus.empty())
+        {
+            return keys;
+        }
+
+        // processors outside the affinity mask of the process (taskset, cgroup cpuset)
+        // can't run the workers; without the mask every online processor is used
+        const int mask_count = std::max(int(*std::max_element(cpus.begin(), cpus.end())) + 1, CPU_SETSIZE);
+        const size_t mask_size = CPU_ALLOC_SIZE(mask_count);
+
+        cpu_set_t* mask = CPU_ALLOC(mask_count);
+        if (mask && ::sched_getaffinity(0, mask_size, mask) != 0)
+        {
+            CPU_FREE(mask);
+            mask = nullptr;
+        }
+
+        for (u32 cpu : cpus)
+        {
+            if (mask && !CPU_ISSET_S(cpu, mask_size, mask))
+            {
+                continue;
+            }
+
+            const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+
+            ProcessorKey key { cpu, cpu, 0, 0, 0 };
+
+            readSysfs(path + "/topology/physical_package_id", key.package);
+            readSysfs(path + "/topology/core_id", key.core);
+
+            auto it = cpu_node.find(cpu);
+            if (it != cpu_node.end())
+            {
+                key.node = it->second;
+            }
+
+            // last level cache domain: identified by the first cpu sharing it
+            key.cache = key.package;
+
+            for (int index = 0; ; ++index)
+            {
+                const std::string cache = path + "/cache/index" + std::to_string(index);
+
+                u64 level;
+                if (!readSysfs(cache + "/level", level))
+                {
+                    break;
+                }
+
+                std::string shared;
+                if (level == 3 && readSysfs(cache + "/shared_cpu_list", shared))
+                {
+                    std::vector<u32> list = parseCpuList(shared);
+                    if (!list.empty())
+                    {
+                        key.cache = *std::min_element(list.begin(), list.end());
+                    }
+                }
+            }
+
+            keys.push_back(key);
+        }
+
+        if (mask)
+        {
+            CPU_FREE(mask);
+        }
+
+        return keys;
+    }
+
+#elif defined(MANGO_PLATFORM_WINDOWS)
+
+    template <typename Function>
+    void forEachProcessor(const GROUP_AFFINITY& group, Function&& func)
+    {
+        for (u32 bit = 0; bit < 64; ++bit)
+        {
+            if (group.Mask & (KAFFINITY(1) << bit))
+            {
+                func(u32(group.Group) * 64 + bit);
+            }
+        }
+    }
+
+    std::vector<ProcessorKey> getPlatformProcessors()
+    {
+        std::vector<ProcessorKey> keys;
+
+        DWORD size = 0;
+        GetLogicalProcessorInformationEx(RelationAll, nullptr, &size);
+        if (GetLastError() != ERROR_INSUFFICIENT_BUFFER)
+        {
+            return keys;
+        }
+
+        std::vector<u8> buffer(size);
+        auto info = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data());
+        if (!GetLogicalProcessorInformationEx(RelationAll, info, &size))
+        {
+            return keys;
+        }
+
+        std::map<u32, ProcessorKey> processors;
+
+        auto get = [&] (u32 id) -> ProcessorKey&
+        {
+            auto it = processors.find(id);
+            if (it == processors.end())
+            {
+                it = processors.emplace(id, ProcessorKey { id, id, 0, 0, 0 }).first;
+            }
+            return it->second;
+        };
+
+        u64 core = 0;
+        u64 package = 0;
+        u64 cache = 0;
+
+        for (DWORD offset = 0; offset < size; )
+        {
+            auto entry = reinterpret_cast<PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX>(buffer.data() + offset);
+
+            switch (entry->Relationship)
+            {
+                case RelationProcessorCore:
+                    for (WORD i = 0; i < entry->Processor.GroupCount; ++i)
+                    {
+                        forEachProcessor(entry->Processor.GroupMask[i], [&] (u32 id) { get(id).core = core; });
+                    }
+                    ++core;
+                    break;
+
+                case RelationProcessorPackage:
+                    for (WORD i = 0; i < entry->Processor.GroupCount; ++i)
+                    {
+                        forEachProcessor(entry->Processor.GroupMask[i], [&] (u32 id) { get(id).package = package; });
+                    }
+                    ++package;
+                    break;
+
+                case RelationNumaNode:
+                    forEachProcessor(entry->NumaNode.GroupMask, [&] (u32 id) { get(id).node = entry->NumaNode.NodeNumber; });
+                    break;
+
+                case RelationCache:
+                    if (entry->Cache.Level == 3)
+                    {
+                        forEachProcessor(entry->Cache.GroupMask, [&] (u32 id) { get(id).cache = cache; });
+                        ++cache;
+                    }
+                    break;
+
+                default:
+                    break;
+            }
+
+            offset += entry->Size;
+        }
+
+        for (auto& it : processors)
+        {
+            keys.push_back(it.second);
+        }
+
+        return keys;
+    }
+
+#else
+
+    std::vector<ProcessorKey> getPlatformProcessors()
+    {
+        return {}; // unsupported platform
+    }
+
+#endif
+
+    cpu::Topology getTopologyInternal()
+    {
+        std::vector<ProcessorKey> keys = getPlatformProcessors();
+        if (keys.empty())
+        {
+            keys = getGenericProcessors();
+        }
+
+        return buildTopology(keys);
+    }
+
 } // namespace
 
 namespace mango::cpu
@@ -357,6 +740,12 @@ namespace mango::cpu
         return g_cpu_flags;
     }
 
+    const Topology& getTopology()
+    {
+        static Topology topology = getTopologyInternal();
+        return topology;
+    }
+
     bool isLittleEndian()
     {
         // This avoids using the macros :)
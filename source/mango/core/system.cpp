@@ -8,6 +8,8 @@
 #include <mango/core/thread.hpp>
 #include <mango/core/timer.hpp>
 #include <mango/simd/simd.hpp>
+#include <cstdlib>
+#include <cstring>
 #include <sstream>
 
 #if defined(WIN32)
@@ -71,6 +73,14 @@ namespace
         return id;
     }
 
+    bool getThreadAffinity()
+    {
+        // Environment variable override to pin the default thread pool workers:
+        //    MANGO_THREAD_AFFINITY = 1 | 0
+        const char* env = std::getenv("MANGO_THREAD_AFFINITY");
+        return env && std::strcmp(env, "0") != 0 && *env;
+    }
+
 } // namespace
 
 namespace mango
@@ -83,7 +93,7 @@ namespace mango
     Context::Context()
         : timer()
         , tracer()
-        , thread_pool(ThreadPool::getHardwareConcurrency())
+        , thread_pool(ThreadPool::getHardwareConcurrency(), getThreadAffinity())
     {
         // get first ID to main thread
         TraceThread th("MainThread");
@@ -4,7 +4,9 @@
 */
 #include <chrono>
 #include <deque>
+#include <map>
 #include <mango/core/system.hpp>
+#include <mango/core/cpuinfo.hpp>
 #include <mango/core/thread.hpp>
 #include "../../external/concurrentqueue/concurrentqueue.h"
 #include "../../external/concurrentqueue/readerwriterqueue.h"
@@ -23,46 +25,33 @@ using std::chrono::milliseconds;
 
 #include <pthread.h>
 
-    template <typename H>
-    static void set_thread_affinity(H handle, int processor)
+    // pins the calling thread; fails when the processor is outside the allowed set
+    static bool set_current_thread_affinity(int processor)
     {
         cpu_set_t cpuset;
 
         CPU_ZERO(&cpuset);
         CPU_SET(processor, &cpuset);
-        pthread_setaffinity_np(handle, sizeof(cpu_set_t), &cpuset);
-    }
-
-    static void set_current_thread_affinity(int processor)
-    {
-        set_thread_affinity(pthread_self(), processor);
+        return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset) == 0;
     }
 
 #elif defined(MANGO_PLATFORM_WINDOWS)
 
-    template <typename H>
-    static void set_thread_affinity(H handle, int processor)
+    static bool set_current_thread_affinity(int processor)
     {
-        SetThreadAffinityMask(handle, DWORD_PTR(1) << processor);
-    }
-
-    static void set_current_thread_affinity(int processor)
-    {
-        set_thread_affinity(GetCurrentThread(), processor);
+        // processor numbers are group * 64 + index (see cpu::getTopology())
+        GROUP_AFFINITY group {};
+        group.Group = WORD(processor / 64);
+        group.Mask  = KAFFINITY(1ull << (processor % 64));
+        return SetThreadGroupAffinity(GetCurrentThread(), &group, nullptr) != 0;
     }
 
 #else
 
-    template <typename H>
-    static void set_thread_affinity(H handle, int processor)
-    {
-        MANGO_UNREFERENCED(handle);
-        MANGO_UNREFERENCED(processor);
-    }
-
-    static void set_current_thread_affinity(int processor)
+    static bool set_current_thread_affinity(int processor)
     {
         MANGO_UNREFERENCED(processor);
+        return false;
     }
 
 #endif
@@ -79,7 +68,7 @@ using std::chrono::milliseconds;
         return pthread_gethandle(t.native_handle());
     }
 
-#else
+#elif defined(MANGO_PLATFORM_WINDOWS)
 
     static auto get_native_handle(std::thread& t)
     {
@@ -91,50 +80,642 @@ using std::chrono::milliseconds;
 namespace mango
 {
 
+    // ------------------------------------------------------------
+    // TaskFunction
+    // ------------------------------------------------------------
+
+    namespace
+    {
+
+        /*
+            Slab pool of fixed size blocks, one pool per thread. The owning thread
+            allocates and frees without atomics; blocks freed by other threads are
+            pushed into a lock-free list which the owner reclaims in one exchange
+            when its local free list runs dry. Every block carries its owner in a
+            small header. The pool is reference counted by the owning thread and
+            the blocks in flight, so it outlives the thread when tasks it allocated
+            are still queued.
+        */
+
+        class SlabPool
+        {
+        public:
+            static constexpr size_t header_size = 16;
+            static constexpr size_t block_size = 256;
+            static constexpr size_t payload_size = block_size - header_size;
+            static constexpr size_t slab_blocks = 64;
+
+            struct Block
+            {
+                SlabPool* owner; // nullptr: large block from operator new
+                Block* next;
+            };
+
+            static_assert(sizeof(Block) <= header_size);
+
+            SlabPool() = default;
+
+            ~SlabPool()
+            {
+                for (u8* slab : m_slabs)
+                {
+                    ::operator delete(slab, std::align_val_t(64));
+                }
+            }
+
+            void* allocate()
+            {
+                Block* block = m_free;
+                if (!block)
+                {
+                    block = m_remote.exchange(nullptr, std::memory_order_acquire);
+                    if (!block)
+                    {
+                        block = grow();
+                    }
+                }
+
+                m_free = block->next;
+                m_references.fetch_add(1, std::memory_order_relaxed);
+
+                return reinterpret_cast<u8*>(block) + header_size;
+            }
+
+            void deallocate(Block* block, bool owner)
+            {
+                if (owner)
+                {
+                    block->next = m_free;
+                    m_free = block;
+                }
+                else
+                {
+                    Block* head = m_remote.load(std::memory_order_relaxed);
+                    do
+                    {
+                        block->next = head;
+                    } while (!m_remote.compare_exchange_weak(head, block,
+                        std::memory_order_release, std::memory_order_relaxed));
+                }
+
+                release();
+            }
+
+            void release()
+            {
+                if (m_references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    delete this;
+                }
+            }
+
+        protected:
+            Block* m_free = nullptr;
+            std::vector<u8*> m_slabs;
+
+            alignas(64) std::atomic<Block*> m_remote { nullptr };
+
+            // owning thread + blocks in flight
+            alignas(64) std::atomic<size_t> m_references { 1 };
+
+            Block* grow()
+            {
+                u8* slab = static_cast<u8*>(::operator new(block_size * slab_blocks, std::align_val_t(64)));
+                m_slabs.push_back(slab);
+
+                Block* head = nullptr;
+
+                for (size_t i = slab_blocks; i-- > 0; )
+                {
+                    Block* block = reinterpret_cast<Block*>(slab + i * block_size);
+                    block->owner = this;
+                    block->next = head;
+                    head = block;
+                }
+
+                return head;
+            }
+        };
+
+        struct SlabPoolHolder
+        {
+            SlabPool* pool = nullptr;
+
+            ~SlabPoolHolder()
+            {
+                if (pool)
+                {
+                    pool->release();
+                    pool = nullptr;
+                }
+            }
+        };
+
+        thread_local SlabPoolHolder g_slab_pool;
+
+    } // namespace
+
+    void* TaskFunction::allocate(size_t size)
+    {
+        if (size > SlabPool::payload_size)
+        {
+            u8* memory = static_cast<u8*>(::operator new(SlabPool::header_size + size));
+            SlabPool::Block* block = reinterpret_cast<SlabPool::Block*>(memory);
+            block->owner = nullptr;
+            return memory + SlabPool::header_size;
+        }
+
+        if (!g_slab_pool.pool)
+        {
+            g_slab_pool.pool = new SlabPool();
+        }
+
+        return g_slab_pool.pool->allocate();
+    }
+
+    void TaskFunction::deallocate(void* ptr)
+    {
+        u8* memory = static_cast<u8*>(ptr) - SlabPool::header_size;
+        SlabPool::Block* block = reinterpret_cast<SlabPool::Block*>(memory);
+
+        SlabPool* owner = block->owner;
+        if (!owner)
+        {
+            ::operator delete(memory);
+            return;
+        }
+
+        owner->deallocate(block, owner == g_slab_pool.pool);
+    }
+
+
     // ------------------------------------------------------------
     // ThreadPool
     // ------------------------------------------------------------
 
+    /*
+        Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli: "Correct and
+        Efficient Work-Stealing for Weak Memory Models", PPoPP 2013).
+
+        The owning worker pushes and pops at the bottom (LIFO, cache warm), thieves
+        steal from the top (FIFO, oldest work first). The ring has fixed capacity;
+        push() fails when it is full and the caller falls back to the shared queue.
+        This keeps the deque free of buffer reallocation and memory reclamation.
+    */
+
+    template <typename Task>
+    class StealingDeque
+    {
+    protected:
+        static constexpr s64 capacity = 4096;
+        static constexpr s64 mask = capacity - 1;
+
+        alignas(64) std::atomic<s64> m_top { 0 };
+        alignas(64) std::atomic<s64> m_bottom { 0 };
+        alignas(64) std::atomic<Task*> m_buffer[capacity];
+
+    public:
+        StealingDeque()
+        {
+            for (auto& slot : m_buffer)
+            {
+                slot.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        ~StealingDeque()
+        {
+            while (Task* task = pop())
+            {
+                delete task;
+            }
+        }
+
+        // owner only
+        bool push(Task* task)
+        {
+            const s64 b = m_bottom.load(std::memory_order_relaxed);
+            const s64 t = m_top.load(std::memory_order_acquire);
+
+            if (b - t >= capacity)
+            {
+                return false;
+            }
+
+            m_buffer[b & mask].store(task, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            m_bottom.store(b + 1, std::memory_order_relaxed);
+
+            return true;
+        }
+
+        // owner only
+        Task* pop()
+        {
+            const s64 b = m_bottom.load(std::memory_order_relaxed) - 1;
+            m_bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            s64 t = m_top.load(std::memory_order_relaxed);
+
+            Task* task = nullptr;
+
+            if (t <= b)
+            {
+                task = m_buffer[b & mask].load(std::memory_order_relaxed);
+
+                if (t == b)
+                {
+                    // last item: race against thieves
+                    if (!m_top.compare_exchange_strong(t, t + 1,
+                            std::memory_order_seq_cst, std::memory_order_relaxed))
+                    {
+                        task = nullptr;
+                    }
+
+                    m_bottom.store(b + 1, std::memory_order_relaxed);
+                }
+            }
+            else
+            {
+                m_bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            return task;
+        }
+
+        // any thread
+        Task* steal()
+        {
+            s64 t = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const s64 b = m_bottom.load(std::memory_order_acquire);
+
+            if (t < b)
+            {
+                Task* task = m_buffer[t & mask].load(std::memory_order_relaxed);
+
+                if (m_top.compare_exchange_strong(t, t + 1,
+                        std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    return task;
+                }
+            }
+
+            return nullptr;
+        }
+
+        bool empty() const
+        {
+            const s64 t = m_top.load(std::memory_order_relaxed);
+            const s64 b = m_bottom.load(std::memory_order_relaxed);
+            return b <= t;
+        }
+    };
+
+    namespace
+    {
+        // worker identity of the current thread; index is only valid for g_worker_pool
+        thread_local const ThreadPool* g_worker_pool { nullptr };
+        thread_local size_t g_worker_index { 0 };
+
+        constexpr size_t kNoWorker = ~size_t(0);
+
+        size_t current_worker(const ThreadPool* pool)
+        {
+            return g_worker_pool == pool ? g_worker_index : kNoWorker;
+        }
+
+        // victim selection for stealing; seeded per thread so the thieves spread out
+        u32 steal_random()
+        {
+            static std::atomic<u32> seed_counter { 0 };
+            thread_local u32 state = (++seed_counter * 0x9e3779b9u) | 1;
+
+            // xorshift32
+            u32 x = state;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            state = x;
+            return x;
+        }
+    }
+
     struct ThreadPool::TaskQueue
     {
         using Task = ThreadPool::Task;
-        moodycamel::ConcurrentQueue<Task> tasks;
+
+        struct Lane
+        {
+            // shared queue for submissions from outside the pool (and deque overflow)
+            moodycamel::ConcurrentQueue<Task*> tasks;
+
+            // one deque per worker; submissions from a worker go to its own deque
+            std::vector<std::unique_ptr<StealingDeque<Task>>> locals;
+
+            // one queue per NUMA node for tasks targeting a node (empty with one node)
+            std::vector<std::unique_ptr<moodycamel::ConcurrentQueue<Task*>>> nodes;
+
+            ~Lane()
+            {
+                Task* task;
+                while (tasks.try_dequeue(task))
+                {
+                    delete task;
+                }
+
+                for (auto& queue : nodes)
+                {
+                    while (queue->try_dequeue(task))
+                    {
+                        delete task;
+                    }
+                }
+            }
+
+            // Node the task must run on, -1 for any
+            int target(Task* task) const
+            {
+                const int node = task->queue->node;
+                return node >= 0 && node < int(nodes.size()) ? node : -1;
+            }
+
+            // Submit from any thread; workers use their own deque when there is room.
+            void enqueue(Task* task, size_t worker, int worker_node)
+            {
+                const int node = target(task);
+                if (node >= 0 && node != worker_node)
+                {
+                    nodes[node]->enqueue(task);
+                    return;
+                }
+
+                if (worker < locals.size() && locals[worker]->push(task))
+                {
+                    return;
+                }
+
+                tasks.enqueue(task);
+            }
+
+            // Own deque first (newest work), then the own node's queue, then the shared
+            // queue, then steal the oldest work from a randomly selected victim.
+            Task* dequeue(size_t worker, int worker_node, moodycamel::ConsumerToken* token)
+            {
+                const size_t count = locals.size();
+
+                if (worker < count)
+                {
+                    if (Task* task = locals[worker]->pop())
+                    {
+                        return task;
+                    }
+                }
+
+                Task* task = nullptr;
+
+                if (worker_node >= 0 && worker_node < int(nodes.size()))
+                {
+                    if (nodes[worker_node]->try_dequeue(task))
+                    {
+                        return task;
+                    }
+                }
+
+                bool dequeued = token ? tasks.try_dequeue(*token, task)
+                                      : tasks.try_dequeue(task);
+                if (dequeued)
+                {
+                    return task;
+                }
+
+                if (count > 0)
+                {
+                    size_t victim = steal_random() % count;
+
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        if (victim != worker)
+                        {
+                            task = locals[victim]->steal();
+                            if (task)
+                            {
+                                const int node = target(task);
+                                if (worker_node < 0 || node < 0 || node == worker_node)
+                                {
+                                    return task;
+                                }
+
+                                // stolen from its node: route it back to the node's queue
+                                nodes[node]->enqueue(task);
+                            }
+                        }
+
+                        if (++victim == count)
+                        {
+                            victim = 0;
+                        }
+                    }
+                }
+
+                if (worker_node < 0)
+                {
+                    // helping thread outside the pool runs anything
+                    for (auto& queue : nodes)
+                    {
+                        if (queue->try_dequeue(task))
+                        {
+                            return task;
+                        }
+                    }
+                }
+
+                return nullptr;
+            }
+        };
+
+        Lane lanes [lane_count];
+
+        // NUMA node of each worker (all zero unless the workers are pinned; -1 when
+        // pinning failed). Each entry is written and read only by its own worker.
+        std::vector<int> worker_nodes;
+        int node_count;
+
+        TaskQueue(const std::vector<int>& worker_nodes, int node_count)
+            : worker_nodes(worker_nodes)
+            , node_count(node_count)
+        {
+            for (Lane& lane : lanes)
+            {
+                lane.locals.resize(worker_nodes.size());
+
+                for (auto& local : lane.locals)
+                {
+                    local = std::make_unique<StealingDeque<Task>>();
+                }
+
+                if (node_count > 1)
+                {
+                    lane.nodes.resize(node_count);
+
+                    for (auto& queue : lane.nodes)
+                    {
+                        queue = std::make_unique<moodycamel::ConcurrentQueue<Task*>>();
+                    }
+                }
+            }
+        }
+
+        int getNode(size_t worker) const
+        {
+            return worker < worker_nodes.size() ? worker_nodes[worker] : -1;
+        }
+
+        void enqueue(Task* task, size_t worker)
+        {
+            lanes[int(task->queue->priority)].enqueue(task, worker, getNode(worker));
+        }
+
+        // Highest priority lane first; tokens is an array of lane_count or nullptr.
+        Task* dequeue(size_t worker, moodycamel::ConsumerToken* tokens)
+        {
+            const int node = getNode(worker);
+
+            for (int i = 0; i < lane_count; ++i)
+            {
+                Task* task = lanes[i].dequeue(worker, node, tokens ? &tokens[i] : nullptr);
+                if (task)
+                {
+                    return task;
+                }
+            }
+
+            return nullptr;
+        }
     };
 
     struct ThreadPool::Consumer
     {
-        moodycamel::ConsumerToken token;
+        moodycamel::ConsumerToken tokens [lane_count];
 
         Consumer(TaskQueue& queue)
-            : token(queue.tasks)
+            : tokens
+            {
+                moodycamel::ConsumerToken(queue.lanes[0].tasks),
+                moodycamel::ConsumerToken(queue.lanes[1].tasks),
+                moodycamel::ConsumerToken(queue.lanes[2].tasks),
+            }
         {
         }
     };
 
+    namespace
+    {
+
+        // Worker placement for pinned pools: spread the workers round-robin over
+        // the NUMA nodes, one per physical core first, SMT siblings last.
+        std::vector<cpu::Processor> getWorkerPlacement()
+        {
+            std::vector<cpu::Processor> processors = cpu::getTopology().processors;
+
+            struct Key
+            {
+                u32 rank;     // SMT sibling index within the core
+                u32 position; // index among processors of the same node and rank
+            };
+
+            std::vector<Key> keys(processors.size());
+            std::vector<u32> core_count(cpu::getTopology().cores, 0);
+            std::map<u64, u32> node_rank_count;
+
+            for (size_t i = 0; i < processors.size(); ++i)
+            {
+                const cpu::Processor& processor = processors[i];
+                keys[i].rank = core_count[processor.core]++;
+                keys[i].position = node_rank_count[(u64(processor.node) << 32) | keys[i].rank]++;
+            }
+
+            std::vector<size_t> order(processors.size());
+            for (size_t i = 0; i < order.size(); ++i)
+            {
+                order[i] = i;
+            }
+
+            std::stable_sort(order.begin(), order.end(), [&] (size_t a, size_t b)
+            {
+                if (keys[a].rank != keys[b].rank)
+                    return keys[a].rank < keys[b].rank;
+                if (keys[a].position != keys[b].position)
+                    return keys[a].position < keys[b].position;
+                return processors[a].node < processors[b].node;
+            });
+
+            std::vector<cpu::Processor> placement;
+            for (size_t i : order)
+            {
+                placement.push_back(processors[i]);
+            }
+
+            return placement;
+        }
+
+    } // namespace
+
     ThreadPool::ThreadPool(size_t size)
+        : ThreadPool(size, false)
+    {
+    }
+
+    ThreadPool::ThreadPool(size_t size, bool affinity)
         : m_queue(nullptr)
         , m_threads(size)
         , m_workers(size)
         , m_utilization_busy_ns(size, 0)
+        , m_lane_busy_ns(lane_count, 0)
     {
-        m_queue = new TaskQueue;
+        // By default the OS scheduler places the workers. With affinity each worker is
+        // pinned to a processor and the pool is split into per-node sub-pools; queues
+        // can then target a node so that the tasks and their memory stay local.
+        std::vector<cpu::Processor> placement;
+        std::vector<int> worker_nodes(size, 0);
+        int node_count = 1;
 
-        // NOTE: let OS scheduler shuffle tasks as it sees fit
-        //       this gives better performance overall UNTIL we have some practical
-        //       use for the affinity (eg. dependent tasks using same cache)
-        const bool affinity = false; //std::thread::hardware_concurrency() > 1;
         if (affinity)
         {
-            set_current_thread_affinity(0);
+            placement = getWorkerPlacement();
+
+            for (size_t i = 0; i < size; ++i)
+            {
+                worker_nodes[i] = int(placement[i % placement.size()].node);
+            }
+
+            // the placement covers the nodes in order; nodes without workers are not used
+            node_count = int(std::clamp(size_t(cpu::getTopology().nodes), size_t(1), std::max(size, size_t(1))));
         }
 
+        m_queue = new TaskQueue(worker_nodes, node_count);
+
         for (size_t i = 0; i < size; ++i)
         {
-            m_threads[i] = std::thread([this, i]
+            const int processor = affinity ? int(placement[i % placement.size()].id) : -1;
+
+            m_threads[i] = std::thread([this, i, processor]
             {
+                // The worker pins itself so that the result is known before it takes any
+                // work; a worker which could not be pinned is not local to any node.
+                if (processor >= 0 && !set_current_thread_affinity(processor))
+                {
+                    m_queue->worker_nodes[i] = -1;
+                }
+
                 thread(i);
             });
 
+            if (affinity)
+            {
+                continue;
+            }
+
 #if defined(MANGO_PLATFORM_WINDOWS)
             constexpr u32 CPUsPerGroup = 64;
 
@@ -152,11 +733,6 @@ namespace mango
                 SetThreadGroupAffinity(handle, &group, nullptr);
             }
 #endif
-
-            if (affinity)
-            {
-                set_thread_affinity(get_native_handle(m_threads[i]), int(i + 1));
-            }
         }
     }
 
@@ -189,6 +765,16 @@ namespace mango
         return int(m_threads.size());
     }
 
+    int ThreadPool::getNodeCount() const
+    {
+        return m_queue->node_count;
+    }
+
+    int ThreadPool::getCurrentNode() const
+    {
+        return m_queue->getNode(current_worker(this));
+    }
+
     namespace
     {
         thread_local int g_thread_pool_depth { 0 };
@@ -260,11 +846,68 @@ namespace mango
         return result;
     }
 
+    std::vector<float> ThreadPool::laneUtilization()
+    {
+        std::vector<float> result(lane_count, 0.0f);
+
+        const u64 now_ns = steady_ns();
+
+        std::lock_guard<std::mutex> lock(m_utilization_mutex);
+
+        u64 busy [lane_count] = { 0 };
+
+        for (const WorkerState& worker : m_workers)
+        {
+            for (int i = 0; i < lane_count; ++i)
+            {
+                busy[i] += worker.lane_busy_ns[i].load(std::memory_order_relaxed);
+            }
+
+            const u64 stamp = worker.busy_stamp_ns.load(std::memory_order_relaxed);
+            if (stamp && stamp < now_ns)
+            {
+                busy[worker.busy_lane.load(std::memory_order_relaxed)] += now_ns - stamp;
+            }
+        }
+
+        if (m_lane_stamp_ns == 0)
+        {
+            // Open the sampling window; first pulse is always zero.
+            for (int i = 0; i < lane_count; ++i)
+            {
+                m_lane_busy_ns[i] = busy[i];
+            }
+            m_lane_stamp_ns = now_ns;
+            return result;
+        }
+
+        const u64 wall_ns = (now_ns - m_lane_stamp_ns) * std::max(m_workers.size(), size_t(1));
+        if (!wall_ns)
+            return result;
+
+        for (int i = 0; i < lane_count; ++i)
+        {
+            const u64 delta = busy[i] - m_lane_busy_ns[i];
+            m_lane_busy_ns[i] = busy[i];
+
+            float u = float(delta) / float(wall_ns);
+            if (u < 0.0f) u = 0.0f;
+            if (u > 1.0f) u = 1.0f;
+            result[i] = u;
+        }
+
+        m_lane_stamp_ns = now_ns;
+        return result;
+    }
+
     void ThreadPool::thread(size_t threadID)
     {
         std::string name = fmt::format("TP#{:03}", threadID + 1);
         TraceThread th(name);
 
+        g_worker_pool = this;
+        g_worker_index = threadID;
+
         Consumer consumer(*m_queue);
         WorkerState& worker = m_workers[threadID];
 
@@ -272,17 +915,22 @@ namespace mango
 
         while (!m_stop.load(std::memory_order_relaxed))
         {
-            Task task;
-            if (m_queue->tasks.try_dequeue(consumer.token, task))
+            Task* task = m_queue->dequeue(threadID, consumer.tokens);
+            if (task)
             {
+                const int lane = int(task->queue->priority);
+
                 const u64 t0 = steady_ns();
+                worker.busy_lane.store(lane, std::memory_order_relaxed);
                 worker.busy_stamp_ns.store(t0, std::memory_order_relaxed);
 
-                process(task);
+                process(*task);
+                delete task;
 
                 const u64 t1 = steady_ns();
                 worker.busy_stamp_ns.store(0, std::memory_order_relaxed);
                 worker.busy_ns.fetch_add(t1 - t0, std::memory_order_relaxed);
+                worker.lane_busy_ns[lane].fetch_add(t1 - t0, std::memory_order_relaxed);
 
                 idle_start = high_resolution_clock::now();
             }
@@ -306,11 +954,13 @@ namespace mango
                 }
             }
         }
+
+        g_worker_pool = nullptr;
     }
 
-    void ThreadPool::enqueue(Queue* queue, std::function<void()>&& func)
+    void ThreadPool::enqueue(Queue* queue, TaskFunction&& func)
     {
-        Task task
+        Task* task = new Task
         {
             .queue = queue,
             .func = std::move(func)
@@ -318,8 +968,10 @@ namespace mango
 
         ++queue->task_counter;
 
-        m_queue->tasks.enqueue(std::move(task));
-        m_queue_condition.notify_one();
+        if (admit(task))
+        {
+            submit(task);
+        }
     }
 
     void ThreadPool::enqueue_bulk(Queue* queue, const std::vector<std::function<void()>>& functions)
@@ -327,21 +979,71 @@ namespace mango
         size_t count = functions.size();
         queue->task_counter += count;
 
-        std::vector<Task> tasks(count);
+        std::vector<Task*> tasks(count);
 
         for (size_t i = 0; i < count; ++i)
         {
-            tasks[i] =
+            tasks[i] = new Task
             {
                 .queue = queue,
-                .func = std::move(functions[i])
+                .func = TaskFunction(functions[i])
             };
         }
 
-        m_queue->tasks.enqueue_bulk(tasks.data(), count);
+        const size_t worker = current_worker(this);
+        if (queue->max_in_flight)
+        {
+            for (Task* task : tasks)
+            {
+                if (admit(task))
+                {
+                    m_queue->enqueue(task, worker);
+                }
+            }
+        }
+        else if (worker != kNoWorker)
+        {
+            for (Task* task : tasks)
+            {
+                m_queue->enqueue(task, worker);
+            }
+        }
+        else
+        {
+            m_queue->lanes[int(queue->priority)].tasks.enqueue_bulk(tasks.data(), count);
+        }
+
         m_queue_condition.notify_all();
     }
 
+    void ThreadPool::submit(Task* task)
+    {
+        m_queue->enqueue(task, current_worker(this));
+        m_queue_condition.notify_one();
+    }
+
+    bool ThreadPool::admit(Task* task)
+    {
+        Queue* queue = task->queue;
+
+        if (!queue->max_in_flight)
+        {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(queue->held_mutex);
+
+        if (queue->in_flight < queue->max_in_flight)
+        {
+            ++queue->in_flight;
+            return true;
+        }
+
+        // over the limit: released by process() when a running task completes
+        queue->held.push_back(task);
+        return false;
+    }
+
     void ThreadPool::process(Task& task)
     {
         Queue* queue = task.queue;
@@ -362,15 +1064,39 @@ namespace mango
             }
         }
 
+        if (queue->max_in_flight)
+        {
+            // hand the slot over to the next held task
+            Task* next = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(queue->held_mutex);
+                if (queue->held.empty())
+                {
+                    --queue->in_flight;
+                }
+                else
+                {
+                    next = queue->held.front();
+                    queue->held.pop_front();
+                }
+            }
+
+            if (next)
+            {
+                submit(next);
+            }
+        }
+
         --queue->task_counter;
     }
 
     bool ThreadPool::dequeue_and_process()
     {
-        Task task;
-        if (m_queue->tasks.try_dequeue(task))
+        Task* task = m_queue->dequeue(current_worker(this), nullptr);
+        if (task)
         {
-            process(task);
+            process(*task);
+            delete task;
             return true;
         }
 
@@ -398,10 +1124,10 @@ namespace mango
 
     struct ConcurrentQueue::NestedQueue
     {
-        std::deque<std::function<void()>> tasks;
+        std::deque<TaskFunction> tasks;
     };
 
-    void ConcurrentQueue::enqueue_task(std::function<void()>&& func)
+    void ConcurrentQueue::enqueue_task(TaskFunction&& func)
     {
         if (m_nested)
         {
@@ -418,7 +1144,10 @@ namespace mango
         if (m_nested)
         {
             size_t count = functions.size();
-            m_nested->tasks.insert(m_nested->tasks.end(), functions.begin(), functions.end());
+            for (const auto& func : functions)
+            {
+                m_nested->tasks.emplace_back(func);
+            }
             m_queue.task_counter += count;
             return;
         }
@@ -450,50 +1179,33 @@ namespace mango
     }
 
     ConcurrentQueue::ConcurrentQueue()
-        : m_pool(ThreadPool::getInstance())
-        , m_queue(&m_pool, "")
+        : ConcurrentQueue(ThreadPool::getInstance(), "", TaskPriority::Normal, 0)
     {
-        if (g_thread_pool_depth > 0)
-        {
-            m_nested = std::make_unique<NestedQueue>();
-        }
-        else
-        {
-            m_pool.m_queue_condition.notify_one();
-        }
     }
 
     ConcurrentQueue::ConcurrentQueue(const std::string& name)
-        : m_pool(ThreadPool::getInstance())
-        , m_queue(&m_pool, name)
+        : ConcurrentQueue(ThreadPool::getInstance(), name, TaskPriority::Normal, 0)
+    {
+    }
+
+    ConcurrentQueue::ConcurrentQueue(ThreadPool& pool)
+        : ConcurrentQueue(pool, "", TaskPriority::Normal, 0)
+    {
+    }
+
+    ConcurrentQueue::ConcurrentQueue(ThreadPool& pool, const std::string& name)
+        : ConcurrentQueue(pool, name, TaskPriority::Normal, 0)
     {
-        if (g_thread_pool_depth > 0)
-        {
-            m_nested = std::make_unique<NestedQueue>();
-        }
-        else
-        {
-            m_pool.m_queue_condition.notify_one();
-        }
     }
 
-    ConcurrentQueue::ConcurrentQueue(ThreadPool& pool)
-        : m_pool(pool)
-        , m_queue(&m_pool, "")
+    ConcurrentQueue::ConcurrentQueue(const std::string& name, TaskPriority priority, size_t max_in_flight)
+        : ConcurrentQueue(ThreadPool::getInstance(), name, priority, max_in_flight)
     {
-        if (g_thread_pool_depth > 0)
-        {
-            m_nested = std::make_unique<NestedQueue>();
-        }
-        else
-        {
-            m_pool.m_queue_condition.notify_one();
-        }
     }
 
-    ConcurrentQueue::ConcurrentQueue(ThreadPool& pool, const std::string& name)
+    ConcurrentQueue::ConcurrentQueue(ThreadPool& pool, const std::string& name, TaskPriority priority, size_t max_in_flight)
         : m_pool(pool)
-        , m_queue(&m_pool, name)
+        , m_queue(&m_pool, name, priority, max_in_flight)
     {
         if (g_thread_pool_depth > 0)
         {
@@ -547,21 +1259,318 @@ namespace mango
         m_pool.wait(&m_queue);
     }
 
+    // ------------------------------------------------------------
+    // TaskGraph
+    // ------------------------------------------------------------
+
+    TaskGraph::TaskGraph()
+        : m_queue()
+    {
+    }
+
+    TaskGraph::TaskGraph(const std::string& name)
+        : m_queue(name)
+    {
+    }
+
+    TaskGraph::TaskGraph(ThreadPool& pool)
+        : m_queue(pool)
+    {
+    }
+
+    TaskGraph::TaskGraph(ThreadPool& pool, const std::string& name)
+        : m_queue(pool, name)
+    {
+    }
+
+    TaskGraph::~TaskGraph()
+    {
+        wait();
+    }
+
+    TaskGraph::Node* TaskGraph::create()
+    {
+        m_nodes.emplace_back(std::make_unique<Node>());
+        return m_nodes.back().get();
+    }
+
+    void TaskGraph::precede(Node* before, Node* after)
+    {
+        before->successors.push_back(after);
+        ++after->predecessors;
+    }
+
+    void TaskGraph::run()
+    {
+        // the cancellation flags are not cleared here; cancel() before run() skips the run
+        for (auto& node : m_nodes)
+        {
+            node->pending.store(node->predecessors, std::memory_order_relaxed);
+        }
+
+        for (auto& node : m_nodes)
+        {
+            if (!node->predecessors)
+            {
+                schedule(node.get());
+            }
+        }
+    }
+
+    void TaskGraph::wait()
+    {
+        m_queue.wait();
+
+        // the graph is complete; the next run starts without cancellations
+        m_cancelled = false;
+
+        for (auto& node : m_nodes)
+        {
+            node->cancelled.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    void TaskGraph::cancel()
+    {
+        m_cancelled = true;
+    }
+
+    void TaskGraph::cancel(Node* node)
+    {
+        node->cancelled = true;
+    }
+
+    void TaskGraph::schedule(Node* node)
+    {
+        m_queue.enqueue([this, node]
+        {
+            execute(node);
+        });
+    }
+
+    void TaskGraph::execute(Node* node)
+    {
+        // Continuation passing: one ready successor is run on this worker right away,
+        // the others are scheduled to the pool.
+        while (node)
+        {
+            if (!node->isCancelled() && !isCancelled())
+            {
+                node->func();
+            }
+
+            const bool cancelled = node->isCancelled() || isCancelled();
+
+            Node* next = nullptr;
+
+            for (Node* successor : node->successors)
+            {
+                if (cancelled)
+                {
+                    successor->cancelled.store(true, std::memory_order_release);
+                }
+
+                if (successor->pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    if (!next)
+                    {
+                        next = successor;
+                    }
+                    else
+                    {
+                        schedule(successor);
+                    }
+                }
+            }
+
+            node = next;
+        }
+    }
+
+    // ------------------------------------------------------------
+    // IntrusiveQueue
+    // ------------------------------------------------------------
+
+    namespace
+    {
+
+        /*
+            Intrusive multi-producer single-consumer FIFO (Vyukov's non-blocking MPSC
+            node queue). Producers link nodes with one atomic exchange, the consumer
+            pops without atomic read-modify-write operations. Unlike a queue with per
+            producer sub-queues the order is the order of the exchanges, so causally
+            ordered enqueues from different threads keep their order.
+
+            pop() can miss a node while its producer is between the exchange and
+            linking it; producers signal the consumer after linking so it retries.
+        */
+
+        template <typename Node>
+        class IntrusiveQueue
+        {
+        protected:
+            alignas(64) std::atomic<Node*> m_head;
+            alignas(64) Node* m_tail;
+            Node m_stub;
+
+        public:
+            IntrusiveQueue()
+                : m_head(&m_stub)
+                , m_tail(&m_stub)
+            {
+            }
+
+            // link a chain of nodes (first..last already linked by next)
+            void push(Node* first, Node* last)
+            {
+                last->next.store(nullptr, std::memory_order_relaxed);
+                Node* prev = m_head.exchange(last, std::memory_order_seq_cst);
+                prev->next.store(first, std::memory_order_release);
+            }
+
+            void push(Node* node)
+            {
+                push(node, node);
+            }
+
+            Node* pop()
+            {
+                Node* tail = m_tail;
+                Node* next = tail->next.load(std::memory_order_acquire);
+
+                if (tail == &m_stub)
+                {
+                    if (!next)
+                    {
+                        return nullptr;
+                    }
+
+                    m_tail = next;
+                    tail = next;
+                    next = next->next.load(std::memory_order_acquire);
+                }
+
+                if (next)
+                {
+                    m_tail = next;
+                    return tail;
+                }
+
+                if (tail != m_head.load(std::memory_order_acquire))
+                {
+                    // producer has not linked the next node yet
+                    return nullptr;
+                }
+
+                push(&m_stub);
+
+                next = tail->next.load(std::memory_order_acquire);
+                if (next)
+                {
+                    m_tail = next;
+                    return tail;
+                }
+
+                return nullptr;
+            }
+        };
+
+        /*
+            Parking for the (single) consumer thread of a lock-free queue. The consumer
+            raises the parked flag with prepare(), re-checks the queue and then sleeps
+            in an atomic wait until the epoch changes. The first producer to see the
+            flag clears it and wakes the consumer; everybody else pays only a load,
+            also while the woken consumer is waiting to be scheduled.
+        */
+
+        class EventCount
+        {
+        protected:
+            std::atomic<u32> m_epoch { 0 };
+            std::atomic<u32> m_parked { 0 };
+
+        public:
+            u32 prepare()
+            {
+                m_parked.store(1, std::memory_order_seq_cst);
+                u32 epoch = m_epoch.load(std::memory_order_seq_cst);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return epoch;
+            }
+
+            void cancel()
+            {
+                m_parked.store(0, std::memory_order_relaxed);
+            }
+
+            void wait(u32 epoch)
+            {
+                m_epoch.wait(epoch, std::memory_order_seq_cst);
+                m_parked.store(0, std::memory_order_relaxed);
+            }
+
+            // call after a sequentially consistent store or read-modify-write which
+            // published the work (IntrusiveQueue::push() is one)
+            void notify()
+            {
+                if (m_parked.load(std::memory_order_seq_cst) && m_parked.exchange(0, std::memory_order_seq_cst))
+                {
+                    m_epoch.fetch_add(1, std::memory_order_seq_cst);
+                    m_epoch.notify_one();
+                }
+            }
+        };
+
+    } // namespace
+
     // ------------------------------------------------------------
     // SerialQueue
     // ------------------------------------------------------------
 
+    struct SerialQueue::TaskQueue
+    {
+        struct Node
+        {
+            std::atomic<Node*> next { nullptr };
+            u32 generation = 0;
+            TaskFunction func;
+
+            static void* operator new (size_t size)
+            {
+                return TaskFunction::allocate(size);
+            }
+
+            static void operator delete (void* ptr)
+            {
+                TaskFunction::deallocate(ptr);
+            }
+        };
+
+        IntrusiveQueue<Node> tasks;
+        EventCount event;
+
+        // cancel() starts a new generation; tasks from older generations are discarded
+        alignas(64) std::atomic<u32> generation { 0 };
+
+        ~TaskQueue()
+        {
+            while (Node* node = tasks.pop())
+            {
+                delete node;
+            }
+        }
+    };
+
     SerialQueue::SerialQueue()
-        : m_name("serial.default")
+        : SerialQueue("serial.default")
     {
-        m_thread = std::thread([this] {
-            thread();
-        });
     }
 
     SerialQueue::SerialQueue(const std::string& name)
         : m_name(name)
+        , m_queue(nullptr)
     {
+        m_queue = new TaskQueue();
         m_thread = std::thread([this] {
             thread();
         });
@@ -571,53 +1580,77 @@ namespace mango
     {
         wait();
 
-        std::unique_lock<std::mutex> queue_lock(m_queue_mutex);
         m_stop = true;
-        queue_lock.unlock();
+        m_queue->event.notify();
 
-        m_task_condition.notify_one();
         m_thread.join();
+        delete m_queue;
+    }
+
+    void SerialQueue::enqueue_task(TaskFunction&& func)
+    {
+        TaskQueue::Node* node = new TaskQueue::Node;
+        node->generation = m_queue->generation.load(std::memory_order_acquire);
+        node->func = std::move(func);
+
+        ++m_task_counter;
+        m_queue->tasks.push(node);
+        m_queue->event.notify();
     }
 
     void SerialQueue::thread()
     {
         while (!m_stop.load(std::memory_order_relaxed))
         {
-            std::unique_lock<std::mutex> queue_lock(m_queue_mutex);
-            if (m_task_counter > 0)
+            TaskQueue::Node* node = m_queue->tasks.pop();
+            if (!node)
             {
-                auto task = std::move(m_task_queue.front());
-                m_task_queue.pop_front();
-                queue_lock.unlock();
+                u32 epoch = m_queue->event.prepare();
 
-                task();
-
-                std::lock_guard<std::mutex> wait_lock(m_wait_mutex);
-                --m_task_counter;
-                if (m_task_counter == 0)
+                node = m_queue->tasks.pop();
+                if (node || m_stop.load(std::memory_order_relaxed))
+                {
+                    m_queue->event.cancel();
+                }
+                else
                 {
-                    m_wait_condition.notify_all();
+                    m_queue->event.wait(epoch);
+                    continue;
                 }
             }
-            else
+
+            if (!node)
+            {
+                continue;
+            }
+
+            if (node->generation == m_queue->generation.load(std::memory_order_acquire))
+            {
+                node->func();
+            }
+
+            delete node;
+
+            if (m_task_counter.fetch_sub(1, std::memory_order_acq_rel) == 1)
             {
-                m_wait_condition.notify_all();
-                m_task_condition.wait(queue_lock, [this] { return m_stop || m_task_counter; });
+                m_task_counter.notify_all();
             }
         }
     }
 
     void SerialQueue::cancel()
     {
-        std::lock_guard<std::mutex> queue_lock(m_queue_mutex);
-        m_task_counter -= m_task_queue.size();
-        m_task_queue.clear();
+        // the execution thread discards the tasks enqueued before this call
+        m_queue->generation.fetch_add(1, std::memory_order_acq_rel);
     }
 
     void SerialQueue::wait()
     {
-        std::unique_lock<std::mutex> wait_lock(m_wait_mutex);
-        m_wait_condition.wait(wait_lock, [this] { return !m_task_counter.load(std::memory_order_relaxed); });
+        size_t count;
+        while ((count = m_task_counter.load(std::memory_order_acquire)) != 0)
+        {
+            m_task_counter.wait(count, std::memory_order_acquire);
+        }
     }
 
     // ------------------------------------------------------------
@@ -625,54 +1658,89 @@ namespace mango
     // ------------------------------------------------------------
 
     TicketQueue::Ticket::Ticket()
-        : task(std::make_shared<Task>())
     {
     }
 
     TicketQueue::Ticket::~Ticket()
     {
-        if (!--task->count)
-        {
-            if (!task->func)
-            {
-                task->promise.set_value();
-            }
-        }
+        release();
     }
 
     TicketQueue::Ticket::Ticket(const Ticket& ticket)
     {
-        task = ticket.task;
-        task->count++;
+        attach(ticket.task);
     }
 
     const TicketQueue::Ticket& TicketQueue::Ticket::operator = (const Ticket& ticket)
     {
         if (this != &ticket)
         {
-            if (!--task->count)
-            {
-                if (!task->func)
-                {
-                    task->promise.set_value();
-                }
-            }
-
-            task = ticket.task;
-            task->count++;
+            release();
+            attach(ticket.task);
         }
 
         return *this;
     }
 
+    void TicketQueue::Ticket::attach(Task* task)
+    {
+        if (task)
+        {
+            task->holders.fetch_add(1, std::memory_order_relaxed);
+            task->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        this->task = task;
+    }
+
+    void TicketQueue::Ticket::release()
+    {
+        if (!task)
+        {
+            return;
+        }
+
+        if (task->holders.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            // last ticket gone; skip the task if it was never consumed
+            signal();
+        }
+
+        if (task->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete task;
+        }
+
+        task = nullptr;
+    }
+
+    void TicketQueue::Ticket::signal() const
+    {
+        if (task->state.exchange(Task::Ready, std::memory_order_acq_rel) == Task::Waiting)
+        {
+            task->state.notify_one();
+        }
+    }
+
     // ------------------------------------------------------------
     // TicketQueue
     // ------------------------------------------------------------
 
     struct TicketQueue::TaskQueue
     {
-        using Task = TicketQueue::SharedTask;
-        moodycamel::ReaderWriterQueue<Task> tasks;
+        IntrusiveQueue<Task> tasks;
+        EventCount event;
+
+        ~TaskQueue()
+        {
+            while (Task* task = tasks.pop())
+            {
+                if (task->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    delete task;
+                }
+            }
+        }
     };
 
     TicketQueue::TicketQueue()
@@ -685,8 +1753,16 @@ namespace mango
             {
                 if (!dequeue_and_process())
                 {
-                    std::unique_lock<std::mutex> lock(m_consume_mutex);
-                    m_consume_condition.wait(lock, [this] { return m_stop || m_queue->tasks.peek(); });
+                    u32 epoch = m_queue->event.prepare();
+
+                    if (m_stop.load(std::memory_order_relaxed) || dequeue_and_process())
+                    {
+                        m_queue->event.cancel();
+                    }
+                    else
+                    {
+                        m_queue->event.wait(epoch);
+                    }
                 }
             }
         });
@@ -696,10 +1772,8 @@ namespace mango
     {
         wait();
 
-        std::unique_lock<std::mutex> lock(m_consume_mutex);
         m_stop = true;
-        lock.unlock();
-        m_consume_condition.notify_one();
+        m_queue->event.notify();
 
         m_thread.join();
         delete m_queue;
@@ -707,61 +1781,103 @@ namespace mango
 
     bool TicketQueue::dequeue_and_process()
     {
-        bool processed = false;
+        Task* task = m_queue->tasks.pop();
+        if (!task)
+        {
+            return false;
+        }
+
+        // park until the ticket is consumed (or released without consume)
+        u32 state = Task::Pending;
+        if (task->state.compare_exchange_strong(state, Task::Waiting, std::memory_order_acq_rel))
+        {
+            state = Task::Waiting;
+        }
 
-        SharedTask task;
-        if (m_queue->tasks.try_dequeue(task))
+        while (state != Task::Ready)
         {
-            std::future<void> future = task->promise.get_future();
-            future.wait();
+            task->state.wait(state, std::memory_order_acquire);
+            state = task->state.load(std::memory_order_acquire);
+        }
 
-            if (task->func)
-            {
-                task->func();
-            }
+        if (task->func)
+        {
+            task->func();
+            task->func.reset();
+        }
 
-            std::lock_guard<std::mutex> wait_lock(m_wait_mutex);
-            if (!--m_ticket_counter)
-            {
-                m_wait_condition.notify_one();
-            }
+        if (task->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            delete task;
+        }
 
-            processed = true;
+        if (m_ticket_counter.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            m_ticket_counter.notify_all();
         }
 
-        return processed;
+        return true;
     }
 
     TicketQueue::Ticket TicketQueue::acquire()
     {
-        std::lock_guard<std::mutex> wait_lock(m_wait_mutex);
-        ++m_ticket_counter;
+        Task* task = new Task;
+
         Ticket ticket;
-        m_queue->tasks.enqueue(ticket.task);
-        m_consume_condition.notify_one();
+        ticket.attach(task); // the queue keeps the initial reference
+
+        ++m_ticket_counter;
+        m_queue->tasks.push(task);
+        m_queue->event.notify();
+
         return ticket;
     }
 
     std::vector<TicketQueue::Ticket> TicketQueue::acquire(size_t count)
     {
-        std::lock_guard<std::mutex> wait_lock(m_wait_mutex);
-        m_ticket_counter += count;
         std::vector<TicketQueue::Ticket> tickets(count);
 
+        if (!count)
+        {
+            return tickets;
+        }
+
+        // link the tickets locally and publish them with one exchange so that
+        // the batch is contiguous in the queue
+        Task* first = nullptr;
+        Task* last = nullptr;
+
         for (size_t i = 0; i < count; ++i)
         {
-            m_queue->tasks.enqueue(tickets[i].task);
+            Task* task = new Task;
+            tickets[i].attach(task);
+
+            if (last)
+            {
+                last->next.store(task, std::memory_order_relaxed);
+            }
+            else
+            {
+                first = task;
+            }
+
+            last = task;
         }
 
-        m_consume_condition.notify_one();
+        m_ticket_counter += count;
+        m_queue->tasks.push(first, last);
+        m_queue->event.notify();
 
         return tickets;
     }
 
     void TicketQueue::wait()
     {
-        std::unique_lock<std::mutex> wait_lock(m_wait_mutex);
-        m_wait_condition.wait(wait_lock, [this] { return !m_ticket_counter.load(std::memory_order_relaxed); });
+        size_t count;
+        while ((count = m_ticket_counter.load(std::memory_order_acquire)) != 0)
+        {
+            m_ticket_counter.wait(count, std::memory_order_acquire);
+        }
     }
 
 } // namespace mango
@@ -13,7 +13,7 @@ namespace mango::filesystem
     // File
     // -----------------------------------------------------------------
 
-    File::File(const std::string& s)
+    File::File(const std::string& s, u32 hints)
     {
         // split s into pathname + filename
         size_t n = getPathSeparatorIndex(s);
@@ -24,10 +24,10 @@ namespace mango::filesystem
 
         // create a internal path
         m_path = std::make_unique<Path>(filepath);
-        initMemory(*m_path);
+        initMemory(*m_path, hints);
     }
 
-    File::File(const Path& path, const std::string& s)
+    File::File(const Path& path, const std::string& s, u32 hints)
     {
         // split s into pathname + filename
         size_t n = getPathSeparatorIndex(s);
@@ -38,7 +38,7 @@ namespace mango::filesystem
 
         // create a internal path
         m_path = std::make_unique<Path>(path, filepath);
-        initMemory(*m_path);
+        initMemory(*m_path, hints);
     }
 
     File::File(ConstMemory memory, const std::string& extension, const std::string& s)
@@ -56,16 +56,16 @@ namespace mango::filesystem
 
         // create a internal path
         m_path = std::make_unique<Path>(path, filepath);
-        initMemory(*m_path);
+        initMemory(*m_path, 0);
     }
 
     File::~File()
     {
     }
 
-    void File::initMemory(Mapper& mapper)
+    void File::initMemory(Mapper& mapper, u32 hints)
     {
-        m_virtual_memory = mapper.map(m_filename);
+        m_virtual_memory = mapper.map(m_filename, hints);
         if (m_virtual_memory)
         {
             m_memory = *m_virtual_memory;
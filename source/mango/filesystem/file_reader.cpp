@@ -0,0 +1,875 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <new>
+#include <mutex>
+#include <thread>
+#include <mango/core/exception.hpp>
+#include <mango/filesystem/file.hpp>
+#include <mango/filesystem/filereader.hpp>
+
+#if defined(MANGO_PLATFORM_UNIX)
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+#if defined(MANGO_PLATFORM_LINUX) && __has_include(<linux/io_uring.h>)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define MANGO_IO_URING
+#endif
+#endif
+
+namespace
+{
+    using namespace mango;
+    using namespace mango::filesystem;
+
+    // NOTE: split large reads to stay below platform syscall limits (see file_stream.cpp)
+    constexpr u64 max_io_chunk_size = 1ull << 28;
+
+    // maximum number of blocking I/O threads
+    constexpr u32 max_io_threads = 16;
+
+    struct ReadBatch
+    {
+        std::vector<FileReadRequest> requests;
+        FileReadCallback callback;
+    };
+
+    struct ReadTask
+    {
+        std::shared_ptr<ReadBatch> batch;
+        size_t index = 0;
+
+        const FileReadRequest& request() const
+        {
+            return batch->requests[index];
+        }
+    };
+
+    bool isValidRequest(const FileReadRequest& request)
+    {
+        // the capacity of a caller buffer is known only when the size is given
+        return request.size || !request.dest;
+    }
+
+    u64 getReadSize(const FileReadRequest& request, u64 file_size)
+    {
+        if (request.size)
+        {
+            return request.size;
+        }
+
+        return file_size > request.offset ? file_size - request.offset : 0;
+    }
+
+    // returns false when the buffer can't be allocated; this runs on the I/O threads
+    // where an exception would terminate the process
+    bool getReadBuffer(u8*& dest, FileReadResult& result, const FileReadRequest& request, u64 size)
+    {
+        if (request.dest)
+        {
+            dest = request.dest;
+            return true;
+        }
+
+        if (size > u64(std::numeric_limits<size_t>::max()))
+        {
+            return false;
+        }
+
+        try
+        {
+            result.buffer = std::make_unique<Buffer>(size_t(size));
+        }
+        catch (const std::bad_alloc&)
+        {
+            return false;
+        }
+
+        dest = result.buffer->data();
+
+        // the buffer doesn't throw when its storage can't be allocated
+        if (size && !dest)
+        {
+            result.buffer.reset();
+            return false;
+        }
+
+        return true;
+    }
+
+#if defined(MANGO_PLATFORM_UNIX)
+
+    void readBlocking(FileReadResult& result, const FileReadRequest& request)
+    {
+        if (!isValidRequest(request))
+        {
+            return;
+        }
+
+        int file = ::open(request.filename.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0)
+        {
+            return;
+        }
+
+        u64 file_size = 0;
+
+        struct stat sb;
+        if (!request.size && ::fstat(file, &sb) == 0)
+        {
+            file_size = u64(sb.st_size);
+        }
+
+        const u64 size = getReadSize(request, file_size);
+        u8* dest = nullptr;
+        if (!getReadBuffer(dest, result, request, size))
+        {
+            ::close(file);
+            return;
+        }
+
+        u64 total = 0;
+
+        while (total < size)
+        {
+            const u64 commit = std::min(size - total, max_io_chunk_size);
+            ssize_t bytes_read = ::pread(file, dest + total, size_t(commit), off_t(request.offset + total));
+            if (bytes_read < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+
+                ::close(file);
+                return;
+            }
+
+            if (bytes_read == 0)
+            {
+                break;
+            }
+
+            total += u64(bytes_read);
+        }
+
+        ::close(file);
+
+        result.memory = ConstMemory(dest, size_t(total));
+        result.status = true;
+    }
+
+#else
+
+    void readBlocking(FileReadResult& result, const FileReadRequest& request)
+    {
+        if (!isValidRequest(request))
+        {
+            return;
+        }
+
+        try
+        {
+            InputFileStream file(request.filename, 0);
+
+            const u64 size = getReadSize(request, request.size ? 0 : file.size());
+            u8* dest = nullptr;
+            if (!getReadBuffer(dest, result, request, size))
+            {
+                return;
+            }
+
+            file.seek(s64(request.offset), Stream::SeekMode::Begin);
+            const u64 bytes = file.read(dest, size);
+
+            result.memory = ConstMemory(dest, size_t(bytes));
+            result.status = true;
+        }
+        catch (const Exception&)
+        {
+        }
+    }
+
+#endif
+
+#if defined(MANGO_IO_URING)
+
+    // -----------------------------------------------------------------
+    // Uring
+    // -----------------------------------------------------------------
+
+    // Minimal io_uring driven with the raw system calls; the kernel headers are
+    // enough and there is no dependency on liburing. One thread owns the ring.
+
+    class Uring : protected NonCopyable
+    {
+    protected:
+        int m_ring = -1;
+        u32 m_entries = 0;
+
+        void* m_sq_ptr = MAP_FAILED;
+        void* m_cq_ptr = MAP_FAILED;
+        size_t m_sq_size = 0;
+        size_t m_cq_size = 0;
+
+        io_uring_sqe* m_sqes = reinterpret_cast<io_uring_sqe*>(MAP_FAILED);
+        size_t m_sqes_size = 0;
+
+        u32* m_sq_head = nullptr;
+        u32* m_sq_tail = nullptr;
+        u32* m_sq_array = nullptr;
+        u32 m_sq_mask = 0;
+
+        u32* m_cq_head = nullptr;
+        u32* m_cq_tail = nullptr;
+        io_uring_cqe* m_cqes = nullptr;
+        u32 m_cq_mask = 0;
+
+        void release()
+        {
+            if (m_sqes != MAP_FAILED)
+            {
+                ::munmap(m_sqes, m_sqes_size);
+                m_sqes = reinterpret_cast<io_uring_sqe*>(MAP_FAILED);
+            }
+
+            if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr)
+            {
+                ::munmap(m_cq_ptr, m_cq_size);
+            }
+
+            if (m_sq_ptr != MAP_FAILED)
+            {
+                ::munmap(m_sq_ptr, m_sq_size);
+            }
+
+            m_sq_ptr = MAP_FAILED;
+            m_cq_ptr = MAP_FAILED;
+
+            if (m_ring >= 0)
+            {
+                ::close(m_ring);
+                m_ring = -1;
+            }
+        }
+
+    public:
+        Uring(u32 entries)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+
+            // fails with ENOSYS on old kernels and EPERM when disabled or filtered
+            m_ring = int(::syscall(__NR_io_uring_setup, entries, &params));
+            if (m_ring < 0)
+            {
+                m_ring = -1;
+                return;
+            }
+
+            m_sq_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+            m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+            bool single_mmap = false;
+#if defined(IORING_FEAT_SINGLE_MMAP)
+            single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+#endif
+            if (single_mmap)
+            {
+                m_sq_size = std::max(m_sq_size, m_cq_size);
+                m_cq_size = m_sq_size;
+            }
+
+            m_sq_ptr = ::mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQ_RING);
+            if (m_sq_ptr == MAP_FAILED)
+            {
+                release();
+                return;
+            }
+
+            if (single_mmap)
+            {
+                m_cq_ptr = m_sq_ptr;
+            }
+            else
+            {
+                m_cq_ptr = ::mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_CQ_RING);
+                if (m_cq_ptr == MAP_FAILED)
+                {
+                    release();
+                    return;
+                }
+            }
+
+            m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqes = ::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED)
+            {
+                release();
+                return;
+            }
+
+            m_sqes = reinterpret_cast<io_uring_sqe*>(sqes);
+
+            u8* sq = reinterpret_cast<u8*>(m_sq_ptr);
+            m_sq_head = reinterpret_cast<u32*>(sq + params.sq_off.head);
+            m_sq_tail = reinterpret_cast<u32*>(sq + params.sq_off.tail);
+            m_sq_array = reinterpret_cast<u32*>(sq + params.sq_off.array);
+            m_sq_mask = *reinterpret_cast<u32*>(sq + params.sq_off.ring_mask);
+
+            u8* cq = reinterpret_cast<u8*>(m_cq_ptr);
+            m_cq_head = reinterpret_cast<u32*>(cq + params.cq_off.head);
+            m_cq_tail = reinterpret_cast<u32*>(cq + params.cq_off.tail);
+            m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            m_cq_mask = *reinterpret_cast<u32*>(cq + params.cq_off.ring_mask);
+
+            m_entries = params.sq_entries;
+        }
+
+        ~Uring()
+        {
+            release();
+        }
+
+        bool isValid() const
+        {
+            return m_ring >= 0;
+        }
+
+        u32 entries() const
+        {
+            return m_entries;
+        }
+
+        // The caller keeps at most entries() reads in flight so the queues can't overflow.
+        void readv(int file, const iovec* iov, u64 offset, u64 user_data)
+        {
+            const u32 tail = *m_sq_tail;
+            const u32 index = tail & m_sq_mask;
+
+            io_uring_sqe* sqe = m_sqes + index;
+            std::memset(sqe, 0, sizeof(io_uring_sqe));
+
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = file;
+            sqe->off = offset;
+            sqe->addr = u64(reinterpret_cast<uintptr_t>(iov));
+            sqe->len = 1;
+            sqe->user_data = user_data;
+
+            m_sq_array[index] = index;
+            std::atomic_ref<u32>(*m_sq_tail).store(tail + 1, std::memory_order_release);
+        }
+
+        // submit the queued reads and wait for at least one completion
+        bool submitAndWait()
+        {
+            const u32 head = std::atomic_ref<u32>(*m_sq_head).load(std::memory_order_acquire);
+            const u32 submit = *m_sq_tail - head;
+
+            int status = int(::syscall(__NR_io_uring_enter, m_ring, submit, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+            return status >= 0 || errno == EINTR || errno == EAGAIN || errno == EBUSY;
+        }
+
+        // Take back the reads which the kernel has not consumed from the submission
+        // queue; returns their user data. The ring must not be submitted to afterwards.
+        std::vector<u64> cancelUnsubmitted()
+        {
+            const u32 head = std::atomic_ref<u32>(*m_sq_head).load(std::memory_order_acquire);
+            const u32 tail = *m_sq_tail;
+
+            std::vector<u64> user_data;
+
+            for (u32 i = head; i != tail; ++i)
+            {
+                user_data.push_back(m_sqes[m_sq_array[i & m_sq_mask]].user_data);
+            }
+
+            std::atomic_ref<u32>(*m_sq_tail).store(head, std::memory_order_release);
+
+            return user_data;
+        }
+
+        // wait for a completion without submitting; sleeps when the system call fails
+        void wait()
+        {
+            int status = int(::syscall(__NR_io_uring_enter, m_ring, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (status < 0 && errno != EINTR)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        template <typename Func>
+        void complete(Func&& func)
+        {
+            u32 head = *m_cq_head;
+            const u32 tail = std::atomic_ref<u32>(*m_cq_tail).load(std::memory_order_acquire);
+
+            for ( ; head != tail; ++head)
+            {
+                const io_uring_cqe& cqe = m_cqes[head & m_cq_mask];
+                const u64 user_data = cqe.user_data;
+                const s32 result = cqe.res;
+
+                std::atomic_ref<u32>(*m_cq_head).store(head + 1, std::memory_order_release);
+                func(user_data, result);
+            }
+        }
+    };
+
+#endif // defined(MANGO_IO_URING)
+
+} // namespace
+
+namespace mango::filesystem
+{
+
+    // -----------------------------------------------------------------
+    // FileReaderState
+    // -----------------------------------------------------------------
+
+    struct FileReaderState
+    {
+        std::mutex m_mutex;
+        std::condition_variable m_task_condition;
+        std::condition_variable m_done_condition;
+        std::deque<ReadTask> m_tasks;
+        size_t m_pending = 0; // queued and in flight
+        size_t m_failed = 0;
+        bool m_stop = false;
+
+        const char* m_backend = "threads";
+        std::vector<std::thread> m_threads;
+
+        FileReaderState(u32 queue_depth, bool uring)
+        {
+#if defined(MANGO_IO_URING)
+            if (uring)
+            {
+                auto ring = std::make_unique<Uring>(queue_depth);
+                if (ring->isValid())
+                {
+                    m_backend = "io_uring";
+                    m_threads.emplace_back([this, ring = std::move(ring)]
+                    {
+                        runUring(*ring);
+                    });
+                    return;
+                }
+            }
+#else
+            MANGO_UNREFERENCED(uring);
+#endif
+
+            const u32 count = std::min(queue_depth, max_io_threads);
+            for (u32 i = 0; i < count; ++i)
+            {
+                m_threads.emplace_back([this]
+                {
+                    runThread();
+                });
+            }
+        }
+
+        ~FileReaderState()
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_stop = true;
+            }
+
+            m_task_condition.notify_all();
+
+            for (auto& thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        void enqueue(std::shared_ptr<ReadBatch> batch)
+        {
+            {
+                std::lock_guard lock(m_mutex);
+
+                for (size_t i = 0; i < batch->requests.size(); ++i)
+                {
+                    m_tasks.push_back({ batch, i });
+                }
+
+                m_pending += batch->requests.size();
+            }
+
+            m_task_condition.notify_all();
+        }
+
+        // blocking pop returns false when the reader is stopped; non-blocking when empty
+        bool dequeue(ReadTask& task, bool block)
+        {
+            std::unique_lock lock(m_mutex);
+
+            if (block)
+            {
+                m_task_condition.wait(lock, [this]
+                {
+                    return m_stop || !m_tasks.empty();
+                });
+            }
+
+            if (m_tasks.empty())
+            {
+                return false;
+            }
+
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+
+            return true;
+        }
+
+        void complete(ReadTask& task, FileReadResult&& result)
+        {
+            bool status = result.status;
+
+            if (task.batch->callback)
+            {
+                try
+                {
+                    task.batch->callback(std::move(result));
+                }
+                catch (...)
+                {
+                    status = false;
+                }
+            }
+
+            task.batch.reset();
+
+            std::lock_guard lock(m_mutex);
+
+            if (!status)
+            {
+                ++m_failed;
+            }
+
+            if (--m_pending == 0)
+            {
+                m_done_condition.notify_all();
+            }
+        }
+
+        size_t wait()
+        {
+            std::unique_lock lock(m_mutex);
+
+            m_done_condition.wait(lock, [this]
+            {
+                return m_pending == 0;
+            });
+
+            size_t failed = m_failed;
+            m_failed = 0;
+
+            return failed;
+        }
+
+        void runThread()
+        {
+            ReadTask task;
+
+            while (dequeue(task, true))
+            {
+                FileReadResult result;
+                result.index = task.index;
+
+                readBlocking(result, task.request());
+                complete(task, std::move(result));
+            }
+        }
+
+#if defined(MANGO_IO_URING)
+
+        struct UringRead
+        {
+            ReadTask task;
+            FileReadResult result;
+            int file = -1;
+            u8* dest = nullptr;
+            u64 size = 0;
+            u64 done = 0;
+            iovec iov;
+        };
+
+        // The kernel owns the buffers of the reads it has consumed until they complete,
+        // so those are reaped before anything is released. The reads in flight are
+        // then restarted with blocking reads.
+        void abandonRing(Uring& ring, std::vector<UringRead>& reads)
+        {
+            std::vector<bool> owned(reads.size(), false);
+            size_t inflight = 0;
+
+            for (size_t index = 0; index < reads.size(); ++index)
+            {
+                if (reads[index].task.batch)
+                {
+                    owned[index] = true;
+                    ++inflight;
+                }
+            }
+
+            for (u64 user_data : ring.cancelUnsubmitted())
+            {
+                owned[size_t(user_data)] = false;
+                --inflight;
+            }
+
+            while (inflight > 0)
+            {
+                ring.complete([&] (u64 user_data, s32 status)
+                {
+                    MANGO_UNREFERENCED(status);
+
+                    if (owned[size_t(user_data)])
+                    {
+                        owned[size_t(user_data)] = false;
+                        --inflight;
+                    }
+                });
+
+                if (inflight > 0)
+                {
+                    ring.wait();
+                }
+            }
+
+            for (UringRead& read : reads)
+            {
+                if (!read.task.batch)
+                {
+                    continue;
+                }
+
+                if (read.file >= 0)
+                {
+                    ::close(read.file);
+                    read.file = -1;
+                }
+
+                FileReadResult result;
+                result.index = read.task.index;
+
+                readBlocking(result, read.task.request());
+                complete(read.task, std::move(result));
+            }
+        }
+
+        void runUring(Uring& ring)
+        {
+            std::vector<UringRead> reads(ring.entries());
+            std::vector<u32> available;
+
+            for (u32 i = 0; i < ring.entries(); ++i)
+            {
+                available.push_back(ring.entries() - i - 1);
+            }
+
+            auto submit = [&] (u32 index)
+            {
+                UringRead& read = reads[index];
+                read.iov.iov_base = read.dest + read.done;
+                read.iov.iov_len = size_t(std::min(read.size - read.done, max_io_chunk_size));
+                ring.readv(read.file, &read.iov, read.task.request().offset + read.done, index);
+            };
+
+            auto finish = [&] (u32 index, bool status)
+            {
+                UringRead& read = reads[index];
+
+                if (read.file >= 0)
+                {
+                    ::close(read.file);
+                    read.file = -1;
+                }
+
+                if (status)
+                {
+                    read.result.memory = ConstMemory(read.dest, size_t(read.done));
+                    read.result.status = true;
+                }
+
+                complete(read.task, std::move(read.result));
+                read.result = FileReadResult();
+                available.push_back(index);
+            };
+
+            for (;;)
+            {
+                // start reads until the ring is full; block only when nothing is in flight
+                while (!available.empty())
+                {
+                    const bool idle = available.size() == reads.size();
+
+                    ReadTask task;
+                    if (!dequeue(task, idle))
+                    {
+                        if (idle)
+                        {
+                            return;
+                        }
+
+                        break;
+                    }
+
+                    const u32 index = available.back();
+                    available.pop_back();
+
+                    UringRead& read = reads[index];
+                    read.task = std::move(task);
+                    read.result.index = read.task.index;
+                    read.done = 0;
+
+                    const FileReadRequest& request = read.task.request();
+
+                    if (!isValidRequest(request))
+                    {
+                        finish(index, false);
+                        continue;
+                    }
+
+                    read.file = ::open(request.filename.c_str(), O_RDONLY | O_CLOEXEC);
+                    if (read.file < 0)
+                    {
+                        finish(index, false);
+                        continue;
+                    }
+
+                    u64 file_size = 0;
+
+                    struct stat sb;
+                    if (!request.size && ::fstat(read.file, &sb) == 0)
+                    {
+                        file_size = u64(sb.st_size);
+                    }
+
+                    read.size = getReadSize(request, file_size);
+                    if (!getReadBuffer(read.dest, read.result, request, read.size))
+                    {
+                        finish(index, false);
+                        continue;
+                    }
+
+                    if (!read.size)
+                    {
+                        finish(index, true);
+                        continue;
+                    }
+
+                    submit(index);
+                }
+
+                if (available.size() == reads.size())
+                {
+                    continue;
+                }
+
+                if (!ring.submitAndWait())
+                {
+                    // the ring is unusable; continue with blocking reads on this thread
+                    abandonRing(ring, reads);
+                    runThread();
+                    return;
+                }
+
+                ring.complete([&] (u64 user_data, s32 status)
+                {
+                    const u32 index = u32(user_data);
+                    UringRead& read = reads[index];
+
+                    if (status == -EINTR || status == -EAGAIN)
+                    {
+                        submit(index);
+                    }
+                    else if (status < 0)
+                    {
+                        finish(index, false);
+                    }
+                    else if (status == 0)
+                    {
+                        // end of file
+                        finish(index, true);
+                    }
+                    else
+                    {
+                        read.done += u64(status);
+                        if (read.done < read.size)
+                        {
+                            submit(index);
+                        }
+                        else
+                        {
+                            finish(index, true);
+                        }
+                    }
+                });
+            }
+        }
+
+#endif // defined(MANGO_IO_URING)
+    };
+
+    // -----------------------------------------------------------------
+    // AsyncFileReader
+    // -----------------------------------------------------------------
+
+    AsyncFileReader::AsyncFileReader(u32 queue_depth, bool uring)
+        : m_state(new FileReaderState(std::max(queue_depth, 1u), uring))
+    {
+    }
+
+    AsyncFileReader::~AsyncFileReader()
+    {
+        m_state->wait();
+        delete m_state;
+    }
+
+    const char* AsyncFileReader::backend() const
+    {
+        return m_state->m_backend;
+    }
+
+    void AsyncFileReader::read(const std::vector<FileReadRequest>& requests, FileReadCallback callback)
+    {
+        if (requests.empty())
+        {
+            return;
+        }
+
+        auto batch = std::make_shared<ReadBatch>();
+        batch->requests = requests;
+        batch->callback = std::move(callback);
+
+        m_state->enqueue(std::move(batch));
+    }
+
+    size_t AsyncFileReader::wait()
+    {
+        return m_state->wait();
+    }
+
+} // namespace mango::filesystem
@@ -10,9 +10,35 @@ namespace mango::filesystem::hbs
 
     namespace
     {
-        std::vector<File> readFileRecords(LittleEndianConstPointer p)
+        // length (4), size (8), checksum (4) and number of segments (4)
+        constexpr size_t file_record_size = 20;
+
+        // block (4), offset (8) and size (8)
+        constexpr size_t segment_record_size = 20;
+
+        // zstd can't represent more than 128 KB of output in a 4 byte block
+        constexpr u64 zstd_max_expansion = 32768;
+
+        std::vector<File> readFileRecords(ConstMemory memory)
         {
+            LittleEndianConstPointer p = memory.address;
+            const u8* end = memory.end();
+
+            auto remaining = [&] () -> size_t
+            {
+                return size_t(end - static_cast<const u8*>(p));
+            };
+
+            if (remaining() < 4)
+            {
+                MANGO_EXCEPTION("[hbs] Incorrect file records.");
+            }
+
             u32 count = p.read32();
+            if (count > remaining() / file_record_size)
+            {
+                MANGO_EXCEPTION("[hbs] Incorrect file record count.");
+            }
 
             std::vector<File> files;
             files.reserve(count);
@@ -21,7 +47,17 @@ namespace mango::filesystem::hbs
             {
                 File file;
 
+                if (remaining() < file_record_size)
+                {
+                    MANGO_EXCEPTION("[hbs] Incorrect file record.");
+                }
+
                 u32 length = p.read32();
+                if (length > remaining() - (file_record_size - 4))
+                {
+                    MANGO_EXCEPTION("[hbs] Incorrect filename length.");
+                }
+
                 const u8* ptr = p;
                 file.filename.assign(reinterpret_cast<const char*>(ptr), length);
                 p += length;
@@ -30,6 +66,11 @@ namespace mango::filesystem::hbs
                 file.checksum = p.read32();
 
                 u32 num_segments = p.read32();
+                if (num_segments > remaining() / segment_record_size)
+                {
+                    MANGO_EXCEPTION("[hbs] Incorrect file segment count.");
+                }
+
                 file.segments.reserve(num_segments);
 
                 for (u32 j = 0; j < num_segments; ++j)
@@ -49,6 +90,21 @@ namespace mango::filesystem::hbs
 
     } // namespace
 
+    void writeDictionaryArray(LittleEndianStream& output, const std::vector<ConstMemory>& dictionaries)
+    {
+        u32 count = u32(dictionaries.size());
+
+        output.write32(filesystem::HBS_MAGIC4);
+        output.write32(filesystem::HBS_VERSION);
+        output.write32(count);
+
+        for (auto &dictionary : dictionaries)
+        {
+            output.write32(u32(dictionary.size));
+            output.write(dictionary.address, dictionary.size);
+        }
+    }
+
     void writeBlockArray(LittleEndianStream& output, const std::vector<Block>& blocks)
     {
         u32 count = u32(blocks.size());
@@ -63,6 +119,7 @@ namespace mango::filesystem::hbs
             output.write64(block.compressed);
             output.write64(block.uncompressed);
             output.write32(block.method);
+            output.write32(block.dictionary);
         }
     }
 
@@ -113,16 +170,143 @@ namespace mango::filesystem::hbs
         output.write(compressed, status.size);
     }
 
-    void writeIndex(LittleEndianStream& output, u64 block_offset, u64 file_offset)
+    void writeIndex(LittleEndianStream& output, u64 block_offset, u64 file_offset, u64 dictionary_offset)
     {
+        output.write64(dictionary_offset);
         output.write32(filesystem::HBS_MAGIC3);
         output.write32(filesystem::HBS_VERSION);
         output.write64(block_offset);
         output.write64(file_offset);
     }
 
+    Index readIndex(ConstMemory archive)
+    {
+        constexpr u64 tail_size = 24;
+
+        if (archive.size < tail_size + 4)
+        {
+            MANGO_EXCEPTION("[hbs] Archive is too small.");
+        }
+
+        LittleEndianConstPointer p = archive.address;
+
+        u32 magic0 = p.read32();
+        if (magic0 != filesystem::HBS_MAGIC0)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect archive identifier ({:#x}).", magic0);
+        }
+
+        Index index;
+
+        index.index_offset = archive.size - tail_size;
+        p = archive.address + index.index_offset;
+
+        u32 magic3 = p.read32();
+        if (magic3 != filesystem::HBS_MAGIC3)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect index identifier ({:#x}).", magic3);
+        }
+
+        index.version = p.read32();
+        index.block_offset = p.read64();
+        index.file_offset = p.read64();
+        index.dictionary_offset = 0;
+
+        u32 major = index.version >> 8;
+
+        switch (major)
+        {
+            case 1:
+                break;
+
+            case 2:
+                // the dictionary offset is stored before the tail
+                if (archive.size < tail_size + 8 + 4)
+                {
+                    MANGO_EXCEPTION("[hbs] Archive is too small.");
+                }
+
+                index.index_offset -= 8;
+                p = archive.address + index.index_offset;
+                index.dictionary_offset = p.read64();
+                break;
+
+            default:
+                MANGO_EXCEPTION("[hbs] Unsupported version ({:#x}).", index.version);
+        }
+
+        u64 first = index.dictionary_offset ? index.dictionary_offset : index.block_offset;
+
+        if (first < 4 || first > index.block_offset ||
+            index.block_offset > index.file_offset ||
+            index.file_offset > index.index_offset)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect index.");
+        }
+
+        return index;
+    }
+
+    std::vector<ConstMemory> readDictionaryArray(ConstMemory memory)
+    {
+        if (memory.size < 12)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect dictionary array size.");
+        }
+
+        LittleEndianConstPointer start = memory.address;
+        LittleEndianConstPointer p = start;
+
+        u32 magic4 = p.read32();
+        if (magic4 != filesystem::HBS_MAGIC4)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect dictionary identifier ({:#x}).", magic4);
+        }
+
+        u32 version = p.read32();
+        MANGO_UNREFERENCED(version);
+
+        u32 count = p.read32();
+        if (count > (memory.size - 12) / 4)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect dictionary count.");
+        }
+
+        std::vector<ConstMemory> dictionaries;
+        dictionaries.reserve(count);
+
+        for (u32 i = 0; i < count; ++i)
+        {
+            if (memory.size - size_t(p - start) < 4)
+            {
+                MANGO_EXCEPTION("[hbs] Incorrect dictionary array size.");
+            }
+
+            u32 size = p.read32();
+            if (size > memory.size - size_t(p - start))
+            {
+                MANGO_EXCEPTION("[hbs] Incorrect dictionary size.");
+            }
+
+            dictionaries.emplace_back(p, size);
+            p += size;
+        }
+
+        if (size_t(p - start) != memory.size)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect dictionary array size.");
+        }
+
+        return dictionaries;
+    }
+
     std::vector<Block> readBlockArray(ConstMemory memory)
     {
+        if (memory.size < 12)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect block array size.");
+        }
+
         LittleEndianConstPointer start = memory.address;
         LittleEndianConstPointer p = start;
 
@@ -133,10 +317,14 @@ namespace mango::filesystem::hbs
         }
 
         u32 version = p.read32();
-        MANGO_UNREFERENCED(version);
-
         u32 count = p.read32();
 
+        const size_t block_size = version >= 0x0200 ? 32 : 28;
+        if (count > (memory.size - 12) / block_size)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect block array size.");
+        }
+
         std::vector<Block> blocks;
         blocks.reserve(count);
 
@@ -147,6 +335,7 @@ namespace mango::filesystem::hbs
             block.compressed = p.read64();
             block.uncompressed = p.read64();
             block.method = p.read32();
+            block.dictionary = version >= 0x0200 ? p.read32() : 0;
             blocks.push_back(block);
         }
 
@@ -160,6 +349,11 @@ namespace mango::filesystem::hbs
 
     std::vector<File> readFileArray(ConstMemory memory)
     {
+        if (memory.size < 24)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect file array size.");
+        }
+
         LittleEndianConstPointer start = memory.address;
         LittleEndianConstPointer p = start;
 
@@ -175,6 +369,16 @@ namespace mango::filesystem::hbs
         u64 compressed = p.read64();
         u64 uncompressed = p.read64();
 
+        if (compressed != memory.size - 24)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect file array size.");
+        }
+
+        if (uncompressed > compressed * zstd_max_expansion)
+        {
+            MANGO_EXCEPTION("[hbs] Incorrect uncompressed file array size.");
+        }
+
         ConstMemory source(p, compressed);
         Buffer temp(uncompressed);
 
@@ -191,7 +395,7 @@ namespace mango::filesystem::hbs
             MANGO_EXCEPTION("[hbs] Incorrect file array size.");
         }
 
-        return readFileRecords(temp.data());
+        return readFileRecords(temp);
     }
 
 } // namespace mango::filesystem::hbs
@@ -0,0 +1,203 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <mutex>
+#include <filesystem>
+#include <mango/core/hash.hpp>
+#include <mango/core/string.hpp>
+#include <mango/core/timer.hpp>
+#include <mango/filesystem/file.hpp>
+#include <mango/filesystem/path.hpp>
+#include "index_cache.hpp"
+
+namespace
+{
+    using namespace mango;
+    using namespace mango::filesystem;
+
+    constexpr u32 INDEX_CACHE_MAGIC = u32_mask('m', 'i', 'd', 'x');
+    constexpr u32 INDEX_CACHE_VERSION = 2;
+
+    struct CacheHeader
+    {
+        u32 magic;
+        u32 version;
+        u32 tag;
+        u32 reserved;
+        u64 checksum; // xx3hash64 of the payload
+    };
+
+    std::mutex g_cache_mutex;
+    std::string g_cache_folder;
+
+    std::string getCacheFolder()
+    {
+        std::lock_guard lock(g_cache_mutex);
+        return g_cache_folder;
+    }
+
+} // namespace
+
+namespace mango::filesystem
+{
+
+    void setIndexCacheFolder(const std::string& folder)
+    {
+        std::lock_guard lock(g_cache_mutex);
+
+        g_cache_folder = folder;
+        if (!g_cache_folder.empty() && g_cache_folder.back() != '/')
+        {
+            g_cache_folder.push_back('/');
+        }
+    }
+
+    // -----------------------------------------------------------------
+    // IndexCache
+    // -----------------------------------------------------------------
+
+    IndexCache::IndexCache(AbstractMapper* mapper, const std::string& archive)
+        : m_mapper(mapper)
+    {
+        const std::string folder = getCacheFolder();
+        if (folder.empty())
+        {
+            return;
+        }
+
+        std::error_code ec;
+
+        const std::filesystem::path path = std::filesystem::absolute(archive, ec);
+        if (ec)
+        {
+            return;
+        }
+
+        const u64 size = std::filesystem::file_size(path, ec);
+        if (ec)
+        {
+            return;
+        }
+
+        const auto time = std::filesystem::last_write_time(path, ec);
+        if (ec)
+        {
+            return;
+        }
+
+        // the key is stored in the cache file and compared when loading;
+        // the hash of the key only names the file
+        m_key = fmt::format("{}\n{}\n{}", path.string(), size, s64(time.time_since_epoch().count()));
+
+        ConstMemory key(reinterpret_cast<const u8*>(m_key.data()), m_key.length());
+        XX3H128 hash = xx3hash128(0, key);
+
+        m_filename = fmt::format("{}{:016x}{:016x}.idx", folder, hash.data[0], hash.data[1]);
+    }
+
+    IndexCache::~IndexCache()
+    {
+    }
+
+    ConstMemory IndexCache::load(u32 tag)
+    {
+        if (m_filename.empty() || !m_mapper->isFile(m_filename))
+        {
+            return {};
+        }
+
+        try
+        {
+            m_memory = m_mapper->map(m_filename, MapHint::ReadSmall);
+        }
+        catch (const Exception&)
+        {
+            return {};
+        }
+
+        if (!m_memory)
+        {
+            return {};
+        }
+
+        CacheReader reader(*m_memory);
+
+        CacheHeader header;
+        reader.read(header);
+        std::span<const char> key = reader.read<char>();
+
+        if (!reader.status() ||
+            header.magic != INDEX_CACHE_MAGIC ||
+            header.version != INDEX_CACHE_VERSION ||
+            header.tag != tag ||
+            std::string_view(key.data(), key.size()) != m_key)
+        {
+            // stale or from a different mapper; it will be overwritten by store()
+            m_memory.reset();
+            return {};
+        }
+
+        ConstMemory payload = reader.tail();
+        if (xx3hash64(0, payload) != header.checksum)
+        {
+            // damaged; the mappers validate the payload as well
+            m_memory.reset();
+            return {};
+        }
+
+        return payload;
+    }
+
+    void IndexCache::store(u32 tag, ConstMemory payload)
+    {
+        if (m_filename.empty())
+        {
+            return;
+        }
+
+        Buffer buffer;
+        CacheWriter writer(buffer);
+
+        CacheHeader header = { INDEX_CACHE_MAGIC, INDEX_CACHE_VERSION, tag, 0, xx3hash64(0, payload) };
+        writer.write(header);
+        writer.write(std::span<const char>(m_key.data(), m_key.length()));
+
+        // write into a temporary file and rename it so that concurrent opens
+        // never see a partially written cache file
+        const std::string temp = fmt::format("{}.{}.tmp", m_filename, Time::us());
+
+        std::error_code ec;
+        std::filesystem::create_directories(getPath(m_filename), ec);
+
+        try
+        {
+            OutputFileStream file(temp);
+            file.write(buffer.data(), buffer.size());
+            file.write(payload.address, payload.size);
+
+            if (!file.close())
+            {
+                std::filesystem::remove(temp, ec);
+                return;
+            }
+        }
+        catch (const Exception&)
+        {
+            std::filesystem::remove(temp, ec);
+            return;
+        }
+
+        std::filesystem::rename(temp, m_filename, ec);
+        if (ec)
+        {
+            std::filesystem::remove(temp, ec);
+        }
+    }
+
+    std::unique_ptr<VirtualMemory> IndexCache::release()
+    {
+        return std::move(m_memory);
+    }
+
+} // namespace mango::filesystem
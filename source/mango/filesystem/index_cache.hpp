@@ -0,0 +1,177 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <string>
+#include <memory>
+#include <span>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+#include <mango/core/configure.hpp>
+#include <mango/core/memory.hpp>
+#include <mango/core/buffer.hpp>
+#include <mango/filesystem/mapper.hpp>
+
+namespace mango::filesystem
+{
+
+    /*
+        Persistent archive index cache
+
+        Opening a large archive is dominated by parsing its directory. When a cache
+        folder is configured with setIndexCacheFolder() the archive mappers store
+        their parsed index into a file keyed on the archive's absolute path, size and
+        modification time. Later opens of the unchanged archive map the file and use
+        the arrays in place.
+
+        The payload is a sequence of 16 byte aligned arrays written with CacheWriter
+        and read back with CacheReader; the element type must be trivially copyable
+        and the element size is checked when reading. The cache files are private to
+        the machine which wrote them (native endianess and structure layout); the tag
+        passed to load() and store() identifies the mapper and its layout version.
+        A cache file with a stale key or a payload checksum mismatch is ignored, and
+        the mappers validate the loaded headers against the archive before use.
+    */
+
+    class CacheWriter
+    {
+    protected:
+        Buffer& m_buffer;
+
+        void align()
+        {
+            const size_t padding = (0 - m_buffer.size()) & 15;
+            m_buffer.append(padding, 0);
+        }
+
+    public:
+        CacheWriter(Buffer& buffer)
+            : m_buffer(buffer)
+        {
+        }
+
+        template <typename T>
+        void write(std::span<const T> data)
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+
+            const u64 header[] = { u64(data.size()), u64(sizeof(T)) };
+            m_buffer.append(header, sizeof(header));
+            m_buffer.append(data.data(), data.size_bytes());
+            align();
+        }
+
+        template <typename T>
+        void write(const T& value)
+        {
+            write(std::span<const T>(&value, 1));
+        }
+    };
+
+    class CacheReader
+    {
+    protected:
+        ConstMemory m_memory;
+        size_t m_offset { 0 };
+        bool m_status { true };
+
+    public:
+        CacheReader(ConstMemory memory)
+            : m_memory(memory)
+        {
+        }
+
+        // false if any read was out of bounds or had the wrong element size
+        bool status() const
+        {
+            return m_status;
+        }
+
+        template <typename T>
+        std::span<const T> read()
+        {
+            static_assert(std::is_trivially_copyable_v<T>);
+            static_assert(alignof(T) <= 16);
+
+            u64 header[2];
+
+            if (!m_status || m_memory.size - m_offset < sizeof(header))
+            {
+                m_status = false;
+                return {};
+            }
+
+            std::memcpy(header, m_memory.address + m_offset, sizeof(header));
+            m_offset += sizeof(header);
+
+            const u64 count = header[0];
+            const u64 available = (m_memory.size - m_offset) / sizeof(T);
+
+            if (header[1] != sizeof(T) || count > available)
+            {
+                m_status = false;
+                return {};
+            }
+
+            const T* data = reinterpret_cast<const T*>(m_memory.address + m_offset);
+            if (reinterpret_cast<uintptr_t>(data) % alignof(T))
+            {
+                m_status = false;
+                return {};
+            }
+
+            m_offset += size_t(count * sizeof(T));
+            m_offset = std::min(m_memory.size, (m_offset + 15) & ~size_t(15));
+
+            return std::span<const T>(data, size_t(count));
+        }
+
+        // memory after the arrays read so far
+        ConstMemory tail() const
+        {
+            return m_memory.slice(m_offset);
+        }
+
+        template <typename T>
+        bool read(T& value)
+        {
+            std::span<const T> data = read<T>();
+            if (data.size() != 1)
+            {
+                m_status = false;
+                return false;
+            }
+
+            value = data[0];
+            return true;
+        }
+    };
+
+    class IndexCache : protected NonCopyable
+    {
+    protected:
+        AbstractMapper* m_mapper;   // native filesystem mapper for reading the cache file
+        std::string m_filename;     // cache file; empty when the archive is not cached
+        std::string m_key;          // archive identity stored in the cache file
+        std::unique_ptr<VirtualMemory> m_memory;
+
+    public:
+        // archive is a native filesystem path which the mapper can map
+        IndexCache(AbstractMapper* mapper, const std::string& archive);
+        ~IndexCache();
+
+        // Payload of the cached index, empty if there is no valid cache for the archive.
+        // The memory stays valid until the cache is released.
+        ConstMemory load(u32 tag);
+
+        // Store the index of the archive; failures are ignored as the cache is optional.
+        void store(u32 tag, ConstMemory payload);
+
+        // Transfer the memory of the loaded payload to the caller.
+        std::unique_ptr<VirtualMemory> release();
+    };
+
+} // namespace mango::filesystem
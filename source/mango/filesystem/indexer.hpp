@@ -1,60 +1,547 @@
 /*
     MANGO Multimedia Development Platform
-    Copyright (C) 2012-2021 Twilight Finland 3D Oy Ltd. All rights reserved.
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
 */
 #pragma once
 
 #include <string>
-#include <map>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <mango/core/configure.hpp>
+#include <mango/core/memory.hpp>
+#include <mango/core/hash.hpp>
+#include "index_cache.hpp"
 
 namespace mango::filesystem
 {
 
+    /*
+        Flat archive index
+
+        The full paths of all entries are interned into a single arena; an entry is
+        a few integers referring to the arena and to the header array. finalize()
+        sorts the entries by (folder, name) so that each folder is a contiguous range
+        and builds two open addressing hash tables: full path -> entry and
+        folder path -> range. After finalize() the lookups are O(1) and the index is
+        read-only, so it can be shared between threads.
+
+        A finalized index can be saved into the persistent index cache and loaded
+        back; a loaded index uses the arrays in the cache memory in place.
+
+        Folder paths end with a '/' and the root folder is the empty string. An entry
+        is inserted into the folder which is a prefix of its path; inserting the same
+        path again replaces the previous header.
+    */
+
     template <typename Header>
-    class Indexer
+    class Indexer : protected NonCopyable
     {
+    protected:
+        struct Record
+        {
+            u32 offset;   // full path in the arena
+            u32 length;
+            u32 folder;   // length of the folder prefix
+            u32 header;   // index into m_headers
+        };
+
+        struct Range
+        {
+            u32 offset;   // folder path in the arena
+            u32 length;
+            u32 begin;    // records in the folder
+            u32 end;
+        };
+
     public:
-        struct Folder
+        struct Entry
         {
-            std::map<std::string, Header *> headers;
+            std::string_view name; // name inside the folder, "file.txt" or "folder/"
+            const Header& header;
+        };
+
+        class Folder
+        {
+        protected:
+            friend class Indexer;
+
+            const Indexer* m_indexer;
+            u32 m_begin;
+            u32 m_end;
+
+        public:
+            class Iterator
+            {
+            protected:
+                const Indexer* m_indexer;
+                u32 m_index;
+
+            public:
+                Iterator(const Indexer* indexer, u32 index)
+                    : m_indexer(indexer)
+                    , m_index(index)
+                {
+                }
+
+                Entry operator * () const
+                {
+                    const Record& record = m_indexer->m_record_view[m_index];
+                    const char* path = m_indexer->m_arena_view.data() + record.offset;
+                    std::string_view name(path + record.folder, record.length - record.folder);
+                    return { name, m_indexer->m_header_view[record.header] };
+                }
+
+                Iterator& operator ++ ()
+                {
+                    ++m_index;
+                    return *this;
+                }
+
+                bool operator != (const Iterator& other) const
+                {
+                    return m_index != other.m_index;
+                }
+            };
+
+            Iterator begin() const
+            {
+                return Iterator(m_indexer, m_begin);
+            }
+
+            Iterator end() const
+            {
+                return Iterator(m_indexer, m_end);
+            }
+
+            size_t size() const
+            {
+                return m_end - m_begin;
+            }
         };
 
     protected:
-        std::map<std::string, Folder> folders;
-        std::map<std::string, Header> headers;
+        std::vector<char> m_arena;
+        std::vector<Header> m_headers;
+        std::vector<Record> m_records;
+        std::vector<Range> m_ranges;
+        std::vector<Folder> m_folders;
+        std::vector<u32> m_record_table; // record index + 1, 0 = empty slot
+        std::vector<u32> m_folder_table; // range index + 1, 0 = empty slot
+        std::string m_last_folder;
+        std::vector<bool> m_synthesized; // by header index: folder created by insertPath()
+
+        // the finalized index is used through these; they refer to the arrays above
+        // or to the memory of a loaded index
+        std::span<const char> m_arena_view;
+        std::span<const Header> m_header_view;
+        std::span<const Record> m_record_view;
+        std::span<const Range> m_range_view;
+        std::span<const u32> m_record_table_view;
+        std::span<const u32> m_folder_table_view;
+
+        std::string_view getString(u32 offset, u32 length) const
+        {
+            return std::string_view(m_arena_view.data() + offset, length);
+        }
+
+        std::string_view getPath(const Record& record) const
+        {
+            return getString(record.offset, record.length);
+        }
+
+        std::string_view getFolderPath(const Record& record) const
+        {
+            return getString(record.offset, record.folder);
+        }
+
+        static
+        size_t getHash(std::string_view s)
+        {
+            // the tables are stored in the index cache so the hash must be stable
+            return size_t(xx3hash64(0, ConstMemory(reinterpret_cast<const u8*>(s.data()), s.length())));
+        }
+
+        static
+        std::vector<u32> createTable(size_t count)
+        {
+            // load factor of at most 0.5 keeps the probe sequences short
+            size_t size = 16;
+            while (size < count * 2)
+            {
+                size *= 2;
+            }
+            return std::vector<u32>(size, 0);
+        }
+
+        static
+        void insertTable(std::vector<u32>& table, std::string_view key, u32 value)
+        {
+            const size_t mask = table.size() - 1;
+            size_t slot = getHash(key) & mask;
+            while (table[slot])
+            {
+                slot = (slot + 1) & mask;
+            }
+            table[slot] = value + 1;
+        }
+
+        template <typename Compare>
+        static
+        const u32* findTable(std::span<const u32> table, std::string_view key, Compare compare)
+        {
+            if (table.empty())
+            {
+                return nullptr;
+            }
+
+            const size_t mask = table.size() - 1;
+            size_t slot = getHash(key) & mask;
+            while (table[slot])
+            {
+                if (compare(table[slot] - 1))
+                {
+                    return &table[slot];
+                }
+                slot = (slot + 1) & mask;
+            }
+
+            return nullptr;
+        }
+
+        static
+        bool isValidTable(std::span<const u32> table, size_t count)
+        {
+            if (table.empty())
+            {
+                return count == 0;
+            }
+
+            if (table.size() & (table.size() - 1))
+            {
+                // size must be a power of two
+                return false;
+            }
+
+            size_t used = 0;
+
+            for (u32 value : table)
+            {
+                if (value > count)
+                {
+                    return false;
+                }
+                used += value != 0;
+            }
+
+            // every value is in the table once and the probing needs an empty slot
+            return used == count && used < table.size();
+        }
+
+        void createFolders()
+        {
+            m_folders.resize(m_range_view.size());
+
+            for (size_t i = 0; i < m_range_view.size(); ++i)
+            {
+                m_folders[i].m_indexer = this;
+                m_folders[i].m_begin = m_range_view[i].begin;
+                m_folders[i].m_end = m_range_view[i].end;
+            }
+        }
 
     public:
-        void insert(const std::string& foldername, const std::string& filename, const Header& header)
+        Indexer()
+        {
+        }
+
+        ~Indexer()
+        {
+        }
+
+        static
+        std::string_view getParentFolder(std::string_view filename)
         {
-            Header* ptr = &headers[filename];
-            *ptr = header;
-            folders[foldername].headers[filename] = ptr;
+            // "a/b/c.txt" -> "a/b/", "a/b/" -> "a/", "a/" -> ""
+            if (filename.length() < 2)
+            {
+                return {};
+            }
+
+            size_t n = filename.find_last_of('/', filename.length() - 2);
+            if (n == std::string_view::npos)
+            {
+                return {};
+            }
+
+            return filename.substr(0, n + 1);
+        }
+
+        // Reserve memory for the entries stored in the archive and for their path
+        // bytes; some slack is added for the folders created by insertPath().
+        void reserve(size_t entries, size_t bytes)
+        {
+            entries += entries / 8;
+            m_arena.reserve(bytes);
+            m_headers.reserve(entries);
+            m_records.reserve(entries);
+            m_synthesized.reserve(entries);
+        }
+
+        void insert(std::string_view folder, std::string_view filename, const Header& header)
+        {
+            Record record;
+
+            record.offset = u32(m_arena.size());
+            record.length = u32(filename.length());
+            record.folder = u32(folder.length());
+            record.header = u32(m_headers.size());
+
+            m_arena.insert(m_arena.end(), filename.begin(), filename.end());
+            m_headers.push_back(header);
+            m_records.push_back(record);
+            m_synthesized.push_back(false);
         }
 
-        const Folder* getFolder(const std::string& pathname) const
+        // Insert filename and the folders leading to it. The folder entries which
+        // are not stored in the archive get the header returned by folder(header).
+        // Archives usually list the files of a folder together so the folders
+        // shared with the previous path are not inserted again. A folder which is
+        // stored in the archive keeps its own header even when it is also created
+        // here, in any order.
+        template <typename FolderHeader>
+        void insertPath(std::string_view filename, const Header& header, FolderHeader&& folder)
         {
-            const Folder* result = nullptr; // default: not found
+            std::string_view parent = getParentFolder(filename);
+            insert(parent, filename, header);
 
-            auto i = folders.find(pathname);
-            if (i != folders.end())
+            const bool is_folder = !filename.empty() && filename.back() == '/';
+            std::string_view indexed = is_folder ? filename : parent;
+
+            if (!parent.empty() && !std::string_view(m_last_folder).starts_with(parent))
             {
-                result = &i->second;
+                const Header temp = folder(header);
+
+                while (!parent.empty() && !std::string_view(m_last_folder).starts_with(parent))
+                {
+                    std::string_view path = parent;
+                    parent = getParentFolder(path);
+                    insert(parent, path, temp);
+                    m_synthesized.back() = true;
+                }
             }
 
-            return result;
+            m_last_folder.assign(indexed);
         }
 
-        const Header* getHeader(const std::string& filename) const
+        void finalize()
         {
-            const Header* result = nullptr; // default: not found
+            m_arena_view = m_arena;
+
+            // sort by (folder, name); the ties are ordered so that the last insert
+            // of a path is the last in its run of duplicates, but an entry stored in
+            // the archive always comes after the folders created by insertPath()
+            std::sort(m_records.begin(), m_records.end(), [this] (const Record& a, const Record& b)
+            {
+                int compare = getFolderPath(a).compare(getFolderPath(b));
+                if (compare)
+                {
+                    return compare < 0;
+                }
+
+                compare = getPath(a).compare(getPath(b));
+                if (compare)
+                {
+                    return compare < 0;
+                }
+
+                if (m_synthesized[a.header] != m_synthesized[b.header])
+                {
+                    return bool(m_synthesized[a.header]);
+                }
+
+                return a.header < b.header;
+            });
+
+            m_synthesized = std::vector<bool>();
+
+            // keep the last record of each path; the headers of the dropped records
+            // stay in the header array but are no longer referenced
+            size_t count = 0;
+
+            for (size_t i = 0; i < m_records.size(); ++i)
+            {
+                if (i + 1 < m_records.size() && getPath(m_records[i]) == getPath(m_records[i + 1]))
+                {
+                    continue;
+                }
+
+                m_records[count++] = m_records[i];
+            }
+
+            m_records.resize(count);
+
+            // folder ranges
+            m_ranges.clear();
+
+            for (u32 i = 0; i < u32(m_records.size()); ++i)
+            {
+                const Record& record = m_records[i];
+                if (m_ranges.empty() || getString(m_ranges.back().offset, m_ranges.back().length) != getFolderPath(record))
+                {
+                    m_ranges.push_back({ record.offset, record.folder, i, i });
+                }
+                m_ranges.back().end = i + 1;
+            }
+
+            // hash tables
+            m_record_table = createTable(m_records.size());
+            for (u32 i = 0; i < u32(m_records.size()); ++i)
+            {
+                insertTable(m_record_table, getPath(m_records[i]), i);
+            }
+
+            m_folder_table = createTable(m_ranges.size());
+            for (u32 i = 0; i < u32(m_ranges.size()); ++i)
+            {
+                insertTable(m_folder_table, getString(m_ranges[i].offset, m_ranges[i].length), i);
+            }
+
+            // shrinking copies the arrays; only worth it when a lot of memory is returned
+            if (m_arena.capacity() - m_arena.size() > m_arena.size() / 4)
+            {
+                m_arena.shrink_to_fit();
+            }
+
+            if (m_records.capacity() - m_records.size() > m_records.size() / 4)
+            {
+                m_records.shrink_to_fit();
+            }
 
-            auto i = headers.find(filename);
-            if (i != headers.end())
+            if (m_headers.capacity() - m_headers.size() > m_headers.size() / 4)
             {
-                result = &i->second;
+                m_headers.shrink_to_fit();
             }
 
-            return result;
+            m_last_folder = std::string();
+
+            m_arena_view = m_arena;
+            m_header_view = m_headers;
+            m_record_view = m_records;
+            m_range_view = m_ranges;
+            m_record_table_view = m_record_table;
+            m_folder_table_view = m_folder_table;
+
+            createFolders();
+        }
+
+        void save(CacheWriter& writer) const
+        {
+            writer.write(m_arena_view);
+            writer.write(m_header_view);
+            writer.write(m_record_view);
+            writer.write(m_range_view);
+            writer.write(m_record_table_view);
+            writer.write(m_folder_table_view);
+        }
+
+        // Use an index written with save(); the reader's memory must outlive the indexer.
+        // The arrays are validated so that a damaged cache file cannot cause out of
+        // bounds access in the indexer; the mapper validates the headers it stores.
+        bool load(CacheReader& reader)
+        {
+            return load(reader, [] (const Header&)
+            {
+                return true;
+            });
+        }
+
+        template <typename Validate>
+        bool load(CacheReader& reader, Validate&& isValidHeader)
+        {
+            std::span<const char> arena = reader.read<char>();
+            std::span<const Header> headers = reader.read<Header>();
+            std::span<const Record> records = reader.read<Record>();
+            std::span<const Range> ranges = reader.read<Range>();
+            std::span<const u32> record_table = reader.read<u32>();
+            std::span<const u32> folder_table = reader.read<u32>();
+
+            if (!reader.status())
+            {
+                return false;
+            }
+
+            for (const Header& header : headers)
+            {
+                if (!isValidHeader(header))
+                {
+                    return false;
+                }
+            }
+
+            for (const Record& record : records)
+            {
+                if (u64(record.offset) + record.length > arena.size() ||
+                    record.folder > record.length ||
+                    record.header >= headers.size())
+                {
+                    return false;
+                }
+            }
+
+            for (const Range& range : ranges)
+            {
+                if (u64(range.offset) + range.length > arena.size() ||
+                    range.begin > range.end ||
+                    range.end > records.size())
+                {
+                    return false;
+                }
+            }
+
+            if (!isValidTable(record_table, records.size()) ||
+                !isValidTable(folder_table, ranges.size()))
+            {
+                return false;
+            }
+
+            m_arena_view = arena;
+            m_header_view = headers;
+            m_record_view = records;
+            m_range_view = ranges;
+            m_record_table_view = record_table;
+            m_folder_table_view = folder_table;
+
+            createFolders();
+
+            return true;
+        }
+
+        size_t size() const
+        {
+            return m_record_view.size();
+        }
+
+        const Folder* getFolder(std::string_view pathname) const
+        {
+            const u32* slot = findTable(m_folder_table_view, pathname, [&] (u32 index)
+            {
+                const Range& range = m_range_view[index];
+                return getString(range.offset, range.length) == pathname;
+            });
+
+            return slot ? &m_folders[*slot - 1] : nullptr;
+        }
+
+        const Header* getHeader(std::string_view filename) const
+        {
+            const u32* slot = findTable(m_record_table_view, filename, [&] (u32 index)
+            {
+                return getPath(m_record_view[index]) == filename;
+            });
+
+            return slot ? &m_header_view[m_record_view[*slot - 1].header] : nullptr;
         }
     };
 
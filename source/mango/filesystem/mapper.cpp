@@ -6,8 +6,10 @@
 #include <algorithm>
 #include <string_view>
 #include <mango/core/string.hpp>
+#include <mango/core/buffer.hpp>
 #include <mango/filesystem/mapper.hpp>
 #include <mango/filesystem/path.hpp>
+#include "index_cache.hpp"
 
 namespace mango::filesystem
 {
@@ -16,13 +18,13 @@ namespace mango::filesystem
     // extension registry
     // -----------------------------------------------------------------
 
-    AbstractMapper* createMapperZIP(ConstMemory parent, const std::string& password);
-    AbstractMapper* createMapperRAR(ConstMemory parent, const std::string& password);
-    AbstractMapper* createMapperHBS(ConstMemory parent, const std::string& password);
-    AbstractMapper* createMapperISO(ConstMemory parent, const std::string& password);
-    AbstractMapper* createMapper7Z(ConstMemory parent, const std::string& password);
+    AbstractMapper* createMapperZIP(ConstMemory parent, const std::string& password, IndexCache* cache);
+    AbstractMapper* createMapperRAR(ConstMemory parent, const std::string& password, IndexCache* cache);
+    AbstractMapper* createMapperHBS(ConstMemory parent, const std::string& password, IndexCache* cache);
+    AbstractMapper* createMapperISO(ConstMemory parent, const std::string& password, IndexCache* cache);
+    AbstractMapper* createMapper7Z(ConstMemory parent, const std::string& password, IndexCache* cache);
 
-    using CreateMapperFunc = AbstractMapper* (*)(ConstMemory, const std::string&);
+    using CreateMapperFunc = AbstractMapper* (*)(ConstMemory, const std::string&, IndexCache*);
 
     struct MapperExtension
     {
@@ -221,6 +223,7 @@ namespace mango::filesystem
         // use parent's mapper
         m_parent_mapper = mapper;
         m_current_mapper = mapper->m_current_mapper;
+        m_current_is_native = mapper->m_current_is_native;
 
         // parse and create mappers
         m_pathname = mapper->m_pathname + pathname;
@@ -233,7 +236,7 @@ namespace mango::filesystem
         const MapperExtension* node = findMapperExtension(ext);
         if (node)
         {
-            AbstractMapper* mapper = node->create(memory, password);
+            AbstractMapper* mapper = node->create(memory, password, nullptr);
             m_mappers.emplace_back(mapper);
             m_current_mapper = mapper;
             m_pathname = "@memory" + extension + "/";
@@ -249,6 +252,7 @@ namespace mango::filesystem
         if (!m_current_mapper)
         {
             m_current_mapper = createFileMapper("");
+            m_current_is_native = true;
         }
 
         std::string lowercase = toLower(pathname);
@@ -273,12 +277,30 @@ namespace mango::filesystem
 
                     if (m_current_mapper->isFile(container))
                     {
-                        std::unique_ptr<VirtualMemory> memory = m_current_mapper->map(container);
+                        std::unique_ptr<VirtualMemory> memory = m_current_mapper->map(container, 0);
+
+                        if (m_current_is_native)
+                        {
+                            // archives on the native filesystem can use the persistent index cache
+                            IndexCache cache(m_current_mapper, container);
+                            mapper = node.create(*memory, password, &cache);
+
+                            // the mapper uses the loaded index in place
+                            std::unique_ptr<VirtualMemory> cache_memory = cache.release();
+                            if (cache_memory)
+                            {
+                                m_parent_memories.push_back(std::move(cache_memory));
+                            }
+                        }
+                        else
+                        {
+                            mapper = node.create(*memory, password, nullptr);
+                        }
 
-                        mapper = node.create(*memory, password);
                         m_parent_memories.push_back(std::move(memory));
                         m_mappers.emplace_back(mapper);
                         m_current_mapper = mapper;
+                        m_current_is_native = false;
 
                         offset += n;
                         remain.remove_prefix(n);
@@ -353,12 +375,52 @@ namespace mango::filesystem
         m_current_mapper->getIndex(index, pathname);
     }
 
-    std::unique_ptr<VirtualMemory> Mapper::map(const std::string& filename)
+    std::unique_ptr<VirtualMemory> Mapper::map(const std::string& filename, u32 hints)
     {
         if (!m_current_mapper)
             return nullptr;
 
-        return m_current_mapper->map(m_basepath + filename);
+        return m_current_mapper->map(m_basepath + filename, hints);
+    }
+
+    std::unique_ptr<Stream> Mapper::stream(const std::string& filename)
+    {
+        if (!m_current_mapper)
+            return nullptr;
+
+        return m_current_mapper->stream(m_basepath + filename);
+    }
+
+    // -----------------------------------------------------------------
+    // AbstractMapper
+    // -----------------------------------------------------------------
+
+    namespace
+    {
+
+        // stream over a mapped file; owns the mapping
+        class VirtualMemoryStream : public ConstMemoryStream
+        {
+        protected:
+            std::unique_ptr<VirtualMemory> m_virtual_memory;
+
+        public:
+            VirtualMemoryStream(std::unique_ptr<VirtualMemory> memory)
+                : ConstMemoryStream(*memory)
+                , m_virtual_memory(std::move(memory))
+            {
+            }
+        };
+
+    } // namespace
+
+    std::unique_ptr<Stream> AbstractMapper::stream(const std::string& filename)
+    {
+        std::unique_ptr<VirtualMemory> memory = map(filename, 0);
+        if (!memory)
+            return nullptr;
+
+        return std::make_unique<VirtualMemoryStream>(std::move(memory));
     }
 
 } // namespace mango::filesystem
@@ -30,6 +30,9 @@ namespace
 {
     using namespace mango;
     using mango::filesystem::Indexer;
+    using mango::filesystem::IndexCache;
+    using mango::filesystem::CacheReader;
+    using mango::filesystem::CacheWriter;
 
     static constexpr u64 kSignatureHeaderSize = 32;
     static constexpr u32 kFolderCacheSize = 8;
@@ -1819,7 +1822,6 @@ namespace
 
     struct FileHeader
     {
-        std::string filename;
         u64 size { 0 };
         u32 checksum { 0 };
         bool is_folder { false };
@@ -1909,6 +1911,8 @@ namespace
     class Index7z
     {
     public:
+        static constexpr u32 INDEX_CACHE_TAG = u32_mask('7', 'z', 'i', '2');
+
         ConstMemory m_memory;
         ArchiveHeader m_header;
         Indexer<FileHeader> m_folders;
@@ -1920,7 +1924,7 @@ namespace
             return m_valid;
         }
 
-        explicit Index7z(ConstMemory memory)
+        Index7z(ConstMemory memory, IndexCache* cache)
             : m_memory(memory)
         {
             if (!memory.address || memory.size < kSignatureHeaderSize)
@@ -1964,29 +1968,99 @@ namespace
                 return;
             }
 
-            ConstMemory header_memory(memory.address + header_offset, size_t(next_size));
-            if (crc32(0, header_memory) != next_crc)
+            m_header_memory = ConstMemory(memory.address + header_offset, size_t(next_size));
+            m_header_crc = next_crc;
+
+            if (cache)
             {
-                return;
+                CacheReader reader(cache->load(INDEX_CACHE_TAG));
+                std::span<const u64> folder_sizes = reader.read<u64>();
+
+                if (reader.status() && m_folders.load(reader, [&] (const FileHeader& header)
+                {
+                    return isValidHeader(header, folder_sizes);
+                }))
+                {
+                    // the archive header is parsed when the first file is decompressed
+                    m_valid = true;
+                    return;
+                }
             }
 
             try
             {
-                parseTopLevel(header_memory);
-                bindFilesToStreams(m_header);
-                buildPackStarts();
+                parse();
                 buildIndexer();
                 m_valid = true;
             }
             catch (...)
             {
                 m_valid = false;
+                return;
+            }
+
+            if (cache)
+            {
+                std::vector<u64> folder_sizes;
+                for (const auto& folder : m_header.folders)
+                {
+                    folder_sizes.push_back(folder.mainUnpackSize());
+                }
+
+                Buffer buffer;
+                CacheWriter writer(buffer);
+                writer.write(std::span<const u64>(folder_sizes));
+                m_folders.save(writer);
+                cache->store(INDEX_CACHE_TAG, buffer);
+            }
+        }
+
+        // a header from the index cache must describe a stream inside its folder
+        static bool isValidHeader(const FileHeader& header, std::span<const u64> folder_sizes)
+        {
+            if (header.folder_index < 0)
+            {
+                // directories and empty files
+                return header.size == 0;
             }
+
+            if (size_t(header.folder_index) >= folder_sizes.size() || header.stream_index < 0)
+            {
+                return false;
+            }
+
+            const u64 folder_size = folder_sizes[size_t(header.folder_index)];
+            return header.stream_offset <= folder_size && header.size <= folder_size - header.stream_offset;
+        }
+
+        // parse the archive header for decompression; the file index can come from the cache
+        void parse()
+        {
+            std::call_once(m_parse_flag, [this]
+            {
+                if (!m_header_memory.size)
+                {
+                    return;
+                }
+
+                if (crc32(0, m_header_memory) != m_header_crc)
+                {
+                    MANGO_EXCEPTION("[mapper.7z] Header CRC mismatch.");
+                }
+
+                parseTopLevel(m_header_memory);
+                bindFilesToStreams(m_header);
+                buildPackStarts();
+            });
         }
 
     private:
         static constexpr int kMaxEncodedHeaderDepth = 16;
 
+        ConstMemory m_header_memory;
+        u32 m_header_crc { 0 };
+        std::once_flag m_parse_flag;
+
         void parseHeaderFromStream(Stream7z& s, std::vector<std::shared_ptr<Buffer>>& decoded_headers)
         {
             for (int depth = 0; depth < kMaxEncodedHeaderDepth; ++depth)
@@ -2080,6 +2154,8 @@ namespace
                 }
             }
 
+            std::string filename;
+
             for (const auto& entry : m_header.files)
             {
                 if (entry.is_anti || entry.name.empty())
@@ -2088,7 +2164,6 @@ namespace
                 }
 
                 FileHeader header;
-                header.filename = entry.name;
                 header.size = entry.size;
                 header.checksum = entry.checksum;
                 header.has_checksum = entry.has_checksum;
@@ -2106,24 +2181,23 @@ namespace
                     header.stream_offset = offsets[size_t(entry.folder_index)][size_t(entry.stream_index)];
                 }
 
-                if (header.is_folder && header.filename.back() != '/')
+                filename = entry.name;
+                if (header.is_folder && filename.back() != '/')
                 {
-                    header.filename.push_back('/');
+                    filename.push_back('/');
                 }
 
-                std::string filename = header.filename;
-                while (!filename.empty())
+                m_folders.insertPath(filename, header, [] (FileHeader folder)
                 {
-                    std::string folder = mango::filesystem::getPath(filename.substr(0, filename.length() - 1));
-                    header.filename = filename.substr(folder.length());
-                    m_folders.insert(folder, filename, header);
-                    header.is_folder = true;
-                    header.size = 0;
-                    header.folder_index = -1;
-                    header.stream_index = -1;
-                    filename = folder;
-                }
+                    folder.is_folder = true;
+                    folder.size = 0;
+                    folder.folder_index = -1;
+                    folder.stream_index = -1;
+                    return folder;
+                });
             }
+
+            m_folders.finalize();
         }
     };
 
@@ -2171,6 +2245,8 @@ namespace mango::filesystem
 
         std::shared_ptr<Buffer> decompressFolderUncached(u32 folder_index)
         {
+            m_index.parse();
+
             if (!m_index.m_header.has_pack_info)
             {
                 MANGO_EXCEPTION("[mapper.7z] Archive has no pack info.");
@@ -2258,8 +2334,8 @@ namespace mango::filesystem
         }
 
     public:
-        Mapper7Z(ConstMemory parent, const std::string& password)
-            : m_index(parent)
+        Mapper7Z(ConstMemory parent, const std::string& password, IndexCache* cache)
+            : m_index(parent, cache)
             , m_password(password)
         {
             MANGO_UNREFERENCED(m_password);
@@ -2298,9 +2374,9 @@ namespace mango::filesystem
                 return;
             }
 
-            for (auto i : folder->headers)
+            for (auto entry : *folder)
             {
-                const FileHeader& header = *i.second;
+                const FileHeader& header = entry.header;
 
                 u32 flags = 0;
                 u64 size = header.size;
@@ -2323,17 +2399,19 @@ namespace mango::filesystem
 
                 if (header.has_checksum)
                 {
-                    index.emplace(header.filename, size, flags, header.checksum);
+                    index.emplace(std::string(entry.name), size, flags, header.checksum);
                 }
                 else
                 {
-                    index.emplace(header.filename, size, flags);
+                    index.emplace(std::string(entry.name), size, flags);
                 }
             }
         }
 
-        std::unique_ptr<VirtualMemory> map(const std::string& filename) override
+        std::unique_ptr<VirtualMemory> map(const std::string& filename, u32 hints) override
         {
+            MANGO_UNREFERENCED(hints);
+
             const FileHeader* ptr = m_index.m_folders.getHeader(filename);
             if (!ptr)
             {
@@ -2355,7 +2433,7 @@ namespace mango::filesystem
 
             auto folder_buffer = decompressFolderCached(u32(header.folder_index));
 
-            if (header.stream_offset + header.size > folder_buffer->size())
+            if (header.stream_offset > folder_buffer->size() || header.size > folder_buffer->size() - header.stream_offset)
             {
                 MANGO_EXCEPTION("[mapper.7z] File \"{}\" exceeds decompressed folder.", filename);
             }
@@ -2375,9 +2453,9 @@ namespace mango::filesystem
         }
     };
 
-    AbstractMapper* createMapper7Z(ConstMemory parent, const std::string& password)
+    AbstractMapper* createMapper7Z(ConstMemory parent, const std::string& password, IndexCache* cache)
     {
-        return new Mapper7Z(parent, password);
+        return new Mapper7Z(parent, password, cache);
     }
 
 } // namespace mango::filesystem
@@ -2,6 +2,12 @@
     MANGO Multimedia Development Platform
     Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
 */
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <unordered_map>
 #include <mango/core/core.hpp>
 #include <mango/filesystem/filesystem.hpp>
 #include <mango/filesystem/hbs.hpp>
@@ -13,8 +19,9 @@ namespace
     using namespace mango;
     namespace fs = mango::filesystem;
 
-    static constexpr u64 hbs_index_size = 24;
-    static constexpr u32 block_cache_size = 96;
+    // decompressed shared blocks (small files merged into blocks of up to a few MB)
+    static constexpr size_t block_cache_bytes = size_t(128) << 20;
+    static constexpr size_t block_cache_shards = 8;
 
     using Segment = fs::hbs::File::Segment;
 
@@ -23,12 +30,21 @@ namespace
         ConstMemory compressed;
         u64 uncompressed;
         u32 method;
+        const zstd::Dictionary* dictionary;
 
         void decompress(Memory dest) const
         {
             assert(dest.size == uncompressed);
-            Compressor compressor = getCompressor(Compressor::Method(method));
-            compressor.decompress(dest, compressed);
+
+            if (dictionary)
+            {
+                dictionary->decompress(dest, compressed);
+            }
+            else
+            {
+                Compressor compressor = getCompressor(Compressor::Method(method));
+                compressor.decompress(dest, compressed);
+            }
         }
     };
 
@@ -38,7 +54,6 @@ namespace
         u32 checksum;
         bool is_compressed;
         std::vector<Segment> segments;
-        std::string filename;
 
         bool isCompressed() const
         {
@@ -56,11 +71,141 @@ namespace
         }
     };
 
+    // -----------------------------------------------------------------
+    // BlockCache
+    // -----------------------------------------------------------------
+
+    struct CacheCounters
+    {
+        std::atomic<u64> hits { 0 };
+        std::atomic<u64> misses { 0 };
+        std::atomic<u64> evictions { 0 };
+        std::atomic<u64> bytes { 0 };
+    };
+
+    // shared by all .hbs mappers; see fs::hbs::getCacheStatistics()
+    CacheCounters g_cache_counters;
+
+    /*
+        Cache of decompressed blocks, bounded by bytes. The blocks are spread over
+        shards by block index, each with its own lock, so threads mapping files
+        from different blocks do not contend. A miss is decompressed outside the
+        lock; threads which miss the same block while it is being decompressed
+        wait for the first one instead of decompressing it again.
+    */
+
+    class BlockCache
+    {
+    protected:
+        using SharedBuffer = std::shared_ptr<Buffer>;
+
+        struct Shard
+        {
+            std::mutex mutex;
+            CostLRUCache<u32, SharedBuffer> cache;
+            std::unordered_map<u32, std::shared_future<SharedBuffer>> inflight;
+
+            Shard(size_t budget)
+                : cache(budget)
+            {
+            }
+        };
+
+        std::vector<std::unique_ptr<Shard>> m_shards;
+
+        void insert(Shard& shard, u32 index, const SharedBuffer& buffer)
+        {
+            const size_t count = shard.cache.size();
+            const size_t used = shard.cache.used();
+
+            shard.cache.insert(index, buffer, buffer->size());
+
+            const size_t evicted = count + 1 - shard.cache.size();
+            g_cache_counters.evictions += evicted;
+            g_cache_counters.bytes += shard.cache.used() - used;
+        }
+
+    public:
+        BlockCache(size_t bytes, size_t shards)
+        {
+            for (size_t i = 0; i < shards; ++i)
+            {
+                m_shards.emplace_back(std::make_unique<Shard>(bytes / shards));
+            }
+        }
+
+        ~BlockCache()
+        {
+            for (auto& shard : m_shards)
+            {
+                g_cache_counters.bytes -= shard->cache.used();
+            }
+        }
+
+        // Returns the decompressed block; decompress(Memory) is called on a miss.
+        template <typename Decompress>
+        SharedBuffer get(u32 index, size_t size, Decompress&& decompress)
+        {
+            Shard& shard = *m_shards[index % m_shards.size()];
+
+            std::unique_lock lock(shard.mutex);
+
+            if (auto cached = shard.cache.get(index))
+            {
+                ++g_cache_counters.hits;
+                return *cached;
+            }
+
+            if (auto it = shard.inflight.find(index); it != shard.inflight.end())
+            {
+                std::shared_future<SharedBuffer> future = it->second;
+                lock.unlock();
+
+                ++g_cache_counters.hits;
+                return future.get();
+            }
+
+            auto promise = std::make_shared<std::promise<SharedBuffer>>();
+            shard.inflight.emplace(index, promise->get_future().share());
+            lock.unlock();
+
+            ++g_cache_counters.misses;
+
+            try
+            {
+                auto buffer = std::make_shared<Buffer>(size);
+                decompress(Memory(*buffer));
+
+                lock.lock();
+                insert(shard, index, buffer);
+                shard.inflight.erase(index);
+                lock.unlock();
+
+                promise->set_value(buffer);
+                return buffer;
+            }
+            catch (...)
+            {
+                lock.lock();
+                shard.inflight.erase(index);
+                lock.unlock();
+
+                promise->set_exception(std::current_exception());
+                throw;
+            }
+        }
+    };
+
+    // -----------------------------------------------------------------
+    // IndexHBS
+    // -----------------------------------------------------------------
+
     struct IndexHBS
     {
         ConstMemory m_memory;
         fs::Indexer<FileHeader> m_folders;
         std::vector<Block> m_blocks;
+        std::vector<std::unique_ptr<zstd::Dictionary>> m_dictionaries;
         u32 m_version { 0 };
 
         IndexHBS(ConstMemory memory)
@@ -72,6 +217,11 @@ namespace
                 return;
             }
 
+            if (memory.size < 4)
+            {
+                return;
+            }
+
             LittleEndianConstPointer p = memory.address;
             u32 magic0 = p.read32();
             if (magic0 != fs::HBS_MAGIC0)
@@ -80,25 +230,20 @@ namespace
                 return;
             }
 
-            u64 index_offset = memory.size - hbs_index_size;
-            p = memory.address + index_offset;
+            fs::hbs::Index index = fs::hbs::readIndex(memory);
+            m_version = index.version;
+
+            u64 block_size = index.file_offset - index.block_offset;
+            u64 file_size = index.index_offset - index.file_offset;
 
-            u32 magic3 = p.read32();
-            if (magic3 != fs::HBS_MAGIC3)
+            if (index.dictionary_offset)
             {
-                //MANGO_EXCEPTION("[mapper.hbs] Incorrect index identifier (%x)", magic3);
-                return;
+                u64 dictionary_size = index.block_offset - index.dictionary_offset;
+                parseDictionaries(m_memory.slice(index.dictionary_offset, dictionary_size));
             }
 
-            m_version = p.read32();
-            u64 block_offset = p.read64();
-            u64 file_offset = p.read64();
-
-            u64 block_size = file_offset - block_offset;
-            u64 file_size = index_offset - file_offset;
-
-            ConstMemory block_memory = m_memory.slice(block_offset, block_size);
-            ConstMemory file_memory = m_memory.slice(file_offset, file_size);
+            ConstMemory block_memory = m_memory.slice(index.block_offset, block_size);
+            ConstMemory file_memory = m_memory.slice(index.file_offset, file_size);
 
             parseBlocks(block_memory);
             parseFileArray(file_memory);
@@ -108,6 +253,14 @@ namespace
         {
         }
 
+        void parseDictionaries(ConstMemory dictionary_memory)
+        {
+            for (ConstMemory memory : fs::hbs::readDictionaryArray(dictionary_memory))
+            {
+                m_dictionaries.push_back(std::make_unique<zstd::Dictionary>(memory));
+            }
+        }
+
         void parseBlocks(ConstMemory block_memory)
         {
             std::vector<fs::hbs::Block> blocks = fs::hbs::readBlockArray(block_memory);
@@ -130,6 +283,19 @@ namespace
                 block.compressed = ConstMemory(block_address, desc.compressed);
                 block.uncompressed = desc.uncompressed;
                 block.method = desc.method;
+                block.dictionary = nullptr;
+
+                if (desc.dictionary)
+                {
+                    if (desc.dictionary > m_dictionaries.size() || desc.method != Compressor::ZSTD)
+                    {
+                        MANGO_EXCEPTION("[mapper.hbs] Block at offset {} has incorrect dictionary ({}).",
+                            desc.offset, desc.dictionary);
+                    }
+
+                    block.dictionary = m_dictionaries[desc.dictionary - 1].get();
+                }
+
                 m_blocks.push_back(block);
             }
         }
@@ -143,7 +309,6 @@ namespace
                 FileHeader header;
 
                 const std::string& filename = entry.filename;
-                u32 length = u32(filename.length());
 
                 header.size = entry.size;
                 header.checksum = entry.checksum;
@@ -168,13 +333,10 @@ namespace
                     }
                 }
 
-                std::string folder = header.isFolder() ?
-                    fs::getPath(filename.substr(0, length - 1)) :
-                    fs::getPath(filename);
-
-                header.filename = filename.substr(folder.length());
-                m_folders.insert(folder, filename, header);
+                m_folders.insert(fs::Indexer<FileHeader>::getParentFolder(filename), filename, header);
             }
+
+            m_folders.finalize();
         }
     };
 
@@ -209,6 +371,183 @@ namespace mango::filesystem
         }
     };
 
+    // -----------------------------------------------------------------
+    // SegmentStreamHBS
+    // -----------------------------------------------------------------
+
+    /*
+        Windowed read access to a file: only the segment under the read position
+        is resident. Segments in blocks of their own are decompressed into a window
+        buffer when the reader enters them, stored segments are read straight from
+        the archive and shared blocks come from the block cache.
+    */
+
+    class SegmentStreamHBS : public Stream
+    {
+    protected:
+        const IndexHBS& m_index;
+        BlockCache& m_cache;
+        std::string m_filename;
+        std::vector<Segment> m_segments;
+        std::vector<u64> m_starts; // file offset of each segment
+        u64 m_size;
+        u64 m_offset = 0;
+
+        // current window
+        size_t m_current = ~size_t(0);
+        ConstMemory m_window;
+        Buffer m_buffer;
+        std::shared_ptr<Buffer> m_shared;
+
+        void load(size_t index)
+        {
+            const Segment& segment = m_segments[index];
+            const Block& block = m_index.m_blocks[segment.block];
+
+            // a segment which does not own the whole block starts at its offset in the block
+            const u64 offset = segment.size == block.uncompressed ? 0 : segment.offset;
+
+            m_shared.reset();
+
+            if (!block.method)
+            {
+                if (offset + segment.size > block.compressed.size)
+                {
+                    MANGO_EXCEPTION("[mapper.hbs] File \"{}\" segment exceeds stored block (size {}, block {}).",
+                        m_filename, segment.size, block.compressed.size);
+                }
+
+                m_window = block.compressed.slice(offset, segment.size);
+            }
+            else if (!offset && segment.size == block.uncompressed)
+            {
+                m_buffer.resize(size_t(block.uncompressed));
+                block.decompress(m_buffer);
+                m_window = m_buffer;
+            }
+            else
+            {
+                m_shared = m_cache.get(segment.block, size_t(block.uncompressed), [&] (Memory dest)
+                {
+                    block.decompress(dest);
+                });
+
+                ConstMemory memory = *m_shared;
+                m_window = memory.slice(offset, segment.size);
+            }
+
+            m_current = index;
+        }
+
+    public:
+        SegmentStreamHBS(const IndexHBS& index, BlockCache& cache, const FileHeader& file, const std::string& filename)
+            : m_index(index)
+            , m_cache(cache)
+            , m_filename(filename)
+            , m_segments(file.segments)
+            , m_size(0)
+        {
+            for (const Segment& segment : m_segments)
+            {
+                if (segment.block >= m_index.m_blocks.size())
+                {
+                    MANGO_EXCEPTION("[mapper.hbs] File \"{}\" references block {} ({} blocks).",
+                        filename, segment.block, m_index.m_blocks.size());
+                }
+
+                m_starts.push_back(m_size);
+                m_size += segment.size;
+            }
+
+            // empty segments would never advance the read position
+            for (size_t i = m_segments.size(); i-- > 0; )
+            {
+                if (!m_segments[i].size)
+                {
+                    m_segments.erase(m_segments.begin() + i);
+                    m_starts.erase(m_starts.begin() + i);
+                }
+            }
+
+            if (m_size != file.size)
+            {
+                MANGO_EXCEPTION("[mapper.hbs] File \"{}\" size mismatch ({} != {}).",
+                    filename, file.size, m_size);
+            }
+        }
+
+        u64 size() const override
+        {
+            return m_size;
+        }
+
+        u64 offset() const override
+        {
+            return m_offset;
+        }
+
+        u64 seek(s64 distance, SeekMode mode) override
+        {
+            s64 offset = s64(m_offset);
+
+            switch (mode)
+            {
+                case SeekMode::Begin:
+                    offset = distance;
+                    break;
+
+                case SeekMode::Current:
+                    offset += distance;
+                    break;
+
+                case SeekMode::End:
+                    offset = s64(m_size) + distance;
+                    break;
+            }
+
+            m_offset = u64(std::clamp(offset, s64(0), s64(m_size)));
+            return m_offset;
+        }
+
+        u64 read(void* dest, u64 bytes) override
+        {
+            u8* output = reinterpret_cast<u8*>(dest);
+            u64 total = 0;
+
+            bytes = std::min(bytes, m_size - m_offset);
+
+            while (bytes > 0)
+            {
+                // segment under the read position
+                size_t index = size_t(std::upper_bound(m_starts.begin(), m_starts.end(), m_offset) - m_starts.begin()) - 1;
+                if (index != m_current)
+                {
+                    load(index);
+                }
+
+                const u64 position = m_offset - m_starts[index];
+                const u64 count = std::min(bytes, m_window.size - position);
+
+                std::memcpy(output, m_window.address + position, size_t(count));
+
+                output += count;
+                total += count;
+                bytes -= count;
+                m_offset += count;
+            }
+
+            return total;
+        }
+
+        u64 write(const void* data, u64 bytes) override
+        {
+            MANGO_UNREFERENCED(data);
+            MANGO_UNREFERENCED(bytes);
+            MANGO_EXCEPTION("[mapper.hbs] Writing into read-only stream.");
+            return 0;
+        }
+    };
+
     // -----------------------------------------------------------------
     // MapperHBS
     // -----------------------------------------------------------------
@@ -219,9 +558,7 @@ namespace mango::filesystem
         IndexHBS m_index;
         std::string m_password;
 
-        // block cache
-        LRUCache<u32, std::shared_ptr<Buffer>> m_cache { block_cache_size };
-        std::mutex m_cache_mutex;
+        BlockCache m_cache { block_cache_bytes, block_cache_shards };
 
         void decompressSegment(u8* base, const Segment& segment, const std::string& filename) const
         {
@@ -293,9 +630,9 @@ namespace mango::filesystem
             const fs::Indexer<FileHeader>::Folder* folder = m_index.m_folders.getFolder(pathname);
             if (folder)
             {
-                for (auto i : folder->headers)
+                for (auto entry : *folder)
                 {
-                    const FileHeader& header = *i.second;
+                    const FileHeader& header = entry.header;
 
                     u32 flags = 0;
 
@@ -309,7 +646,7 @@ namespace mango::filesystem
                         flags |= FileInfo::Compressed;
                     }
 
-                    index.emplace(header.filename, header.size, flags, header.checksum);
+                    index.emplace(std::string(entry.name), header.size, flags, header.checksum);
                 }
             }
         }
@@ -326,8 +663,10 @@ namespace mango::filesystem
             return block.compressed.slice(offset, size);
         }
 
-        std::unique_ptr<VirtualMemory> map(const std::string& filename) override
+        std::unique_ptr<VirtualMemory> map(const std::string& filename, u32 hints) override
         {
+            MANGO_UNREFERENCED(hints);
+
             const FileHeader* ptrHeader = m_index.m_folders.getHeader(filename);
             if (!ptrHeader)
             {
@@ -371,23 +710,10 @@ namespace mango::filesystem
                     {
                         // a small file stored in one block with other small files
 
-                        std::shared_ptr<Buffer> buffer;
-
-                        std::lock_guard<std::mutex> cache_lock(m_cache_mutex);
-
-                        auto value = m_cache.get(blockIndex);
-                        if (value)
+                        std::shared_ptr<Buffer> buffer = m_cache.get(blockIndex, size_t(block.uncompressed), [&] (Memory dest)
                         {
-                            // cache hit
-                            buffer = *value;
-                        }
-                        else
-                        {
-                            // cache miss
-                            buffer = std::make_shared<Buffer>(block.uncompressed);
-                            block.decompress(*buffer);
-                            m_cache.insert(blockIndex, buffer);
-                        }
+                            block.decompress(dest);
+                        });
 
                         ConstMemory block_memory = *buffer;
                         ConstMemory memory = block_memory.slice(segment.offset, segment.size);
@@ -412,22 +738,83 @@ namespace mango::filesystem
             std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>(file.size);
             u8* base = buffer->data();
 
-            for (const auto& segment : file.segments)
+            // the segments are disjoint ranges of the file; decompress them in parallel
+            std::exception_ptr error;
+            std::mutex error_mutex;
+
+            parallel_for(0, file.segments.size(), 1, [&] (size_t begin, size_t end)
             {
-                decompressSegment(base, segment, filename);
+                try
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        decompressSegment(base, file.segments[i], filename);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(error_mutex);
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+            });
+
+            if (error)
+            {
+                std::rethrow_exception(error);
             }
 
             ConstMemory memory = *buffer;
             return std::make_unique<VirtualMemoryHBS>(buffer, memory);
         }
+
+        std::unique_ptr<Stream> stream(const std::string& filename) override
+        {
+            const FileHeader* ptrHeader = m_index.m_folders.getHeader(filename);
+            if (!ptrHeader)
+            {
+                MANGO_EXCEPTION("[mapper.hbs] File \"{}\" not found.", filename);
+            }
+
+            const FileHeader& file = *ptrHeader;
+
+            if (file.isFolder())
+            {
+                MANGO_EXCEPTION("[mapper.hbs] Cannot stream directory \"{}\".", filename);
+            }
+
+            return std::make_unique<SegmentStreamHBS>(m_index, m_cache, file, filename);
+        }
     };
 
     // -----------------------------------------------------------------
     // functions
     // -----------------------------------------------------------------
 
-    AbstractMapper* createMapperHBS(ConstMemory parent, const std::string& password)
+    namespace hbs
+    {
+
+        CacheStatistics getCacheStatistics()
+        {
+            CacheStatistics statistics;
+
+            statistics.hits = g_cache_counters.hits.load(std::memory_order_relaxed);
+            statistics.misses = g_cache_counters.misses.load(std::memory_order_relaxed);
+            statistics.evictions = g_cache_counters.evictions.load(std::memory_order_relaxed);
+            statistics.bytes = g_cache_counters.bytes.load(std::memory_order_relaxed);
+
+            return statistics;
+        }
+
+    } // namespace hbs
+
+    AbstractMapper* createMapperHBS(ConstMemory parent, const std::string& password, IndexCache* cache)
     {
+        // the index is read directly from the archive
+        MANGO_UNREFERENCED(cache);
+
         AbstractMapper* mapper = new MapperHBS(parent, password);
         return mapper;
     }
@@ -2,7 +2,7 @@
     MANGO Multimedia Development Platform
     Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
 */
-#include <map>
+#include <unordered_set>
 #include <algorithm>
 #include <mango/core/string.hpp>
 #include <mango/core/system.hpp>
@@ -10,6 +10,8 @@
 #include <mango/core/pointer.hpp>
 #include <mango/filesystem/mapper.hpp>
 #include <mango/filesystem/path.hpp>
+#include "indexer.hpp"
+#include "index_cache.hpp"
 
 namespace
 {
@@ -23,6 +25,7 @@ namespace
     using mango::u16;
     using mango::u32;
     using mango::u64;
+    using mango::filesystem::Indexer;
 
     void getSystemUseArea(const u8* record, u8 record_length, u8 filename_length, const u8*& system_use, u8& system_use_length)
     {
@@ -339,13 +342,11 @@ namespace
     {
         u32 extent_location;
         u32 data_length;
-        std::string filename;
         bool is_directory;
 
-        FileEntry(u32 location, u32 length, const std::string& name, bool directory)
+        FileEntry(u32 location, u32 length, bool directory)
             : extent_location(location)
             , data_length(length)
-            , filename(name)
             , is_directory(directory)
         {
         }
@@ -391,7 +392,7 @@ namespace
         u32 m_joliet_root_extent;
         u32 m_joliet_root_length;
 
-        mutable std::map<std::string, std::vector<FileEntry>> m_directory_cache;
+        Indexer<FileEntry> m_folders;
 
         bool checkForRockRidge(const u8* dir_data, u32 data_length) const
         {
@@ -406,7 +407,7 @@ namespace
                 u8 record_length = ptr[0];
                 if (record_length == 0)
                 {
-                    ptr = dir_data + ((ptr - dir_data + 2047) & ~2047);
+                    ptr = dir_data + (((ptr - dir_data) | 2047) + 1);
                     continue;
                 }
 
@@ -497,8 +498,11 @@ namespace
             // Check for Rock Ridge extensions by examining the root directory
             if (has_primary)
             {
-                const u8* root_dir_data = m_parent_memory.address + (m_root_extent * m_logical_block_size);
-                has_rock_ridge = checkForRockRidge(root_dir_data, m_root_length);
+                const u8* root_dir_data = getExtent(m_root_extent, m_root_length);
+                if (root_dir_data)
+                {
+                    has_rock_ridge = checkForRockRidge(root_dir_data, m_root_length);
+                }
             }
 
             // Report ISO extensions
@@ -511,9 +515,9 @@ namespace
 #endif
         }
 
-        std::vector<FileEntry> parseDirectoryContents(const u8* dir_data, u32 data_length, bool use_joliet = false) const
+        template <typename Callback>
+        void parseDirectoryContents(const u8* dir_data, u32 data_length, bool use_joliet, Callback&& callback) const
         {
-            std::vector<FileEntry> entries;
             const u8* ptr = dir_data;
             const u8* end = dir_data + data_length;
 
@@ -532,7 +536,7 @@ namespace
                 if (record_length == 0)
                 {
                     // Skip to next sector boundary
-                    ptr = dir_data + ((ptr - dir_data + 2047) & ~2047);
+                    ptr = dir_data + (((ptr - dir_data) | 2047) + 1);
                     continue;
                 }
 
@@ -569,136 +573,88 @@ namespace
                     continue;
                 }
 
-                // Safety check: if we can't advance, break to prevent infinite loop
-                if (record_length == 0)
-                {
-                    break;
-                }
-
                 // Add trailing slash to directory names to match filesystem convention
-                if (is_directory && !filename.empty() && filename.back() != '/')
+                if (is_directory && filename.back() != '/')
                 {
                     filename += "/";
                 }
 
-                entries.emplace_back(extent_location, data_length, filename, is_directory);
+                callback(filename, FileEntry(extent_location, data_length, is_directory));
                 ptr += record_length;
             }
-
-            return entries;
         }
 
-        std::vector<FileEntry> getDirectoryEntries(const std::string& pathname) const
+        const u8* getExtent(u32 extent_location, u32 data_length) const
         {
-            // Check cache first
-            auto it = m_directory_cache.find(pathname);
-            if (it != m_directory_cache.end())
+            const u64 offset = u64(extent_location) * m_logical_block_size;
+            if (offset + data_length > m_parent_memory.size)
             {
-                return it->second;
+                return nullptr;
             }
 
-            // Safety check to prevent infinite recursion
-            static int recursion_count = 0;
-            recursion_count++;
-            if (recursion_count > 100)  // Back to normal limit
+            return m_parent_memory.address + offset;
+        }
+
+        void buildIndex()
+        {
+            struct Directory
             {
-                recursion_count = 0;
-                return std::vector<FileEntry>();
-            }
+                std::string path;
+                u32 extent_location;
+                u32 data_length;
+                int depth;
+            };
 
-            std::vector<FileEntry> entries;
+            std::vector<Directory> stack;
+            std::unordered_set<u32> visited;
 
-            if (pathname.empty() || pathname == "/" || pathname == "\\")
+            if (m_has_joliet)
             {
-                const u8* root_dir_data = m_parent_memory.address +
-                    ((m_has_joliet ? m_joliet_root_extent : m_root_extent) * m_logical_block_size);
-                const u32 root_length = m_has_joliet ? m_joliet_root_length : m_root_length;
-                entries = parseDirectoryContents(root_dir_data, root_length, m_has_joliet);
+                stack.push_back({ std::string(), m_joliet_root_extent, m_joliet_root_length, 0 });
             }
             else
             {
-                // Handle path parsing for virtual filesystem
-                // For "POOL/MAIN/", we want to find "MAIN" in the "POOL/" directory
-                // Custom path parsing for container paths that end with slashes
-                std::string parent_path;
-                std::string dir_name;
-                
-                if (pathname.empty())
-                {
-                    parent_path = "";
-                    dir_name = "";
-                }
-                else if (pathname == "/" || pathname == "\\")
-                {
-                    parent_path = "";
-                    dir_name = "";
-                }
-                else
+                stack.push_back({ std::string(), m_root_extent, m_root_length, 0 });
+            }
+
+            while (!stack.empty())
+            {
+                Directory directory = std::move(stack.back());
+                stack.pop_back();
+
+                // a corrupted image can link directories into a cycle
+                if (!visited.insert(directory.extent_location).second)
                 {
-                    // Find the second-to-last slash for multi-level paths
-                    size_t last_slash = pathname.find_last_of("/\\");
-                    if (last_slash != std::string::npos && last_slash > 0)
-                    {
-                        // Look for the previous slash
-                        size_t prev_slash = pathname.find_last_of("/\\", last_slash - 1);
-                        if (prev_slash != std::string::npos)
-                        {
-                            // Multi-level path: "POOL/MAIN/" -> parent="POOL/", dir="MAIN/"
-                            parent_path = pathname.substr(0, prev_slash + 1);
-                            dir_name = pathname.substr(prev_slash + 1);
-                        }
-                        else
-                        {
-                            // Single-level path: "POOL/" -> parent="", dir="POOL/"
-                            parent_path = "";
-                            dir_name = pathname;
-                        }
-                    }
-                    else
-                    {
-                        // No slashes or only trailing slash
-                        parent_path = "";
-                        dir_name = pathname;
-                    }
+                    continue;
                 }
 
-                // Remove trailing slash from dir_name for lookup
-                if (!dir_name.empty() && dir_name.back() == '/')
+                const u8* dir_data = getExtent(directory.extent_location, directory.data_length);
+                if (!dir_data)
                 {
-                    dir_name.pop_back();
+                    continue;
                 }
 
-                // Get parent directory entries
-                auto parent_entries = getDirectoryEntries(parent_path);
-
-                // Find the requested directory
-                bool found = false;
-                for (const auto& entry : parent_entries)
+                parseDirectoryContents(dir_data, directory.data_length, m_has_joliet,
+                    [&] (const std::string& name, const FileEntry& entry)
                 {
-                    // Remove trailing slash from entry name for comparison
-                    std::string entry_name = entry.filename;
-                    if (!entry_name.empty() && entry_name.back() == '/')
+                    std::string filename = directory.path + name;
+
+                    // the parent folders are already in the index; the directory
+                    // records are walked from the root down
+                    m_folders.insertPath(filename, entry, [] (FileEntry folder)
                     {
-                        entry_name.pop_back();
-                    }
+                        folder.is_directory = true;
+                        return folder;
+                    });
 
-                    if (entry_name == dir_name)
+                    if (entry.is_directory && directory.depth < 100)
                     {
-                        if (entry.is_directory)
-                        {
-                            const u8* dir_data = m_parent_memory.address + (entry.extent_location * m_logical_block_size);
-                            entries = parseDirectoryContents(dir_data, entry.data_length, m_has_joliet);
-                            found = true;
-                        }
-                        break;
+                        stack.push_back({ filename, entry.extent_location, entry.data_length, directory.depth + 1 });
                     }
-                }
+                });
             }
 
-            // Cache the results
-            m_directory_cache[pathname] = entries;
-            recursion_count--;
-            return entries;
+            m_folders.finalize();
         }
 
     public:
@@ -725,6 +681,7 @@ namespace
                     {
                         printLine(Print::Info, "[ISO] Valid ISO 9660 image detected");
                         parseVolumeDescriptors();
+                        buildIndex();
                         
                         if (m_has_joliet)
                         {
@@ -749,42 +706,42 @@ namespace
 
         u64 getSize(const std::string& filename) const override
         {
-            std::string pathname = mango::filesystem::getPath(filename);
-            std::string name = filename.substr(pathname.length());
-            
-            auto entries = getDirectoryEntries(pathname);
-            for (const auto& entry : entries)
+            const FileEntry* entry = m_folders.getHeader(filename);
+            if (entry)
             {
-                if (entry.filename == name)
-                {
-                    return entry.data_length;
-                }
+                return entry->data_length;
             }
             return 0;
         }
 
         bool isFile(const std::string& filename) const override
         {
-            std::string pathname = mango::filesystem::getPath(filename);
-            std::string name = filename.substr(pathname.length());
-            
-            auto entries = getDirectoryEntries(pathname);
-            for (const auto& entry : entries)
+            const FileEntry* entry = m_folders.getHeader(filename);
+            if (entry)
             {
-                if (entry.filename == name)
-                {
-                    return !entry.is_directory;
-                }
+                return !entry->is_directory;
             }
             return false;
         }
 
         void getIndex(mango::filesystem::FileIndex& index, const std::string& pathname) override
         {
-            auto entries = getDirectoryEntries(pathname);
+            std::string_view folder_name = pathname;
+            if (folder_name == "/" || folder_name == "\\")
+            {
+                folder_name = std::string_view();
+            }
+
+            const Indexer<FileEntry>::Folder* folder = m_folders.getFolder(folder_name);
+            if (!folder)
+            {
+                return;
+            }
 
-            for (const auto& entry : entries)
+            for (auto node : *folder)
             {
+                const FileEntry& entry = node.header;
+
                 u32 flags = 0;
                 u64 size = entry.data_length;
 
@@ -794,29 +751,31 @@ namespace
                     size = 0;
                 }
 
-                index.emplace(entry.filename, size, flags);
+                index.emplace(std::string(node.name), size, flags);
             }
         }
 
-        std::unique_ptr<mango::VirtualMemory> map(const std::string& filename) override
+        std::unique_ptr<mango::VirtualMemory> map(const std::string& filename, u32 hints) override
         {
-            std::string pathname = mango::filesystem::getPath(filename);
-            std::string name = filename.substr(pathname.length());
-            
-            auto entries = getDirectoryEntries(pathname);
-            for (const auto& entry : entries)
+            MANGO_UNREFERENCED(hints);
+
+            const FileEntry* entry = m_folders.getHeader(filename);
+            if (!entry)
             {
-                if (entry.filename == name)
-                {
-                    if (entry.is_directory)
-                    {
-                        MANGO_EXCEPTION("[mapper.iso] Cannot map directory \"{}\".", filename);
-                    }
-                    return entry.map(m_parent_memory.address, m_logical_block_size);
-                }
+                MANGO_EXCEPTION("[mapper.iso] File \"{}\" not found.", filename);
+            }
+
+            if (entry->is_directory)
+            {
+                MANGO_EXCEPTION("[mapper.iso] Cannot map directory \"{}\".", filename);
             }
 
-            MANGO_EXCEPTION("[mapper.iso] File \"{}\" not found.", filename);
+            if (!getExtent(entry->extent_location, entry->data_length))
+            {
+                MANGO_EXCEPTION("[mapper.iso] File \"{}\" is out of bounds.", filename);
+            }
+
+            return entry->map(m_parent_memory.address, m_logical_block_size);
         }
     };
 
@@ -825,8 +784,11 @@ namespace
 namespace mango::filesystem
 {
 
-    AbstractMapper* createMapperISO(ConstMemory parent, const std::string& password)
+    AbstractMapper* createMapperISO(ConstMemory parent, const std::string& password, IndexCache* cache)
     {
+        // the index is built from the directory records; it is not cached
+        MANGO_UNREFERENCED(cache);
+
         AbstractMapper* mapper = new MapperISO(parent, password);
         return mapper;
     }
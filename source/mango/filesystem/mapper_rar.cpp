@@ -359,10 +359,9 @@ namespace
         bool solid_continue;
         u64 win_size;
         size_t index;
-        std::string filename;
 
         bool folder;
-        const u8* data;
+        u64 offset; // compressed data offset from the start of the archive
 
         bool compressed() const
         {
@@ -398,14 +397,24 @@ namespace mango::filesystem
     class MapperRAR : public AbstractMapper
     {
     public:
+        static constexpr u32 INDEX_CACHE_TAG = u32_mask('r', 'a', 'r', '1');
+
+        ConstMemory m_memory;
         std::string m_password;
         std::vector<RarEntry> m_files;
+        std::vector<std::string> m_filenames; // only used while parsing
         Indexer<RarEntry> m_folders;
         bool is_encrypted { false };
 
-        MapperRAR(ConstMemory parent, const std::string& password)
-            : m_password(password)
+        MapperRAR(ConstMemory parent, const std::string& password, IndexCache* cache)
+            : m_memory(parent)
+            , m_password(password)
         {
+            if (cache && loadIndex(cache))
+            {
+                return;
+            }
+
             if (parent.address)
             {
                 const u8* ptr = parent.address;
@@ -437,26 +446,21 @@ namespace mango::filesystem
                     m_files[i].index = i;
                 }
 
-                for (auto& header : m_files)
+                for (size_t i = 0; i < m_files.size(); ++i)
                 {
-                    std::string filename = header.filename;
-                    bool is_leaf = true;
-
-                    while (!filename.empty())
+                    m_folders.insertPath(m_filenames[i], m_files[i], [] (RarEntry folder)
                     {
-                        std::string folder = getPath(filename.substr(0, filename.length() - 1));
+                        folder.folder = true;
+                        return folder;
+                    });
+                }
 
-                        RarEntry entry = header;
-                        entry.filename = filename.substr(folder.length());
-                        if (!is_leaf)
-                        {
-                            entry.folder = true;
-                        }
+                m_filenames = std::vector<std::string>();
+                m_folders.finalize();
 
-                        m_folders.insert(folder, filename, entry);
-                        is_leaf = false;
-                        filename = folder;
-                    }
+                if (cache)
+                {
+                    storeIndex(cache);
                 }
             }
         }
@@ -465,6 +469,45 @@ namespace mango::filesystem
         {
         }
 
+        bool loadIndex(IndexCache* cache)
+        {
+            CacheReader reader(cache->load(INDEX_CACHE_TAG));
+
+            u32 encrypted = 0;
+            reader.read(encrypted);
+            std::span<const RarEntry> files = reader.read<RarEntry>();
+
+            if (!reader.status() || !m_folders.load(reader))
+            {
+                return false;
+            }
+
+            for (const RarEntry& file : files)
+            {
+                if (file.offset > m_memory.size || file.packed_size > m_memory.size - file.offset)
+                {
+                    return false;
+                }
+            }
+
+            m_files.assign(files.begin(), files.end());
+            is_encrypted = encrypted != 0;
+
+            return true;
+        }
+
+        void storeIndex(IndexCache* cache) const
+        {
+            Buffer buffer;
+            CacheWriter writer(buffer);
+
+            writer.write(u32(is_encrypted));
+            writer.write(std::span<const RarEntry>(m_files));
+            m_folders.save(writer);
+
+            cache->store(INDEX_CACHE_TAG, buffer);
+        }
+
         void parse_rar4(const u8* start, const u8* end)
         {
             const u8* p = start;
@@ -502,15 +545,16 @@ namespace mango::filesystem
                                 {
                                     file.win_size = 0x10000ULL << ((header.flags & LHD_WINDOWMASK) >> 5);
                                 }
-                                file.data = p;
+                                file.offset = u64(p - m_memory.address);
 
-                                file.filename = header.filename;
+                                std::string filename = header.filename;
                                 if (file.folder)
                                 {
-                                    file.filename += "/";
+                                    filename += "/";
                                 }
 
                                 m_files.push_back(file);
+                                m_filenames.push_back(filename);
                             }
                         }
                         else
@@ -639,15 +683,15 @@ namespace mango::filesystem
             file.win_size = win_size;
 
             file.folder = is_directory;
-            file.data = compressed_data.address;
+            file.offset = u64(compressed_data.address - m_memory.address);
 
-            file.filename = filename;
             if (file.folder)
             {
-                file.filename += "/";
+                filename += "/";
             }
 
             m_files.push_back(file);
+            m_filenames.push_back(filename);
         }
 
         void parse_rar5(const u8* start, const u8* end)
@@ -739,9 +783,9 @@ namespace mango::filesystem
             const Indexer<RarEntry>::Folder* ptrFolder = m_folders.getFolder(pathname);
             if (ptrFolder)
             {
-                for (auto i : ptrFolder->headers)
+                for (auto entry : *ptrFolder)
                 {
-                    const RarEntry& header = *i.second;
+                    const RarEntry& header = entry.header;
 
                     u32 flags = 0;
                     u64 size = header.unpacked_size;
@@ -762,24 +806,29 @@ namespace mango::filesystem
                         flags |= FileInfo::Encrypted;
                     }
 
-                    index.emplace(header.filename, size, flags);
+                    index.emplace(std::string(entry.name), size, flags);
                 }
             }
         }
 
-        std::unique_ptr<VirtualMemory> mapFile(size_t file_index) const
+        std::unique_ptr<VirtualMemory> mapFile(size_t file_index, const std::string& filename) const
         {
+            if (file_index >= m_files.size())
+            {
+                MANGO_EXCEPTION("[mapper.rar] File \"{}\" has invalid index.", filename);
+            }
+
             const RarEntry& file = m_files[file_index];
 
             if (file.folder)
             {
-                MANGO_EXCEPTION("[mapper.rar] Cannot map directory \"{}\".", file.filename);
+                MANGO_EXCEPTION("[mapper.rar] Cannot map directory \"{}\".", filename);
             }
 
             if (!file.compressed())
             {
                 return std::make_unique<VirtualMemoryRAR>(
-                    file.data, nullptr, size_t(file.unpacked_size));
+                    m_memory.address + file.offset, nullptr, size_t(file.unpacked_size));
             }
 
             const size_t group_start = solidGroupStart(m_files, file_index);
@@ -797,7 +846,7 @@ namespace mango::filesystem
                     if (i == file_index)
                     {
                         return std::make_unique<VirtualMemoryRAR>(
-                            current.data, nullptr, size_t(current.unpacked_size));
+                            m_memory.address + current.offset, nullptr, size_t(current.unpacked_size));
                     }
                     continue;
                 }
@@ -816,7 +865,7 @@ namespace mango::filesystem
                     buffer = scratch.data();
                 }
 
-                if (!decompress(io, unpack, buffer, current.data, current.unpacked_size,
+                if (!decompress(io, unpack, buffer, m_memory.address + current.offset, current.unpacked_size,
                     current.packed_size, current.unp_ver, current.win_size, current.solid_continue))
                 {
                     MANGO_EXCEPTION("[mapper.rar] Decompression failed.");
@@ -833,15 +882,17 @@ namespace mango::filesystem
             MANGO_EXCEPTION("[mapper.rar] Decompression failed.");
         }
 
-        std::unique_ptr<VirtualMemory> map(const std::string& filename) override
+        std::unique_ptr<VirtualMemory> map(const std::string& filename, u32 hints) override
         {
+            MANGO_UNREFERENCED(hints);
+
             const RarEntry* ptrHeader = m_folders.getHeader(filename);
             if (!ptrHeader)
             {
                 MANGO_EXCEPTION("[mapper.rar] File \"{}\" not found.", filename);
             }
 
-            return mapFile(ptrHeader->index);
+            return mapFile(ptrHeader->index, filename);
         }
     };
 
@@ -849,9 +900,9 @@ namespace mango::filesystem
     // functions
     // -----------------------------------------------------------------
 
-    AbstractMapper* createMapperRAR(ConstMemory parent, const std::string& password)
+    AbstractMapper* createMapperRAR(ConstMemory parent, const std::string& password, IndexCache* cache)
     {
-        AbstractMapper* mapper = new MapperRAR(parent, password);
+        AbstractMapper* mapper = new MapperRAR(parent, password, cache);
         return mapper;
     }
 
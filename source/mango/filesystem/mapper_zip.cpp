@@ -236,7 +236,7 @@ namespace
         u32	external;          // external file attributes
         u64	localOffset;       // relative offset of the local file header, ZIP64: 0xffffffff
 
-        std::string filename;      // filename is stored after the header
+        std::string_view filename; // filename is stored after the header (view into the central directory)
         bool        is_folder;     // if the last character of filename is "/", it is a folder
         Encryption  encryption;
 
@@ -279,7 +279,7 @@ namespace
                 is_folder = false;
             }
 
-            filename = std::string(s, filenameLen);
+            filename = std::string_view(s, filenameLen);
             encryption = flags & 1 ? ENCRYPTION_CLASSIC : ENCRYPTION_NONE;
 
             // read extra fields
@@ -399,7 +399,9 @@ namespace
                         signature = 0;
                     }
 
-                    if (dirStartOffset == 0xffffffff)
+                    // any saturated field means the values are in the ZIP64 record
+                    // (the 20 byte locator precedes the end record)
+                    if ((numEntriesTotal == 0xffff || dirSize == 0xffffffff || dirStartOffset == 0xffffffff) && end - start >= 20)
                     {
                         p = end - 20;
                         u32 magic = p.read32();
@@ -409,6 +411,13 @@ namespace
                             p += 4;
                             u64 offset = p.read64();
 
+                            // the ZIP64 end record is 56 bytes
+                            if (offset > memory.size || memory.size - offset < 56)
+                            {
+                                signature = 0;
+                                break;
+                            }
+
                             p = start + offset;
                             magic = p.read32();
                             if (magic == 0x06064b50)
@@ -658,20 +667,40 @@ namespace mango::filesystem
     class MapperZIP : public AbstractMapper
     {
     public:
+        // layout version of the cached index
+        static constexpr u32 INDEX_CACHE_TAG = u32_mask('z', 'i', 'p', '1');
+
         ConstMemory m_parent_memory;
         std::string m_password;
         Indexer<FileHeader> m_folders;
 
-        MapperZIP(ConstMemory parent, const std::string& password)
+        MapperZIP(ConstMemory parent, const std::string& password, IndexCache* cache)
             : m_parent_memory(parent)
             , m_password(password)
         {
             if (parent.address)
             {
+                if (cache)
+                {
+                    CacheReader reader(cache->load(INDEX_CACHE_TAG));
+                    if (m_folders.load(reader, [&] (const FileHeader& header)
+                    {
+                        return isValidHeader(header);
+                    }))
+                    {
+                        return;
+                    }
+                }
+
                 DirEndRecord record(parent);
                 if (record.status())
                 {
-                    const int numFiles = int(record.numEntriesTotal);
+                    // every central directory entry has at least 46 bytes of fixed size header;
+                    // the names are most of what is left
+                    const u64 dirSize = std::min(record.dirSize, u64(parent.size));
+                    const int numFiles = int(std::min(record.numEntriesTotal, dirSize / 46));
+
+                    m_folders.reserve(numFiles, size_t(dirSize - u64(numFiles) * 46));
 
                     // read file headers
                     LittleEndianConstPointer p = parent.address + record.dirStartOffset;
@@ -684,19 +713,28 @@ namespace mango::filesystem
                             // NOTE: Don't index files that can't be decompressed
                             if (isCompressionSupported(header.compression))
                             {
-                                std::string filename = header.filename;
-                                while (!filename.empty())
-                                {
-                                    std::string folder = getPath(filename.substr(0, filename.length() - 1));
+                                // the index stores the path; the header must not point into the archive
+                                std::string_view filename = header.filename;
+                                header.filename = std::string_view();
 
-                                    header.filename = filename.substr(folder.length());
-                                    m_folders.insert(folder, filename, header);
-                                    header.is_folder = true;
-                                    filename = folder;
-                                }
+                                m_folders.insertPath(filename, header, [] (FileHeader folder)
+                                {
+                                    folder.is_folder = true;
+                                    return folder;
+                                });
                             }
                         }
                     }
+
+                    m_folders.finalize();
+
+                    if (cache)
+                    {
+                        Buffer buffer;
+                        CacheWriter writer(buffer);
+                        m_folders.save(writer);
+                        cache->store(INDEX_CACHE_TAG, buffer);
+                    }
                 }
             }
         }
@@ -705,6 +743,23 @@ namespace mango::filesystem
         {
         }
 
+        // a header from the index cache must describe a file inside the archive
+        bool isValidHeader(const FileHeader& header) const
+        {
+            const u64 size = m_parent_memory.size;
+
+            if (header.localOffset > size || size - header.localOffset < 30)
+                return false;
+
+            if (header.compressedSize > size - header.localOffset - 30)
+                return false;
+
+            if (header.encryption > ENCRYPTION_AES256 || !isCompressionSupported(header.compression))
+                return false;
+
+            return header.filename.empty();
+        }
+
         std::unique_ptr<VirtualMemory> map(FileHeader header, const u8* start, const std::string& password)
         {
             LittleEndianConstPointer p = start + header.localOffset;
@@ -965,9 +1020,9 @@ namespace mango::filesystem
             const Indexer<FileHeader>::Folder* ptrFolder = m_folders.getFolder(pathname);
             if (ptrFolder)
             {
-                for (auto i : ptrFolder->headers)
+                for (auto entry : *ptrFolder)
                 {
-                    const FileHeader& header = *i.second;
+                    const FileHeader& header = entry.header;
 
                     u32 flags = 0;
                     u64 size = header.uncompressedSize;
@@ -988,13 +1043,15 @@ namespace mango::filesystem
                         flags |= FileInfo::Encrypted;
                     }
 
-                    index.emplace(header.filename, size, flags);
+                    index.emplace(std::string(entry.name), size, flags);
                 }
             }
         }
 
-        std::unique_ptr<VirtualMemory> map(const std::string& filename) override
+        std::unique_ptr<VirtualMemory> map(const std::string& filename, u32 hints) override
         {
+            MANGO_UNREFERENCED(hints);
+
             const FileHeader* ptrHeader = m_folders.getHeader(filename);
             if (!ptrHeader)
             {
@@ -1010,9 +1067,9 @@ namespace mango::filesystem
     // functions
     // -----------------------------------------------------------------
 
-    AbstractMapper* createMapperZIP(ConstMemory parent, const std::string& password)
+    AbstractMapper* createMapperZIP(ConstMemory parent, const std::string& password, IndexCache* cache)
     {
-        AbstractMapper* mapper = new MapperZIP(parent, password);
+        AbstractMapper* mapper = new MapperZIP(parent, password, cache);
         return mapper;
     }
 
@@ -4,9 +4,11 @@
 */
 #include <mango/core/exception.hpp>
 #include <mango/core/string.hpp>
+#include <mango/core/buffer.hpp>
 #include <mango/filesystem/mapper.hpp>
 #include <mango/filesystem/path.hpp>
 
+#include <cerrno>
 #include <dirent.h>
 #include <fcntl.h>
 #include <unistd.h>
@@ -30,6 +32,42 @@ namespace
         return x;
     }
 
+    // -----------------------------------------------------------------
+    // advise()
+    // -----------------------------------------------------------------
+
+    void advise(void* address, size_t size, u32 hints)
+    {
+        // NOTE: the hints are advisory; failures are ignored
+
+        if (hints & MapHint::Sequential)
+        {
+            ::posix_madvise(address, size, POSIX_MADV_SEQUENTIAL);
+        }
+
+        if (hints & MapHint::Random)
+        {
+            ::posix_madvise(address, size, POSIX_MADV_RANDOM);
+        }
+
+#if defined(MADV_HUGEPAGE)
+        if (hints & MapHint::HugePages)
+        {
+            ::madvise(address, size, MADV_HUGEPAGE);
+        }
+#endif
+
+        if (hints & MapHint::WillNeed)
+        {
+#if defined(MADV_POPULATE_READ)
+            // populate after the huge page advice so that the pages can be collapsed
+            if (::madvise(address, size, MADV_POPULATE_READ) == 0)
+                return;
+#endif
+            ::posix_madvise(address, size, POSIX_MADV_WILLNEED);
+        }
+    }
+
     // -----------------------------------------------------------------
     // FileMemory
     // -----------------------------------------------------------------
@@ -40,9 +78,82 @@ namespace
         int m_file;
         size_t m_size;
         void* m_address;
+        Buffer m_buffer;
+
+        void read(const std::string& filename, size_t offset)
+        {
+            // read small files into memory; the copy is cheaper than mmap + munmap
+            m_buffer.resize(m_size);
+
+            size_t bytes = 0;
+            while (bytes < m_size)
+            {
+                ssize_t result = ::pread(m_file, m_buffer.data() + bytes, m_size - bytes, off_t(offset + bytes));
+                if (result < 0)
+                {
+                    if (errno == EINTR)
+                        continue;
+
+                    ::close(m_file);
+                    m_file = -1;
+                    MANGO_EXCEPTION("[mapper.file] Reading \"{}\" failed.", filename);
+                }
+
+                if (result == 0)
+                {
+                    // the file was truncated after fstat
+                    break;
+                }
+
+                bytes += size_t(result);
+            }
+
+            m_memory.size = bytes;
+            m_memory.address = m_buffer.data();
+
+            ::close(m_file);
+            m_file = -1;
+        }
+
+        void map(const std::string& filename, size_t offset, u32 hints)
+        {
+            size_t page_offset = 0;
+            if (offset > 0)
+            {
+                const long page_size = get_pagesize();
+                const long page_number = offset / page_size;
+                page_offset = page_number * page_size;
+            }
+
+            int flags = MAP_FILE | MAP_SHARED;
+
+#if defined(MAP_POPULATE)
+            // huge page advice must be given before the mapping is populated
+            if ((hints & (MapHint::WillNeed | MapHint::HugePages)) == MapHint::WillNeed)
+            {
+                flags |= MAP_POPULATE;
+                hints &= ~u32(MapHint::WillNeed);
+            }
+#endif
+
+            m_address = ::mmap(nullptr, m_size, PROT_READ, flags, m_file, page_offset);
+
+            if (m_address == MAP_FAILED)
+            {
+                m_address = nullptr;
+                ::close(m_file);
+                m_file = -1;
+                MANGO_EXCEPTION("[mapper.file] Memory mapping \"{}\" failed.", filename);
+            }
+
+            advise(m_address, m_size, hints);
+
+            m_memory.size = m_size;
+            m_memory.address = reinterpret_cast<u8*>(m_address) + (offset - page_offset);
+        }
 
     public:
-        FileMemory(const std::string& filename, u64 x_offset, u64 x_size)
+        FileMemory(const std::string& filename, u64 x_offset, u64 x_size, u32 hints)
             : m_file(-1)
             , m_size(0)
             , m_address(nullptr)
@@ -64,14 +175,6 @@ namespace
                     const size_t file_size = size_t(sb.st_size);
                     const size_t file_offset = size_t(x_offset);
 
-                    size_t page_offset = 0;
-                    if (file_offset > 0)
-                    {
-                        const long page_size = get_pagesize();
-                        const long page_number = file_offset / page_size;
-                        page_offset = page_number * page_size;
-                    }
-
                     m_size = file_size - file_offset;
                     if (x_size > 0)
                     {
@@ -80,15 +183,14 @@ namespace
 
                     if (m_size > 0)
                     {
-                        m_address = ::mmap(nullptr, m_size, PROT_READ, MAP_FILE | MAP_SHARED, m_file, page_offset);
-
-                        if (m_address == MAP_FAILED)
+                        if ((hints & MapHint::ReadSmall) && m_size <= MapHint::small_file_size)
                         {
-                            MANGO_EXCEPTION("[mapper.file] Memory mapping \"{}\" failed.", filename);
+                            read(filename, file_offset);
+                        }
+                        else
+                        {
+                            map(filename, file_offset, hints);
                         }
-
-                        m_memory.size = m_size;
-                        m_memory.address = reinterpret_cast<u8*>(m_address) + (file_offset - page_offset);
                     }
                     else
                     {
@@ -267,10 +369,10 @@ namespace
 
 #endif
 
-        std::unique_ptr<VirtualMemory> map(const std::string& filename) override
+        std::unique_ptr<VirtualMemory> map(const std::string& filename, u32 hints) override
         {
             std::string fullname = m_basepath + filename;
-            return std::make_unique<FileMemory>(fullname, 0, 0);
+            return std::make_unique<FileMemory>(fullname, 0, 0, hints);
         }
     };
 
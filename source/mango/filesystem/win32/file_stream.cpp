@@ -31,7 +31,19 @@ namespace mango::filesystem
 
         ~FileHandle()
         {
-            CloseHandle(m_handle);
+            close();
+        }
+
+        bool close()
+        {
+            if (m_handle == INVALID_HANDLE_VALUE)
+            {
+                return true;
+            }
+
+            BOOL status = CloseHandle(m_handle);
+            m_handle = INVALID_HANDLE_VALUE;
+            return status != 0;
         }
 
         const std::string& filename() const
@@ -132,8 +144,9 @@ namespace mango::filesystem
     // FileStream
     // -----------------------------------------------------------------
 
-    FileStream::FileStream(const std::string& filename, OpenMode mode)
-        : m_handle(nullptr)
+    FileStream::FileStream(const std::string& filename, OpenMode mode, size_t buffer_size)
+        : BufferedStream(buffer_size)
+        , m_handle(nullptr)
     {
         DWORD access;
         DWORD disposition;
@@ -166,25 +179,34 @@ namespace mango::filesystem
 
     FileStream::~FileStream()
     {
+        // best effort; use close() to know if the buffered data was written
+        flush();
         delete m_handle;
     }
 
+    bool FileStream::close()
+    {
+        bool status = flush();
+        status &= m_handle->close();
+        return status;
+    }
+
     const std::string& FileStream::filename() const
     {
         return m_handle->filename();
     }
 
-    u64 FileStream::size() const
+    u64 FileStream::unbufferedSize() const
     {
         return m_handle->size();
     }
 
-    u64 FileStream::offset() const
+    u64 FileStream::unbufferedOffset() const
     {
         return m_handle->offset();
     }
 
-    u64 FileStream::seek(s64 distance, SeekMode mode)
+    u64 FileStream::unbufferedSeek(s64 distance, SeekMode mode)
     {
         DWORD method = 0;
 
@@ -206,12 +228,12 @@ namespace mango::filesystem
         return m_handle->seek(distance, method);
     }
 
-    u64 FileStream::read(void* dest, u64 bytes)
+    u64 FileStream::unbufferedRead(void* dest, u64 bytes)
     {
         return m_handle->read(dest, bytes);
     }
 
-    u64 FileStream::write(const void* data, u64 bytes)
+    u64 FileStream::unbufferedWrite(const void* data, u64 bytes)
     {
         return m_handle->write(data, bytes);
     }
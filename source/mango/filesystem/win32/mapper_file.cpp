@@ -4,6 +4,7 @@
 */
 #include <mango/core/exception.hpp>
 #include <mango/core/string.hpp>
+#include <mango/core/buffer.hpp>
 #include <mango/filesystem/mapper.hpp>
 #include <mango/filesystem/path.hpp>
 
@@ -26,14 +27,49 @@ namespace
         LPVOID  m_address;
         HANDLE  m_file;
         HANDLE  m_map;
+        Buffer  m_buffer;
+
+        void read(const std::string& filename, u64 offset, size_t size)
+        {
+            // read small files into memory; the copy is cheaper than mapping a view
+            m_buffer.resize(size);
+
+            LARGE_INTEGER position;
+            position.QuadPart = LONGLONG(offset);
+            SetFilePointerEx(m_file, position, NULL, FILE_BEGIN);
+
+            DWORD bytes = 0;
+            if (!ReadFile(m_file, m_buffer.data(), DWORD(size), &bytes, NULL))
+            {
+                // the destructor does not run when the constructor throws
+                CloseHandle(m_file);
+                m_file = INVALID_HANDLE_VALUE;
+                MANGO_EXCEPTION("[FileMemory] File \"{}\" cannot be read.", filename);
+            }
+
+            m_memory.address = m_buffer.data();
+            m_memory.size = size_t(bytes);
+        }
 
     public:
-        FileMemory(const std::string& filename, u64 x_offset, u64 x_size)
+        FileMemory(const std::string& filename, u64 x_offset, u64 x_size, u32 hints)
             : m_address(nullptr)
             , m_file(INVALID_HANDLE_VALUE)
             , m_map(nullptr)
         {
-            m_file = CreateFileW(u16_fromBytes(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+            // NOTE: the cache manager readahead serves mapped views as well
+            DWORD attributes = FILE_ATTRIBUTE_NORMAL;
+
+            if (hints & MapHint::Sequential)
+            {
+                attributes |= FILE_FLAG_SEQUENTIAL_SCAN;
+            }
+            else if (hints & MapHint::Random)
+            {
+                attributes |= FILE_FLAG_RANDOM_ACCESS;
+            }
+
+            m_file = CreateFileW(u16_fromBytes(filename).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, attributes, NULL);
 
             // special handling when too long filename
             if (m_file == INVALID_HANDLE_VALUE)
@@ -51,7 +87,17 @@ namespace
                 LARGE_INTEGER file_size;
                 GetFileSizeEx(m_file, &file_size);
 
-                if (file_size.QuadPart > 0)
+                u64 read_size = u64(file_size.QuadPart) - std::min(x_offset, u64(file_size.QuadPart));
+                if (x_size > 0)
+                {
+                    read_size = std::min(read_size, x_size);
+                }
+
+                if ((hints & MapHint::ReadSmall) && read_size > 0 && read_size <= MapHint::small_file_size)
+                {
+                    read(filename, x_offset, size_t(read_size));
+                }
+                else if (file_size.QuadPart > 0)
                 {
                     DWORD maxSizeHigh = 0;
                     DWORD maxSizeLow = 0;
@@ -86,9 +132,21 @@ namespace
 
                         m_address = address_;
                         m_memory.address = reinterpret_cast<u8*>(address_) + (x_offset - page_offset);
+
+#if defined(NTDDI_WIN8) && (NTDDI_VERSION >= NTDDI_WIN8)
+                        if (address_ && (hints & MapHint::WillNeed))
+                        {
+                            WIN32_MEMORY_RANGE_ENTRY range;
+                            range.VirtualAddress = const_cast<u8*>(m_memory.address);
+                            range.NumberOfBytes = m_memory.size;
+                            PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+                        }
+#endif
                     }
                     else
                     {
+                        CloseHandle(m_file);
+                        m_file = INVALID_HANDLE_VALUE;
                         MANGO_EXCEPTION("[FileMemory] Memory \"{}\" mapping failed.", filename);
                     }
                 }
@@ -211,10 +269,10 @@ namespace
             }
         }
 
-        std::unique_ptr<VirtualMemory> map(const std::string& filename) override
+        std::unique_ptr<VirtualMemory> map(const std::string& filename, u32 hints) override
         {
             std::string fullname = m_basepath + filename;
-            return std::make_unique<FileMemory>(fullname, 0, 0);
+            return std::make_unique<FileMemory>(fullname, 0, 0, hints);
         }
     };
 
@@ -1336,33 +1336,13 @@ namespace
         size_t xstride = info.width * surface.format.bytes();
         size_t ystride = info.height * surface.stride;
 
-        size_t concurrency = ThreadPool::getHardwareConcurrency();
-        bool multithread = concurrency > 1;
-
-        if (multithread)
-        {
-            ConcurrentQueue queue;
-
-            for (int y = 0; y < yblocks; ++y)
-            {
-                queue.enqueue([=, &info]
-                {
-                    scanBlockDecode(info, image, data, stride, xblocks, xstride);
-                });
-
-                image += ystride;
-                data += info.bytes * xblocks;
-            }
-        }
-        else
+        parallel_for(0, yblocks, 1, [&] (size_t y0, size_t y1)
         {
-            for (int y = 0; y < yblocks; ++y)
+            for (size_t y = y0; y < y1; ++y)
             {
-                scanBlockDecode(info, image, data, stride, xblocks, xstride);
-                image += ystride;
-                data += info.bytes * xblocks;
+                scanBlockDecode(info, image + y * ystride, data + y * info.bytes * xblocks, stride, xblocks, xstride);
             }
-        }
+        });
     }
 
 } // namespace
@@ -1536,16 +1516,14 @@ namespace mango::image
         }
         else
         {
-            ConcurrentQueue queue;
-
             u8* address = memory.address;
 
-            for (int y = 0; y < yblocks; ++y)
+            parallel_for(0, yblocks, 1, [&] (size_t y0, size_t y1)
             {
-                queue.enqueue([=, this]
-                {
-                    Bitmap temp(compressed_width, height, format);
+                Bitmap temp(compressed_width, height, format);
 
+                for (int y = int(y0); y < int(y1); ++y)
+                {
                     int source_width = std::min(surface.width, compressed_width);
                     int source_height = std::min(height, surface.height - y * height);
 
@@ -1562,8 +1540,8 @@ namespace mango::image
                         data += bytes;
                         image += step;
                     }
-                });
-            }
+                }
+            });
         }
 
         return status;
@@ -11,11 +11,11 @@
 
 namespace mango::image
 {
-    const char* detectImageCodecPNM(ConstMemory memory);
+    static std::string probeImageDecoders(ConstMemory memory, ImageDecoder::ProbeStrength strength);
 
-    std::string detectImageFormatExtension(ConstMemory memory)
+    static std::string detectImageFormatExtension(ConstMemory memory, ImageDecoder::ProbeStrength strength)
     {
-        // Recognize image format from header signature
+        // Recognize image format from header signature; one pass over the first 16 bytes
         struct Signature
         {
             u8 data[16];
@@ -80,10 +80,14 @@ namespace mango::image
             }
         }
 
-        if (const char* pnm = detectImageCodecPNM(memory))
-            return pnm;
+        // formats which need more than a fixed signature
+        return probeImageDecoders(memory, strength);
+    }
 
-        return "";
+    std::string detectImageFormatExtension(ConstMemory memory)
+    {
+        // no filename to compare against; every probe is allowed to decide
+        return detectImageFormatExtension(memory, ImageDecoder::ProbeStrength::Weak);
     }
 
 } // namespace mango::image
@@ -177,8 +181,16 @@ namespace mango::image
     class ImageServer
     {
     protected:
+        struct Probe
+        {
+            ImageDecoder::ProbeFunc func;
+            ImageDecoder::ProbeStrength strength;
+            std::string extension;
+        };
+
         std::map<std::string, ImageDecoder::CreateDecodeFunc> m_decoders;
         std::map<std::string, ImageEncoder::EncodeFunc> m_encoders;
+        std::vector<Probe> m_probes; // in registration order
 
     public:
         ImageServer()
@@ -260,12 +272,33 @@ namespace mango::image
             m_decoders[s] = func;
         }
 
+        void registerImageDecoder(ImageDecoder::CreateDecodeFunc func, ImageDecoder::ProbeFunc probe, ImageDecoder::ProbeStrength strength, const std::string& extension)
+        {
+            std::string s = toLower(extension);
+            m_decoders[s] = func;
+            m_probes.push_back({ probe, strength, s });
+        }
+
         void registerImageEncoder(ImageEncoder::EncodeFunc func, const std::string& extension)
         {
             std::string s = toLower(extension);
             m_encoders[s] = func;
         }
 
+        // runs the probes which are at least as strong as requested
+        std::string probe(ConstMemory memory, ImageDecoder::ProbeStrength strength) const
+        {
+            for (const Probe& probe : m_probes)
+            {
+                if (probe.strength >= strength && probe.func(memory))
+                {
+                    return probe.extension;
+                }
+            }
+
+            return "";
+        }
+
         ImageDecoder::CreateDecodeFunc getImageDecoder(const std::string& extension) const
         {
             auto i = m_decoders.find(extension);
@@ -284,6 +317,16 @@ namespace mango::image
         g_imageServer.registerImageDecoder(func, extension);
     }
 
+    void registerImageDecoder(ImageDecoder::CreateDecodeFunc func, ImageDecoder::ProbeFunc probe, ImageDecoder::ProbeStrength strength, const std::string& extension)
+    {
+        g_imageServer.registerImageDecoder(func, probe, strength, extension);
+    }
+
+    static std::string probeImageDecoders(ConstMemory memory, ImageDecoder::ProbeStrength strength)
+    {
+        return g_imageServer.probe(memory, strength);
+    }
+
     void registerImageEncoder(ImageEncoder::EncodeFunc func, const std::string& extension)
     {
         g_imageServer.registerImageEncoder(func, extension);
@@ -307,6 +350,12 @@ namespace mango::image
     // ImageDecodeInterface
     // ----------------------------------------------------------------------------
 
+    ImageHeader ImageDecodeInterface::getScaledHeader(const ImageDecodeOptions& options) const
+    {
+        MANGO_UNREFERENCED(options);
+        return header;
+    }
+
     ImageDecodeStatus ImageDecodeInterface::decode(const Surface& dest, const ImageDecodeOptions& options, int level, int depth, int face)
     {
         MANGO_UNREFERENCED(dest);
@@ -318,6 +367,30 @@ namespace mango::image
         return ImageDecodeStatus();
     }
 
+    ImageDecodeStatus ImageDecodeInterface::decodeRegion(const Surface& dest, const ImageDecodeRegion& region, const ImageDecodeOptions& options, int level, int depth, int face)
+    {
+        // generic path: decode the whole image and copy the region
+        ImageHeader full = getScaledHeader(options);
+        Bitmap temp(full.width, full.height, dest.format);
+
+        // band callbacks would report coordinates of the temporary surface
+        ImageDecodeCallback saved = std::move(callback);
+        callback = nullptr;
+
+        ImageDecodeStatus status = decode(temp, options, level, depth, face);
+
+        callback = std::move(saved);
+
+        if (status)
+        {
+            Surface source(temp, region.x, region.y, region.width, region.height);
+            dest.blit(0, 0, source);
+            status.direct = false;
+        }
+
+        return status;
+    }
+
     ConstMemory ImageDecodeInterface::memory(int level, int depth, int face)
     {
         MANGO_UNREFERENCED(level);
@@ -395,11 +468,21 @@ namespace mango::image
     static ImageDecodeInterface* createDecodeInterface(ConstMemory memory, const std::string& filename)
     {
         // Inspect signature to determine image format
-        std::string extension = detectImageFormatExtension(memory);
-        if (extension.empty())
+        std::string extension = detectImageFormatExtension(memory, ImageDecoder::ProbeStrength::Strong);
+        if (extension.empty() || !g_imageServer.getImageDecoder(extension))
         {
-            // signature wasn't recognized -> trust the filename
-            extension = getLowerCaseExtension(filename);
+            // signature wasn't recognized (or the codec is not available) -> trust the filename
+            extension = filename.empty() ? std::string() : getLowerCaseExtension(filename);
+
+            if (!g_imageServer.getImageDecoder(extension))
+            {
+                // unknown extension -> a weak probe is better than nothing
+                std::string probed = probeImageDecoders(memory, ImageDecoder::ProbeStrength::Weak);
+                if (!probed.empty())
+                {
+                    extension = probed;
+                }
+            }
         }
         else if (extension == ".tiff")
         {
@@ -421,8 +504,9 @@ namespace mango::image
         }
 
         ImageDecodeInterface* x = create(memory);
-        x->name = fmt::format("ImageDecoder:{}", filesystem::removePath(filename));
+        x->name = fmt::format("ImageDecoder:{}", filename.empty() ? extension : filesystem::removePath(filename));
         x->filename = filename;
+        x->codec = extension;
         return x;
     }
 
@@ -464,6 +548,12 @@ namespace mango::image
         };
     }
 
+    ImageDecoder::ImageDecoder(ConstMemory memory)
+    {
+        // no name: the content alone selects the codec, no companion files
+        m_interface.reset(createDecodeInterface(memory, std::string()));
+    }
+
     ImageDecoder::ImageDecoder(ConstMemory memory, const std::string& filename)
     {
         ImageDecodeInterface* x = createDecodeInterface(memory, filename);
@@ -518,6 +608,11 @@ namespace mango::image
         return m_interface ? m_interface->async : false;
     }
 
+    std::string ImageDecoder::codec() const
+    {
+        return m_interface ? m_interface->codec : std::string();
+    }
+
     ImageHeader ImageDecoder::header()
     {
         ImageHeader header;
@@ -534,6 +629,22 @@ namespace mango::image
         return header;
     }
 
+    ImageHeader ImageDecoder::header(const ImageDecodeOptions& options)
+    {
+        ImageHeader header;
+
+        if (m_interface)
+        {
+            header = m_interface->getScaledHeader(options);
+        }
+        else
+        {
+            header.setError("[WARNING] header() is not supported for this extension.");
+        }
+
+        return header;
+    }
+
     ImageDecodeStatus ImageDecoder::decode(const Surface& dest, const ImageDecodeOptions& options, int level, int depth, int face)
     {
         ImageDecodeStatus status;
@@ -551,6 +662,45 @@ namespace mango::image
         return status;
     }
 
+    ImageDecodeStatus ImageDecoder::decode(const Surface& dest, const ImageDecodeRegion& region, const ImageDecodeOptions& options, int level, int depth, int face)
+    {
+        ImageDecodeStatus status;
+
+        if (!m_interface)
+        {
+            status.setError("[WARNING] decode() is not supported for this extension.");
+            return status;
+        }
+
+        ImageHeader header = m_interface->getScaledHeader(options);
+
+        // clip to the image and the destination
+        int x0 = std::max(region.x, 0);
+        int y0 = std::max(region.y, 0);
+        int x1 = std::min(region.x + region.width, header.width);
+        int y1 = std::min(region.y + region.height, header.height);
+        x1 = std::min(x1, x0 + dest.width);
+        y1 = std::min(y1, y0 + dest.height);
+
+        if (x0 >= x1 || y0 >= y1)
+        {
+            status.setError("[ImageDecoder] Empty decoding region.");
+            return status;
+        }
+
+        ImageDecodeRegion clipped { x0, y0, x1 - x0, y1 - y0 };
+
+        if (clipped.x == 0 && clipped.y == 0 && clipped.width == header.width && clipped.height == header.height)
+        {
+            return decode(dest, options, level, depth, face);
+        }
+
+        Trace trace("ImageDecoder", m_interface->name);
+        status = m_interface->decodeRegion(dest, clipped, options, level, depth, face);
+
+        return status;
+    }
+
     ImageDecodeFuture ImageDecoder::launch(ImageDecodeCallback callback, const Surface& dest, const ImageDecodeOptions& options, int level, int depth, int face)
     {
         if (m_interface)
@@ -44,6 +44,17 @@ namespace
         {
         }
 
+        ImageHeader getScaledHeader(const ImageDecodeOptions& options) const override
+        {
+            ImageHeader scaled = m_parser.getHeader(options);
+
+            // keep the color signalling resolved in the constructor
+            ImageHeader result = header;
+            result.width = scaled.width;
+            result.height = scaled.height;
+            return result;
+        }
+
         ImageDecodeStatus decode(const Surface& dest, const ImageDecodeOptions& options, int level, int depth, int face) override
         {
             MANGO_UNREFERENCED(level);
@@ -65,6 +76,25 @@ namespace
             return status;
         }
 
+        ImageDecodeStatus decodeRegion(const Surface& dest, const ImageDecodeRegion& region, const ImageDecodeOptions& options, int level, int depth, int face) override
+        {
+            MANGO_UNREFERENCED(level);
+            MANGO_UNREFERENCED(depth);
+            MANGO_UNREFERENCED(face);
+
+            ImageDecodeStatus status = m_parser.decode(dest, options, region);
+
+            // same color signalling as a full decode
+            if (status && m_parser.components() == 4)
+            {
+                icc = ConstMemory();
+                header.color.primaries = ColorPrimaries::BT709;
+                header.color.transfer = TransferFunction::sRGB;
+            }
+
+            return status;
+        }
+
         void populateInspect(ImageInspect& report) const override
         {
             report.lossless = m_parser.isLossless() ? InspectTriState::Yes : InspectTriState::No;
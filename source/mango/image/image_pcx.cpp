@@ -760,6 +760,24 @@ namespace
         return x;
     }
 
+    bool probe(ConstMemory memory)
+    {
+        // A single manufacturer byte is too weak alone; validate the other small fields too
+        if (memory.size < 128)
+            return false;
+
+        const u8* p = memory.address;
+
+        u8 manufacturer = p[0];
+        u8 version = p[1];
+        u8 encoding = p[2];
+        u8 bits = p[3];
+
+        bool valid_version = version == 0 || (version >= 2 && version <= 5);
+        bool valid_bits = bits == 1 || bits == 2 || bits == 4 || bits == 8;
+        return manufacturer == 10 && valid_version && encoding <= 1 && valid_bits;
+    }
+
 } // namespace
 
 namespace mango::image
@@ -767,7 +785,7 @@ namespace mango::image
 
     void registerImageCodecPCX()
     {
-        registerImageDecoder(createInterface, ".pcx");
+        registerImageDecoder(createInterface, probe, ImageDecoder::ProbeStrength::Weak, ".pcx");
     }
 
 } // namespace mango::image
@@ -4114,17 +4114,25 @@ namespace
         }
     }
 
-#if 0
-    // NOTE: This is what the UP/AVERAGE/PAETH filters would look like if we wanted to use them.
-    //       We don't want to use them because these depend on previous scanline so don't work
-    //       with parallel decoder unless each segment starts with NONE or SUB filter which do not
-    //       require the previous scanline. Selecting which filter is the best one is too slow so
-    //       we go with the SUB filter every time. :)
+    // The UP/AVERAGE/PAETH filters depend on the previous scanline so they only work with
+    // the parallel decoder when each segment starts with NONE or SUB filter. The adaptive
+    // filter selection restricts the first scanline of each segment to those.
 
     static
     void write_filter_up(u8* dest, const u8* scan, const u8* prev, size_t bytes)
     {
-        for (size_t i = 0; i < bytes; ++i)
+        size_t i = 0;
+
+#if defined(MANGO_ENABLE_SSE2)
+        for ( ; i + 16 <= bytes; i += 16)
+        {
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scan + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_sub_epi8(x, b));
+        }
+#endif
+
+        for ( ; i < bytes; ++i)
         {
             dest[i] = u8(scan[i] - prev[i]);
         }
@@ -4142,7 +4150,21 @@ namespace
         dest += bpp;
         prev += bpp;
 
-        for (size_t i = 0; i < bytes; ++i)
+        size_t i = 0;
+
+#if defined(MANGO_ENABLE_SSE2)
+        for ( ; i + 16 <= bytes; i += 16)
+        {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scan + i));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + i));
+            __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(scan + i + bpp));
+            __m128i avg = _mm_avg_epu8(a, b);
+            avg = _mm_sub_epi8(avg, _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_sub_epi8(x, avg));
+        }
+#endif
+
+        for ( ; i < bytes; ++i)
         {
             dest[i] = u8(scan[i + bpp] - ((prev[i] + scan[i]) / 2));
         }
@@ -4159,7 +4181,34 @@ namespace
         bytes -= bpp;
         dest += bpp;
 
-        for (size_t i = 0; i < bytes; ++i)
+        size_t i = 0;
+
+#if defined(MANGO_ENABLE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+
+        for ( ; i + 8 <= bytes; i += 8)
+        {
+            __m128i x = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(scan + i + bpp));
+            int16x8 a(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(scan + i)), zero));
+            int16x8 b(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(prev + i + bpp)), zero));
+            int16x8 c(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(prev + i)), zero));
+
+            int16x8 pa = b - c;
+            int16x8 pb = a - c;
+            int16x8 pc = pa + pb;
+            pa = abs(pa);
+            pb = abs(pb);
+            pc = abs(pc);
+            int16x8 smallest = min(pc, min(pa, pb));
+            int16x8 nearest = select(smallest == pa, a,
+                              select(smallest == pb, b, c));
+
+            __m128i predictor = _mm_packus_epi16(nearest, nearest);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i), _mm_sub_epi8(x, predictor));
+        }
+#endif
+
+        for ( ; i < bytes; ++i)
         {
             int b = prev[i + bpp];
             int c = prev[i];
@@ -4177,8 +4226,78 @@ namespace
             dest[i] = u8(scan[i + bpp] - p);
         }
     }
+
+    static
+    u64 filter_cost(const u8* data, size_t bytes)
+    {
+        // sum of absolute values of the residuals interpreted as signed bytes
+        u64 cost = 0;
+        size_t i = 0;
+
+#if defined(MANGO_ENABLE_SSE2)
+        const __m128i zero = _mm_setzero_si128();
+        __m128i sum = zero;
+
+        for ( ; i + 16 <= bytes; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            v = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(v, zero));
+        }
+
+        u64 temp[2];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(temp), sum);
+        cost = temp[0] + temp[1];
 #endif
 
+        for ( ; i < bytes; ++i)
+        {
+            cost += std::abs(int(s8(data[i])));
+        }
+
+        return cost;
+    }
+
+    static
+    void write_filter_adaptive(u8* dest, const u8* scan, const u8* prev, u8* temp, size_t bpp, size_t bytes)
+    {
+        // Select the filter with the smallest sum of absolute residuals. The previous
+        // scanline is not available at the start of the image or a parallel segment.
+
+        const u8* best = scan;
+        u8 best_filter = FILTER_NONE;
+        u64 best_cost = filter_cost(scan, bytes);
+
+        auto select = [&] (const u8* residual, u8 filter)
+        {
+            u64 cost = filter_cost(residual, bytes);
+            if (cost < best_cost)
+            {
+                best = residual;
+                best_filter = filter;
+                best_cost = cost;
+            }
+        };
+
+        write_filter_sub(temp + bytes * 0, scan, bpp, bytes);
+        select(temp + bytes * 0, FILTER_SUB);
+
+        if (prev)
+        {
+            write_filter_up(temp + bytes * 1, scan, prev, bytes);
+            select(temp + bytes * 1, FILTER_UP);
+
+            write_filter_average(temp + bytes * 2, scan, prev, bpp, bytes);
+            select(temp + bytes * 2, FILTER_AVERAGE);
+
+            write_filter_paeth(temp + bytes * 3, scan, prev, bpp, bytes);
+            select(temp + bytes * 3, FILTER_PAETH);
+        }
+
+        dest[0] = best_filter;
+        std::memcpy(dest + 1, best, bytes);
+    }
+
     static
     void write_chunk(Stream& stream, u32 chunk_id, ConstMemory memory)
     {
@@ -4218,7 +4337,7 @@ namespace
     static
     void write_PLTE(Stream& stream, const Palette& palette)
     {
-        constexpr size_t count = 256;
+        const size_t count = palette.size;
 
         Buffer buffer(count * 3);
 
@@ -4232,6 +4351,31 @@ namespace
         write_chunk(stream, u32_mask_rev('P', 'L', 'T', 'E'), buffer);
     }
 
+    static
+    void write_tRNS(Stream& stream, const Palette& palette)
+    {
+        // trailing opaque entries can be omitted
+        size_t count = palette.size;
+        while (count > 0 && palette[count - 1].a == 255)
+        {
+            --count;
+        }
+
+        if (!count)
+        {
+            return;
+        }
+
+        Buffer buffer(count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            buffer[i] = palette[i].a;
+        }
+
+        write_chunk(stream, u32_mask_rev('t', 'R', 'N', 'S'), buffer);
+    }
+
     static
     void write_iCCP(Stream& stream, const ImageEncodeOptions& options)
     {
@@ -4265,23 +4409,35 @@ namespace
         BigEndianStream s(buffer);
 
         s.write32(segment_height);
-        s.write8(0x01); // parallel filtering is supported (because we always use SUB filter)
+        s.write8(0x01); // parallel filtering is supported (segments start with NONE or SUB filter)
 
         write_chunk(stream, u32_mask_rev('p', 'L', 'L', 'D'), buffer);
     }
 
     static
-    void filter_range(u8* buffer, const Surface& surface, int color_bits, int y0, int y1)
+    void filter_range(u8* buffer, const Surface& surface, int color_bits, int y0, int y1, bool adaptive)
     {
         const int bpp = surface.format.bytes();
         const int bytes_per_scan = surface.width * bpp;
 
         u8* image = surface.address(0, y0);
 
+        // residuals of the candidate filters
+        Buffer temp(adaptive ? bytes_per_scan * 4 : 0);
+
         for (int y = y0; y < y1; ++y)
         {
-            *buffer++ = FILTER_SUB;
-            write_filter_sub(buffer, image, bpp, bytes_per_scan);
+            if (adaptive)
+            {
+                const u8* prev = y > y0 ? image - surface.stride : nullptr;
+                write_filter_adaptive(buffer, image, prev, temp, bpp, bytes_per_scan);
+                ++buffer;
+            }
+            else
+            {
+                *buffer++ = FILTER_SUB;
+                write_filter_sub(buffer, image, bpp, bytes_per_scan);
+            }
 
 #ifdef MANGO_LITTLE_ENDIAN
             byteswap(Memory(buffer, bytes_per_scan), color_bits);
@@ -4301,7 +4457,8 @@ namespace
         Buffer buffer(bytes_per_scan * surface.height);
 
         // filtering
-        filter_range(buffer, surface, color_bits, 0, surface.height);
+        const bool adaptive = options.adaptive_filter && !surface.format.isIndexed();
+        filter_range(buffer, surface, color_bits, 0, surface.height, adaptive);
 
         // compute fpng scaling factor
         int factor = 0; // default: not supported
@@ -4384,6 +4541,7 @@ namespace
 
         const int N = div_ceil(surface.height, segment_height);
         const int level = math::clamp(options.compression, 0, 9);
+        const bool adaptive = options.adaptive_filter;
 
         u32 cumulative_adler = 1;
 
@@ -4408,7 +4566,7 @@ namespace
 
             q.enqueue([=, &encoding_failure, &surface, &stream, &cumulative_adler]
             {
-                filter_range(source.address, surface, color_bits, y, y + h);
+                filter_range(source.address, surface, color_bits, y, y + h, adaptive);
 
 #if defined(USE_ISAL_ENCODE)
 
@@ -4646,7 +4804,8 @@ namespace
     }
 
     static
-    void write_png(Stream& stream, ImageEncodeStatus& status, const Surface& surface, u8 color_bits, ColorType color_type, const ImageEncodeOptions& options)
+    void write_png(Stream& stream, ImageEncodeStatus& status, const Surface& surface, u8 color_bits, ColorType color_type,
+                   const ImageEncodeOptions& options, bool palette_alpha = false)
     {
         BigEndianStream s(stream);
 
@@ -4661,6 +4820,12 @@ namespace
         if (surface.format.isIndexed())
         {
             write_PLTE(stream, *surface.palette);
+
+            if (palette_alpha)
+            {
+                write_tRNS(stream, *surface.palette);
+            }
+
             segment_height = 0; // parallel encoder only supports 24 and 32 bit color
         }
 
@@ -4682,6 +4847,418 @@ namespace
         s.write32(0xae426082);
     }
 
+    // ------------------------------------------------------------
+    // color type reduction
+    // ------------------------------------------------------------
+
+    struct ColorSet
+    {
+        // open addressing hash set which holds up to 256 colors; the values
+        // are the palette indices once the palette has been resolved
+        static constexpr u32 capacity = 512;
+
+        u32 keys[capacity];
+        u8 values[capacity];
+        bool used[capacity];
+        u32 size = 0;
+
+        ColorSet()
+        {
+            std::memset(used, 0, sizeof(used));
+        }
+
+        static
+        u32 hash(u32 color)
+        {
+            return (color * 0x9e3779b1) >> 23;
+        }
+
+        u32 slot(u32 color) const
+        {
+            u32 index = hash(color);
+
+            while (used[index] && keys[index] != color)
+            {
+                index = (index + 1) & (capacity - 1);
+            }
+
+            return index;
+        }
+
+        // returns false when the color would not fit into the set
+        bool insert(u32 color)
+        {
+            u32 index = slot(color);
+
+            if (!used[index])
+            {
+                if (size == 256)
+                {
+                    return false;
+                }
+
+                used[index] = true;
+                keys[index] = color;
+                ++size;
+            }
+
+            return true;
+        }
+
+        u8 lookup(u32 color) const
+        {
+            return values[slot(color)];
+        }
+    };
+
+    struct ColorAnalysis
+    {
+        bool opaque = true;  // all alpha samples are at maximum value
+        bool gray = true;    // red, green and blue samples are equal
+        bool depth8 = true;  // 16 bit samples are exactly representable with 8 bits (false for 8 bit input)
+        bool palette = true; // no more than 256 unique colors
+        ColorSet colors;
+    };
+
+    template <typename T, int C>
+    inline
+    void read_color(const T* s, u32& r, u32& g, u32& b, u32& a)
+    {
+        constexpr u32 maxvalue = (1u << (sizeof(T) * 8)) - 1;
+
+        if constexpr (C == 1)
+        {
+            r = g = b = s[0];
+            a = maxvalue;
+        }
+        else if constexpr (C == 2)
+        {
+            r = g = b = s[0];
+            a = s[1];
+        }
+        else
+        {
+            r = s[0];
+            g = s[1];
+            b = s[2];
+            a = s[3];
+        }
+    }
+
+    template <typename T, int C>
+    void analyze_range(ColorAnalysis& result, const Surface& surface, int y0, int y1)
+    {
+        constexpr u32 maxvalue = (1u << (sizeof(T) * 8)) - 1;
+        constexpr u32 shift = (sizeof(T) - 1) * 8;
+
+        u32 opaque = 1;
+        u32 gray = 1;
+        u32 depth8 = sizeof(T) == 2;
+        bool palette = true;
+
+        u32 previous = 0;
+        bool cached = false;
+
+        for (int y = y0; y < y1; ++y)
+        {
+            const T* s = reinterpret_cast<const T*>(surface.address(0, y));
+
+            for (int x = 0; x < surface.width; ++x)
+            {
+                u32 r, g, b, a;
+                read_color<T, C>(s, r, g, b, a);
+                s += C;
+
+                opaque &= (a == maxvalue);
+                gray &= (r == g) & (g == b);
+
+                if constexpr (sizeof(T) == 2)
+                {
+                    depth8 &= ((r >> 8) == (r & 0xff)) & ((g >> 8) == (g & 0xff)) &
+                              ((b >> 8) == (b & 0xff)) & ((a >> 8) == (a & 0xff));
+                }
+
+                if (palette)
+                {
+                    u32 color = Color(r >> shift, g >> shift, b >> shift, a >> shift);
+
+                    // consecutive pixels often have the same color
+                    if (color != previous || !cached)
+                    {
+                        palette = result.colors.insert(color);
+                        previous = color;
+                        cached = true;
+                    }
+                }
+            }
+
+            if (!(opaque | gray | depth8 | palette))
+            {
+                // nothing left to discover
+                break;
+            }
+        }
+
+        result.opaque = opaque;
+        result.gray = gray;
+        result.depth8 = depth8;
+        result.palette = palette;
+    }
+
+    template <typename T, typename O, int C>
+    void reduce_range(const Surface& dest, const Surface& source, ColorType color_type, const ColorSet& colors, int y0, int y1)
+    {
+        constexpr u32 shift = (sizeof(T) - sizeof(O)) * 8;
+        constexpr u32 palette_shift = (sizeof(T) - 1) * 8;
+
+        for (int y = y0; y < y1; ++y)
+        {
+            const T* s = reinterpret_cast<const T*>(source.address(0, y));
+
+            if (color_type == COLOR_TYPE_PALETTE)
+            {
+                u8* d = dest.address(0, y);
+
+                for (int x = 0; x < source.width; ++x)
+                {
+                    u32 r, g, b, a;
+                    read_color<T, C>(s, r, g, b, a);
+                    s += C;
+
+                    d[x] = colors.lookup(Color(r >> palette_shift, g >> palette_shift, b >> palette_shift, a >> palette_shift));
+                }
+            }
+            else
+            {
+                O* d = reinterpret_cast<O*>(dest.address(0, y));
+
+                for (int x = 0; x < source.width; ++x)
+                {
+                    u32 r, g, b, a;
+                    read_color<T, C>(s, r, g, b, a);
+                    s += C;
+
+                    switch (color_type)
+                    {
+                        case COLOR_TYPE_I:
+                            *d++ = O(r >> shift);
+                            break;
+                        case COLOR_TYPE_IA:
+                            *d++ = O(r >> shift);
+                            *d++ = O(a >> shift);
+                            break;
+                        case COLOR_TYPE_RGB:
+                            *d++ = O(r >> shift);
+                            *d++ = O(g >> shift);
+                            *d++ = O(b >> shift);
+                            break;
+                        default:
+                            *d++ = O(r >> shift);
+                            *d++ = O(g >> shift);
+                            *d++ = O(b >> shift);
+                            *d++ = O(a >> shift);
+                            break;
+                    }
+                }
+            }
+        }
+    }
+
+    using AnalyzeFunc = void (*)(ColorAnalysis& result, const Surface& surface, int y0, int y1);
+    using ReduceFunc = void (*)(const Surface& dest, const Surface& source, ColorType color_type, const ColorSet& colors, int y0, int y1);
+
+    static
+    int configure_bands(const Surface& surface)
+    {
+        constexpr size_t band_pixels = 256 * 1024;
+        size_t pixels = size_t(surface.width) * surface.height;
+        return int(std::clamp<size_t>(pixels / band_pixels, 1, std::min(64, surface.height)));
+    }
+
+    static
+    bool write_png_reduced(Stream& stream, ImageEncodeStatus& status, const Surface& surface, u8 color_bits, ColorType color_type, const ImageEncodeOptions& options)
+    {
+        // The surface is I, IA or RGBA with 8 or 16 bits per sample. Find the smallest
+        // color type and bit depth which represents the image exactly.
+
+        const int channels = surface.format.bytes() * 8 / color_bits;
+        const bool wide = color_bits == 16;
+
+        AnalyzeFunc analyze = nullptr;
+        ReduceFunc reduce = nullptr;
+
+        switch (channels)
+        {
+            case 1:
+                analyze = wide ? analyze_range<u16, 1> : analyze_range<u8, 1>;
+                break;
+            case 2:
+                analyze = wide ? analyze_range<u16, 2> : analyze_range<u8, 2>;
+                break;
+            case 4:
+                analyze = wide ? analyze_range<u16, 4> : analyze_range<u8, 4>;
+                break;
+            default:
+                return false;
+        }
+
+        const int N = configure_bands(surface);
+        const int band_height = div_ceil(surface.height, N);
+
+        std::vector<ColorAnalysis> bands(N);
+
+        ConcurrentQueue q("png.analyze");
+
+        for (int i = 0; i < N; ++i)
+        {
+            int y0 = i * band_height;
+            int y1 = std::min(y0 + band_height, surface.height);
+
+            q.enqueue([&bands, &surface, analyze, i, y0, y1]
+            {
+                analyze(bands[i], surface, y0, y1);
+            });
+        }
+
+        q.wait();
+
+        // merge the bands
+        ColorAnalysis result;
+
+        for (const ColorAnalysis& band : bands)
+        {
+            result.opaque &= band.opaque;
+            result.gray &= band.gray;
+            result.depth8 &= band.depth8;
+            result.palette &= band.palette;
+
+            for (u32 i = 0; result.palette && i < ColorSet::capacity; ++i)
+            {
+                if (band.colors.used[i])
+                {
+                    result.palette = result.colors.insert(band.colors.keys[i]);
+                }
+            }
+        }
+
+        const bool depth8 = !wide || result.depth8;
+        const bool gray = channels < 4 || result.gray;
+
+        ColorType reduced_type = COLOR_TYPE_RGBA;
+
+        if (gray && result.opaque)
+        {
+            reduced_type = COLOR_TYPE_I;
+        }
+        else if (result.palette && depth8)
+        {
+            // one byte per pixel beats two (IA) or more bytes per pixel
+            reduced_type = COLOR_TYPE_PALETTE;
+        }
+        else if (gray)
+        {
+            reduced_type = COLOR_TYPE_IA;
+        }
+        else if (result.opaque)
+        {
+            reduced_type = COLOR_TYPE_RGB;
+        }
+
+        u8 reduced_bits = depth8 ? 8 : 16;
+
+        if (reduced_type == color_type && reduced_bits == color_bits)
+        {
+            // no reduction is possible
+            return false;
+        }
+
+        Format format;
+
+        switch (reduced_type)
+        {
+            case COLOR_TYPE_I:
+                format = LuminanceFormat(reduced_bits, Format::UNORM, reduced_bits, 0);
+                break;
+            case COLOR_TYPE_IA:
+                format = LuminanceFormat(reduced_bits * 2, Format::UNORM, reduced_bits, reduced_bits);
+                break;
+            case COLOR_TYPE_RGB:
+                format = Format(reduced_bits * 3, Format::UNORM, Format::RGB, reduced_bits, reduced_bits, reduced_bits);
+                break;
+            case COLOR_TYPE_PALETTE:
+                format = IndexedFormat(8);
+                break;
+            default:
+                format = Format(reduced_bits * 4, Format::UNORM, Format::RGBA, reduced_bits, reduced_bits, reduced_bits, reduced_bits);
+                break;
+        }
+
+        Bitmap bitmap(surface.width, surface.height, format);
+
+        if (reduced_type == COLOR_TYPE_PALETTE)
+        {
+            // translucent colors first so that the tRNS chunk is as short as possible
+            std::vector<u32> colors;
+
+            for (u32 i = 0; i < ColorSet::capacity; ++i)
+            {
+                if (result.colors.used[i])
+                {
+                    colors.push_back(result.colors.keys[i]);
+                }
+            }
+
+            std::stable_partition(colors.begin(), colors.end(), [] (u32 color)
+            {
+                return Color(color).a != 255;
+            });
+
+            Palette& palette = *bitmap.palette;
+            palette.size = u32(colors.size());
+
+            for (u32 i = 0; i < palette.size; ++i)
+            {
+                palette[i] = Color(colors[i]);
+                result.colors.values[result.colors.slot(colors[i])] = u8(i);
+            }
+
+            reduced_bits = 8;
+        }
+
+        switch (channels)
+        {
+            case 1:
+                reduce = !wide ? reduce_range<u8, u8, 1> : depth8 ? reduce_range<u16, u8, 1> : reduce_range<u16, u16, 1>;
+                break;
+            case 2:
+                reduce = !wide ? reduce_range<u8, u8, 2> : depth8 ? reduce_range<u16, u8, 2> : reduce_range<u16, u16, 2>;
+                break;
+            default:
+                reduce = !wide ? reduce_range<u8, u8, 4> : depth8 ? reduce_range<u16, u8, 4> : reduce_range<u16, u16, 4>;
+                break;
+        }
+
+        for (int i = 0; i < N; ++i)
+        {
+            int y0 = i * band_height;
+            int y1 = std::min(y0 + band_height, surface.height);
+
+            q.enqueue([&bitmap, &surface, &result, reduce, reduced_type, y0, y1]
+            {
+                reduce(bitmap, surface, reduced_type, result.colors, y0, y1);
+            });
+        }
+
+        q.wait();
+
+        printLine(Print::Debug, "[ImageEncoder.PNG] reduced {} ({} bits) to {} ({} bits)",
+            get_string(color_type), color_bits, get_string(reduced_type), reduced_bits);
+
+        write_png(stream, status, bitmap, reduced_bits, reduced_type, options, true);
+
+        return true;
+    }
+
     // ------------------------------------------------------------
     // ImageDecoder
     // ------------------------------------------------------------
@@ -4833,6 +5410,11 @@ namespace
         // convert to correct format when required
         TemporaryBitmap temp(surface, format);
 
+        if (options.reduce && write_png_reduced(stream, status, temp, color_bits, color_type, options))
+        {
+            return status;
+        }
+
         // encode
         write_png(stream, status, temp, color_bits, color_type, options);
 
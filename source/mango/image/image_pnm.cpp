@@ -692,6 +692,12 @@ namespace
         }
     }
 
+    bool isFormatPNM(ConstMemory memory, const char* extension)
+    {
+        const char* detected = getFormatExtensionPNM(memory);
+        return detected && !std::strcmp(detected, extension);
+    }
+
 } // namespace
 
 namespace mango::image
@@ -700,20 +706,15 @@ namespace mango::image
     void registerImageCodecPNM()
     {
         // decoders
-        registerImageDecoder(createInterface, ".pbm");
-        registerImageDecoder(createInterface, ".pgm");
-        registerImageDecoder(createInterface, ".ppm");
+        registerImageDecoder(createInterface, [] (ConstMemory memory) { return isFormatPNM(memory, ".pbm"); }, ImageDecoder::ProbeStrength::Strong, ".pbm");
+        registerImageDecoder(createInterface, [] (ConstMemory memory) { return isFormatPNM(memory, ".pgm"); }, ImageDecoder::ProbeStrength::Strong, ".pgm");
+        registerImageDecoder(createInterface, [] (ConstMemory memory) { return isFormatPNM(memory, ".ppm"); }, ImageDecoder::ProbeStrength::Strong, ".ppm");
         registerImageDecoder(createInterface, ".pnm");
-        registerImageDecoder(createInterface, ".pam");
-        registerImageDecoder(createInterface, ".pfm");
+        registerImageDecoder(createInterface, [] (ConstMemory memory) { return isFormatPNM(memory, ".pam"); }, ImageDecoder::ProbeStrength::Strong, ".pam");
+        registerImageDecoder(createInterface, [] (ConstMemory memory) { return isFormatPNM(memory, ".pfm"); }, ImageDecoder::ProbeStrength::Strong, ".pfm");
 
         // encoders
         registerImageEncoder(imageEncodePFM, ".pfm");
     }
 
-    const char* detectImageCodecPNM(ConstMemory memory)
-    {
-        return getFormatExtensionPNM(memory);
-    }
-
 } // namespace mango::image
@@ -369,6 +369,19 @@ namespace
         return x;
     }
 
+    bool probe(ConstMemory memory)
+    {
+        if (memory.size < 512)
+            return false;
+
+        BigEndianConstPointer p = memory.address;
+
+        u16 magic = p.read16();
+        u8 encoding = p.read8();
+        u8 bpc = p.read8();
+        return magic == 474 && encoding <= 1 && (bpc == 1 || bpc == 2);
+    }
+
 } // namespace
 
 namespace mango::image
@@ -376,7 +389,7 @@ namespace mango::image
 
     void registerImageCodecSGI()
     {
-        registerImageDecoder(createInterface, ".rgb");
+        registerImageDecoder(createInterface, probe, ImageDecoder::ProbeStrength::Weak, ".rgb");
         registerImageDecoder(createInterface, ".rgba");
         registerImageDecoder(createInterface, ".bw");
         registerImageDecoder(createInterface, ".sgi");
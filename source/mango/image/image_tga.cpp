@@ -588,6 +588,17 @@ namespace
         return x;
     }
 
+    bool probe(ConstMemory memory)
+    {
+        // TGA has no header magic; only version 2 files can be recognized (by the footer)
+        const char signature[] = "TRUEVISION-XFILE.";
+        if (memory.size < 18 + 26)
+            return false;
+
+        const u8* footer = memory.end() - 18;
+        return !std::memcmp(footer, signature, sizeof(signature));
+    }
+
     // ------------------------------------------------------------
     // ImageEncoder
     // ------------------------------------------------------------
@@ -646,7 +657,7 @@ namespace mango::image
 
     void registerImageCodecTGA()
     {
-        registerImageDecoder(createInterface, ".tga");
+        registerImageDecoder(createInterface, probe, ImageDecoder::ProbeStrength::Strong, ".tga");
         registerImageEncoder(imageEncode, ".tga");
     }
 
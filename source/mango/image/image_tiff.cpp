@@ -3028,6 +3028,9 @@ namespace
 
         bool decompress_jpeg(DecodeTargetBitmap& target, ImageDecodeOptions options, int level, int depth, int face)
         {
+            // strips and tiles are assembled at full resolution
+            options.scale = 1;
+
             if (m_context.photometric == 2)
             {
                 options.jpeg_colorspace_rgb = true;
@@ -0,0 +1,851 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <cmath>
+#include <type_traits>
+#include <vector>
+#include <mango/core/core.hpp>
+#include <mango/image/image.hpp>
+#include <mango/math/math.hpp>
+
+namespace
+{
+
+    using namespace mango;
+    using namespace mango::math;
+    using namespace mango::image;
+
+    // destination scanlines filtered from one set of horizontally filtered source scanlines
+    constexpr int band_height = 16;
+
+    // ------------------------------------------------------------------
+    // filters
+    // ------------------------------------------------------------------
+
+    struct Kernel
+    {
+        float support;
+        float (*evaluate)(float x);
+    };
+
+    float box_kernel(float x)
+    {
+        return (x >= -0.5f && x < 0.5f) ? 1.0f : 0.0f;
+    }
+
+    float triangle_kernel(float x)
+    {
+        x = std::abs(x);
+        return x < 1.0f ? 1.0f - x : 0.0f;
+    }
+
+    float mitchell_kernel(float x)
+    {
+        constexpr float B = 1.0f / 3.0f;
+        constexpr float C = 1.0f / 3.0f;
+
+        x = std::abs(x);
+
+        if (x < 1.0f)
+        {
+            return ((12.0f - 9.0f * B - 6.0f * C) * x * x * x +
+                    (-18.0f + 12.0f * B + 6.0f * C) * x * x +
+                    (6.0f - 2.0f * B)) * (1.0f / 6.0f);
+        }
+
+        if (x < 2.0f)
+        {
+            return ((-B - 6.0f * C) * x * x * x +
+                    (6.0f * B + 30.0f * C) * x * x +
+                    (-12.0f * B - 48.0f * C) * x +
+                    (8.0f * B + 24.0f * C)) * (1.0f / 6.0f);
+        }
+
+        return 0.0f;
+    }
+
+    float sinc(float x)
+    {
+        if (x == 0.0f)
+        {
+            return 1.0f;
+        }
+
+        x *= float(pi);
+        return std::sin(x) / x;
+    }
+
+    float lanczos_kernel(float x)
+    {
+        return std::abs(x) < 3.0f ? sinc(x) * sinc(x / 3.0f) : 0.0f;
+    }
+
+    Kernel getKernel(ResampleFilter filter)
+    {
+        switch (filter)
+        {
+            case ResampleFilter::BOX:
+                return { 0.5f, box_kernel };
+            case ResampleFilter::TRIANGLE:
+                return { 1.0f, triangle_kernel };
+            case ResampleFilter::MITCHELL:
+                return { 2.0f, mitchell_kernel };
+            case ResampleFilter::LANCZOS:
+            default:
+                return { 3.0f, lanczos_kernel };
+        }
+    }
+
+    // ------------------------------------------------------------------
+    // Coefficients
+    // ------------------------------------------------------------------
+
+    /*
+        Filter weights for one axis, computed once per resample. Output sample i is
+        the weighted sum of count[i] source samples starting at start[i]. The filter
+        is widened by the scale factor when minifying; the samples which fall outside
+        of the source are dropped and the remaining weights are normalized.
+    */
+
+    struct Coefficients
+    {
+        int taps;
+        std::vector<int> start;
+        std::vector<int> count;
+        std::vector<float> weights;
+
+        Coefficients(int dest_size, int source_size, const Kernel& kernel)
+        {
+            const float scale = float(source_size) / float(dest_size);
+            const float filter_scale = std::max(1.0f, scale);
+            const float support = kernel.support * filter_scale;
+
+            taps = int(std::ceil(support * 2.0f)) + 2;
+
+            start.resize(dest_size);
+            count.resize(dest_size);
+            weights.resize(size_t(dest_size) * taps);
+
+            for (int i = 0; i < dest_size; ++i)
+            {
+                const float center = (i + 0.5f) * scale;
+                const int left = std::max(0, int(std::floor(center - support)));
+                const int right = std::min(source_size, int(std::ceil(center + support)));
+
+                float* w = &weights[size_t(i) * taps];
+
+                int first = -1;
+                int last = -1;
+                float sum = 0.0f;
+
+                for (int j = left; j < right; ++j)
+                {
+                    const float value = kernel.evaluate((j + 0.5f - center) / filter_scale);
+                    if (value != 0.0f)
+                    {
+                        if (first < 0)
+                        {
+                            first = j;
+                        }
+
+                        w[j - first] = value;
+                        last = j;
+                        sum += value;
+                    }
+                    else if (first >= 0)
+                    {
+                        w[j - first] = 0.0f;
+                    }
+                }
+
+                if (first < 0 || sum == 0.0f)
+                {
+                    // nothing in range; use the nearest sample
+                    start[i] = std::min(source_size - 1, int(center));
+                    count[i] = 1;
+                    w[0] = 1.0f;
+                    continue;
+                }
+
+                start[i] = first;
+                count[i] = last - first + 1;
+
+                const float inv_sum = 1.0f / sum;
+
+                for (int k = 0; k < count[i]; ++k)
+                {
+                    w[k] *= inv_sum;
+                }
+            }
+        }
+
+        const float* getWeights(int index) const
+        {
+            return &weights[size_t(index) * taps];
+        }
+    };
+
+    // ------------------------------------------------------------------
+    // channel conversion
+    // ------------------------------------------------------------------
+
+    template <typename T>
+    struct Channel;
+
+    template <>
+    struct Channel<u8>
+    {
+        static float load(u8 value)
+        {
+            return value * (1.0f / 255.0f);
+        }
+
+        static u8 store(float value)
+        {
+            return u8(clamp(value, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+    };
+
+    template <>
+    struct Channel<u16>
+    {
+        static float load(u16 value)
+        {
+            return value * (1.0f / 65535.0f);
+        }
+
+        static u16 store(float value)
+        {
+            return u16(clamp(value, 0.0f, 1.0f) * 65535.0f + 0.5f);
+        }
+    };
+
+    template <>
+    struct Channel<float16>
+    {
+        static float load(float16 value)
+        {
+            return float(value);
+        }
+
+        static float16 store(float value)
+        {
+            return float16(value);
+        }
+    };
+
+    template <>
+    struct Channel<float>
+    {
+        static float load(float value)
+        {
+            return value;
+        }
+
+        static float store(float value)
+        {
+            return value;
+        }
+    };
+
+    template <typename T>
+    void load_row(float* dest, const T* src, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            dest[i] = Channel<T>::load(src[i]);
+        }
+    }
+
+    template <typename T>
+    void store_row(T* dest, const float* src, int count)
+    {
+        for (int i = 0; i < count; ++i)
+        {
+            dest[i] = Channel<T>::store(src[i]);
+        }
+    }
+
+    template <>
+    void load_row<u8>(float* dest, const u8* src, int count)
+    {
+        int i = 0;
+
+        for ( ; i <= count - 4; i += 4)
+        {
+            const int32x4 v = simd::unpack(uload32(src + i));
+            float32x4::ustore(dest + i, convert<float32x4>(v) * (1.0f / 255.0f));
+        }
+
+        for ( ; i < count; ++i)
+        {
+            dest[i] = Channel<u8>::load(src[i]);
+        }
+    }
+
+    template <>
+    void store_row<u8>(u8* dest, const float* src, int count)
+    {
+        int i = 0;
+
+        for ( ; i <= count - 4; i += 4)
+        {
+            // rounds the same way as Channel<u8>::store() in the tail loop
+            const float32x4 v = clamp(float32x4::uload(src + i), 0.0f, 1.0f) * 255.0f + 0.5f;
+            ustore32(dest + i, simd::pack(truncate<int32x4>(v)));
+        }
+
+        for ( ; i < count; ++i)
+        {
+            dest[i] = Channel<u8>::store(src[i]);
+        }
+    }
+
+    template <>
+    void load_row<u16>(float* dest, const u16* src, int count)
+    {
+        int i = 0;
+
+        for ( ; i <= count - 4; i += 4)
+        {
+            const int32x4 v(src[i + 0], src[i + 1], src[i + 2], src[i + 3]);
+            float32x4::ustore(dest + i, convert<float32x4>(v) * (1.0f / 65535.0f));
+        }
+
+        for ( ; i < count; ++i)
+        {
+            dest[i] = Channel<u16>::load(src[i]);
+        }
+    }
+
+    template <>
+    void store_row<u16>(u16* dest, const float* src, int count)
+    {
+        int i = 0;
+
+        for ( ; i <= count - 4; i += 4)
+        {
+            const float32x4 v = clamp(float32x4::uload(src + i), 0.0f, 1.0f) * 65535.0f + 0.5f;
+            const int32x4 s = truncate<int32x4>(v);
+            dest[i + 0] = u16(s.x);
+            dest[i + 1] = u16(s.y);
+            dest[i + 2] = u16(s.z);
+            dest[i + 3] = u16(s.w);
+        }
+
+        for ( ; i < count; ++i)
+        {
+            dest[i] = Channel<u16>::store(src[i]);
+        }
+    }
+
+    template <>
+    void load_row<float16>(float* dest, const float16* src, int count)
+    {
+        int i = 0;
+
+        for ( ; i <= count - 4; i += 4)
+        {
+            float32x4::ustore(dest + i, float32x4(float16x4::uload(src + i)));
+        }
+
+        for ( ; i < count; ++i)
+        {
+            dest[i] = Channel<float16>::load(src[i]);
+        }
+    }
+
+    template <>
+    void store_row<float16>(float16* dest, const float* src, int count)
+    {
+        int i = 0;
+
+        for ( ; i <= count - 4; i += 4)
+        {
+            float16x4::ustore(dest + i, float16x4(float32x4::uload(src + i)));
+        }
+
+        for ( ; i < count; ++i)
+        {
+            dest[i] = Channel<float16>::store(src[i]);
+        }
+    }
+
+    // IEC 61966-2-1 transfer function; the approximations in srgb.hpp do not
+    // round-trip 8 bit values
+
+    float32x4 srgb_decode(float32x4 s)
+    {
+        const float32x4 low = s * (1.0f / 12.92f);
+        const float32x4 high = pow((s + 0.055f) * (1.0f / 1.055f), float32x4(2.4f));
+        return select(s <= float32x4(0.04045f), low, high);
+    }
+
+    float32x4 srgb_encode(float32x4 linear)
+    {
+        const float32x4 low = linear * 12.92f;
+        const float32x4 high = pow(linear, float32x4(1.0f / 2.4f)) * 1.055f - 0.055f;
+        return select(linear <= float32x4(0.0031308f), low, high);
+    }
+
+    /*
+        sRGB <-> linear conversion of the color channels. The scanlines are processed
+        four floats at a time; the lanes which hold alpha depend on the channel where
+        the vector starts, so there is a pair of lane masks for each channel. 8 bit
+        scanlines are decoded with a table while they are loaded.
+    */
+
+    struct LinearLight
+    {
+        bool enabled;
+        int channels;
+        int alpha_channel;
+        float32x4 color[4]; // 1.0 in color lanes
+        float32x4 alpha[4]; // 1.0 in alpha lanes
+        float table[256];
+
+        LinearLight(bool enabled, int channels, int alpha_channel)
+            : enabled(enabled)
+            , channels(channels)
+            , alpha_channel(alpha_channel)
+        {
+            for (int i = 0; i < 256; i += 4)
+            {
+                const float32x4 v(float(i + 0), float(i + 1), float(i + 2), float(i + 3));
+                float32x4::ustore(table + i, srgb_decode(v * (1.0f / 255.0f)));
+            }
+
+            for (int k = 0; k < channels; ++k)
+            {
+                float c[4];
+                float a[4];
+
+                for (int lane = 0; lane < 4; ++lane)
+                {
+                    const bool is_alpha = (k + lane) % channels == alpha_channel;
+                    c[lane] = is_alpha ? 0.0f : 1.0f;
+                    a[lane] = is_alpha ? 1.0f : 0.0f;
+                }
+
+                color[k] = float32x4(c[0], c[1], c[2], c[3]);
+                alpha[k] = float32x4(a[0], a[1], a[2], a[3]);
+            }
+        }
+
+        void decode(float* dest, const u8* src, int count) const
+        {
+            int c = 0;
+
+            for (int i = 0; i < count; ++i)
+            {
+                dest[i] = c == alpha_channel ? Channel<u8>::load(src[i]) : table[src[i]];
+
+                if (++c == channels)
+                {
+                    c = 0;
+                }
+            }
+        }
+
+        void decode(float* data, size_t size) const
+        {
+            for (size_t i = 0; i < size; i += 4)
+            {
+                const size_t k = i % channels;
+                float32x4 v = float32x4::uload(data + i);
+                v = madd(v * alpha[k], srgb_decode(v), color[k]);
+                float32x4::ustore(data + i, v);
+            }
+        }
+
+        void encode(float* data, size_t size) const
+        {
+            for (size_t i = 0; i < size; i += 4)
+            {
+                const size_t k = i % channels;
+                float32x4 v = float32x4::uload(data + i);
+                v = madd(v * alpha[k], srgb_encode(v), color[k]);
+                float32x4::ustore(data + i, v);
+            }
+        }
+    };
+
+    // ------------------------------------------------------------------
+    // filtering
+    // ------------------------------------------------------------------
+
+    /*
+        Horizontal filter of one scanline. The source scanline must have four floats of
+        padding after the last pixel: the 3 channel filter loads and stores a whole
+        vector per pixel and ignores the fourth lane. The 1 and 2 channel filters are
+        vectorized over the taps and only load the samples in the filter footprint.
+    */
+
+    template <int N>
+    void filter_horizontal(float* dest, const float* src, const Coefficients& coefficients, int width)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            const float* weights = coefficients.getWeights(x);
+            const float* s = src + coefficients.start[x] * N;
+            const int count = coefficients.count[x];
+
+            if constexpr (N == 1)
+            {
+                // four taps per vector
+                float32x4 v = 0.0f;
+                int k = 0;
+
+                for ( ; k <= count - 4; k += 4)
+                {
+                    v = madd(v, float32x4::uload(s + k), float32x4::uload(weights + k));
+                }
+
+                float sum = v.x + v.y + v.z + v.w;
+
+                for ( ; k < count; ++k)
+                {
+                    sum += s[k] * weights[k];
+                }
+
+                dest[x] = sum;
+            }
+            else if constexpr (N == 2)
+            {
+                // two taps per vector
+                float32x4 v = 0.0f;
+                int k = 0;
+
+                for ( ; k <= count - 4; k += 4)
+                {
+                    const float32x4 w = float32x4::uload(weights + k);
+                    v = madd(v, float32x4::uload(s + k * 2 + 0), shuffle<0, 0, 1, 1>(w, w));
+                    v = madd(v, float32x4::uload(s + k * 2 + 4), shuffle<2, 2, 3, 3>(w, w));
+                }
+
+                float v0 = v.x + v.z;
+                float v1 = v.y + v.w;
+
+                for ( ; k < count; ++k)
+                {
+                    v0 += s[k * 2 + 0] * weights[k];
+                    v1 += s[k * 2 + 1] * weights[k];
+                }
+
+                dest[x * 2 + 0] = v0;
+                dest[x * 2 + 1] = v1;
+            }
+            else if constexpr (N == 3)
+            {
+                // one pixel per vector; the fourth lane holds the next pixel and is ignored
+                float32x4 v = 0.0f;
+
+                for (int k = 0; k < count; ++k)
+                {
+                    v = madd(v, float32x4::uload(s + k * 3), weights[k]);
+                }
+
+                if (x < width - 1)
+                {
+                    // the fourth lane is overwritten by the next pixel
+                    float32x4::ustore(dest + x * 3, v);
+                }
+                else
+                {
+                    dest[x * 3 + 0] = v.x;
+                    dest[x * 3 + 1] = v.y;
+                    dest[x * 3 + 2] = v.z;
+                }
+            }
+            else
+            {
+                float32x4 v = 0.0f;
+
+                for (int k = 0; k < count; ++k)
+                {
+                    v = madd(v, float32x4::uload(s + k * 4), weights[k]);
+                }
+
+                float32x4::ustore(dest + x * 4, v);
+            }
+        }
+    }
+
+    void filter_vertical(float* dest, const float* const* rows, const float* weights, int count, size_t size)
+    {
+        for (size_t i = 0; i < size; i += 4)
+        {
+            float32x4 v = 0.0f;
+
+            for (int k = 0; k < count; ++k)
+            {
+                v = madd(v, float32x4::uload(rows[k] + i), weights[k]);
+            }
+
+            float32x4::ustore(dest + i, v);
+        }
+    }
+
+    /*
+        The destination is processed in bands of scanlines (in parallel). The source
+        scanlines which contribute to a band are converted to float, filtered
+        horizontally into the band buffer and the band is then filtered vertically.
+        The scanlines are padded to a multiple of four floats for the SIMD loops and
+        the source scanline has a vector of extra padding for the horizontal filter.
+    */
+
+    template <typename T, int N>
+    void resample_surface(const Surface& dest, const Surface& source, const Coefficients& xcoefficients,
+                          const Coefficients& ycoefficients, const LinearLight& light)
+    {
+        const size_t source_size = (size_t(source.width) * N + 3) & ~size_t(3);
+        const size_t dest_size = (size_t(dest.width) * N + 3) & ~size_t(3);
+
+        parallel_for(0, dest.height, band_height, [&] (size_t begin, size_t end)
+        {
+            std::vector<float> scan(source_size + 4, 0.0f);
+            std::vector<float> output(dest_size);
+            std::vector<float> band;
+            std::vector<const float*> rows(ycoefficients.taps);
+
+            for (int y0 = int(begin); y0 < int(end); y0 += band_height)
+            {
+                const int y1 = std::min(int(end), y0 + band_height);
+
+                int sy0 = source.height;
+                int sy1 = 0;
+
+                for (int y = y0; y < y1; ++y)
+                {
+                    sy0 = std::min(sy0, ycoefficients.start[y]);
+                    sy1 = std::max(sy1, ycoefficients.start[y] + ycoefficients.count[y]);
+                }
+
+                band.resize(size_t(sy1 - sy0) * dest_size);
+
+                for (int sy = sy0; sy < sy1; ++sy)
+                {
+                    const T* src = source.address<T>(0, sy);
+
+                    if constexpr (std::is_same_v<T, u8>)
+                    {
+                        if (light.enabled)
+                            light.decode(scan.data(), src, source.width * N);
+                        else
+                            load_row(scan.data(), src, source.width * N);
+                    }
+                    else
+                    {
+                        load_row(scan.data(), src, source.width * N);
+
+                        if (light.enabled)
+                        {
+                            light.decode(scan.data(), source_size);
+                        }
+                    }
+
+                    float* h = band.data() + size_t(sy - sy0) * dest_size;
+                    filter_horizontal<N>(h, scan.data(), xcoefficients, dest.width);
+                }
+
+                for (int y = y0; y < y1; ++y)
+                {
+                    const int count = ycoefficients.count[y];
+                    const int first = ycoefficients.start[y] - sy0;
+
+                    for (int k = 0; k < count; ++k)
+                    {
+                        rows[k] = band.data() + size_t(first + k) * dest_size;
+                    }
+
+                    filter_vertical(output.data(), rows.data(), ycoefficients.getWeights(y), count, dest_size);
+
+                    if (light.enabled)
+                    {
+                        light.encode(output.data(), dest_size);
+                    }
+
+                    store_row(dest.address<T>(0, y), output.data(), dest.width * N);
+                }
+            }
+        });
+    }
+
+    // ------------------------------------------------------------------
+    // formats
+    // ------------------------------------------------------------------
+
+    struct Layout
+    {
+        int bits = 0;      // bits per channel
+        int channels = 0;
+        int alpha = -1;    // channel index of alpha, -1 if none
+    };
+
+    // formats where every channel has the same size and type are filtered directly
+    bool getLayout(Layout& layout, const Format& format)
+    {
+        if (format.isIndexed())
+        {
+            return false;
+        }
+
+        int bits = 0;
+
+        switch (format.type)
+        {
+            case Format::UNORM:
+                bits = format.size[0];
+                if (bits != 8 && bits != 16)
+                {
+                    return false;
+                }
+                break;
+
+            case Format::FLOAT16:
+                bits = 16;
+                break;
+
+            case Format::FLOAT32:
+                bits = 32;
+                break;
+
+            default:
+                return false;
+        }
+
+        if (format.bits % bits)
+        {
+            return false;
+        }
+
+        for (int i = 0; i < 4; ++i)
+        {
+            if (format.size[i] && (format.size[i] != bits || format.offset[i] % bits))
+            {
+                return false;
+            }
+        }
+
+        layout.bits = bits;
+        layout.channels = format.bits / bits;
+        layout.alpha = format.size[Format::ALPHA] ? format.offset[Format::ALPHA] / bits : -1;
+
+        return layout.channels >= 1 && layout.channels <= 4;
+    }
+
+    // intermediate format for the formats which are not filtered directly
+    Format getWorkingFormat(const Format& format)
+    {
+        bool wide = format.isFloat();
+
+        for (int i = 0; i < 4; ++i)
+        {
+            wide |= format.size[i] > 8;
+        }
+
+        return wide ? Format(128, Format::FLOAT32, Format::RGBA, 32, 32, 32, 32)
+                    : Format(32, Format::UNORM, Format::RGBA, 8, 8, 8, 8);
+    }
+
+    template <typename T>
+    void resample_type(const Surface& dest, const Surface& source, const Coefficients& xcoefficients,
+                       const Coefficients& ycoefficients, const LinearLight& light)
+    {
+        switch (light.channels)
+        {
+            case 1:
+                resample_surface<T, 1>(dest, source, xcoefficients, ycoefficients, light);
+                break;
+            case 2:
+                resample_surface<T, 2>(dest, source, xcoefficients, ycoefficients, light);
+                break;
+            case 3:
+                resample_surface<T, 3>(dest, source, xcoefficients, ycoefficients, light);
+                break;
+            case 4:
+                resample_surface<T, 4>(dest, source, xcoefficients, ycoefficients, light);
+                break;
+        }
+    }
+
+    void resample_layout(const Surface& dest, const Surface& source, const Layout& layout, ResampleFilter filter, bool linear)
+    {
+        const Kernel kernel = getKernel(filter);
+
+        Coefficients xcoefficients(dest.width, source.width, kernel);
+        Coefficients ycoefficients(dest.height, source.height, kernel);
+
+        LinearLight light(linear, layout.channels, layout.alpha);
+
+        switch (source.format.type)
+        {
+            case Format::UNORM:
+                if (layout.bits == 8)
+                    resample_type<u8>(dest, source, xcoefficients, ycoefficients, light);
+                else
+                    resample_type<u16>(dest, source, xcoefficients, ycoefficients, light);
+                break;
+
+            case Format::FLOAT16:
+                resample_type<float16>(dest, source, xcoefficients, ycoefficients, light);
+                break;
+
+            default:
+                resample_type<float>(dest, source, xcoefficients, ycoefficients, light);
+                break;
+        }
+    }
+
+} // namespace
+
+namespace mango::image
+{
+
+    void resample(const Surface& dest, const Surface& source, ResampleFilter filter, bool linear)
+    {
+        if (dest.width < 1 || dest.height < 1 || source.width < 1 || source.height < 1)
+        {
+            return;
+        }
+
+        // the floating point formats are linear; so are the formats flagged as such
+        linear = linear && source.format.type == Format::UNORM && !source.format.isLinear();
+
+        Layout layout;
+
+        if (getLayout(layout, source.format))
+        {
+            if (dest.format == source.format)
+            {
+                resample_layout(dest, source, layout, filter, linear);
+            }
+            else
+            {
+                Bitmap temp(dest.width, dest.height, source.format);
+                resample_layout(temp, source, layout, filter, linear);
+                dest.blit(0, 0, temp);
+            }
+
+            return;
+        }
+
+        const Format format = getWorkingFormat(source.format);
+        getLayout(layout, format);
+
+        Bitmap temp_source(source, format);
+
+        if (dest.format == format)
+        {
+            resample_layout(dest, temp_source, layout, filter, linear);
+        }
+        else
+        {
+            Bitmap temp(dest.width, dest.height, format);
+            resample_layout(temp, temp_source, layout, filter, linear);
+            dest.blit(0, 0, temp);
+        }
+    }
+
+} // namespace mango::image
@@ -298,6 +298,7 @@ namespace mango::image::jpeg
         int vsf;    // Vertical sampling factor
         int tq;     // Quantization table destination selector
         int offset;
+        int size = 8; // Samples per block side written by the idct
     };
 
     struct DecodeBlock
@@ -345,6 +346,7 @@ namespace mango::image::jpeg
     struct Block
     {
         s16* qt;
+        void (*idct) (u8* dest, const s16* data, const s16* qt) = nullptr;
     };
 
     struct ProcessState;
@@ -353,7 +355,7 @@ namespace mango::image::jpeg
 
     struct ProcessState
     {
-        // NOTE: this is just quantization tables
+        // NOTE: quantization table and idct for each block in the MCU
         Block block[JPEG_MAX_BLOCKS_IN_MCU];
         int blocks;
 
@@ -362,6 +364,12 @@ namespace mango::image::jpeg
 
         ColorSpace colorspace = ColorSpace::CMYK; // default
 
+        // Samples per block side written by the idct: 8 normally, 4, 2 or 1 when
+        // decoding with DCT scaling. The block storage is always 8x8 (stride 8);
+        // scaled blocks occupy the top-left corner. Subsampled components are
+        // reconstructed with a larger idct (Frame::size), up to the full 8x8.
+        int block_size = 8;
+
         void (*idct) (u8* dest, const s16* data, const s16* qt);
         // Counted linear 8x8s: dest/src step 64 samples, qt[idx + k] (table duplicated to 2*blocks).
         void (*idct1)(u8* dest, const s16* src, const s16* const* qt, int blocks, int idx, int count) = nullptr;
@@ -378,7 +386,7 @@ namespace mango::image::jpeg
         {
             for (int i = 0; i < blocks; ++i)
             {
-                idct(spatial + i * 64, data + i * 64, block[i].qt);
+                block[i].idct(spatial + i * 64, data + i * 64, block[i].qt);
             }
         }
 
@@ -441,7 +449,7 @@ namespace mango::image::jpeg
 
             for (int i = 0; i < rest; ++i)
             {
-                idct(dest, data, qt[idx]);
+                block[idx].idct(dest, data, qt[idx]);
                 dest += 64;
                 data += 64;
                 if (++idx == blocks)
@@ -576,6 +584,18 @@ namespace mango::image::jpeg
         int m_width;
         int m_height;
 
+        // output geometry: same as the frame geometry unless decoding with DCT scaling
+        int m_scale = 1; // 1, 2, 4 or 8
+        int m_scaled_width;
+        int m_scaled_height;
+
+        // region of interest in MCUs: [x0, x1) x [y0, y1), only used when m_region is set
+        bool m_region = false;
+        int m_region_x0;
+        int m_region_y0;
+        int m_region_x1;
+        int m_region_y1;
+
         bool m_rgb_colorspace = false;
         bool m_relaxed_parser = false;
         Buffer m_source_icc;
@@ -598,6 +618,8 @@ namespace mango::image::jpeg
         int blocks_in_mcu;
         int xblock;
         int yblock;
+        int xblock_scaled;
+        int yblock_scaled;
         int xmcu;
         int ymcu;
         int mcus;
@@ -633,6 +655,7 @@ namespace mango::image::jpeg
         void decodeSequential();
         void decodeSequentialST();
         void decodeSequentialMT(int N);
+        void decodeSequentialRegion();
         void decodeMultiScan();
         void decodeProgressive();
         void decodeProgressiveDC();
@@ -640,12 +663,14 @@ namespace mango::image::jpeg
         void finishProgressive();
 
         void process_range(int y0, int y1, const s16* data);
+        void process_region_row(int y, const s16* data);
         void process_and_clip(u8* dest, size_t stride, const s16* data, int width, int height);
         void color_and_clip(u8* dest, size_t stride, const u8* spatial, int width, int height);
         void process_span(u8* dest, size_t stride, const s16* data, int count, int width, int height);
         void blit_and_update(const ImageDecodeRect& rect);
 
         int getTaskSize(int count) const;
+        void configureScale(int scale);
         void configureCPU(SampleType sample, const ImageDecodeOptions& options);
         std::string getInfo() const;
 
@@ -693,7 +718,12 @@ namespace mango::image::jpeg
             return m_components;
         }
 
+        // Effective DCT scaling denominator for the requested scale: 1, 2, 4 or 8.
+        // Lossless streams have no DCT and always decode at full size.
+        int getScale(int scale) const;
+
         ImageDecodeStatus decode(const Surface& target, const ImageDecodeOptions& options);
+        ImageDecodeStatus decode(const Surface& target, const ImageDecodeOptions& options, const ImageDecodeRegion& region);
     };
 
     // ----------------------------------------------------------------------------
@@ -766,7 +796,11 @@ namespace mango::image::jpeg
             return m_base.components();
         }
 
+        // Image header for decoding with the given options (dimensions reflect options.scale).
+        ImageHeader getHeader(const ImageDecodeOptions& options) const;
+
         ImageDecodeStatus decode(const Surface& target, const ImageDecodeOptions& options);
+        ImageDecodeStatus decode(const Surface& target, const ImageDecodeOptions& options, const ImageDecodeRegion& region);
     };
 
     // ----------------------------------------------------------------------------
@@ -790,6 +824,14 @@ namespace mango::image::jpeg
     void idct8                          (u8* dest, const s16* data, const s16* qt);
     void idct12                         (u8* dest, const s16* data, const s16* qt);
 
+    // reduced-size idct for DCT scaling: output is NxN samples at block stride 8
+    void idct8_4x4                      (u8* dest, const s16* data, const s16* qt);
+    void idct8_2x2                      (u8* dest, const s16* data, const s16* qt);
+    void idct8_1x1                      (u8* dest, const s16* data, const s16* qt);
+    void idct12_4x4                     (u8* dest, const s16* data, const s16* qt);
+    void idct12_2x2                     (u8* dest, const s16* data, const s16* qt);
+    void idct12_1x1                     (u8* dest, const s16* data, const s16* qt);
+
 #define JPEG_COLOR_KERNEL(name) \
     void name(u8* dest, size_t stride, const u8* spatial, ProcessState* state, int width, int height, int count, size_t xstride)
 
@@ -866,6 +908,7 @@ namespace mango::image::jpeg
 #if defined(MANGO_ENABLE_SSE2)
 
     void idct_sse2                      (u8* dest, const s16* data, const s16* qt);
+    void idct_sse2_4x4                  (u8* dest, const s16* data, const s16* qt);
     void idct_sse2_n                    (u8* dest, const s16* src, const s16* const* qt, int blocks, int idx, int count);
 
     JPEG_YCBCR_KERNEL(process_ycbcr_bgra_8x8_sse2);
@@ -1170,16 +1170,54 @@ namespace mango::image::jpeg
         return status;
     }
 
+    ImageHeader Parser::getHeader(const ImageDecodeOptions& options) const
+    {
+        ImageHeader result = m_base.header;
+
+        // the gain map join works at full resolution
+        if (m_gainmap_kind == GainMapKind::None && result)
+        {
+            const int scale = m_base.getScale(options.scale);
+            result.width = div_ceil(result.width, scale);
+            result.height = div_ceil(result.height, scale);
+        }
+
+        return result;
+    }
+
     ImageDecodeStatus Parser::decode(const Surface& target, const ImageDecodeOptions& options)
     {
         if (m_gainmap_kind != GainMapKind::None)
         {
-            return decodeUltraHDR(target, options);
+            ImageDecodeOptions fullsize = options;
+            fullsize.scale = 1;
+            return decodeUltraHDR(target, fullsize);
         }
 
         return m_base.decode(target, options);
     }
 
+    ImageDecodeStatus Parser::decode(const Surface& target, const ImageDecodeOptions& options, const ImageDecodeRegion& region)
+    {
+        if (m_gainmap_kind != GainMapKind::None)
+        {
+            // the gain map join works on the whole image
+            Bitmap temp(m_base.header.width, m_base.header.height, target.format);
+
+            ImageDecodeStatus status = decode(temp, options);
+            if (status)
+            {
+                Surface source(temp, region.x, region.y, region.width, region.height);
+                target.blit(0, 0, source);
+                status.direct = false;
+            }
+
+            return status;
+        }
+
+        return m_base.decode(target, options, region);
+    }
+
     void StreamDecoder::setMemory(ConstMemory memory)
     {
         m_memory = memory;
@@ -1722,6 +1760,8 @@ namespace mango::image::jpeg
         ymcu = m_aligned_height / yblock;
         mcus = xmcu * ymcu;
 
+        configureScale(1);
+
         printLine(Print::Debug, "  {} MCUs ({} x {}) -> ({} x {})", mcus, xmcu, ymcu, xmcu * xblock, ymcu * yblock);
         printLine(Print::Debug, "  Image: {} x {}", m_width, m_height);
 
@@ -2616,6 +2656,63 @@ namespace mango::image::jpeg
             m_idct_name = "scalar (12 bit)";
         }
 
+        if (m_scale > 1)
+        {
+            // DCT scaling: reduced-size idct, one block at a time
+            processState.idct1 = nullptr;
+            processState.idct2 = nullptr;
+            processState.idct4 = nullptr;
+        }
+
+        // configure idct for each block in the MCU
+
+        const auto idct_full = processState.idct;
+
+        auto getScaledIDCT = [=, this] (int size)
+        {
+            const bool precision12 = m_precision == 12;
+
+            switch (size)
+            {
+                case 4:
+#if defined(MANGO_ENABLE_SSE2)
+                    if ((flags & INTEL_SSE2) && !precision12)
+                    {
+                        return idct_sse2_4x4;
+                    }
+#endif
+                    return precision12 ? idct12_4x4 : idct8_4x4;
+                case 2:
+                    return precision12 ? idct12_2x2 : idct8_2x2;
+                case 1:
+                    return precision12 ? idct12_1x1 : idct8_1x1;
+                default:
+                    return idct_full;
+            }
+        };
+
+        std::string sizes;
+
+        for (int i = 0; i < processState.frames; ++i)
+        {
+            const Frame& frame = processState.frame[i];
+            const int blocks = frame.hsf * frame.vsf;
+
+            for (int j = 0; j < blocks; ++j)
+            {
+                processState.block[frame.offset + j].idct = getScaledIDCT(frame.size);
+            }
+
+            sizes += fmt::format(" {}x{}", frame.size, frame.size);
+        }
+
+        processState.idct = getScaledIDCT(processState.block_size);
+
+        if (m_scale > 1)
+        {
+            m_idct_name = fmt::format("scaled{} ({} bit)", sizes, m_precision);
+        }
+
         // configure block processing
 
         ColorFunc color_y     = nullptr;
@@ -2847,8 +2944,8 @@ namespace mango::image::jpeg
                 processState.color = color_ycbcr;
                 id = "YCbCr";
 
-                // detect optimized cases
-                if (blocks_in_mcu <= 6)
+                // detect optimized cases (these assume full 8x8 blocks)
+                if (blocks_in_mcu <= 6 && m_scale == 1)
                 {
                     if (xblock == 8 && yblock == 8)
                     {
@@ -2942,6 +3039,9 @@ namespace mango::image::jpeg
             std::memset(blockVector, 0, blockVector.size() * sizeof(s16));
         }
 
+        // output geometry
+        configureScale(getScale(options.scale));
+
         // find best matching format
         SampleFormat sf = getSampleFormat(target.format);
 
@@ -2983,7 +3083,11 @@ namespace mango::image::jpeg
 
         m_decode_status.direct = true;
 
-        if (target.width < m_width || target.height < m_height)
+        // the working surface covers the MCUs being decoded
+        const int surface_width = m_region ? (m_region_x1 - m_region_x0) * xblock_scaled : m_scaled_width;
+        const int surface_height = m_region ? (m_region_y1 - m_region_y0) * yblock_scaled : m_scaled_height;
+
+        if (target.width < surface_width || target.height < surface_height)
         {
             m_decode_status.direct = false;
         }
@@ -3004,7 +3108,9 @@ namespace mango::image::jpeg
         if (!m_decode_status.direct)
         {
             // create a temporary decoding target
-            temp = std::make_unique<Bitmap>(m_aligned_width, m_aligned_height, sf.format);
+            const int width = m_region ? surface_width : xmcu * xblock_scaled;
+            const int height = m_region ? surface_height : ymcu * yblock_scaled;
+            temp = std::make_unique<Bitmap>(width, height, sf.format);
             m_sink.surface = temp.get();
         }
 
@@ -3048,18 +3154,23 @@ namespace mango::image::jpeg
             finishProgressive();
         }
 
-        if (is_lossless && !m_sink.direct)
+        if (m_region && !m_sink.direct)
+        {
+            // region decoding does not deliver bands
+            m_sink.target->blit(0, 0, *m_sink.surface);
+        }
+        else if (is_lossless && !m_sink.direct)
         {
             // lossless writes the working surface in one pass (no band blits)
-            Surface source(*m_sink.surface, 0, 0, m_width, m_height);
+            Surface source(*m_sink.surface, 0, 0, m_scaled_width, m_scaled_height);
             m_sink.target->blit(0, 0, source);
         }
         else if (m_components == 4 && m_cmyk_store_mode)
         {
             ConstMemory profile = getCmykIcc();
             Surface surface = m_decode_status.direct
-                ? Surface(*m_sink.surface, 0, 0, m_width, m_height)
-                : Surface(*m_sink.surface, 0, 0, m_width, m_height);
+                ? Surface(*m_sink.surface, 0, 0, m_scaled_width, m_scaled_height)
+                : Surface(*m_sink.surface, 0, 0, m_scaled_width, m_scaled_height);
 
             if (profile.size && transform_cmyk_surface_to_srgb(surface, profile, processState.colorspace == ColorSpace::CMYK))
             {
@@ -3095,8 +3206,8 @@ namespace mango::image::jpeg
 
                 rect.x = 0;
                 rect.y = 0;
-                rect.width = m_width;
-                rect.height = m_height;
+                rect.width = m_scaled_width;
+                rect.height = m_scaled_height;
                 rect.progress = 1.0f;
 
                 m_interface->clipAndDispatch(*m_sink.target, rect);
@@ -3109,6 +3220,80 @@ namespace mango::image::jpeg
         return m_decode_status;
     }
 
+    ImageDecodeStatus StreamDecoder::decode(const Surface& target, const ImageDecodeOptions& options, const ImageDecodeRegion& region)
+    {
+        if (!scan_memory.address || !header)
+        {
+            ImageDecodeStatus status;
+            status.setError(header.info);
+            return status;
+        }
+
+        configureScale(getScale(options.scale));
+
+        // band callbacks would report coordinates of the working surface
+        ImageDecodeCallback saved_callback = std::move(m_interface->callback);
+        m_interface->callback = nullptr;
+
+        ImageDecodeStatus status;
+
+        if (is_lossless || m_components == 4)
+        {
+            // lossless predictors and the CMYK post-process work on the whole image
+            Bitmap temp(m_scaled_width, m_scaled_height, target.format);
+
+            status = decode(temp, options);
+            if (status)
+            {
+                Surface source(temp, region.x, region.y, region.width, region.height);
+                target.blit(0, 0, source);
+            }
+        }
+        else
+        {
+            // MCUs covering the region; the region is decoded into an MCU aligned surface
+            m_region_x0 = region.x / xblock_scaled;
+            m_region_y0 = region.y / yblock_scaled;
+            m_region_x1 = div_ceil(region.x + region.width, xblock_scaled);
+            m_region_y1 = div_ceil(region.y + region.height, yblock_scaled);
+
+            const int xoffset = region.x - m_region_x0 * xblock_scaled;
+            const int yoffset = region.y - m_region_y0 * yblock_scaled;
+
+            Bitmap temp((m_region_x1 - m_region_x0) * xblock_scaled,
+                        (m_region_y1 - m_region_y0) * yblock_scaled, target.format);
+
+            m_region = true;
+            status = decode(temp, options);
+            m_region = false;
+
+            if (status)
+            {
+                Surface source(temp, xoffset, yoffset, region.width, region.height);
+                target.blit(0, 0, source);
+            }
+        }
+
+        status.direct = false;
+
+        m_interface->callback = std::move(saved_callback);
+
+        if (status && !m_interface->cancelled)
+        {
+            ImageDecodeRect rect;
+
+            rect.x = 0;
+            rect.y = 0;
+            rect.width = region.width;
+            rect.height = region.height;
+            rect.progress = 1.0f;
+
+            m_interface->clipAndDispatch(target, rect);
+        }
+
+        return status;
+    }
+
     std::string StreamDecoder::chromaSubsampling() const
     {
         if (m_components <= 1)
@@ -3151,6 +3336,54 @@ namespace mango::image::jpeg
         return info;
     }
 
+    int StreamDecoder::getScale(int scale) const
+    {
+        int result = 1;
+
+        if (!is_lossless)
+        {
+            // largest supported denominator which does not exceed the request
+            while (result < 8 && result * 2 <= scale)
+            {
+                result *= 2;
+            }
+        }
+
+        return result;
+    }
+
+    void StreamDecoder::configureScale(int scale)
+    {
+        // The MCU grid is unchanged; each block is reconstructed at 8/scale samples
+        m_scale = scale;
+        m_scaled_width = div_ceil(m_width, scale);
+        m_scaled_height = div_ceil(m_height, scale);
+        xblock_scaled = xblock / scale;
+        yblock_scaled = yblock / scale;
+        processState.block_size = 8 / scale;
+
+        // Subsampled components are reconstructed with a larger idct, like libjpeg does,
+        // so that they come out closer to the output resolution (4:2:0 at 1/8 scale has
+        // 1x1 luma and 2x2 chroma blocks). The idct is square; the remaining factor is
+        // replicated by the color conversion.
+        for (int i = 0; i < processState.frames; ++i)
+        {
+            Frame& frame = processState.frame[i];
+
+            const int xscale = Hmax / frame.hsf;
+            const int yscale = Vmax / frame.vsf;
+
+            int size = processState.block_size;
+            while (size < 8 && !(xscale % (size * 2 / processState.block_size)) &&
+                               !(yscale % (size * 2 / processState.block_size)))
+            {
+                size *= 2;
+            }
+
+            frame.size = size;
+        }
+    }
+
     int StreamDecoder::getTaskSize(int tasks) const
     {
         constexpr int max_threads = 64;
@@ -3321,7 +3554,11 @@ namespace mango::image::jpeg
 
     void StreamDecoder::decodeSequential()
     {
-        if (m_hardware_concurrency > 1)
+        if (m_region)
+        {
+            decodeSequentialRegion();
+        }
+        else if (m_hardware_concurrency > 1)
         {
             int n = getTaskSize(ymcu);
             decodeSequentialMT(n);
@@ -3342,8 +3579,8 @@ namespace mango::image::jpeg
 
             const size_t stride = m_sink.surface->stride;
             const size_t bytes_per_pixel = m_sink.surface->format.bytes();
-            const size_t xstride = bytes_per_pixel * xblock;
-            const size_t ystride = stride * yblock;
+            const size_t xstride = bytes_per_pixel * xblock_scaled;
+            const size_t ystride = stride * yblock_scaled;
             const int N = 8;
 
             const int mcu_data_size = blocks_in_mcu * 64;
@@ -3368,13 +3605,13 @@ namespace mango::image::jpeg
                     const int xmcu_last = xmcu - 1;
                     const int ymcu_last = ymcu - 1;
 
-                    const int xclip = m_width  % xblock;
-                    const int yclip = m_height % yblock;
-                    const int xblock_last = xclip ? xclip : xblock;
-                    const int yblock_last = yclip ? yclip : yblock;
+                    const int xclip = m_scaled_width  % xblock_scaled;
+                    const int yclip = m_scaled_height % yblock_scaled;
+                    const int xblock_last = xclip ? xclip : xblock_scaled;
+                    const int yblock_last = yclip ? yclip : yblock_scaled;
 
                     u8* dest = image + y * ystride;
-                    const int ysize = y == ymcu_last ? yblock_last : yblock;
+                    const int ysize = y == ymcu_last ? yblock_last : yblock_scaled;
 
                     int n = 0;
                     u8* span_dest = dest;
@@ -3383,7 +3620,7 @@ namespace mango::image::jpeg
                     {
                         if (n > 0)
                         {
-                            process_span(span_dest, stride, data, n, xblock, ysize);
+                            process_span(span_dest, stride, data, n, xblock_scaled, ysize);
                             span_dest += size_t(n) * xstride;
                             n = 0;
                         }
@@ -3394,7 +3631,7 @@ namespace mango::image::jpeg
                         s16* slot = data + n * mcu_data_size;
                         decodeState.decode(slot, &decodeState);
 
-                        const bool last_clipped = (x == xmcu_last && xblock_last != xblock);
+                        const bool last_clipped = (x == xmcu_last && xblock_last != xblock_scaled);
                         if (last_clipped)
                         {
                             flush();
@@ -3439,10 +3676,10 @@ namespace mango::image::jpeg
                 ImageDecodeRect rect;
 
                 rect.x = 0;
-                rect.y = y0 * yblock;
-                rect.width = m_width;
-                rect.height = std::min(m_height, y1 * yblock) - y0 * yblock;
-                rect.progress = float(rect.height) / m_height;
+                rect.y = y0 * yblock_scaled;
+                rect.width = m_scaled_width;
+                rect.height = std::min(m_scaled_height, y1 * yblock_scaled) - y0 * yblock_scaled;
+                rect.progress = float(rect.height) / m_scaled_height;
 
                 blit_and_update(rect);
             }
@@ -3509,8 +3746,8 @@ namespace mango::image::jpeg
 
             const size_t stride = m_sink.surface->stride;
             const size_t bytes_per_pixel = m_sink.surface->format.bytes();
-            const size_t xstride = bytes_per_pixel * xblock;
-            const size_t ystride = stride * yblock;
+            const size_t xstride = bytes_per_pixel * xblock_scaled;
+            const size_t ystride = stride * yblock_scaled;
 
             const u8* p = decodeState.buffer.ptr;
             u8* image = m_sink.surface->image;
@@ -3520,10 +3757,10 @@ namespace mango::image::jpeg
             // Precompute constants
             const int xmcu_last = xmcu - 1;
             const int ymcu_last = ymcu - 1;
-            const int xclip = m_width  % xblock;
-            const int yclip = m_height % yblock;
-            const int xblock_last = xclip ? xclip : xblock;
-            const int yblock_last = yclip ? yclip : yblock;
+            const int xclip = m_scaled_width  % xblock_scaled;
+            const int yclip = m_scaled_height % yblock_scaled;
+            const int xblock_last = xclip ? xclip : xblock_scaled;
+            const int yblock_last = yclip ? yclip : yblock_scaled;
 
             for (int y = 0; y < ymcu; y += N)
             {
@@ -3556,7 +3793,7 @@ namespace mango::image::jpeg
                         ptr = m_memory.address + offsets[i];
 
                         u8* dest = image + i * ystride;
-                        const int height = (i == ymcu_last) ? yblock_last : yblock;
+                        const int height = (i == ymcu_last) ? yblock_last : yblock_scaled;
 
                         for (int x = 0; x < xmcu_last; )
                         {
@@ -3565,7 +3802,7 @@ namespace mango::image::jpeg
                             {
                                 state.decode(data + k * mcu_data_size, &state);
                             }
-                            process_span(dest, stride, data, n, xblock, height);
+                            process_span(dest, stride, data, n, xblock_scaled, height);
                             dest += size_t(n) * xstride;
                             x += n;
                         }
@@ -3578,10 +3815,10 @@ namespace mango::image::jpeg
                     ImageDecodeRect rect;
 
                     rect.x = 0;
-                    rect.y = y0 * yblock;
-                    rect.width = m_width;
-                    rect.height = std::min(m_height, y1 * yblock) - y0 * yblock;
-                    rect.progress = float(rect.height) / m_height;
+                    rect.y = y0 * yblock_scaled;
+                    rect.width = m_scaled_width;
+                    rect.height = std::min(m_scaled_height, y1 * yblock_scaled) - y0 * yblock_scaled;
+                    rect.progress = float(rect.height) / m_scaled_height;
 
                     blit_and_update(rect);
                 });
@@ -3612,18 +3849,18 @@ namespace mango::image::jpeg
 
             const size_t stride = m_sink.surface->stride;
             const size_t bytes_per_pixel = m_sink.surface->format.bytes();
-            const size_t xstride = bytes_per_pixel * xblock;
-            const size_t ystride = stride * yblock;
+            const size_t xstride = bytes_per_pixel * xblock_scaled;
+            const size_t ystride = stride * yblock_scaled;
 
             u8* image = m_sink.surface->image;
 
             // Precompute constants
             const int xmcu_last = xmcu - 1;
             const int ymcu_last = ymcu - 1;
-            const int xclip = m_width  % xblock;
-            const int yclip = m_height % yblock;
-            const int xblock_last = xclip ? xclip : xblock;
-            const int yblock_last = yclip ? yclip : yblock;
+            const int xclip = m_scaled_width  % xblock_scaled;
+            const int yclip = m_scaled_height % yblock_scaled;
+            const int xblock_last = xclip ? xclip : xblock_scaled;
+            const int yblock_last = yclip ? yclip : yblock_scaled;
 
             for (int y = 0; y < ymcu; y += N)
             {
@@ -3654,7 +3891,7 @@ namespace mango::image::jpeg
                         state.buffer.ptr = p;
 
                         u8* dest = image + y * ystride;
-                        const int height = (y == ymcu_last) ? yblock_last : yblock;
+                        const int height = (y == ymcu_last) ? yblock_last : yblock_scaled;
 
                         for (int x = 0; x < xmcu_last; )
                         {
@@ -3663,7 +3900,7 @@ namespace mango::image::jpeg
                             {
                                 state.decode(data + k * mcu_data_size, &state);
                             }
-                            process_span(dest, stride, data, n, xblock, height);
+                            process_span(dest, stride, data, n, xblock_scaled, height);
                             dest += size_t(n) * xstride;
                             x += n;
                         }
@@ -3688,10 +3925,10 @@ namespace mango::image::jpeg
                     ImageDecodeRect rect;
 
                     rect.x = 0;
-                    rect.y = y0 * yblock;
-                    rect.width = m_width;
-                    rect.height = std::min(m_height, y1 * yblock) - y0 * yblock;
-                    rect.progress = float(rect.height) / m_height;
+                    rect.y = y0 * yblock_scaled;
+                    rect.width = m_scaled_width;
+                    rect.height = std::min(m_scaled_height, y1 * yblock_scaled) - y0 * yblock_scaled;
+                    rect.progress = float(rect.height) / m_scaled_height;
 
                     blit_and_update(rect);
                 }, p);
@@ -3764,6 +4001,97 @@ namespace mango::image::jpeg
         }
     }
 
+    void StreamDecoder::decodeSequentialRegion()
+    {
+        // Entropy decoding is serial: MCUs in front of the region and outside of its columns
+        // are decoded and discarded without idct or color conversion. Restart intervals let
+        // us jump ahead, with the offset table when present or by scanning for RSTn markers.
+        // Nothing after the last row of the region is decoded.
+
+        const int mcu_data_size = blocks_in_mcu * 64;
+        const int columns = m_region_x1 - m_region_x0;
+
+        AlignedStorage<s16> data(size_t(columns) * mcu_data_size);
+        AlignedStorage<s16> discard(mcu_data_size);
+
+        const u8* end = decodeState.buffer.end;
+
+        int cursor = 0; // next MCU in the scan
+        int interval = 0; // restart interval of the cursor
+
+        for (int y = m_region_y0; y < m_region_y1; ++y)
+        {
+            if (m_interface->cancelled)
+            {
+                break;
+            }
+
+            const int first = y * xmcu + m_region_x0;
+            const int last = y * xmcu + m_region_x1;
+
+            if (restartInterval && first / restartInterval > interval)
+            {
+                // jump to the restart interval containing the first MCU
+                const int target = first / restartInterval;
+                const u8* p = decodeState.buffer.ptr;
+
+                if (target <= int(m_restart_offsets.size()))
+                {
+                    p = m_memory.address + m_restart_offsets[target - 1];
+                }
+                else
+                {
+                    for (int i = interval; i < target; ++i)
+                    {
+                        p = seekMarker(p, end);
+                        if (!isRestartMarker(p))
+                        {
+                            break;
+                        }
+
+                        p += 2;
+                    }
+                }
+
+                if (p >= end)
+                {
+                    // out of data
+                    break;
+                }
+
+                decodeState.restart();
+                decodeState.buffer.ptr = p;
+
+                cursor = target * restartInterval;
+                interval = target;
+            }
+
+            for ( ; cursor < last; ++cursor)
+            {
+                if (restartInterval && cursor == (interval + 1) * restartInterval)
+                {
+                    const u8* p = seekMarker(decodeState.buffer.ptr, end);
+                    if (isRestartMarker(p))
+                    {
+                        p += 2;
+                    }
+
+                    decodeState.restart();
+                    decodeState.buffer.ptr = p;
+                    ++interval;
+                }
+
+                s16* dest = cursor < first ? discard : data + (cursor - first) * mcu_data_size;
+                decodeState.decode(dest, &decodeState);
+            }
+
+            process_region_row(y, data);
+        }
+
+        // the rest of the scan is not needed
+        decodeState.buffer.ptr = end;
+    }
+
     void StreamDecoder::decodeMultiScan()
     {
         s16* data = blockVector;
@@ -3992,6 +4320,24 @@ namespace mango::image::jpeg
 
     void StreamDecoder::finishProgressive()
     {
+        if (m_region)
+        {
+            const size_t mcu_data_size = size_t(blocks_in_mcu) * 64;
+
+            for (int y = m_region_y0; y < m_region_y1; ++y)
+            {
+                if (m_interface->cancelled)
+                {
+                    break;
+                }
+
+                const s16* data = blockVector + (size_t(y) * xmcu + m_region_x0) * mcu_data_size;
+                process_region_row(y, data);
+            }
+
+            return;
+        }
+
         int n = getTaskSize(ymcu);
         if (n)
         {
@@ -4032,8 +4378,8 @@ namespace mango::image::jpeg
     {
         const size_t stride = m_sink.surface->stride;
         const size_t bytes_per_pixel = m_sink.surface->format.bytes();
-        const size_t xstride = bytes_per_pixel * xblock;
-        const size_t ystride = stride * yblock;
+        const size_t xstride = bytes_per_pixel * xblock_scaled;
+        const size_t ystride = stride * yblock_scaled;
 
         u8* image = m_sink.surface->image;
 
@@ -4042,10 +4388,10 @@ namespace mango::image::jpeg
         const int xmcu_last = xmcu - 1;
         const int ymcu_last = ymcu - 1;
 
-        const int xclip = m_width  % xblock;
-        const int yclip = m_height % yblock;
-        const int xblock_last = xclip ? xclip : xblock;
-        const int yblock_last = yclip ? yclip : yblock;
+        const int xclip = m_scaled_width  % xblock_scaled;
+        const int yclip = m_scaled_height % yblock_scaled;
+        const int xblock_last = xclip ? xclip : xblock_scaled;
+        const int yblock_last = yclip ? yclip : yblock_scaled;
 
         for (int y = y0; y < y1; ++y)
         {
@@ -4055,9 +4401,9 @@ namespace mango::image::jpeg
             }
 
             u8* dest = image + y * ystride;
-            int ysize = y == ymcu_last ? yblock_last : yblock;
+            int ysize = y == ymcu_last ? yblock_last : yblock_scaled;
 
-            process_span(dest, stride, data, xmcu_last, xblock, ysize);
+            process_span(dest, stride, data, xmcu_last, xblock_scaled, ysize);
             data += xmcu_last * mcu_data_size;
             dest += xmcu_last * xstride;
 
@@ -4069,22 +4415,51 @@ namespace mango::image::jpeg
         ImageDecodeRect rect;
 
         rect.x = 0;
-        rect.y = y0 * yblock;
-        rect.width = m_width;
-        rect.height = std::min(m_height, y1 * yblock) - y0 * yblock;
-        rect.progress = float(rect.height) / m_height;
+        rect.y = y0 * yblock_scaled;
+        rect.width = m_scaled_width;
+        rect.height = std::min(m_scaled_height, y1 * yblock_scaled) - y0 * yblock_scaled;
+        rect.progress = float(rect.height) / m_scaled_height;
 
         blit_and_update(rect);
     }
 
+    void StreamDecoder::process_region_row(int y, const s16* data)
+    {
+        // data is the MCUs [m_region_x0, m_region_x1) of the row y
+        const size_t stride = m_sink.surface->stride;
+        const size_t xstride = m_sink.surface->format.bytes() * xblock_scaled;
+
+        u8* dest = m_sink.surface->image + (y - m_region_y0) * stride * yblock_scaled;
+
+        const int mcu_data_size = blocks_in_mcu * 64;
+
+        const int xclip = m_scaled_width  % xblock_scaled;
+        const int yclip = m_scaled_height % yblock_scaled;
+        const int xblock_last = xclip ? xclip : xblock_scaled;
+        const int yblock_last = yclip ? yclip : yblock_scaled;
+
+        const int height = y == ymcu - 1 ? yblock_last : yblock_scaled;
+
+        int count = m_region_x1 - m_region_x0;
+
+        if (m_region_x1 == xmcu && xblock_last != xblock_scaled)
+        {
+            // last column is clipped
+            --count;
+            process_and_clip(dest + count * xstride, stride, data + count * mcu_data_size, xblock_last, height);
+        }
+
+        process_span(dest, stride, data, count, xblock_scaled, height);
+    }
+
     void StreamDecoder::color_and_clip(u8* dest, size_t stride, const u8* spatial, int width, int height)
     {
-        if (xblock != width || yblock != height)
+        if (xblock_scaled != width || yblock_scaled != height)
         {
             u8 temp[JPEG_MAX_SAMPLES_IN_MCU * 4];
 
             const int bytes_per_scan = width * m_sink.surface->format.bytes();
-            const int block_stride = xblock * 4;
+            const int block_stride = xblock_scaled * 4;
             u8* src = temp;
 
             processState.color(temp, block_stride, spatial, &processState, width, height, 1, 0);
@@ -4105,7 +4480,7 @@ namespace mango::image::jpeg
     void StreamDecoder::process_span(u8* dest, size_t stride, const s16* data, int count, int width, int height)
     {
         const int mcu_data_size = blocks_in_mcu * 64;
-        const size_t xstride = m_sink.surface->format.bytes() * xblock;
+        const size_t xstride = m_sink.surface->format.bytes() * xblock_scaled;
         const size_t spatial_stride = processState.spatialMCUBytes();
 
         alignas(64) u8 slab[JPEG_MCU_TILE * JPEG_MAX_SAMPLES_IN_MCU];
@@ -4117,7 +4492,7 @@ namespace mango::image::jpeg
 
             processState.idctSpan(slab, data, n * processState.blocks);
 
-            if (width == xblock && height == yblock)
+            if (width == xblock_scaled && height == yblock_scaled)
             {
                 processState.color(dest, stride, slab, &processState, width, height, n, xstride);
                 dest += size_t(n) * xstride;
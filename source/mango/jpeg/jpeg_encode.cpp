@@ -193,6 +193,18 @@ namespace
         0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA,
     };
 
+    const u8 g_zigzag_table_inverse [] =
+    {
+         0,  1,  8, 16,  9,  2,  3, 10,
+        17, 24, 32, 25, 18, 11,  4,  5,
+        12, 19, 26, 33, 40, 48, 41, 34,
+        27, 20, 13,  6,  7, 14, 21, 28,
+        35, 42, 49, 56, 57, 50, 43, 36,
+        29, 22, 15, 23, 30, 37, 44, 51,
+        58, 59, 52, 45, 38, 31, 39, 46,
+        53, 60, 61, 54, 47, 55, 62, 63,
+    };
+
     // ----------------------------------------------------------------------------
     // HuffmanEncoder
     // ----------------------------------------------------------------------------
@@ -303,6 +315,312 @@ namespace
         }
     };
 
+    // ----------------------------------------------------------------------------
+    // HuffmanTable
+    // ----------------------------------------------------------------------------
+
+    static inline
+    int coefficient_size(int value)
+    {
+        int absValue = std::abs(value);
+        return absValue ? u32_log2(absValue) + 1 : 0;
+    }
+
+    static inline
+    u32 coefficient_bits(int value, int size)
+    {
+        // negative values are stored as one's complement
+        value -= (value < 0);
+        return u32(value) & ((1u << size) - 1);
+    }
+
+    struct HuffmanStatistics
+    {
+        // symbol frequencies for luminance and chrominance tables
+        u32 dc[2][256];
+        u32 ac[2][256];
+
+        HuffmanStatistics()
+        {
+            std::memset(this, 0, sizeof(HuffmanStatistics));
+        }
+
+        void add(const HuffmanStatistics& stats)
+        {
+            for (int i = 0; i < 2; ++i)
+            {
+                for (int j = 0; j < 256; ++j)
+                {
+                    dc[i][j] += stats.dc[i][j];
+                    ac[i][j] += stats.ac[i][j];
+                }
+            }
+        }
+    };
+
+    struct HuffmanTable
+    {
+        u8 bits[17];
+        u8 values[256];
+        int count = 0;
+
+        u32 code[256];
+        u8 size[256];
+
+        void build(const u32* frequency)
+        {
+            // Annex K.2: code lengths from symbol frequencies, limited to 16 bits.
+            // Symbol 256 is reserved so that no code consists of all one bits.
+
+            u32 freq[257];
+            int codesize[257];
+            int others[257];
+
+            std::copy_n(frequency, 256, freq);
+            freq[256] = 1;
+
+            std::fill_n(codesize, 257, 0);
+            std::fill_n(others, 257, -1);
+
+            for (;;)
+            {
+                // find the two least frequent symbols, ties resolved to the largest value
+                int c1 = -1;
+                int c2 = -1;
+                u32 v1 = 0xffffffff;
+                u32 v2 = 0xffffffff;
+
+                for (int i = 0; i < 257; ++i)
+                {
+                    if (freq[i] && freq[i] <= v1)
+                    {
+                        v2 = v1;
+                        c2 = c1;
+                        v1 = freq[i];
+                        c1 = i;
+                    }
+                    else if (freq[i] && freq[i] <= v2)
+                    {
+                        v2 = freq[i];
+                        c2 = i;
+                    }
+                }
+
+                if (c2 < 0)
+                {
+                    break;
+                }
+
+                // merge the trees
+                freq[c1] += freq[c2];
+                freq[c2] = 0;
+
+                ++codesize[c1];
+                while (others[c1] >= 0)
+                {
+                    c1 = others[c1];
+                    ++codesize[c1];
+                }
+
+                others[c1] = c2;
+
+                ++codesize[c2];
+                while (others[c2] >= 0)
+                {
+                    c2 = others[c2];
+                    ++codesize[c2];
+                }
+            }
+
+            int length[33] = { 0 };
+
+            for (int i = 0; i < 257; ++i)
+            {
+                if (codesize[i])
+                {
+                    ++length[std::min(codesize[i], 32)];
+                }
+            }
+
+            // limit code lengths to 16 bits
+            for (int i = 32; i > 16; --i)
+            {
+                while (length[i] > 0)
+                {
+                    int j = i - 2;
+                    while (!length[j])
+                    {
+                        --j;
+                    }
+
+                    length[i] -= 2;
+                    length[i - 1] += 1;
+                    length[j + 1] += 2;
+                    length[j] -= 1;
+                }
+            }
+
+            // remove the reserved symbol from the longest codes
+            int i = 16;
+            while (i > 0 && !length[i])
+            {
+                --i;
+            }
+
+            --length[i];
+
+            bits[0] = 0;
+            for (int i = 1; i <= 16; ++i)
+            {
+                bits[i] = u8(length[i]);
+            }
+
+            count = 0;
+            for (int i = 1; i <= 32; ++i)
+            {
+                for (int j = 0; j < 256; ++j)
+                {
+                    if (codesize[j] == i)
+                    {
+                        values[count++] = u8(j);
+                    }
+                }
+            }
+
+            // Annex C: canonical codes
+            std::fill_n(size, 256, 0);
+            std::fill_n(code, 256, 0);
+
+            u32 value = 0;
+            int index = 0;
+
+            for (int i = 1; i <= 16; ++i)
+            {
+                for (int j = 0; j < bits[i]; ++j)
+                {
+                    u8 symbol = values[index++];
+                    code[symbol] = value++;
+                    size[symbol] = u8(i);
+                }
+
+                value <<= 1;
+            }
+        }
+
+        void write(BigEndianStream& p, u8 target) const
+        {
+            p.write16(MARKER_DHT);
+            p.write16(u16(2 + 1 + 16 + count));
+            p.write8(target); // Tc, Th
+            p.write(bits + 1, 16);
+            p.write(values, count);
+        }
+
+        void getDC(u32* dc_code, u16* dc_size) const
+        {
+            // code is pre-shifted to make room for the coefficient bits
+            for (int category = 0; category < 12; ++category)
+            {
+                dc_code[category] = code[category] << category;
+                dc_size[category] = u16(size[category] + category);
+            }
+        }
+
+        void getAC(u32* ac_code, u16* ac_size) const
+        {
+            // same layout as the Annex K tables: index is run + size * 16,
+            // except for index 0 (EOB) and 1 (ZRL)
+            std::fill_n(ac_code, 176, 0);
+            std::fill_n(ac_size, 176, 0);
+
+            ac_code[0] = code[0x00];
+            ac_size[0] = size[0x00];
+            ac_code[1] = code[0xf0];
+            ac_size[1] = size[0xf0];
+
+            for (int category = 1; category < 11; ++category)
+            {
+                for (int run = 0; run < 16; ++run)
+                {
+                    int symbol = (run << 4) | category;
+                    int index = run + category * 16;
+                    ac_code[index] = code[symbol] << category;
+                    ac_size[index] = u16(size[symbol] + category);
+                }
+            }
+        }
+    };
+
+    // Scan emitters: the first pass counts symbols for the optimized tables and
+    // the second pass writes the scan with them.
+
+    struct SymbolCounter
+    {
+        u32 frequency[2][256];
+
+        SymbolCounter()
+        {
+            std::memset(frequency, 0, sizeof(frequency));
+        }
+
+        void symbol(int table, int symbol)
+        {
+            ++frequency[table][symbol];
+        }
+
+        void bits(u32 value, int size)
+        {
+            MANGO_UNREFERENCED(value);
+            MANGO_UNREFERENCED(size);
+        }
+    };
+
+    struct SymbolWriter
+    {
+        static constexpr int buffer_size = 4096;
+        static constexpr int flush_threshold = buffer_size - 1024;
+
+        Buffer& buffer;
+        HuffmanEncoder huffman;
+        const HuffmanTable* table[2];
+
+        u8 temp[buffer_size];
+        u8* ptr;
+
+        SymbolWriter(Buffer& buffer, const HuffmanTable* table0, const HuffmanTable* table1)
+            : buffer(buffer)
+        {
+            table[0] = table0;
+            table[1] = table1;
+            ptr = temp;
+        }
+
+        void symbol(int index, int symbol)
+        {
+            ptr = huffman.putBits(ptr, table[index]->code[symbol], table[index]->size[symbol]);
+            if (ptr - temp > flush_threshold)
+            {
+                buffer.append(temp, ptr - temp);
+                ptr = temp;
+            }
+        }
+
+        void bits(u32 value, int size)
+        {
+            if (size)
+            {
+                ptr = huffman.putBits(ptr, value, size);
+            }
+        }
+
+        void flush()
+        {
+            ptr = huffman.flush(ptr);
+            buffer.append(temp, ptr - temp);
+            ptr = temp;
+        }
+    };
+
     struct jpegEncoder
     {
         Surface m_surface;
@@ -335,6 +653,23 @@ namespace
         Channel channel[3];
         int components;
 
+        // luminance sampling factors; chroma is always sampled once per MCU
+        int xsample;
+        int ysample;
+
+        // blocks in MCU in encoding order: luminance blocks followed by Cb and Cr
+        int blocks_in_mcu;
+        int block_channel[6];
+
+        // optimized huffman tables
+        HuffmanTable dc_table[2];
+        HuffmanTable ac_table[2];
+        u32 dc_code[2][12];
+        u16 dc_size[2][12];
+        alignas(64) u32 ac_code[2][176];
+        alignas(64) u16 ac_size[2][176];
+        bool optimized = false;
+
         std::string info;
 
         u64 restart_offset = 0;
@@ -350,11 +685,35 @@ namespace
         jpegEncoder(const Surface& surface, SampleType sample, const ImageEncodeOptions& options);
         ~jpegEncoder();
 
+        template <int YS>
+        void configureSubsampled(u64 flags, const char*& sampler_name);
+
         void writeMarkers(BigEndianStream& p, int interval);
 
+        void readRow(s16* blocks, const u8* image, size_t stride, int y);
+        void countInterval(HuffmanStatistics& stats, int y0, int y1, const u8* image, size_t stride);
+        void buildOptimizedTables(int interval);
+
         void encodeScan(Buffer& buffer, HuffmanEncoder& huffman, const u8* src, size_t stride, ReadFunc read_func, int rows);
         void encodeInterval(Buffer& buffer, int y0, int y1, int restartCounter, const u8* image, size_t stride);
         ImageEncodeStatus encodeImage(Stream& stream);
+
+        // progressive
+        struct Scan
+        {
+            int components;
+            int component[3];
+            int ss; // spectral selection start
+            int se; // spectral selection end
+        };
+
+        AlignedStorage<s16> coefficients; // quantized, zigzag order, MCU order
+
+        s16* getBlock(int component, int bx, int by);
+        void transformRow(int y);
+        template <typename Emitter>
+        void processScan(const Scan& scan, Emitter& emitter);
+        ImageEncodeStatus encodeProgressive(Stream& stream);
     };
 
     // ----------------------------------------------------------------------------
@@ -1082,18 +1441,6 @@ namespace
 
         p = encode_dc(encoder, p, block[0], channel);
 
-        const u8 zigzag_table_inverse [] =
-        {
-             0,  1,  8, 16,  9,  2,  3, 10,
-            17, 24, 32, 25, 18, 11,  4,  5,
-            12, 19, 26, 33, 40, 48, 41, 34,
-            27, 20, 13,  6,  7, 14, 21, 28,
-            35, 42, 49, 56, 57, 50, 43, 36,
-            29, 22, 15, 23, 30, 37, 44, 51,
-            58, 59, 52, 45, 38, 31, 39, 46,
-            53, 60, 61, 54, 47, 55, 62, 63,
-        };
-
         const u32* ac_code = channel.ac_code;
         const u16* ac_size = channel.ac_size;
         const u32 zero16_code = ac_code[1];
@@ -1103,7 +1450,7 @@ namespace
 
         for (int i = 1; i < 64; ++i)
         {
-            int coeff = block[zigzag_table_inverse[i]];
+            int coeff = block[g_zigzag_table_inverse[i]];
             if (coeff)
             {
                 while (counter > 15)
@@ -1944,8 +2291,124 @@ namespace
         }
     }
 
+    // Subsampled readers produce 2 (4:2:2) or 4 (4:2:0) luminance blocks followed by
+    // the Cb and Cr blocks. Chroma is computed from the box filtered RGB of the
+    // 2x1 or 2x2 pixel footprint. Clipped MCUs replicate the last column and row.
+
+    template <int BPP, int R, int G, int B, int YS>
+    void read_subsampled_format(s16* block, const u8* input, size_t stride, int rows, int cols)
+    {
+        s16* chroma = block + YS * 2 * 64;
+
+        for (int y = 0; y < 8 * YS; ++y)
+        {
+            const u8* scan = input + std::min(y, rows - 1) * stride;
+            s16* dest = block + (y >> 3) * 128 + (y & 7) * 8;
+
+            for (int x = 0; x < 16; ++x)
+            {
+                const u8* s = scan + std::min(x, cols - 1) * BPP;
+                int luma = (76 * s[R] + 151 * s[G] + 29 * s[B]) >> 8;
+                dest[(x >> 3) * 64 + (x & 7)] = s16(luma - 128);
+            }
+        }
+
+        for (int y = 0; y < 8; ++y)
+        {
+            for (int x = 0; x < 8; ++x)
+            {
+                int r = 0;
+                int g = 0;
+                int b = 0;
+
+                for (int i = 0; i < YS; ++i)
+                {
+                    const u8* scan = input + std::min(y * YS + i, rows - 1) * stride;
+                    const u8* s0 = scan + std::min(x * 2 + 0, cols - 1) * BPP;
+                    const u8* s1 = scan + std::min(x * 2 + 1, cols - 1) * BPP;
+                    r += s0[R] + s1[R];
+                    g += s0[G] + s1[G];
+                    b += s0[B] + s1[B];
+                }
+
+                r = (r + YS) >> YS;
+                g = (g + YS) >> YS;
+                b = (b + YS) >> YS;
+
+                int luma = (76 * r + 151 * g + 29 * b) >> 8;
+                chroma[0 * 64 + y * 8 + x] = s16(((b - luma) * 144) >> 8);
+                chroma[1 * 64 + y * 8 + x] = s16(((r - luma) * 182) >> 8);
+            }
+        }
+    }
+
 #if defined(MANGO_ENABLE_SSE2) || defined(MANGO_ENABLE_SSE4_1)
 
+    static inline
+    __m128i compute_luma_sse2(__m128i r, __m128i g, __m128i b)
+    {
+        __m128i s0 = _mm_mullo_epi16(r, _mm_set1_epi16(76));
+        __m128i s1 = _mm_mullo_epi16(g, _mm_set1_epi16(151));
+        __m128i s2 = _mm_mullo_epi16(b, _mm_set1_epi16(29));
+        __m128i s = _mm_add_epi16(s0, _mm_add_epi16(s1, s2));
+        return _mm_srli_epi16(s, 8);
+    }
+
+    template <void (*load)(const u8*, __m128i&, __m128i&, __m128i&), int BPP, int YS>
+    void read_subsampled_format_sse2(s16* block, const u8* input, size_t stride, int rows, int cols)
+    {
+        MANGO_UNREFERENCED(rows);
+        MANGO_UNREFERENCED(cols);
+
+        const __m128i one = _mm_set1_epi16(1);
+        const __m128i c128 = _mm_set1_epi16(128);
+        const __m128i round = _mm_set1_epi16(YS);
+
+        s16* chroma = block + YS * 2 * 64;
+
+        for (int y = 0; y < 8; ++y)
+        {
+            __m128i r = _mm_setzero_si128();
+            __m128i g = _mm_setzero_si128();
+            __m128i b = _mm_setzero_si128();
+
+            for (int i = 0; i < YS; ++i)
+            {
+                const int row = y * YS + i;
+                __m128i* dest = reinterpret_cast<__m128i*>(block + (row >> 3) * 128 + (row & 7) * 8);
+
+                __m128i r0, g0, b0;
+                __m128i r1, g1, b1;
+                load(input + 0 * BPP, r0, g0, b0);
+                load(input + 8 * BPP, r1, g1, b1);
+
+                // luminance
+                _mm_storeu_si128(dest + 0, _mm_sub_epi16(compute_luma_sse2(r0, g0, b0), c128));
+                _mm_storeu_si128(dest + 8, _mm_sub_epi16(compute_luma_sse2(r1, g1, b1), c128));
+
+                // horizontal pair sums
+                r = _mm_add_epi16(r, _mm_packs_epi32(_mm_madd_epi16(r0, one), _mm_madd_epi16(r1, one)));
+                g = _mm_add_epi16(g, _mm_packs_epi32(_mm_madd_epi16(g0, one), _mm_madd_epi16(g1, one)));
+                b = _mm_add_epi16(b, _mm_packs_epi32(_mm_madd_epi16(b0, one), _mm_madd_epi16(b1, one)));
+
+                input += stride;
+            }
+
+            r = _mm_srli_epi16(_mm_add_epi16(r, round), YS);
+            g = _mm_srli_epi16(_mm_add_epi16(g, round), YS);
+            b = _mm_srli_epi16(_mm_add_epi16(b, round), YS);
+
+            // chroma
+            __m128i luma = compute_luma_sse2(r, g, b);
+            __m128i cb = _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(b, luma), _mm_set1_epi16(144)), 8);
+            __m128i cr = _mm_srai_epi16(_mm_mullo_epi16(_mm_sub_epi16(r, luma), _mm_set1_epi16(182)), 8);
+
+            __m128i* dest = reinterpret_cast<__m128i*>(chroma + y * 8);
+            _mm_storeu_si128(dest + 0, cb);
+            _mm_storeu_si128(dest + 8, cr);
+        }
+    }
+
     static
     void compute_ycbcr_sse2(s16* dest, __m128i r, __m128i g, __m128i b)
     {
@@ -2116,10 +2579,55 @@ namespace
         }
     }
 
+    static inline
+    void load_bgra_sse2(const u8* input, __m128i& r, __m128i& g, __m128i& b)
+    {
+        const __m128i mask = _mm_set1_epi32(0xff);
+        const __m128i* ptr = reinterpret_cast<const __m128i*>(input);
+
+        __m128i v0 = _mm_loadu_si128(ptr + 0);
+        __m128i v1 = _mm_loadu_si128(ptr + 1);
+        b = _mm_packs_epi32(_mm_and_si128(v0, mask), _mm_and_si128(v1, mask));
+        g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 8), mask), _mm_and_si128(_mm_srli_epi32(v1, 8), mask));
+        r = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(v0, 16), mask), _mm_and_si128(_mm_srli_epi32(v1, 16), mask));
+    }
+
+    static inline
+    void load_rgba_sse2(const u8* input, __m128i& r, __m128i& g, __m128i& b)
+    {
+        load_bgra_sse2(input, b, g, r);
+    }
+
 #endif // MANGO_ENABLE_SSE2
 
 #if defined(MANGO_ENABLE_SSE4_1)
 
+    static inline
+    void load_bgr_sse41(const u8* input, __m128i& r, __m128i& g, __m128i& b)
+    {
+        const __m128i* ptr = reinterpret_cast<const __m128i*>(input);
+
+        __m128i v0 = _mm_loadu_si128(ptr + 0);
+        __m128i v1 = _mm_loadl_epi64(ptr + 1);
+
+        constexpr u8 n = 0x80;
+        __m128i b0 = _mm_shuffle_epi8(v0, _mm_setr_epi8(0, n, 3, n, 6, n, 9, n, 12, n, 15, n, n, n, n, n));
+        __m128i b1 = _mm_shuffle_epi8(v1, _mm_setr_epi8(n, n, n, n, n, n, n, n, n, n, n, n, 2, n, 5, n));
+        __m128i g0 = _mm_shuffle_epi8(v0, _mm_setr_epi8(1, n, 4, n, 7, n, 10, n, 13, n, n, n, n, n, n, n));
+        __m128i g1 = _mm_shuffle_epi8(v1, _mm_setr_epi8(n, n, n, n, n, n, n, n, n, n, 0, n, 3, n, 6, n));
+        __m128i r0 = _mm_shuffle_epi8(v0, _mm_setr_epi8(2, n, 5, n, 8, n, 11, n, 14, n, n, n, n, n, n, n));
+        __m128i r1 = _mm_shuffle_epi8(v1, _mm_setr_epi8(n, n, n, n, n, n, n, n, n, n, 1, n, 4, n, 7, n));
+        b = _mm_or_si128(b0, b1);
+        g = _mm_or_si128(g0, g1);
+        r = _mm_or_si128(r0, r1);
+    }
+
+    static inline
+    void load_rgb_sse41(const u8* input, __m128i& r, __m128i& g, __m128i& b)
+    {
+        load_bgr_sse41(input, b, g, r);
+    }
+
     static
     void read_bgr_format_sse41(s16* block, const u8* input, size_t stride, int rows, int cols)
     {
@@ -2476,6 +2984,48 @@ namespace
             read_8x8 = read;
         }
 
+        // select chroma subsampling
+
+        xsample = 1;
+        ysample = 1;
+
+        if (components == 3)
+        {
+            switch (options.subsampling)
+            {
+                case ChromaSubsampling::S444:
+                    break;
+                case ChromaSubsampling::S422:
+                    xsample = 2;
+                    break;
+                case ChromaSubsampling::S420:
+                    xsample = 2;
+                    ysample = 2;
+                    break;
+            }
+        }
+
+        if (ysample == 2)
+        {
+            configureSubsampled<2>(flags, sampler_name);
+        }
+        else if (xsample == 2)
+        {
+            configureSubsampled<1>(flags, sampler_name);
+        }
+
+        blocks_in_mcu = 0;
+
+        for (int i = 0; i < xsample * ysample; ++i)
+        {
+            block_channel[blocks_in_mcu++] = 0;
+        }
+
+        for (int i = 1; i < components; ++i)
+        {
+            block_channel[blocks_in_mcu++] = i;
+        }
+
         // select fdct
 
         fdct = fdct_scalar;
@@ -2542,11 +3092,11 @@ namespace
         info += ", Encoder: ";
         info += encode_name;
 
-        mcu_width = 8;
-        mcu_height = 8;
+        mcu_width = 8 * xsample;
+        mcu_height = 8 * ysample;
 
-        horizontal_mcus = (m_surface.width + mcu_width - 1) >> 3;
-        vertical_mcus   = (m_surface.height + mcu_height - 1) >> 3;
+        horizontal_mcus = div_ceil(m_surface.width, mcu_width);
+        vertical_mcus   = div_ceil(m_surface.height, mcu_height);
 
         rows_in_bottom_mcus = m_surface.height - (vertical_mcus - 1) * mcu_height;
         cols_in_right_mcus  = m_surface.width  - (horizontal_mcus - 1) * mcu_width;
@@ -2590,10 +3140,74 @@ namespace
     {
     }
 
-    void jpegEncoder::writeMarkers(BigEndianStream& p, int interval)
+    template <int YS>
+    void jpegEncoder::configureSubsampled(u64 flags, const char*& sampler_name)
     {
-        // Start of image marker
-        p.write16(MARKER_SOI);
+        MANGO_UNREFERENCED(flags);
+
+        read_8x8 = nullptr;
+        sampler_name = YS == 2 ? "4:2:0 Scalar" : "4:2:2 Scalar";
+
+        switch (m_sample)
+        {
+            case SampleType::U8_Y:
+                break;
+
+            case SampleType::U8_BGR:
+#if defined(MANGO_ENABLE_SSE4_1)
+                if (flags & INTEL_SSE4_1)
+                {
+                    read_8x8 = read_subsampled_format_sse2<load_bgr_sse41, 3, YS>;
+                    sampler_name = YS == 2 ? "BGR 4:2:0 SSE4.1" : "BGR 4:2:2 SSE4.1";
+                }
+#endif
+                read = read_subsampled_format<3, 2, 1, 0, YS>;
+                break;
+
+            case SampleType::U8_RGB:
+#if defined(MANGO_ENABLE_SSE4_1)
+                if (flags & INTEL_SSE4_1)
+                {
+                    read_8x8 = read_subsampled_format_sse2<load_rgb_sse41, 3, YS>;
+                    sampler_name = YS == 2 ? "RGB 4:2:0 SSE4.1" : "RGB 4:2:2 SSE4.1";
+                }
+#endif
+                read = read_subsampled_format<3, 0, 1, 2, YS>;
+                break;
+
+            case SampleType::U8_BGRA:
+#if defined(MANGO_ENABLE_SSE2)
+                if (flags & INTEL_SSE2)
+                {
+                    read_8x8 = read_subsampled_format_sse2<load_bgra_sse2, 4, YS>;
+                    sampler_name = YS == 2 ? "BGRA 4:2:0 SSE2" : "BGRA 4:2:2 SSE2";
+                }
+#endif
+                read = read_subsampled_format<4, 2, 1, 0, YS>;
+                break;
+
+            case SampleType::U8_RGBA:
+#if defined(MANGO_ENABLE_SSE2)
+                if (flags & INTEL_SSE2)
+                {
+                    read_8x8 = read_subsampled_format_sse2<load_rgba_sse2, 4, YS>;
+                    sampler_name = YS == 2 ? "RGBA 4:2:0 SSE2" : "RGBA 4:2:2 SSE2";
+                }
+#endif
+                read = read_subsampled_format<4, 0, 1, 2, YS>;
+                break;
+        }
+
+        if (!read_8x8)
+        {
+            read_8x8 = read;
+        }
+    }
+
+    void jpegEncoder::writeMarkers(BigEndianStream& p, int interval)
+    {
+        // Start of image marker
+        p.write16(MARKER_SOI);
 
         // ICC profile.  splitting to multiple markers if necessary
         if (m_options.icc.size)
@@ -2616,23 +3230,26 @@ namespace
             }
         }
 
-        // MANGO marker
-        const u8 magic_mango [] = { 0x4d, 0x61, 0x6e, 0x67, 0x6f, 0x31 }; // 'Mango1'
-        const u32 magic_mango_size = sizeof(magic_mango);
+        if (!m_options.progressive)
+        {
+            // MANGO marker
+            const u8 magic_mango [] = { 0x4d, 0x61, 0x6e, 0x67, 0x6f, 0x31 }; // 'Mango1'
+            const u32 magic_mango_size = sizeof(magic_mango);
 
-        int intervals = div_ceil(vertical_mcus, interval);
+            int intervals = div_ceil(vertical_mcus, interval);
 
-        p.write16(MARKER_APP14);
-        p.write16(u16(6 + magic_mango_size + intervals * sizeof(u32)));
-        p.write(magic_mango, magic_mango_size);
-        p.write32(interval);
+            p.write16(MARKER_APP14);
+            p.write16(u16(6 + magic_mango_size + intervals * sizeof(u32)));
+            p.write(magic_mango, magic_mango_size);
+            p.write32(interval);
 
-        restart_offset = p.offset();
+            restart_offset = p.offset();
 
-        for (int i = 0; i < intervals; ++i)
-        {
-            // reserve space for restart offsets
-            p.write32(0);
+            for (int i = 0; i < intervals; ++i)
+            {
+                // reserve space for restart offsets
+                p.write32(0);
+            }
         }
 
         // Quantization table marker
@@ -2652,7 +3269,7 @@ namespace
         p.write(chrominance_qtable, 64);
 
         // Start of frame marker
-        p.write16(MARKER_SOF0);
+        p.write16(m_options.progressive ? MARKER_SOF2 : MARKER_SOF0);
 
         u8 number_of_components = 0;
 
@@ -2678,19 +3295,36 @@ namespace
         p.write16(u16(m_surface.width)); // image width
         p.write8(number_of_components); // Nf
 
+        const u8 luma_sampling = u8((xsample << 4) | ysample);
+
         const u8 nfdata[] =
         {
-            0x01, 0x11, 0x00, // component 1
-            0x00, 0x00, 0x00, // padding
-            0x01, 0x11, 0x00, // component 1
+            0x01, luma_sampling, 0x00, // component 1
             0x02, 0x11, 0x01, // component 2
             0x03, 0x11, 0x01, // component 3
         };
 
-        p.write(nfdata + (number_of_components - 1) * 3, number_of_components * 3);
+        p.write(nfdata, number_of_components * 3);
+
+        if (m_options.progressive)
+        {
+            // huffman tables are defined for each scan
+            return;
+        }
 
         // huffman table (DHT)
-        p.write(g_marker_data, sizeof(g_marker_data));
+        if (optimized)
+        {
+            for (int i = 0; i < std::min(components, 2); ++i)
+            {
+                dc_table[i].write(p, u8(0x00 | i));
+                ac_table[i].write(p, u8(0x10 | i));
+            }
+        }
+        else
+        {
+            p.write(g_marker_data, sizeof(g_marker_data));
+        }
 
         // Define Restart Interval (DRI)
         p.write16(MARKER_DRI);
@@ -2738,13 +3372,13 @@ namespace
             }
 
             // read MCU data
-            s16 block[BLOCK_SIZE * 3];
+            s16 block[BLOCK_SIZE * 6];
             reader(block, image, stride, rows, cols);
 
             // encode the data in MCU
-            for (int i = 0; i < components; ++i)
+            for (int i = 0; i < blocks_in_mcu; ++i)
             {
-                ptr = encode(huffman, ptr, block + i * BLOCK_SIZE, channel[i]);
+                ptr = encode(huffman, ptr, block + i * BLOCK_SIZE, channel[block_channel[i]]);
             }
 
             // flush encoding buffer
@@ -2792,8 +3426,160 @@ namespace
         p.write16(MARKER_RST0 + (restartCounter & 7));
     }
 
+    void jpegEncoder::readRow(s16* blocks, const u8* image, size_t stride, int y)
+    {
+        const int right_mcu = horizontal_mcus - 1;
+
+        int rows = mcu_height;
+        int cols = mcu_width;
+        auto reader = read_8x8;
+
+        if (y >= vertical_mcus - 1)
+        {
+            // vertical clipping
+            rows = rows_in_bottom_mcus;
+            reader = read;
+        }
+
+        for (int x = 0; x < horizontal_mcus; ++x)
+        {
+            if (x >= right_mcu)
+            {
+                // horizontal clipping
+                cols = cols_in_right_mcus;
+                reader = read;
+            }
+
+            reader(blocks, image, stride, rows, cols);
+
+            blocks += blocks_in_mcu * BLOCK_SIZE;
+            image += mcu_stride;
+        }
+    }
+
+    void jpegEncoder::countInterval(HuffmanStatistics& stats, int y0, int y1, const u8* image, size_t stride)
+    {
+        const int blocks_in_row = horizontal_mcus * blocks_in_mcu;
+        AlignedStorage<s16> blocks(blocks_in_row * BLOCK_SIZE);
+
+        // the interval begins with a restart
+        int last_dc_value[3] = { 0, 0, 0 };
+
+        for (int y = y0; y < y1; ++y)
+        {
+            readRow(blocks, image, stride, y);
+
+            for (int i = 0; i < blocks_in_row; ++i)
+            {
+                const int component = block_channel[i % blocks_in_mcu];
+                const int table = component ? 1 : 0;
+
+                s16 block[64];
+                fdct(block, blocks + i * BLOCK_SIZE, channel[component].qtable);
+
+                int dc = block[0] - last_dc_value[component];
+                last_dc_value[component] = block[0];
+                ++stats.dc[table][coefficient_size(dc)];
+
+                int run = 0;
+
+                for (int k = 1; k < 64; ++k)
+                {
+                    int coeff = block[g_zigzag_table_inverse[k]];
+                    if (!coeff)
+                    {
+                        ++run;
+                        continue;
+                    }
+
+                    for ( ; run > 15; run -= 16)
+                    {
+                        ++stats.ac[table][0xf0];
+                    }
+
+                    ++stats.ac[table][(run << 4) | coefficient_size(coeff)];
+                    run = 0;
+                }
+
+                if (run)
+                {
+                    ++stats.ac[table][0x00];
+                }
+            }
+
+            image += stride * mcu_height;
+        }
+    }
+
+    void jpegEncoder::buildOptimizedTables(int interval)
+    {
+        const u8* image = m_surface.image;
+        size_t stride = m_surface.stride;
+
+        // symbol statistics are gathered with the same work split as the encoding
+        const int intervals = div_ceil(vertical_mcus, interval);
+        std::vector<HuffmanStatistics> stats(intervals);
+
+        auto count = [this, &stats, interval, image, stride] (int i)
+        {
+            int y0 = i * interval;
+            int y1 = std::min(vertical_mcus, y0 + interval);
+            countInterval(stats[i], y0, y1, image + y0 * mcu_height * stride, stride);
+        };
+
+        if (m_options.multithread)
+        {
+            ConcurrentQueue queue;
+
+            for (int i = 0; i < intervals; ++i)
+            {
+                queue.enqueue(count, i);
+            }
+
+            queue.wait();
+        }
+        else
+        {
+            for (int i = 0; i < intervals; ++i)
+            {
+                count(i);
+            }
+        }
+
+        HuffmanStatistics total;
+
+        for (const auto& s : stats)
+        {
+            total.add(s);
+        }
+
+        for (int i = 0; i < std::min(components, 2); ++i)
+        {
+            dc_table[i].build(total.dc[i]);
+            ac_table[i].build(total.ac[i]);
+            dc_table[i].getDC(dc_code[i], dc_size[i]);
+            ac_table[i].getAC(ac_code[i], ac_size[i]);
+        }
+
+        for (int i = 0; i < 3; ++i)
+        {
+            const int table = i ? 1 : 0;
+            channel[i].dc_code = dc_code[table];
+            channel[i].dc_size = dc_size[table];
+            channel[i].ac_code = ac_code[table];
+            channel[i].ac_size = ac_size[table];
+        }
+
+        optimized = true;
+    }
+
     ImageEncodeStatus jpegEncoder::encodeImage(Stream& stream)
     {
+        if (m_options.progressive)
+        {
+            return encodeProgressive(stream);
+        }
+
         const u8* image = m_surface.image;
         size_t stride = m_surface.stride;
 
@@ -2805,6 +3591,12 @@ namespace
         int N = 1; // number of MCU scans per restart interval
         int restartCounter = 0;
 
+        if (m_options.optimize)
+        {
+            // first pass: symbol statistics
+            buildOptimizedTables(N);
+        }
+
         // writing marker data
         writeMarkers(s, N);
 
@@ -2883,6 +3675,311 @@ namespace
         ImageEncodeStatus status;
         status.info = info;
 
+        if (optimized)
+        {
+            status.info += ", Huffman: Optimized";
+        }
+
+        return status;
+    }
+
+    // ----------------------------------------------------------------------------
+    // progressive
+    // ----------------------------------------------------------------------------
+
+    s16* jpegEncoder::getBlock(int component, int bx, int by)
+    {
+        int mx = bx;
+        int my = by;
+        int index = xsample * ysample + component - 1;
+
+        if (!component)
+        {
+            mx = bx / xsample;
+            my = by / ysample;
+            index = (by % ysample) * xsample + (bx % xsample);
+        }
+
+        size_t offset = (size_t(my) * horizontal_mcus + mx) * blocks_in_mcu + index;
+        return coefficients + offset * BLOCK_SIZE;
+    }
+
+    void jpegEncoder::transformRow(int y)
+    {
+        const int blocks_in_row = horizontal_mcus * blocks_in_mcu;
+        AlignedStorage<s16> blocks(blocks_in_row * BLOCK_SIZE);
+
+        const u8* image = m_surface.image + size_t(y) * mcu_height * m_surface.stride;
+        readRow(blocks, image, m_surface.stride, y);
+
+        s16* dest = coefficients + size_t(y) * blocks_in_row * BLOCK_SIZE;
+
+        for (int i = 0; i < blocks_in_row; ++i)
+        {
+            const int component = block_channel[i % blocks_in_mcu];
+
+            s16 block[64];
+            fdct(block, blocks + i * BLOCK_SIZE, channel[component].qtable);
+
+            for (int k = 0; k < 64; ++k)
+            {
+                dest[k] = block[g_zigzag_table_inverse[k]];
+            }
+
+            dest += BLOCK_SIZE;
+        }
+    }
+
+    template <typename Emitter>
+    void jpegEncoder::processScan(const Scan& scan, Emitter& emitter)
+    {
+        // Spectral selection only (Ah = Al = 0). Single component scans cover the
+        // blocks of the component, not the padded MCU grid.
+
+        auto xblocks = [this] (int component) -> int
+        {
+            int width = component ? div_ceil(m_surface.width, xsample) : m_surface.width;
+            return div_ceil(width, 8);
+        };
+
+        auto yblocks = [this] (int component) -> int
+        {
+            int height = component ? div_ceil(m_surface.height, ysample) : m_surface.height;
+            return div_ceil(height, 8);
+        };
+
+        if (!scan.ss)
+        {
+            int last_dc_value[3] = { 0, 0, 0 };
+
+            auto encodeDC = [&] (int component, const s16* block)
+            {
+                int dc = block[0] - last_dc_value[component];
+                last_dc_value[component] = block[0];
+
+                int size = coefficient_size(dc);
+                emitter.symbol(scan.components > 1 && component ? 1 : 0, size);
+                emitter.bits(coefficient_bits(dc, size), size);
+            };
+
+            if (scan.components > 1)
+            {
+                const s16* block = coefficients;
+
+                for (int i = 0; i < horizontal_mcus * vertical_mcus; ++i)
+                {
+                    for (int j = 0; j < blocks_in_mcu; ++j)
+                    {
+                        encodeDC(block_channel[j], block);
+                        block += BLOCK_SIZE;
+                    }
+                }
+            }
+            else
+            {
+                const int component = scan.component[0];
+
+                for (int y = 0; y < yblocks(component); ++y)
+                {
+                    for (int x = 0; x < xblocks(component); ++x)
+                    {
+                        encodeDC(component, getBlock(component, x, y));
+                    }
+                }
+            }
+        }
+        else
+        {
+            const int component = scan.component[0];
+
+            int eobrun = 0;
+
+            auto encodeEOB = [&] ()
+            {
+                if (eobrun)
+                {
+                    int size = u32_log2(eobrun);
+                    emitter.symbol(0, size << 4);
+                    emitter.bits(eobrun & ((1 << size) - 1), size);
+                    eobrun = 0;
+                }
+            };
+
+            for (int y = 0; y < yblocks(component); ++y)
+            {
+                for (int x = 0; x < xblocks(component); ++x)
+                {
+                    const s16* block = getBlock(component, x, y);
+
+                    int run = 0;
+
+                    for (int k = scan.ss; k <= scan.se; ++k)
+                    {
+                        int coeff = block[k];
+                        if (!coeff)
+                        {
+                            ++run;
+                            continue;
+                        }
+
+                        encodeEOB();
+
+                        for ( ; run > 15; run -= 16)
+                        {
+                            emitter.symbol(0, 0xf0);
+                        }
+
+                        int size = coefficient_size(coeff);
+                        emitter.symbol(0, (run << 4) | size);
+                        emitter.bits(coefficient_bits(coeff, size), size);
+                        run = 0;
+                    }
+
+                    if (run)
+                    {
+                        // end-of-band runs are limited to 0x7fff blocks
+                        if (++eobrun == 0x7fff)
+                        {
+                            encodeEOB();
+                        }
+                    }
+                }
+            }
+
+            encodeEOB();
+        }
+    }
+
+    ImageEncodeStatus jpegEncoder::encodeProgressive(Stream& stream)
+    {
+        // quantized coefficients for the whole image
+        coefficients.resize(size_t(horizontal_mcus) * vertical_mcus * blocks_in_mcu * BLOCK_SIZE);
+
+        std::vector<Scan> scans;
+
+        if (components == 3)
+        {
+            scans.push_back({ 3, { 0, 1, 2 }, 0, 0 });
+            scans.push_back({ 1, { 0 }, 1, 5 });
+            scans.push_back({ 1, { 2 }, 1, 63 });
+            scans.push_back({ 1, { 1 }, 1, 63 });
+            scans.push_back({ 1, { 0 }, 6, 63 });
+        }
+        else
+        {
+            scans.push_back({ 1, { 0 }, 0, 0 });
+            scans.push_back({ 1, { 0 }, 1, 5 });
+            scans.push_back({ 1, { 0 }, 6, 63 });
+        }
+
+        struct ScanData
+        {
+            HuffmanTable table[2];
+            Buffer buffer;
+        };
+
+        std::vector<ScanData> data(scans.size());
+
+        // scans are independent: each one gathers statistics for its own tables
+        auto encodeScan = [this, &scans, &data] (size_t i)
+        {
+            SymbolCounter counter;
+            processScan(scans[i], counter);
+
+            data[i].table[0].build(counter.frequency[0]);
+            data[i].table[1].build(counter.frequency[1]);
+
+            SymbolWriter writer(data[i].buffer, &data[i].table[0], &data[i].table[1]);
+            processScan(scans[i], writer);
+            writer.flush();
+        };
+
+        if (m_options.multithread)
+        {
+            ConcurrentQueue queue;
+
+            for (int y = 0; y < vertical_mcus; ++y)
+            {
+                queue.enqueue([this, y]
+                {
+                    transformRow(y);
+                });
+            }
+
+            queue.wait();
+
+            for (size_t i = 0; i < scans.size(); ++i)
+            {
+                queue.enqueue(encodeScan, i);
+            }
+
+            queue.wait();
+        }
+        else
+        {
+            for (int y = 0; y < vertical_mcus; ++y)
+            {
+                transformRow(y);
+            }
+
+            for (size_t i = 0; i < scans.size(); ++i)
+            {
+                encodeScan(i);
+            }
+        }
+
+        MemoryStream temp;
+        BigEndianStream s(temp);
+
+        writeMarkers(s, 1);
+
+        for (size_t i = 0; i < scans.size(); ++i)
+        {
+            const Scan& scan = scans[i];
+
+            // huffman tables (DHT)
+            if (!scan.ss)
+            {
+                data[i].table[0].write(s, 0x00);
+
+                if (scan.components > 1)
+                {
+                    data[i].table[1].write(s, 0x01);
+                }
+            }
+            else
+            {
+                data[i].table[0].write(s, 0x10);
+            }
+
+            // Start of scan marker
+            s.write16(MARKER_SOS);
+            s.write16(u16(6 + scan.components * 2)); // header length
+            s.write8(u8(scan.components)); // Ns
+
+            for (int j = 0; j < scan.components; ++j)
+            {
+                const int component = scan.component[j];
+                const int table = !scan.ss && scan.components > 1 && component ? 1 : 0;
+                s.write8(u8(component + 1));
+                s.write8(u8(table << 4)); // Td, Ta
+            }
+
+            s.write8(u8(scan.ss));
+            s.write8(u8(scan.se));
+            s.write8(0x00); // Ah, Al
+
+            s.write(data[i].buffer);
+        }
+
+        // EOI marker
+        s.write16(MARKER_EOI);
+
+        stream.write(temp);
+
+        ImageEncodeStatus status;
+        status.info = info + ", Progressive";
+
         return status;
     }
 
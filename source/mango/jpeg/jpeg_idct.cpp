@@ -118,6 +118,104 @@ namespace
         }
     }
 
+    // ------------------------------------------------------------------------------------------------
+    // reduced-size idct
+    // ------------------------------------------------------------------------------------------------
+
+    /*
+        DCT scaling: a block is reconstructed at N x N samples (N = 4, 2, 1) from its N x N lowest
+        frequency coefficients. Evaluating the 8-point inverse transform at the centers of the
+        sample pairs (quads) reduces to an N-point inverse DCT with the 8-point normalization, so
+        the result is the (box filtered) full resolution block without computing it.
+    */
+
+    template <int PRECISION>
+    void idct4x4(u8* dest, const s16* data, const s16* qt)
+    {
+        // cos(pi/4), cos(pi/8), cos(3pi/8) in 1.12 fixed point
+        const int c4 = 2896;
+        const int c2 = 3784;
+        const int c6 = 1567;
+
+        int temp[16];
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const int s0 = data[i + 8 * 0] * qt[i + 8 * 0];
+            const int s1 = data[i + 8 * 1] * qt[i + 8 * 1];
+            const int s2 = data[i + 8 * 2] * qt[i + 8 * 2];
+            const int s3 = data[i + 8 * 3] * qt[i + 8 * 3];
+
+            const int e0 = (s0 + s2) * c4;
+            const int e1 = (s0 - s2) * c4;
+            const int o0 = s1 * c2 + s3 * c6;
+            const int o1 = s1 * c6 - s3 * c2;
+
+            // keep two fractional bits (the 1/2 normalization is folded into the shift)
+            const int bias = 0x400;
+            temp[i * 4 + 0] = (e0 + o0 + bias) >> 11;
+            temp[i * 4 + 1] = (e1 + o1 + bias) >> 11;
+            temp[i * 4 + 2] = (e1 - o1 + bias) >> 11;
+            temp[i * 4 + 3] = (e0 - o0 + bias) >> 11;
+        }
+
+        const int shift = PRECISION + 7;
+
+        for (int i = 0; i < 4; ++i)
+        {
+            const int s0 = temp[i + 4 * 0];
+            const int s1 = temp[i + 4 * 1];
+            const int s2 = temp[i + 4 * 2];
+            const int s3 = temp[i + 4 * 3];
+
+            const int bias = (1 << (shift - 1)) + (128 << shift);
+            const int e0 = (s0 + s2) * c4 + bias;
+            const int e1 = (s0 - s2) * c4 + bias;
+            const int o0 = s1 * c2 + s3 * c6;
+            const int o1 = s1 * c6 - s3 * c2;
+
+            dest[0] = u8_clamp((e0 + o0) >> shift);
+            dest[1] = u8_clamp((e1 + o1) >> shift);
+            dest[2] = u8_clamp((e1 - o1) >> shift);
+            dest[3] = u8_clamp((e0 - o0) >> shift);
+            dest += 8;
+        }
+    }
+
+    template <int PRECISION>
+    void idct2x2(u8* dest, const s16* data, const s16* qt)
+    {
+        const int c4 = 2896;
+
+        const int s00 = data[0] * qt[0];
+        const int s01 = data[1] * qt[1];
+        const int s10 = data[8] * qt[8];
+        const int s11 = data[9] * qt[9];
+
+        // columns (two fractional bits, see idct4x4)
+        const int a0 = ((s00 + s10) * c4 + 0x400) >> 11;
+        const int a1 = ((s00 - s10) * c4 + 0x400) >> 11;
+        const int b0 = ((s01 + s11) * c4 + 0x400) >> 11;
+        const int b1 = ((s01 - s11) * c4 + 0x400) >> 11;
+
+        const int shift = PRECISION + 7;
+        const int bias = (1 << (shift - 1)) + (128 << shift);
+
+        dest[0] = u8_clamp(((a0 + b0) * c4 + bias) >> shift);
+        dest[1] = u8_clamp(((a0 - b0) * c4 + bias) >> shift);
+        dest[8] = u8_clamp(((a1 + b1) * c4 + bias) >> shift);
+        dest[9] = u8_clamp(((a1 - b1) * c4 + bias) >> shift);
+    }
+
+    template <int PRECISION>
+    void idct1x1(u8* dest, const s16* data, const s16* qt)
+    {
+        // the block average is DC / 8
+        const int shift = PRECISION - 5;
+        const int dc = data[0] * qt[0];
+        dest[0] = u8_clamp(((dc + (1 << (shift - 1))) >> shift) + 128);
+    }
+
 } // namespace
 
 namespace mango::image::jpeg
@@ -137,6 +235,36 @@ namespace mango::image::jpeg
         idct<12>(dest, data, qt);
     }
 
+    void idct8_4x4(u8* dest, const s16* data, const s16* qt)
+    {
+        idct4x4<8>(dest, data, qt);
+    }
+
+    void idct8_2x2(u8* dest, const s16* data, const s16* qt)
+    {
+        idct2x2<8>(dest, data, qt);
+    }
+
+    void idct8_1x1(u8* dest, const s16* data, const s16* qt)
+    {
+        idct1x1<8>(dest, data, qt);
+    }
+
+    void idct12_4x4(u8* dest, const s16* data, const s16* qt)
+    {
+        idct4x4<12>(dest, data, qt);
+    }
+
+    void idct12_2x2(u8* dest, const s16* data, const s16* qt)
+    {
+        idct2x2<12>(dest, data, qt);
+    }
+
+    void idct12_1x1(u8* dest, const s16* data, const s16* qt)
+    {
+        idct1x1<12>(dest, data, qt);
+    }
+
 #if defined(MANGO_ENABLE_SSE2)
 
     // ------------------------------------------------------------------------------------------------
@@ -499,6 +627,67 @@ namespace mango::image::jpeg
         idct_sse2_n(dest, src, q, 1, 0, 1);
     }
 
+    // Reduced 4x4 iDCT for DCT scaling (see idct4x4); one row of coefficients per register.
+
+    static inline
+    void idct4_sse2(__m128& v0, __m128& v1, __m128& v2, __m128& v3)
+    {
+        const __m128 c4 = _mm_set1_ps(0.707106781f);
+        const __m128 c2 = _mm_set1_ps(0.923879533f);
+        const __m128 c6 = _mm_set1_ps(0.382683432f);
+
+        const __m128 e0 = _mm_mul_ps(_mm_add_ps(v0, v2), c4);
+        const __m128 e1 = _mm_mul_ps(_mm_sub_ps(v0, v2), c4);
+        const __m128 o0 = _mm_add_ps(_mm_mul_ps(v1, c2), _mm_mul_ps(v3, c6));
+        const __m128 o1 = _mm_sub_ps(_mm_mul_ps(v1, c6), _mm_mul_ps(v3, c2));
+
+        v0 = _mm_add_ps(e0, o0);
+        v1 = _mm_add_ps(e1, o1);
+        v2 = _mm_sub_ps(e1, o1);
+        v3 = _mm_sub_ps(e0, o0);
+    }
+
+    static inline
+    __m128 dequantize_sse2(const s16* data, const s16* qt)
+    {
+        const __m128i c = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+        const __m128i q = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(qt));
+        const __m128i lo = _mm_mullo_epi16(c, q);
+        const __m128i hi = _mm_mulhi_epi16(c, q);
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, hi));
+    }
+
+    void idct_sse2_4x4(u8* dest, const s16* data, const s16* qt)
+    {
+        __m128 v0 = dequantize_sse2(data + 8 * 0, qt + 8 * 0);
+        __m128 v1 = dequantize_sse2(data + 8 * 1, qt + 8 * 1);
+        __m128 v2 = dequantize_sse2(data + 8 * 2, qt + 8 * 2);
+        __m128 v3 = dequantize_sse2(data + 8 * 3, qt + 8 * 3);
+
+        // columns, then rows; the transposes restore row order
+        idct4_sse2(v0, v1, v2, v3);
+        _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+        idct4_sse2(v0, v1, v2, v3);
+        _MM_TRANSPOSE4_PS(v0, v1, v2, v3);
+
+        // 1/2 normalization per pass, level shift
+        const __m128 scale = _mm_set1_ps(0.25f);
+        const __m128 bias = _mm_set1_ps(128.0f);
+
+        __m128i r0 = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(v0, scale), bias));
+        __m128i r1 = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(v1, scale), bias));
+        __m128i r2 = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(v2, scale), bias));
+        __m128i r3 = _mm_cvtps_epi32(_mm_add_ps(_mm_mul_ps(v3, scale), bias));
+
+        __m128i result = _mm_packus_epi16(_mm_packs_epi32(r0, r1), _mm_packs_epi32(r2, r3));
+
+        for (int y = 0; y < 4; ++y)
+        {
+            ustore32(dest + y * 8, _mm_cvtsi128_si32(result));
+            result = _mm_srli_si128(result, 4);
+        }
+    }
+
 #if defined(MANGO_ENABLE_AVX2)
 
     // Linear dual 8x8 iDCT: consecutive blocks in 128-bit lanes, fused dequant.
@@ -141,6 +141,7 @@ void process_cmyk_rgba(u8* dest, size_t stride, const u8* spatial, ProcessState*
         int hmax;
         int vmax;
         get_cmyk_mcu_extent(state, hmax, vmax);
+        int bs = state->block_size;
 
     u8 temp[JPEG_MAX_SAMPLES_IN_MCU * 4];
 
@@ -150,43 +151,48 @@ void process_cmyk_rgba(u8* dest, size_t stride, const u8* spatial, ProcessState*
         int offset = state->frame[channel].offset * 64;
         int hsf = state->frame[channel].hsf;
         int vsf = state->frame[channel].vsf;
+        int size = state->frame[channel].size;
+
+        // samples in the MCU for each block side, and how many times each sample is repeated
+        int xsize = (hmax / hsf) * bs;
+        int ysize = (vmax / vsf) * bs;
+        int xrep = xsize / size;
+        int yrep = ysize / size;
 
         for (int yblock = 0; yblock < vsf; ++yblock)
         {
             for (int xblock = 0; xblock < hsf; ++xblock)
             {
                 const u8* source = result + offset + (yblock * hsf + xblock) * 64;
-                u8* d = temp + channel * JPEG_MAX_SAMPLES_IN_MCU + yblock * 8 * (hmax * 8) + xblock * 8;
+                u8* d = temp + channel * JPEG_MAX_SAMPLES_IN_MCU + yblock * ysize * (hmax * bs) + xblock * xsize;
 
-                if (hmax != hsf || vmax != vsf)
+                if (xrep > 1 || yrep > 1)
                 {
-                    int xscale = hmax / hsf;
-                    int yscale = vmax / vsf;
-
-                    for (int y = 0; y < 8; ++y)
+                    for (int y = 0; y < size; ++y)
                     {
-                        for (int x = 0; x < 8; ++x)
+                        for (int x = 0; x < size; ++x)
                         {
-                            u8 sample = *source++;
-                            std::memset(d + x * xscale, sample, xscale);
+                            u8 sample = source[x];
+                            std::memset(d + x * xrep, sample, xrep);
                         }
 
-                        d += hmax * 8;
+                        source += 8;
+                        d += hmax * bs;
 
-                        for (int s = 1; s < yscale; ++s)
+                        for (int s = 1; s < yrep; ++s)
                         {
-                            std::memcpy(d, d - hmax * 8, xscale * 8);
-                            d += hmax * 8;
+                            std::memcpy(d, d - hmax * bs, xsize);
+                            d += hmax * bs;
                         }
                     }
                 }
                 else
                 {
-                    for (int y = 0; y < 8; ++y)
+                    for (int y = 0; y < size; ++y)
                     {
-                        std::memcpy(d, source, 8);
+                        std::memcpy(d, source, size);
                         source += 8;
-                        d += hmax * 8;
+                        d += hmax * bs;
                     }
                 }
             }
@@ -199,10 +205,10 @@ void process_cmyk_rgba(u8* dest, size_t stride, const u8* spatial, ProcessState*
     // second pass: resolve color
     for (int y = 0; y < height; ++y)
     {
-        u8* source0 = temp + 0 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
-        u8* source1 = temp + 1 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
-        u8* source2 = temp + 2 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
-        u8* source3 = temp + 3 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
+        u8* source0 = temp + 0 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
+        u8* source1 = temp + 1 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
+        u8* source2 = temp + 2 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
+        u8* source3 = temp + 3 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
         u32* d = reinterpret_cast<u32*>(dest + y * stride);
 
         for (int x = 0; x < width; ++x)
@@ -269,6 +275,7 @@ void process_cmyk_store_rgba(u8* dest, size_t stride, const u8* spatial, Process
         int hmax;
         int vmax;
         get_cmyk_mcu_extent(state, hmax, vmax);
+        int bs = state->block_size;
 
     u8 temp[JPEG_MAX_SAMPLES_IN_MCU * 4];
 
@@ -277,43 +284,48 @@ void process_cmyk_store_rgba(u8* dest, size_t stride, const u8* spatial, Process
         int offset = state->frame[channel].offset * 64;
         int hsf = state->frame[channel].hsf;
         int vsf = state->frame[channel].vsf;
+        int size = state->frame[channel].size;
+
+        // samples in the MCU for each block side, and how many times each sample is repeated
+        int xsize = (hmax / hsf) * bs;
+        int ysize = (vmax / vsf) * bs;
+        int xrep = xsize / size;
+        int yrep = ysize / size;
 
         for (int yblock = 0; yblock < vsf; ++yblock)
         {
             for (int xblock = 0; xblock < hsf; ++xblock)
             {
                 const u8* source = result + offset + (yblock * hsf + xblock) * 64;
-                u8* d = temp + channel * JPEG_MAX_SAMPLES_IN_MCU + yblock * 8 * (hmax * 8) + xblock * 8;
+                u8* d = temp + channel * JPEG_MAX_SAMPLES_IN_MCU + yblock * ysize * (hmax * bs) + xblock * xsize;
 
-                if (hmax != hsf || vmax != vsf)
+                if (xrep > 1 || yrep > 1)
                 {
-                    int xscale = hmax / hsf;
-                    int yscale = vmax / vsf;
-
-                    for (int y = 0; y < 8; ++y)
+                    for (int y = 0; y < size; ++y)
                     {
-                        for (int x = 0; x < 8; ++x)
+                        for (int x = 0; x < size; ++x)
                         {
-                            u8 sample = *source++;
-                            std::memset(d + x * xscale, sample, xscale);
+                            u8 sample = source[x];
+                            std::memset(d + x * xrep, sample, xrep);
                         }
 
-                        d += hmax * 8;
+                        source += 8;
+                        d += hmax * bs;
 
-                        for (int s = 1; s < yscale; ++s)
+                        for (int s = 1; s < yrep; ++s)
                         {
-                            std::memcpy(d, d - hmax * 8, xscale * 8);
-                            d += hmax * 8;
+                            std::memcpy(d, d - hmax * bs, xsize);
+                            d += hmax * bs;
                         }
                     }
                 }
                 else
                 {
-                    for (int y = 0; y < 8; ++y)
+                    for (int y = 0; y < size; ++y)
                     {
-                        std::memcpy(d, source, 8);
+                        std::memcpy(d, source, size);
                         source += 8;
-                        d += hmax * 8;
+                        d += hmax * bs;
                     }
                 }
             }
@@ -324,10 +336,10 @@ void process_cmyk_store_rgba(u8* dest, size_t stride, const u8* spatial, Process
 
     for (int y = 0; y < height; ++y)
     {
-        u8* source0 = temp + 0 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
-        u8* source1 = temp + 1 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
-        u8* source2 = temp + 2 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
-        u8* source3 = temp + 3 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
+        u8* source0 = temp + 0 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
+        u8* source1 = temp + 1 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
+        u8* source2 = temp + 2 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
+        u8* source3 = temp + 3 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
         u32* d = reinterpret_cast<u32*>(dest + y * stride);
 
         for (int x = 0; x < width; ++x)
@@ -491,19 +503,21 @@ void process_ycbcr_8bit(u8* dest, size_t stride, const u8* spatial, ProcessState
         dest = origin + m * xstride;
         const u8* result = spatial + m * state->spatialMCUBytes();
 
+        const int bs = state->block_size;
+
         // MCU size in blocks
-        int xsize = (width + 7) / 8;
-        int ysize = (height + 7) / 8;
+        int xsize = (width + bs - 1) / bs;
+        int ysize = (height + bs - 1) / bs;
 
         for (int yb = 0; yb < ysize; ++yb)
         {
-            const int ymax = std::min(8, height - yb * 8);
+            const int ymax = std::min(bs, height - yb * bs);
 
             for (int xb = 0; xb < xsize; ++xb)
             {
-                u8* dest_block = dest + yb * 8 * stride + xb * 8 * sizeof(u8);
+                u8* dest_block = dest + yb * bs * stride + xb * bs * sizeof(u8);
                 const u8* y_block = result + (yb * xsize + xb) * 64;
-                const int xmax = std::min(8, width - xb * 8);
+                const int xmax = std::min(bs, width - xb * bs);
 
                 for (int y = 0; y < ymax; ++y)
                 {
@@ -531,12 +545,12 @@ void process_rgb_bgr(u8* dest, size_t stride, const u8* spatial, ProcessState* s
         dest = origin + m * xstride;
         const u8* result = spatial + m * state->spatialMCUBytes();
 
-        for (int y = 0; y < 8; ++y)
+        for (int y = 0; y < height; ++y)
         {
             u8* d = dest + y * stride;
             const u8* s = result + y * 8;
 
-            for (int x = 0; x < 8; ++x)
+            for (int x = 0; x < width; ++x)
             {
                 u8 r = s[x];
                 u8 g = s[x + 64];
@@ -547,10 +561,6 @@ void process_rgb_bgr(u8* dest, size_t stride, const u8* spatial, ProcessState* s
             }
         }
     }
-
-    MANGO_UNREFERENCED(state);
-    MANGO_UNREFERENCED(width);
-    MANGO_UNREFERENCED(height);
 }
 
 void process_rgb_rgb(u8* dest, size_t stride, const u8* spatial, ProcessState* state, int width, int height, int count, size_t xstride)
@@ -562,12 +572,12 @@ void process_rgb_rgb(u8* dest, size_t stride, const u8* spatial, ProcessState* s
         dest = origin + m * xstride;
         const u8* result = spatial + m * state->spatialMCUBytes();
 
-        for (int y = 0; y < 8; ++y)
+        for (int y = 0; y < height; ++y)
         {
             u8* d = dest + y * stride;
             const u8* s = result + y * 8;
 
-            for (int x = 0; x < 8; ++x)
+            for (int x = 0; x < width; ++x)
             {
                 u8 r = s[x];
                 u8 g = s[x + 64];
@@ -580,8 +590,6 @@ void process_rgb_rgb(u8* dest, size_t stride, const u8* spatial, ProcessState* s
     }
 
     MANGO_UNREFERENCED(state);
-    MANGO_UNREFERENCED(width);
-    MANGO_UNREFERENCED(height);
 }
 
 void process_rgb_bgra(u8* dest, size_t stride, const u8* spatial, ProcessState* state, int width, int height, int count, size_t xstride)
@@ -593,12 +601,12 @@ void process_rgb_bgra(u8* dest, size_t stride, const u8* spatial, ProcessState*
         dest = origin + m * xstride;
         const u8* result = spatial + m * state->spatialMCUBytes();
 
-        for (int y = 0; y < 8; ++y)
+        for (int y = 0; y < height; ++y)
         {
             u8* d = dest + y * stride;
             const u8* s = result + y * 8;
 
-            for (int x = 0; x < 8; ++x)
+            for (int x = 0; x < width; ++x)
             {
                 u8 r = s[x];
                 u8 g = s[x + 64];
@@ -612,8 +620,6 @@ void process_rgb_bgra(u8* dest, size_t stride, const u8* spatial, ProcessState*
     }
 
     MANGO_UNREFERENCED(state);
-    MANGO_UNREFERENCED(width);
-    MANGO_UNREFERENCED(height);
 }
 
 void process_rgb_rgba(u8* dest, size_t stride, const u8* spatial, ProcessState* state, int width, int height, int count, size_t xstride)
@@ -625,12 +631,12 @@ void process_rgb_rgba(u8* dest, size_t stride, const u8* spatial, ProcessState*
         dest = origin + m * xstride;
         const u8* result = spatial + m * state->spatialMCUBytes();
 
-        for (int y = 0; y < 8; ++y)
+        for (int y = 0; y < height; ++y)
         {
             u8* d = dest + y * stride;
             const u8* s = result + y * 8;
 
-            for (int x = 0; x < 8; ++x)
+            for (int x = 0; x < width; ++x)
             {
                 u8 r = s[x];
                 u8 g = s[x + 64];
@@ -644,8 +650,6 @@ void process_rgb_rgba(u8* dest, size_t stride, const u8* spatial, ProcessState*
     }
 
     MANGO_UNREFERENCED(state);
-    MANGO_UNREFERENCED(width);
-    MANGO_UNREFERENCED(height);
 }
 
 // ------------------------------------------------------------------------------------------------
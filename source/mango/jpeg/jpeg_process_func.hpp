@@ -9,6 +9,7 @@ void FUNCTION_GENERIC(u8* dest, size_t stride, const u8* spatial, ProcessState*
 {
     int hmax = std::max(std::max(state->frame[0].hsf, state->frame[1].hsf), state->frame[2].hsf);
     int vmax = std::max(std::max(state->frame[0].vsf, state->frame[1].vsf), state->frame[2].vsf);
+    int bs = state->block_size;
 
     u8* origin = dest;
 
@@ -25,43 +26,48 @@ void FUNCTION_GENERIC(u8* dest, size_t stride, const u8* spatial, ProcessState*
             int offset = state->frame[channel].offset * 64;
             int hsf = state->frame[channel].hsf;
             int vsf = state->frame[channel].vsf;
+            int size = state->frame[channel].size;
+
+            // samples in the MCU for each block side, and how many times each sample is repeated
+            int xsize = (hmax / hsf) * bs;
+            int ysize = (vmax / vsf) * bs;
+            int xrep = xsize / size;
+            int yrep = ysize / size;
 
             for (int yblock = 0; yblock < vsf; ++yblock)
             {
                 for (int xblock = 0; xblock < hsf; ++xblock)
                 {
                     const u8* source = result + offset + (yblock * hsf + xblock) * 64;
-                    u8* d = temp + channel * JPEG_MAX_SAMPLES_IN_MCU + yblock * 8 * (hmax * 8) + xblock * 8;
+                    u8* d = temp + channel * JPEG_MAX_SAMPLES_IN_MCU + yblock * ysize * (hmax * bs) + xblock * xsize;
 
-                    if (hmax != hsf || vmax != vsf)
+                    if (xrep > 1 || yrep > 1)
                     {
-                        int xscale = hmax / hsf;
-                        int yscale = vmax / vsf;
-
-                        for (int y = 0; y < 8; ++y)
+                        for (int y = 0; y < size; ++y)
                         {
-                            for (int x = 0; x < 8; ++x)
+                            for (int x = 0; x < size; ++x)
                             {
-                                u8 sample = *source++;
-                                std::memset(d + x * xscale, sample, xscale);
+                                u8 sample = source[x];
+                                std::memset(d + x * xrep, sample, xrep);
                             }
 
-                            d += hmax * 8;
+                            source += 8;
+                            d += hmax * bs;
 
-                            for (int s = 1; s < yscale; ++s)
+                            for (int s = 1; s < yrep; ++s)
                             {
-                                std::memcpy(d, d - hmax * 8, xscale * 8);
-                                d += hmax * 8;
+                                std::memcpy(d, d - hmax * bs, xsize);
+                                d += hmax * bs;
                             }
                         }
                     }
                     else
                     {
-                        for (int y = 0; y < 8; ++y)
+                        for (int y = 0; y < size; ++y)
                         {
-                            std::memcpy(d, source, 8);
+                            std::memcpy(d, source, size);
                             source += 8;
-                            d += hmax * 8;
+                            d += hmax * bs;
                         }
                     }
                 }
@@ -71,9 +77,9 @@ void FUNCTION_GENERIC(u8* dest, size_t stride, const u8* spatial, ProcessState*
         // second pass: resolve color
         for (int y = 0; y < height; ++y)
         {
-            u8* source0 = temp + 0 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
-            u8* source1 = temp + 1 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
-            u8* source2 = temp + 2 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * 8);
+            u8* source0 = temp + 0 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
+            u8* source1 = temp + 1 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
+            u8* source2 = temp + 2 * JPEG_MAX_SAMPLES_IN_MCU + (y * hmax * bs);
             u8* d = dest + y * stride;
 
             for (int x = 0; x < width; ++x)
@@ -192,6 +192,153 @@ namespace
         return true;
     }
 
+    // BufferedStream over a MemoryStream which counts the unbuffered calls
+    class CountingStream : public BufferedStream
+    {
+    public:
+        MemoryStream m_stream;
+        int m_reads = 0;
+        int m_writes = 0;
+
+        CountingStream(size_t buffer_size)
+            : BufferedStream(buffer_size)
+        {
+        }
+
+        ~CountingStream()
+        {
+            flush();
+        }
+
+    protected:
+        u64 unbufferedSize() const override
+        {
+            return m_stream.size();
+        }
+
+        u64 unbufferedOffset() const override
+        {
+            return m_stream.offset();
+        }
+
+        u64 unbufferedSeek(s64 distance, SeekMode mode) override
+        {
+            return m_stream.seek(distance, mode);
+        }
+
+        u64 unbufferedRead(void* dest, u64 bytes) override
+        {
+            ++m_reads;
+            return m_stream.read(dest, bytes);
+        }
+
+        u64 unbufferedWrite(const void* data, u64 bytes) override
+        {
+            ++m_writes;
+            return m_stream.write(data, bytes);
+        }
+    };
+
+    bool test_buffered_stream_write()
+    {
+        CountingStream stream(64);
+        LittleEndianStream s(stream);
+
+        for (u32 i = 0; i < 100; ++i)
+        {
+            s.write32(i);
+        }
+
+        CHECK(stream.offset() == 400);
+        CHECK(stream.size() == 400);
+        CHECK(stream.m_writes == 6);
+
+        // large writes bypass the buffer
+        u8 block[256] = {};
+        stream.write(block, sizeof(block));
+        CHECK(stream.offset() == 656);
+
+        CHECK(stream.flush());
+        CHECK(stream.m_stream.size() == 656);
+
+        const u8* data = stream.m_stream.data();
+        for (u32 i = 0; i < 100; ++i)
+        {
+            CHECK(littleEndian::uload32(data + i * 4) == i);
+        }
+
+        return true;
+    }
+
+    bool test_buffered_stream_read_seek()
+    {
+        CountingStream stream(64);
+
+        for (u32 i = 0; i < 256; ++i)
+        {
+            u8 value = u8(i);
+            stream.write(&value, 1);
+        }
+
+        stream.seek(0, Stream::SeekMode::Begin);
+        stream.m_reads = 0;
+
+        LittleEndianStream s(stream);
+
+        CHECK(s.read8() == 0);
+        CHECK(s.read8() == 1);
+        CHECK(stream.offset() == 2);
+
+        // relative seeks inside the buffer don't read again
+        stream.seek(10, Stream::SeekMode::Current);
+        CHECK(stream.offset() == 12);
+        CHECK(s.read8() == 12);
+        stream.seek(-13, Stream::SeekMode::Current);
+        CHECK(s.read8() == 0);
+        CHECK(stream.m_reads == 1);
+
+        // relative seek past the buffer
+        stream.seek(99, Stream::SeekMode::Current);
+        CHECK(stream.offset() == 100);
+        CHECK(s.read8() == 100);
+
+        stream.seek(-1, Stream::SeekMode::End);
+        CHECK(s.read8() == 255);
+
+        u8 tail[4];
+        CHECK(stream.read(tail, sizeof(tail)) == 0);
+
+        // writing after reading continues at the logical offset
+        stream.seek(4, Stream::SeekMode::Begin);
+        CHECK(s.read8() == 4);
+        s.write8(0xaa);
+        CHECK(stream.offset() == 6);
+        CHECK(s.read8() == 6);
+
+        CHECK(stream.flush());
+        CHECK(stream.m_stream.size() == 256);
+        CHECK(stream.m_stream.data()[5] == 0xaa);
+        CHECK(stream.m_stream.data()[6] == 6);
+
+        return true;
+    }
+
+    bool test_buffered_stream_unbuffered()
+    {
+        CountingStream stream(0);
+        LittleEndianStream s(stream);
+
+        s.write16(0x1234);
+        s.write16(0x5678);
+        CHECK(stream.m_writes == 2);
+
+        stream.seek(0, Stream::SeekMode::Begin);
+        CHECK(s.read32() == 0x56781234);
+        CHECK(stream.m_reads == 1);
+
+        return true;
+    }
+
     const Case g_cases [] =
     {
         { "buffer_append_growth",         test_buffer_append_and_growth },
@@ -201,6 +348,9 @@ namespace
         { "memory_stream_write_past_end", test_memory_stream_write_past_end },
         { "const_memory_stream_read_only", test_const_memory_stream_is_read_only },
         { "buffer_stream_roundtrip",      test_buffer_stream_roundtrip },
+        { "buffered_stream_write",        test_buffered_stream_write },
+        { "buffered_stream_read_seek",    test_buffered_stream_read_seek },
+        { "buffered_stream_unbuffered",   test_buffered_stream_unbuffered },
     };
 
 } // namespace
@@ -264,6 +264,7 @@ namespace
             CHECK(compressor.bound != nullptr);
             CHECK(compressor.compress != nullptr);
             CHECK(compressor.decompress != nullptr);
+            CHECK(compressor.createContext != nullptr);
         }
 
         Compressor zlib = getCompressor(Compressor::ZLIB);
@@ -450,6 +451,242 @@ namespace
         return true;
     }
 
+    bool context_roundtrip(const std::shared_ptr<CompressionContext>& context, size_t (*bound_fn)(size_t))
+    {
+        CHECK(context != nullptr);
+
+        // many small blocks and a level change through the same context
+        for (int i = 0; i < 16; ++i)
+        {
+            Buffer source(256 + i * 97);
+            fill_pattern(source);
+            source[0] = u8(i);
+
+            int level = i < 8 ? 4 : 9;
+
+            Buffer compressed(bound_fn(source.size()));
+            CompressionStatus encoded = context->compress(compressed, source, level);
+            CHECK(encoded);
+            CHECK(encoded.size > 0);
+
+            Buffer output(source.size());
+            CompressionStatus decoded = context->decompress(output, Memory(compressed, encoded.size));
+            CHECK(decoded);
+            CHECK(decoded.size == source.size());
+            CHECK(mem_equal(source, output));
+        }
+
+        return true;
+    }
+
+    bool test_context_roundtrip()
+    {
+        CHECK(context_roundtrip(zstd::createContext(), zstd::bound));
+        CHECK(context_roundtrip(deflate::createContext(), deflate::bound));
+        CHECK(context_roundtrip(deflate_zlib::createContext(), deflate_zlib::bound));
+        CHECK(context_roundtrip(deflate_gzip::createContext(), deflate_gzip::bound));
+
+        for (const Compressor& compressor : getCompressors())
+        {
+            CHECK(context_roundtrip(compressor.createContext(), compressor.bound));
+        }
+
+        return true;
+    }
+
+    bool test_context_compatible()
+    {
+        // blocks compressed with a context decompress with the stateless functions
+        Buffer source(4096);
+        fill_pattern(source);
+
+        auto context = deflate_zlib::createContext();
+
+        Buffer compressed(deflate_zlib::bound(source.size()));
+        CompressionStatus encoded = context->compress(compressed, source, 6);
+        CHECK(encoded);
+
+        Buffer output(source.size());
+        CompressionStatus decoded = deflate_zlib::decompress(output, Memory(compressed, encoded.size));
+        CHECK(decoded);
+        CHECK(mem_equal(source, output));
+
+        // the gzip wrapper must not leak into the thread-local zlib state
+        Buffer gzip(deflate_gzip::bound(source.size()));
+        CHECK(deflate_gzip::compress(gzip, source, 6));
+
+        CompressionStatus again = deflate_zlib::compress(gzip, source, 6);
+        CHECK(again);
+        CHECK(again.size == encoded.size);
+        CHECK(std::memcmp(gzip.data(), compressed.data(), again.size) == 0);
+
+        return true;
+    }
+
+    bool test_zstd_seekable_roundtrip()
+    {
+        const size_t frame_size = 1000;
+
+        Buffer source(frame_size * 7 + 123);
+        fill_pattern(source);
+
+        Buffer compressed(zstd::bound_seekable(source.size(), frame_size));
+        CompressionStatus encoded = zstd::compress_seekable(compressed, source, 4, frame_size);
+        CHECK(encoded);
+
+        Buffer output(source.size());
+        CompressionStatus decoded = zstd::decompress_seekable(output, Memory(compressed, encoded.size));
+        CHECK(decoded);
+        CHECK(decoded.size == source.size());
+        CHECK(mem_equal(source, output));
+
+        // the seekable format is a valid zstd stream
+        Buffer output2(source.size());
+        decoded = zstd::decompress(output2, Memory(compressed, encoded.size));
+        CHECK(decoded);
+        CHECK(mem_equal(source, output2));
+
+        // an oversized destination is accepted like with the other decompressors
+        Buffer output3(source.size() + 1000);
+        decoded = zstd::decompress_seekable(output3, Memory(compressed, encoded.size));
+        CHECK(decoded);
+        CHECK(decoded.size == source.size());
+        CHECK(std::memcmp(output3.data(), source.data(), source.size()) == 0);
+
+        return true;
+    }
+
+    bool test_zstd_seekable_random_access()
+    {
+        const size_t frame_size = 512;
+
+        Buffer source(frame_size * 9 + 17);
+        fill_pattern(source);
+
+        Buffer compressed(zstd::bound_seekable(source.size(), frame_size));
+        CompressionStatus encoded = zstd::compress_seekable(compressed, source, 4, frame_size);
+        CHECK(encoded);
+
+        zstd::SeekableDecoder decoder(ConstMemory(compressed, encoded.size));
+        CHECK(decoder.isSeekable());
+        CHECK(decoder.size() == source.size());
+
+        const size_t ranges [][2] =
+        {
+            { 0, 1 },
+            { 0, frame_size },
+            { frame_size - 1, 2 },
+            { 700, 3000 },
+            { source.size() - 5, 5 },
+            { source.size(), 0 },
+        };
+
+        for (auto range : ranges)
+        {
+            Buffer output(range[1]);
+            CompressionStatus status = decoder.read(output, range[0]);
+            CHECK(status);
+            CHECK(std::memcmp(output.data(), source.data() + range[0], range[1]) == 0);
+        }
+
+        Buffer output(2);
+        CHECK(!decoder.read(output, source.size() - 1));
+
+        // the frame sizes in the seek table must agree with the frame headers
+        Buffer tampered(compressed, encoded.size);
+        LittleEndianPointer p = tampered.data() + encoded.size - 9 - 10 * 8 + 4;
+        p.write32(0x7fffffff);
+
+        zstd::SeekableDecoder broken(tampered);
+        CHECK(broken.isSeekable());
+        CHECK(!broken.read(output, 0));
+
+        return true;
+    }
+
+    bool test_zstd_seekable_plain_stream()
+    {
+        Buffer source(4096);
+        fill_pattern(source);
+
+        Buffer compressed(zstd::bound(source.size()));
+        CompressionStatus encoded = zstd::compress(compressed, source, 4);
+        CHECK(encoded);
+
+        zstd::SeekableDecoder decoder(ConstMemory(compressed, encoded.size));
+        CHECK(!decoder.isSeekable());
+
+        Buffer output(source.size());
+        CompressionStatus decoded = zstd::decompress_seekable(output, Memory(compressed, encoded.size));
+        CHECK(decoded);
+        CHECK(mem_equal(source, output));
+
+        // a small plain frame has the same size as an empty seek table
+        Buffer small(8);
+        fill_pattern(small);
+
+        encoded = zstd::compress(compressed, small, 4);
+        CHECK(encoded);
+        CHECK(encoded.size == 17);
+
+        zstd::SeekableDecoder small_decoder(ConstMemory(compressed, encoded.size));
+        CHECK(!small_decoder.isSeekable());
+
+        Buffer small_output(small.size());
+        decoded = zstd::decompress_seekable(small_output, Memory(compressed, encoded.size));
+        CHECK(decoded);
+        CHECK(mem_equal(small, small_output));
+
+        return true;
+    }
+
+    bool test_zstd_dictionary_roundtrip()
+    {
+        // many small records which share structure
+        Buffer samples;
+        std::vector<size_t> sample_sizes;
+
+        for (int i = 0; i < 400; ++i)
+        {
+            std::string text = fmt::format("{{ \"name\": \"object{}\", \"position\": [{}, {}, {}], "
+                                           "\"material\": \"material{}\", \"visible\": {} }}",
+                                           i, i * 3, i * 7 % 113, i * 11 % 37, i % 5, i & 1 ? "true" : "false");
+            samples.append(text.data(), text.length());
+            sample_sizes.push_back(text.length());
+        }
+
+        Buffer buffer(4096);
+        CompressionStatus trained = zstd::train(buffer, samples, sample_sizes);
+        CHECK(trained);
+        CHECK(trained.size > 0 && trained.size <= buffer.size());
+
+        zstd::Dictionary dictionary(ConstMemory(buffer, trained.size), 4);
+        CHECK(dictionary.memory().size == trained.size);
+
+        const u8* sample = samples.data();
+
+        for (size_t size : sample_sizes)
+        {
+            ConstMemory source(sample, size);
+            sample += size;
+
+            Buffer compressed(zstd::bound(size));
+            CompressionStatus encoded = dictionary.compress(compressed, source);
+            CHECK(encoded);
+
+            Buffer output(size);
+            CompressionStatus decoded = dictionary.decompress(output, Memory(compressed, encoded.size));
+            CHECK(decoded);
+            CHECK(decoded.size == size);
+            CHECK(mem_equal(source, output));
+
+            // the frame cannot be decoded without the dictionary
+            CHECK(!zstd::decompress(output, Memory(compressed, encoded.size)));
+        }
+
+        return true;
+    }
+
     bool test_corrupt_input_fails()
     {
         Buffer source(256);
@@ -521,6 +758,12 @@ namespace
         { "tiny roundtrip", test_tiny_roundtrip },
         { "compression levels", test_compression_levels },
         { "corrupt input fails", test_corrupt_input_fails },
+        { "context roundtrip", test_context_roundtrip },
+        { "context compatible", test_context_compatible },
+        { "zstd seekable roundtrip", test_zstd_seekable_roundtrip },
+        { "zstd seekable random access", test_zstd_seekable_random_access },
+        { "zstd seekable plain stream", test_zstd_seekable_plain_stream },
+        { "zstd dictionary roundtrip", test_zstd_dictionary_roundtrip },
 #if defined(MANGO_ENABLE_LZ4)
         { "lz4 roundtrip", test_lz4_roundtrip },
         { "lz4 stream chunks", test_lz4_stream_chunks },
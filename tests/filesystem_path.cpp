@@ -4,6 +4,9 @@
 */
 #include "core_test.hpp"
 
+#include <chrono>
+#include <cstring>
+#include <filesystem>
 #include <vector>
 
 using namespace mango;
@@ -26,6 +29,173 @@ namespace
         return false;
     }
 
+    // name, size and contents of every file in the path and its folders
+    void listEntries(const Path& path, std::vector<std::string>& entries)
+    {
+        for (const FileInfo& info : path)
+        {
+            if (info.isDirectory())
+            {
+                Path folder(path, info.name);
+                listEntries(folder, entries);
+            }
+            else
+            {
+                File file(path, info.name);
+                entries.push_back(fmt::format("{}{} {} {:08x}", path.pathname(), info.name,
+                    info.size, crc32c(0, file)));
+            }
+        }
+    }
+
+    std::vector<std::string> listArchive(const std::string& pathname, const std::string& password)
+    {
+        Path path(pathname, password);
+
+        std::vector<std::string> entries;
+        listEntries(path, entries);
+        return entries;
+    }
+
+    bool checkIndexCache(const std::string& folder, const std::string& pathname, const std::string& password)
+    {
+        std::filesystem::remove_all(folder);
+
+        // cold cache: parse the archive and store the index
+        const std::vector<std::string> cold = listArchive(pathname, password);
+        CHECK(!cold.empty());
+
+        std::vector<std::filesystem::path> files;
+        for (const auto& entry : std::filesystem::directory_iterator(folder))
+        {
+            files.push_back(entry.path());
+        }
+
+        CHECK(files.size() == 1);
+        const std::string cachename = files[0].string();
+
+        // warm cache: the cache file is used as it is, not stored again
+        const auto stamp = std::filesystem::last_write_time(cachename) - std::chrono::hours(1);
+        std::filesystem::last_write_time(cachename, stamp);
+
+        CHECK(listArchive(pathname, password) == cold);
+        CHECK(std::filesystem::last_write_time(cachename) == stamp);
+
+        Buffer original;
+        {
+            File file(cachename);
+            original.append(file.data(), file.size());
+        }
+        CHECK(original.size() > 0);
+
+        // damaged cache: the index is parsed from the archive again
+        for (size_t i = 0; i < 64; ++i)
+        {
+            const size_t offset = i * original.size() / 64;
+
+            Buffer damaged(original.data(), original.size());
+            damaged.data()[offset] ^= 0x5a;
+
+            {
+                OutputFileStream file(cachename);
+                file.write(damaged.data(), damaged.size());
+            }
+
+            CHECK(listArchive(pathname, password) == cold);
+        }
+
+        return true;
+    }
+
+    // Damage an array of the cached index and recompute the payload checksum so that
+    // the damage gets past the cache file validation. The payload follows two arrays,
+    // the cache header and the key; index is counted from the start of the payload.
+    void damageCacheArray(Buffer& buffer, size_t index)
+    {
+        auto align = [] (u64 offset)
+        {
+            return (offset + 15) & ~u64(15);
+        };
+
+        u64 key_length;
+        std::memcpy(&key_length, buffer.data() + 48, 8);
+
+        const u64 payload = 48 + align(16 + key_length);
+        u64 offset = payload;
+
+        for (size_t i = 0; offset + 16 <= buffer.size(); ++i)
+        {
+            u64 header[2];
+            std::memcpy(header, buffer.data() + offset, 16);
+
+            if (i == index)
+            {
+                // the first element is out of range in every field
+                std::memset(buffer.data() + offset + 16, 0xff, size_t(std::min(header[0], u64(1)) * header[1]));
+                break;
+            }
+
+            offset = align(offset + 16 + header[0] * header[1]);
+        }
+
+        const u64 checksum = xx3hash64(0, ConstMemory(buffer.data() + payload, size_t(buffer.size() - payload)));
+        std::memcpy(buffer.data() + 32, &checksum, 8);
+    }
+
+    // The cache file checksum is valid but the headers or the records of the index are not;
+    // index is the position of the indexer's arrays in the cached payload.
+    bool checkIndexCacheValidation(const std::string& folder, const std::string& pathname, const std::string& password, size_t index)
+    {
+        std::filesystem::remove_all(folder);
+
+        const std::vector<std::string> cold = listArchive(pathname, password);
+        CHECK(!cold.empty());
+
+        const std::string cachename = std::filesystem::directory_iterator(folder)->path().string();
+
+        Buffer original;
+        {
+            File file(cachename);
+            original.append(file.data(), file.size());
+        }
+
+        // Indexer::save() writes the arena, headers, records, ranges and the two tables
+        for (size_t array = 1; array < 6; ++array)
+        {
+            Buffer damaged(original.data(), original.size());
+            damageCacheArray(damaged, index + array);
+
+            {
+                OutputFileStream file(cachename);
+                file.write(damaged.data(), damaged.size());
+            }
+
+            CHECK(listArchive(pathname, password) == cold);
+        }
+
+        return true;
+    }
+
+    bool test_index_cache_fallback()
+    {
+        const std::string folder = "index_cache.tmp/";
+        setIndexCacheFolder(folder);
+
+        bool status = checkIndexCache(folder, "data/ziptest/deflate.zip/", "") &&
+                      checkIndexCache(folder, "data/ziptest/aes128.zip/", "secret1234") &&
+                      checkIndexCache(folder, "data/ziptest/ppmd.7z/", "") &&
+                      checkIndexCache(folder, "data/ziptest/normal.rar/", "") &&
+                      checkIndexCache(folder, "data/pathtest/kokopaska.zip/", "") &&
+                      checkIndexCacheValidation(folder, "data/ziptest/deflate.zip/", "", 0) &&
+                      checkIndexCacheValidation(folder, "data/pathtest/kokopaska.zip/", "", 0) &&
+                      checkIndexCacheValidation(folder, "data/ziptest/ppmd.7z/", "", 1);
+
+        setIndexCacheFolder("");
+        std::filesystem::remove_all(folder);
+
+        return status;
+    }
+
     bool test_copy_same_pathname()
     {
         Path original("data/pathtest/foo/");
@@ -187,6 +357,73 @@ namespace
         return true;
     }
 
+    bool test_file_map_hints()
+    {
+        const u32 hints [] =
+        {
+            MapHint::Sequential,
+            MapHint::Random,
+            MapHint::WillNeed,
+            MapHint::HugePages,
+            MapHint::WillNeed | MapHint::HugePages,
+            MapHint::ReadSmall,
+            MapHint::ReadSmall | MapHint::Sequential,
+        };
+
+        Path path("data/pathtest/");
+        File original(path, "kokopaska.zip");
+
+        for (u32 hint : hints)
+        {
+            File file(path, "kokopaska.zip", hint);
+            CHECK(file.size() == original.size());
+            CHECK(crc32c(0, file) == crc32c(0, original));
+        }
+
+        // the hints are ignored inside containers
+        File file(path, "kokopaska.zip/test/flower1.jpg", MapHint::ReadSmall | MapHint::Random);
+        File stored(path, "kokopaska.zip/test/flower1.jpg");
+        CHECK(crc32c(0, file) == crc32c(0, stored));
+
+        return true;
+    }
+
+    bool test_file_read_small()
+    {
+        File mapped("data/pathtest/foo/test.data");
+        File copied("data/pathtest/foo/test.data", MapHint::ReadSmall);
+
+        CHECK(copied.size() == mapped.size());
+        CHECK(copied.size() <= MapHint::small_file_size);
+        CHECK(copied.data() != mapped.data());
+        CHECK(crc32c(0, copied) == 0x149cd379u);
+
+        return true;
+    }
+
+    bool test_file_stream_close()
+    {
+        const std::string filename = "file_stream_close.tmp";
+        const char text[] = "buffered until close";
+
+        {
+            OutputFileStream file(filename);
+            file.write(text, sizeof(text));
+            CHECK(file.close());
+            CHECK(file.close());
+        }
+
+        bool status;
+        {
+            File file(filename);
+            status = file.size() == sizeof(text) &&
+                     !std::memcmp(file.data(), text, sizeof(text));
+        }
+
+        std::filesystem::remove(filename);
+        return status;
+    }
+
     const Case cases[] =
     {
         { "copy_same_pathname", test_copy_same_pathname },
@@ -200,6 +437,10 @@ namespace
         { "fresh_string_still_independent", test_fresh_string_still_independent },
         { "zip_logical_subfolder_index", test_zip_logical_subfolder_index },
         { "empty_child_path_shares_mapper", test_empty_child_path_shares_mapper },
+        { "file_map_hints", test_file_map_hints },
+        { "file_read_small", test_file_read_small },
+        { "index_cache_fallback", test_index_cache_fallback },
+        { "file_stream_close", test_file_stream_close },
     };
 
 } // namespace
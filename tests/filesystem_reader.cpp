@@ -0,0 +1,180 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include "core_test.hpp"
+
+#include <mutex>
+#include <vector>
+
+using namespace mango;
+using namespace mango::filesystem;
+using mango::test::Case;
+using mango::test::run_cases;
+
+#define CHECK CORE_CHECK
+
+namespace
+{
+
+    const char* g_files [] =
+    {
+        "data/ziptest/deflate.zip",
+        "data/ziptest/lzma.7z",
+        "data/ziptest/normal.rar",
+        "data/ziptest/test.hbs",
+    };
+
+    bool test_whole_files(bool uring)
+    {
+        AsyncFileReader reader(4, uring);
+
+        std::vector<FileReadRequest> requests;
+        for (const char* filename : g_files)
+        {
+            requests.push_back({ filename });
+        }
+
+        std::mutex mutex;
+        std::vector<FileReadResult> results;
+
+        reader.read(requests, [&] (FileReadResult result)
+        {
+            std::lock_guard lock(mutex);
+            results.push_back(std::move(result));
+        });
+
+        CHECK(reader.wait() == 0);
+        CHECK(results.size() == requests.size());
+
+        for (const FileReadResult& result : results)
+        {
+            File file(g_files[result.index]);
+
+            CHECK(result.status);
+            CHECK(result.buffer != nullptr);
+            CHECK(result.memory.size == file.size());
+            CHECK(std::memcmp(result.memory.address, file.data(), file.size()) == 0);
+        }
+
+        return true;
+    }
+
+    bool test_ranges(bool uring)
+    {
+        AsyncFileReader reader(8, uring);
+
+        File file(g_files[0]);
+        const size_t size = file.size();
+
+        // more requests than the queue depth into one caller buffer
+        Buffer buffer(size);
+        std::vector<FileReadRequest> requests;
+
+        for (size_t offset = 0; offset < size; offset += 97)
+        {
+            const size_t bytes = std::min(size_t(97), size - offset);
+            requests.push_back({ g_files[0], offset, bytes, buffer.data() + offset });
+        }
+
+        reader.read(requests);
+        CHECK(reader.wait() == 0);
+        CHECK(std::memcmp(buffer.data(), file.data(), size) == 0);
+
+        return true;
+    }
+
+    bool test_errors(bool uring)
+    {
+        AsyncFileReader reader(4, uring);
+
+        File file(g_files[1]);
+        const size_t size = file.size();
+
+        Buffer buffer(16);
+
+        std::vector<FileReadRequest> requests;
+        requests.push_back({ "data/ziptest/missing.zip" });
+        requests.push_back({ g_files[1], size - 10, 100 });
+        requests.push_back({ g_files[1], size + 10 });
+        requests.push_back({ g_files[1], 0, 0, buffer.data() });
+        requests.push_back({ g_files[1], 0, 1ull << 62 });
+
+        std::vector<FileReadResult> results(requests.size());
+
+        reader.read(requests, [&] (FileReadResult result)
+        {
+            size_t index = result.index;
+            results[index] = std::move(result);
+        });
+
+        CHECK(reader.wait() == 3);
+
+        CHECK(!results[0].status);
+
+        // short read at the end of the file
+        CHECK(results[1].status);
+        CHECK(results[1].memory.size == 10);
+        CHECK(std::memcmp(results[1].memory.address, file.data() + size - 10, 10) == 0);
+
+        // nothing to read past the end of the file
+        CHECK(results[2].status);
+        CHECK(results[2].memory.size == 0);
+
+        // a whole file read into a caller buffer of unknown capacity is rejected
+        CHECK(!results[3].status);
+
+        // a buffer which can't be allocated fails the request instead of the process
+        CHECK(!results[4].status);
+        CHECK(results[4].buffer == nullptr);
+
+        return true;
+    }
+
+    bool test_uring_whole_files()
+    {
+        return test_whole_files(true);
+    }
+
+    bool test_uring_ranges()
+    {
+        return test_ranges(true);
+    }
+
+    bool test_uring_errors()
+    {
+        return test_errors(true);
+    }
+
+    bool test_threads_whole_files()
+    {
+        return test_whole_files(false);
+    }
+
+    bool test_threads_ranges()
+    {
+        return test_ranges(false);
+    }
+
+    bool test_threads_errors()
+    {
+        return test_errors(false);
+    }
+
+    const Case g_cases [] =
+    {
+        { "uring_whole_files", test_uring_whole_files },
+        { "uring_ranges", test_uring_ranges },
+        { "uring_errors", test_uring_errors },
+        { "threads_whole_files", test_threads_whole_files },
+        { "threads_ranges", test_threads_ranges },
+        { "threads_errors", test_threads_errors },
+    };
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    printLine("AsyncFileReader backend: {}", AsyncFileReader().backend());
+    return run_cases("filesystem_reader", g_cases, sizeof(g_cases) / sizeof(g_cases[0]), argc, argv);
+}
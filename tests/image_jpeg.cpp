@@ -0,0 +1,130 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include "core_test.hpp"
+
+#include <cmath>
+
+using namespace mango;
+using namespace mango::image;
+using mango::test::Case;
+using mango::test::run_cases;
+
+#define CHECK CORE_CHECK
+
+namespace
+{
+
+    const Format g_rgba8(32, Format::UNORM, Format::RGBA, 8, 8, 8, 8);
+
+    // smooth luminance with colors which change every few MCUs
+    void fillPattern(Bitmap& bitmap)
+    {
+        for (int y = 0; y < bitmap.height; ++y)
+        {
+            u32* s = bitmap.address<u32>(0, y);
+
+            for (int x = 0; x < bitmap.width; ++x)
+            {
+                const float u = float(x) / float(bitmap.width);
+                const float v = float(y) / float(bitmap.height);
+                const float r = 0.5f + 0.45f * std::sin(u * 19.0f + v * 3.0f);
+                const float g = 0.5f + 0.45f * std::sin(v * 17.0f - u * 5.0f);
+                const float b = 0.5f + 0.45f * std::cos((u + v) * 13.0f);
+                s[x] = makeRGBA(u32(r * 255.0f), u32(g * 255.0f), u32(b * 255.0f), 0xff);
+            }
+        }
+    }
+
+    double psnr(const Surface& a, const Surface& b)
+    {
+        double error = 0.0;
+
+        for (int y = 0; y < a.height; ++y)
+        {
+            const u8* sa = a.address<u8>(0, y);
+            const u8* sb = b.address<u8>(0, y);
+
+            for (int x = 0; x < a.width * 4; ++x)
+            {
+                if ((x & 3) != 3)
+                {
+                    const double delta = double(sa[x]) - double(sb[x]);
+                    error += delta * delta;
+                }
+            }
+        }
+
+        const double mse = error / (double(a.width) * a.height * 3.0);
+        return mse > 0.0 ? 10.0 * std::log10(255.0 * 255.0 / mse) : 100.0;
+    }
+
+    bool test_scaled_420()
+    {
+        // the scaled decode of a 4:2:0 image matches the box filtered full decode;
+        // chroma is reconstructed at the output resolution instead of being upsampled
+        // from 1/2 of it (1/8 scale: 2x2 chroma samples per MCU, not one)
+        const struct
+        {
+            int scale;
+            double threshold;
+        }
+        tests [] =
+        {
+            { 2, 45.0 },
+            { 4, 40.0 },
+            { 8, 36.0 },
+        };
+
+        Bitmap source(512, 384, g_rgba8);
+        fillPattern(source);
+
+        ImageEncodeOptions encode_options;
+        encode_options.quality = 0.95f;
+        encode_options.subsampling = ChromaSubsampling::S420;
+
+        MemoryStream stream;
+        ImageEncoder encoder(".jpg");
+        CHECK(encoder.encode(stream, source, encode_options));
+
+        ImageDecoder decoder(ConstMemory(stream.data(), stream.size()), ".jpg");
+        CHECK(decoder.isDecoder());
+
+        Bitmap full(source.width, source.height, g_rgba8);
+        CHECK(decoder.decode(full));
+
+        for (auto test : tests)
+        {
+            ImageDecodeOptions options;
+            options.scale = test.scale;
+
+            ImageHeader header = decoder.header(options);
+            CHECK(header.width == source.width / test.scale && header.height == source.height / test.scale);
+
+            Bitmap scaled(header.width, header.height, g_rgba8);
+            CHECK(decoder.decode(scaled, options));
+
+            Bitmap reference(header.width, header.height, g_rgba8);
+            resample(reference, full, ResampleFilter::BOX);
+
+            const double quality = psnr(scaled, reference);
+            printLine("    1/{}: {:.1f} dB", test.scale, quality);
+
+            CHECK(quality >= test.threshold);
+        }
+
+        return true;
+    }
+
+    const Case g_cases [] =
+    {
+        { "scaled_420", test_scaled_420 },
+    };
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    return run_cases("image_jpeg", g_cases, std::size(g_cases), argc, argv);
+}
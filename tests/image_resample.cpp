@@ -0,0 +1,246 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2026 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include "core_test.hpp"
+
+#include <cmath>
+
+using namespace mango;
+using namespace mango::image;
+using mango::test::Case;
+using mango::test::run_cases;
+
+#define CHECK CORE_CHECK
+
+namespace
+{
+
+    const Format g_rgba32f(128, Format::FLOAT32, Format::RGBA, 32, 32, 32, 32);
+
+    const Format g_formats [] =
+    {
+        Format(8,   Format::UNORM,   Format::R,    8, 0, 0, 0),
+        Format(16,  Format::UNORM,   Format::RA,   8, 8, 0, 0),
+        Format(24,  Format::UNORM,   Format::RGB,  8, 8, 8, 0),
+        Format(32,  Format::UNORM,   Format::RGBA, 8, 8, 8, 8),
+        Format(16,  Format::UNORM,   Format::R,    16, 0, 0, 0),
+        Format(48,  Format::UNORM,   Format::RGB,  16, 16, 16, 0),
+        Format(64,  Format::UNORM,   Format::RGBA, 16, 16, 16, 16),
+        Format(32,  Format::FLOAT16, Format::RG,   16, 16, 0, 0),
+        Format(64,  Format::FLOAT16, Format::RGBA, 16, 16, 16, 16),
+        Format(32,  Format::FLOAT32, Format::R,    32, 0, 0, 0),
+        Format(64,  Format::FLOAT32, Format::RG,   32, 32, 0, 0),
+        Format(96,  Format::FLOAT32, Format::RGB,  32, 32, 32, 0),
+        Format(128, Format::FLOAT32, Format::RGBA, 32, 32, 32, 32),
+    };
+
+    const ResampleFilter g_filters [] =
+    {
+        ResampleFilter::BOX,
+        ResampleFilter::TRIANGLE,
+        ResampleFilter::MITCHELL,
+        ResampleFilter::LANCZOS,
+    };
+
+    // largest difference of the channels in the format, in float
+    float difference(const Surface& a, const Surface& b)
+    {
+        Bitmap fa(a, g_rgba32f);
+        Bitmap fb(b, g_rgba32f);
+
+        float result = 0.0f;
+
+        for (int y = 0; y < fa.height; ++y)
+        {
+            const float* sa = fa.address<float>(0, y);
+            const float* sb = fb.address<float>(0, y);
+
+            for (int x = 0; x < fa.width * 4; ++x)
+            {
+                result = std::max(result, std::abs(sa[x] - sb[x]));
+            }
+        }
+
+        return result;
+    }
+
+    // 8 bit pattern with edges and gradients; exact in every format of the matrix
+    void fillPattern(Bitmap& bitmap)
+    {
+        for (int y = 0; y < bitmap.height; ++y)
+        {
+            float* s = bitmap.address<float>(0, y);
+
+            for (int x = 0; x < bitmap.width; ++x)
+            {
+                const u32 hash = u32(x * 73856093) ^ u32(y * 19349663);
+                s[x * 4 + 0] = float((x * 255) / (bitmap.width - 1)) / 255.0f;
+                s[x * 4 + 1] = float((y * 255) / (bitmap.height - 1)) / 255.0f;
+                s[x * 4 + 2] = ((x / 4 + y / 4) & 1) ? 1.0f : 0.0f;
+                s[x * 4 + 3] = float(hash & 0xff) / 255.0f;
+            }
+        }
+    }
+
+    bool test_identity()
+    {
+        // same size: the filters which interpolate give back the source
+        const ResampleFilter filters [] =
+        {
+            ResampleFilter::BOX,
+            ResampleFilter::TRIANGLE,
+            ResampleFilter::LANCZOS,
+        };
+
+        Bitmap pattern(37, 19, g_rgba32f);
+        fillPattern(pattern);
+
+        for (const Format& format : g_formats)
+        {
+            if (format.type != Format::UNORM || format.size[0] != 8)
+                continue;
+
+            Bitmap source(pattern, format);
+
+            for (ResampleFilter filter : filters)
+            {
+                Bitmap dest(source.width, source.height, format);
+                resample(dest, source, filter);
+
+                for (int y = 0; y < source.height; ++y)
+                {
+                    CHECK(!std::memcmp(dest.address(0, y), source.address(0, y), source.width * format.bytes()));
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool test_constant()
+    {
+        // the weights are normalized; a constant image stays constant at any scale
+        const int sizes [][2] = { { 7, 5 }, { 16, 16 }, { 45, 29 }, { 128, 3 } };
+
+        auto createConstant = [] (int width, int height, const Format& format)
+        {
+            Bitmap constant(width, height, g_rgba32f);
+
+            for (int y = 0; y < height; ++y)
+            {
+                float* s = constant.address<float>(0, y);
+                std::fill(s, s + width * 4, 151.0f / 255.0f);
+            }
+
+            return Bitmap(constant, format);
+        };
+
+        for (const Format& format : g_formats)
+        {
+            Bitmap source = createConstant(33, 17, format);
+
+            for (ResampleFilter filter : g_filters)
+            {
+                for (auto size : sizes)
+                {
+                    Bitmap dest(size[0], size[1], format);
+                    resample(dest, source, filter);
+
+                    Bitmap expected = createConstant(size[0], size[1], format);
+
+                    const float tolerance = format.isFloat() && format.size[0] == 16 ? 1e-3f : 1e-5f;
+                    CHECK(difference(dest, expected) <= tolerance);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool test_format_matrix()
+    {
+        // every layout matches the four channel float path within the precision of the format
+        const int sizes [][2] = { { 24, 13 }, { 61, 40 }, { 5, 3 }, { 119, 77 } };
+
+        Bitmap source(61, 40, g_rgba32f);
+        fillPattern(source);
+
+        for (const Format& format : g_formats)
+        {
+            Bitmap converted(source, format);
+
+            for (ResampleFilter filter : g_filters)
+            {
+                for (auto size : sizes)
+                {
+                    Bitmap reference(size[0], size[1], g_rgba32f);
+                    resample(reference, source, filter);
+
+                    Bitmap dest(size[0], size[1], format);
+                    resample(dest, converted, filter);
+
+                    float tolerance = 1e-5f;
+
+                    if (format.type == Format::UNORM)
+                        tolerance = 1.01f / float((1 << format.size[0]) - 1);
+                    else if (format.type == Format::FLOAT16)
+                        tolerance = 2e-3f;
+
+                    Bitmap expected(reference, format);
+                    CHECK(difference(dest, expected) <= tolerance);
+                }
+            }
+        }
+
+        return true;
+    }
+
+    bool test_rounding()
+    {
+        // box filtered pairs (a, a + 1) land halfway between two 8 bit values; the
+        // vector loop and the scalar tail must round every pixel of a row the same way
+        Bitmap source(10, 255, Format(8, Format::UNORM, Format::R, 8, 0, 0, 0));
+
+        for (int y = 0; y < source.height; ++y)
+        {
+            u8* s = source.address<u8>(0, y);
+
+            for (int x = 0; x < source.width; ++x)
+            {
+                s[x] = u8(y + (x & 1));
+            }
+        }
+
+        Bitmap dest(5, 255, source.format);
+        resample(dest, source, ResampleFilter::BOX);
+
+        for (int y = 0; y < dest.height; ++y)
+        {
+            const u8* d = dest.address<u8>(0, y);
+
+            CHECK(d[0] == y || d[0] == y + 1);
+
+            for (int x = 1; x < dest.width; ++x)
+            {
+                CHECK(d[x] == d[0]);
+            }
+        }
+
+        return true;
+    }
+
+    const Case g_cases [] =
+    {
+        { "identity",      test_identity },
+        { "constant",      test_constant },
+        { "format_matrix", test_format_matrix },
+        { "rounding",      test_rounding },
+    };
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    return run_cases("image_resample", g_cases, std::size(g_cases), argc, argv);
+}
@@ -700,6 +700,688 @@ bool test12()
     return success;
 }
 
+bool test13()
+{
+    // Pool scaling: tasks/s for 1..N workers. Each root task fans out from inside
+    // a worker, so the subtasks go to the per-worker deques and get stolen by idle
+    // workers; the root tasks go through the shared queue.
+
+    const size_t concurrency = ThreadPool::getHardwareConcurrency();
+
+    constexpr size_t roots = 20'000;
+    constexpr size_t fanout = 16;
+    constexpr size_t task_count = roots * (fanout + 1);
+
+    printf("  %8s  %12s  %8s  %8s\n", "workers", "tasks/s", "ms", "speedup");
+    printf("  --------  ------------  --------  --------\n");
+
+    bool success = true;
+    double baseline = 0.0;
+
+    // 1, 2, 4, .. and the full hardware concurrency
+    std::vector<size_t> counts;
+    for (size_t workers = 1; workers < concurrency; workers *= 2)
+    {
+        counts.push_back(workers);
+    }
+    counts.push_back(concurrency);
+
+    for (size_t workers : counts)
+    {
+        ThreadPool pool(workers);
+
+        std::atomic<size_t> counter { 0 };
+
+        const u64 time0 = Time::us();
+        {
+            ConcurrentQueue q(pool);
+
+            for (size_t i = 0; i < roots; ++i)
+            {
+                q.enqueue([&]
+                {
+                    for (size_t j = 0; j < fanout; ++j)
+                    {
+                        q.enqueue([&]
+                        {
+                            counter.fetch_add(1, std::memory_order_relaxed);
+                        });
+                    }
+
+                    counter.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+
+            q.wait();
+        }
+        const u64 elapsed_us = std::max(u64(1), Time::us() - time0);
+
+        const double tasks_per_sec = double(task_count) / (double(elapsed_us) / 1.0e6);
+        if (workers == 1)
+        {
+            baseline = tasks_per_sec;
+        }
+
+        printf("  %8zu  %12.0f  %8.1f  %7.2fx\n",
+            workers, tasks_per_sec, double(elapsed_us) / 1000.0, tasks_per_sec / baseline);
+
+        success &= counter.load() == task_count;
+    }
+
+    return success;
+}
+
+bool test14()
+{
+    // parallel_for covers every index exactly once; parallel_reduce sums; also from a worker
+
+    constexpr size_t count = 1'000'003;
+
+    std::vector<u8> visited(count, 0);
+
+    parallel_for(0, count, 1000, [&] (size_t i0, size_t i1)
+    {
+        for (size_t i = i0; i < i1; ++i)
+        {
+            ++visited[i];
+        }
+    });
+
+    const bool covered = std::all_of(visited.begin(), visited.end(), [] (u8 v) { return v == 1; });
+
+    auto sum = [] (size_t begin, size_t end)
+    {
+        return parallel_reduce(begin, end, 4096, u64(0),
+            [] (size_t i0, size_t i1)
+            {
+                u64 s = 0;
+                for (size_t i = i0; i < i1; ++i)
+                {
+                    s += i;
+                }
+                return s;
+            },
+            [] (u64 a, u64 b)
+            {
+                return a + b;
+            });
+    };
+
+    const u64 expected = u64(count) * (count - 1) / 2;
+    const u64 main_sum = sum(0, count);
+
+    // nested: the loop runs pinned on the worker
+    std::atomic<u64> worker_sum { 0 };
+    ConcurrentQueue q;
+    q.enqueue([&]
+    {
+        worker_sum = sum(0, count);
+    });
+    q.wait();
+
+    // zero grain is clamped to one index per range
+    constexpr size_t small_count = 10'000;
+
+    std::vector<u8> small_visited(small_count, 0);
+
+    parallel_for(0, small_count, 0, [&] (size_t i0, size_t i1)
+    {
+        for (size_t i = i0; i < i1; ++i)
+        {
+            ++small_visited[i];
+        }
+    });
+
+    const bool small_covered = std::all_of(small_visited.begin(), small_visited.end(), [] (u8 v) { return v == 1; });
+
+    const u64 small_sum = parallel_reduce(0, small_count, 0, u64(0),
+        [] (size_t i0, size_t i1)
+        {
+            u64 s = 0;
+            for (size_t i = i0; i < i1; ++i)
+            {
+                s += i;
+            }
+            return s;
+        },
+        [] (u64 a, u64 b)
+        {
+            return a + b;
+        });
+
+    const u64 small_expected = u64(small_count) * (small_count - 1) / 2;
+
+    const bool success = covered && main_sum == expected && worker_sum.load() == expected &&
+                         small_covered && small_sum == small_expected;
+
+    printf("  parallel_for: %s\n", covered ? "every index once" : "FAILED");
+    printf("  parallel_reduce: main %llu, worker %llu (expected %llu)\n",
+        (unsigned long long)main_sum, (unsigned long long)worker_sum.load(), (unsigned long long)expected);
+    printf("  zero grain: %s, sum %llu (expected %llu)\n", small_covered ? "every index once" : "FAILED",
+        (unsigned long long)small_sum, (unsigned long long)small_expected);
+
+    return success;
+}
+
+bool test15()
+{
+    // TaskFunction: move-only captures, inline and slab pooled closures
+
+    std::atomic<u64> sum { 0 };
+
+    constexpr int count = 100'000;
+
+    {
+        ConcurrentQueue q;
+
+        for (int i = 0; i < count; ++i)
+        {
+            // move-only capture (not possible with std::function)
+            auto value = std::make_unique<int>(i);
+
+            // closure larger than the inline capacity
+            u64 payload [32];
+            payload[0] = 1;
+            payload[31] = 2;
+
+            q.enqueue([value = std::move(value), payload, &sum]
+            {
+                sum.fetch_add(u64(*value) + payload[0] + payload[31], std::memory_order_relaxed);
+            });
+        }
+
+        q.wait();
+    }
+
+    const u64 expected = u64(count) * (count - 1) / 2 + u64(count) * 3;
+    const bool success = sum.load() == expected;
+
+    printf("  sum: %llu (expected %llu) [%s]\n",
+        (unsigned long long)sum.load(), (unsigned long long)expected, success ? "Success" : "FAILED");
+
+    return success;
+}
+
+bool test16()
+{
+    // TaskGraph: dependency order, continuation, cancellation propagation, rerun
+
+    constexpr int width = 64;
+
+    TaskGraph graph;
+
+    std::atomic<int> stage0 { 0 };
+    std::atomic<int> stage1 { 0 };
+    std::atomic<int> ordering_errors { 0 };
+    std::atomic<int> joined { 0 };
+
+    // fan-out -> per-item chain -> fan-in
+    auto root = graph.add([&]
+    {
+        ++stage0;
+    });
+
+    std::vector<TaskGraph::Node*> leaves;
+
+    for (int i = 0; i < width; ++i)
+    {
+        auto a = graph.add([&]
+        {
+            if (stage0.load() != 1)
+                ++ordering_errors;
+            ++stage1;
+        }, { root });
+
+        auto b = graph.add([&]
+        {
+            if (stage1.load() < 1)
+                ++ordering_errors;
+        }, { a });
+
+        leaves.push_back(b);
+    }
+
+    auto join = graph.add([&]
+    {
+        if (stage1.load() != width)
+            ++ordering_errors;
+        ++joined;
+    });
+
+    for (auto leaf : leaves)
+    {
+        graph.precede(leaf, join);
+    }
+
+    // cancellation: a failing node skips its successors
+    std::atomic<int> skipped { 0 };
+
+    auto failing = graph.add([&]
+    {
+        return false;
+    }, { root });
+
+    auto after = graph.add([&]
+    {
+        ++skipped;
+    }, { failing });
+
+    graph.add([&]
+    {
+        ++skipped;
+    }, { after, join });
+
+    bool success = true;
+
+    for (int run = 0; run < 3; ++run)
+    {
+        stage0 = 0;
+        stage1 = 0;
+
+        graph.run();
+        graph.wait();
+
+        success &= stage1.load() == width;
+
+        // wait() clears the cancellations for the next run
+        success &= !after->isCancelled();
+    }
+
+    // cancel() before run() skips the whole run
+    stage0 = 0;
+
+    graph.cancel();
+    graph.run();
+    graph.wait();
+
+    const bool cancelled_run = stage0.load() == 0 && joined.load() == 3;
+    success &= cancelled_run;
+
+    // ..and the next run is not affected
+    stage1 = 0;
+
+    graph.run();
+    graph.wait();
+
+    success &= stage0.load() == 1;
+    success &= joined.load() == 4;
+    success &= skipped.load() == 0;
+    success &= ordering_errors.load() == 0;
+
+    printf("  nodes run: %d x 4, joined: %d, skipped ran: %d, ordering errors: %d, cancel before run: %s [%s]\n",
+        width * 2 + 2, joined.load(), skipped.load(), ordering_errors.load(),
+        cancelled_run ? "skipped" : "ran", success ? "Success" : "FAILED");
+
+    return success;
+}
+
+bool test17()
+{
+    // Priority lanes and max-in-flight cap
+
+    ThreadPool pool(4);
+
+    constexpr size_t cap = 2;
+    constexpr int background_tasks = 64;
+
+    std::atomic<int> running { 0 };
+    std::atomic<int> peak { 0 };
+    std::atomic<int> background_done { 0 };
+    std::atomic<int> interactive_done { 0 };
+    std::atomic<int> background_done_at_interactive { -1 };
+
+    ConcurrentQueue background(pool, "background", TaskPriority::Background, cap);
+    ConcurrentQueue interactive(pool, "interactive", TaskPriority::Interactive);
+
+    pool.laneUtilization();
+
+    for (int i = 0; i < background_tasks; ++i)
+    {
+        background.enqueue([&]
+        {
+            int current = ++running;
+            int expected = peak.load();
+            while (current > expected && !peak.compare_exchange_weak(expected, current))
+            {
+            }
+
+            Sleep::ms(1);
+            --running;
+            ++background_done;
+        });
+    }
+
+    interactive.enqueue([&]
+    {
+        background_done_at_interactive = background_done.load();
+        ++interactive_done;
+    });
+
+    interactive.wait();
+    background.wait();
+
+    auto lanes = pool.laneUtilization();
+
+    // the interactive task must not wait behind the background backlog: with the cap
+    // only a few background tasks can complete before a worker picks it up
+    constexpr int max_background_before_interactive = background_tasks / 4;
+
+    const int before = background_done_at_interactive.load();
+    bool success = peak.load() <= int(cap) &&
+                   background_done.load() == background_tasks &&
+                   interactive_done.load() == 1 &&
+                   before >= 0 && before <= max_background_before_interactive;
+
+    // the window covers the whole test: background work dominates, nothing ran in
+    // the normal lane and the shares don't exceed the pool's worker time
+    float total = 0.0f;
+
+    for (float lane : lanes)
+    {
+        success &= lane >= 0.0f && lane <= 1.0f;
+        total += lane;
+    }
+
+    success &= lanes.size() == 3;
+    success &= total <= 1.001f;
+    success &= lanes[1] == 0.0f;
+    success &= lanes[2] > 0.0f && lanes[2] >= lanes[0];
+
+    // at most cap of the 4 workers run background tasks at any time
+    success &= lanes[2] <= float(cap) / 4.0f + 0.05f;
+
+    printf("  background peak in flight: %d (cap %zu)\n", peak.load(), cap);
+    printf("  interactive task ran after %d / %d background tasks (limit %d)\n",
+        before, background_tasks, max_background_before_interactive);
+    printf("  lane occupancy: interactive %.1f%%, normal %.1f%%, background %.1f%%\n",
+        lanes[0] * 100.0f, lanes[1] * 100.0f, lanes[2] * 100.0f);
+    printf("  [%s]\n", success ? "Success" : "FAILED");
+
+    return success;
+}
+
+bool test18()
+{
+    // Pinned pool: tasks of a node-targeted queue run on the node's workers
+
+    ThreadPool pool(ThreadPool::getHardwareConcurrency(), true);
+
+    const int nodes = pool.getNodeCount();
+    constexpr int tasks_per_node = 256;
+
+    std::atomic<int> misplaced { 0 };
+    std::atomic<int> completed { 0 };
+
+    std::vector<std::unique_ptr<ConcurrentQueue>> queues;
+
+    for (int node = 0; node < nodes; ++node)
+    {
+        queues.emplace_back(std::make_unique<ConcurrentQueue>(pool, "node"));
+        queues.back()->setNode(node);
+
+        for (int i = 0; i < tasks_per_node; ++i)
+        {
+            queues.back()->enqueue([&pool, &misplaced, &completed, node]
+            {
+                int current = pool.getCurrentNode();
+                if (current != node && current != -1)
+                {
+                    ++misplaced;
+                }
+
+                ++completed;
+            });
+        }
+    }
+
+    for (auto& queue : queues)
+    {
+        queue->wait();
+    }
+
+    printf("  nodes: %d, completed: %d, misplaced: %d\n", nodes, completed.load(), misplaced.load());
+
+    return misplaced.load() == 0 && completed.load() == nodes * tasks_per_node &&
+           pool.getCurrentNode() == -1;
+}
+
+// ----------------------------------------------------------------------------------
+// Reference queues: the previous mutex + deque implementations, kept for comparison
+// ----------------------------------------------------------------------------------
+
+class LockedSerialQueue
+{
+protected:
+    std::thread m_thread;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_task_condition;
+    std::condition_variable m_wait_condition;
+    size_t m_count = 0;
+    bool m_stop = false;
+
+public:
+    LockedSerialQueue()
+    {
+        m_thread = std::thread([this]
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            for (;;)
+            {
+                m_task_condition.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+                if (m_tasks.empty())
+                {
+                    break;
+                }
+
+                auto task = std::move(m_tasks.front());
+                m_tasks.pop_front();
+                lock.unlock();
+
+                task();
+
+                lock.lock();
+                if (!--m_count)
+                {
+                    m_wait_condition.notify_all();
+                }
+            }
+        });
+    }
+
+    ~LockedSerialQueue()
+    {
+        wait();
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stop = true;
+        lock.unlock();
+
+        m_task_condition.notify_one();
+        m_thread.join();
+    }
+
+    template <typename F>
+    void enqueue(F&& f)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.emplace_back(std::forward<F>(f));
+        ++m_count;
+        m_task_condition.notify_one();
+    }
+
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_wait_condition.wait(lock, [this] { return !m_count; });
+    }
+};
+
+class PromiseTicketQueue
+{
+protected:
+    struct Task
+    {
+        std::function<void()> func;
+        std::promise<void> promise;
+    };
+
+    LockedSerialQueue m_queue;
+    std::mutex m_mutex;
+
+public:
+    using Ticket = std::shared_ptr<Task>;
+
+    Ticket acquire()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto task = std::make_shared<Task>();
+
+        m_queue.enqueue([task]
+        {
+            task->promise.get_future().wait();
+            task->func();
+        });
+
+        return task;
+    }
+
+    static void consume(const Ticket& ticket, std::function<void()> func)
+    {
+        ticket->func = std::move(func);
+        ticket->promise.set_value();
+    }
+
+    void wait()
+    {
+        m_queue.wait();
+    }
+};
+
+template <typename Queue>
+double serial_throughput(int producers, int count, std::atomic<int>& counter)
+{
+    Queue queue;
+
+    u64 time0 = Time::us();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i)
+    {
+        threads.emplace_back([&queue, &counter, count]
+        {
+            for (int j = 0; j < count; ++j)
+            {
+                queue.enqueue([&counter]
+                {
+                    counter.fetch_add(1, std::memory_order_relaxed);
+                });
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    queue.wait();
+
+    u64 time1 = Time::us();
+    return double(producers) * count / std::max(u64(1), time1 - time0);
+}
+
+bool test19()
+{
+    // SerialQueue throughput: lock-free queue vs. mutex + deque
+
+    const int producers = std::max(2, int(ThreadPool::getHardwareConcurrency()));
+    const int count = 200'000;
+
+    std::atomic<int> counter0 { 0 };
+    std::atomic<int> counter1 { 0 };
+
+    double locked = serial_throughput<LockedSerialQueue>(producers, count, counter0);
+    double lockfree = serial_throughput<SerialQueue>(producers, count, counter1);
+
+    printf("  producers: %d, tasks: %d\n", producers, producers * count);
+    printf("  mutex + deque: %6.2f M tasks/s\n", locked);
+    printf("  SerialQueue:   %6.2f M tasks/s\n", lockfree);
+
+    return counter0 == producers * count && counter1 == producers * count;
+}
+
+bool test20()
+{
+    // TicketQueue throughput: ordered writes from pool workers (hcompress pattern)
+
+    constexpr int count = 500'000;
+
+    std::vector<int> order0;
+    std::vector<int> order1;
+    order0.reserve(count);
+    order1.reserve(count);
+
+    u64 time0 = Time::us();
+    {
+        ConcurrentQueue q;
+        PromiseTicketQueue tk;
+
+        for (int i = 0; i < count; ++i)
+        {
+            auto ticket = tk.acquire();
+
+            q.enqueue([ticket, &order0, i]
+            {
+                PromiseTicketQueue::consume(ticket, [&order0, i]
+                {
+                    order0.push_back(i);
+                });
+            });
+        }
+
+        q.wait();
+        tk.wait();
+    }
+
+    u64 time1 = Time::us();
+    {
+        ConcurrentQueue q;
+        TicketQueue tk;
+
+        for (int i = 0; i < count; ++i)
+        {
+            auto ticket = tk.acquire();
+
+            q.enqueue([ticket, &order1, i]
+            {
+                ticket.consume([&order1, i]
+                {
+                    order1.push_back(i);
+                });
+            });
+        }
+
+        q.wait();
+        tk.wait();
+    }
+
+    u64 time2 = Time::us();
+
+    printf("  tickets: %d\n", count);
+    printf("  promise + mutex: %6.2f M tickets/s\n", double(count) / std::max(u64(1), time1 - time0));
+    printf("  TicketQueue:     %6.2f M tickets/s\n", double(count) / std::max(u64(1), time2 - time1));
+
+    bool success = order0.size() == count && order1.size() == count;
+
+    for (int i = 0; success && i < count; ++i)
+    {
+        success = order0[i] == i && order1[i] == i;
+    }
+
+    return success;
+}
+
 int main(int argc, char* argv[])
 {
     int count = 1;
@@ -732,6 +1414,14 @@ int main(int argc, char* argv[])
         { "test10", "crc32c main (parallel) vs worker (nested CQ)", test10 },
         { "test11", "bounded in-flight + worker crc (hdecompress-like)", test11 },
         { "test12", "pool throughput (crc32c payload) + utilization",   test12 },
+        { "test13", "pool scaling: tasks/s from 1 to N workers",       test13 },
+        { "test14", "parallel_for / parallel_reduce",                   test14 },
+        { "test15", "TaskFunction move-only and pooled closures",       test15 },
+        { "test16", "TaskGraph dependencies and cancellation",          test16 },
+        { "test17", "priority lanes and max-in-flight cap",             test17 },
+        { "test18", "pinned pool with NUMA node-targeted queues",       test18 },
+        { "test19", "SerialQueue throughput vs. mutex + deque",         test19 },
+        { "test20", "TicketQueue throughput vs. promise + mutex",       test20 },
     };
 
     int passed = 0;
@@ -29,6 +29,807 @@ struct Test
     const std::string password;
 };
 
+bool expectException(ConstMemory memory, void (*func)(ConstMemory))
+{
+    try
+    {
+        func(memory);
+    }
+    catch (const mango::Exception&)
+    {
+        return true;
+    }
+
+    return false;
+}
+
+int test_truncated_hbs()
+{
+    // truncated archives are rejected with an exception; the copies are exactly the
+    // size of the truncated data so that a sanitizer catches reads past the end
+    int failed_count = 0;
+
+    // archive tails (version 2.0) which are too short for the dictionary offset
+    for (size_t size = 0; size < 36; ++size)
+    {
+        Buffer buffer(size, 0);
+
+        if (size >= 28)
+        {
+            LittleEndianPointer p = buffer.data();
+            p.write32(HBS_MAGIC0);
+
+            p = buffer.data() + size - 24;
+            p.write32(HBS_MAGIC3);
+            p.write32(HBS_VERSION);
+            p.write64(4);
+            p.write64(4);
+        }
+
+        bool status = expectException(buffer, [] (ConstMemory memory)
+        {
+            hbs::readIndex(memory);
+        });
+
+        if (!status)
+        {
+            printLine("truncated index ({} bytes) : FAILED", size);
+            ++failed_count;
+        }
+    }
+
+    // dictionary array without the complete header
+    for (size_t size = 0; size < 12; ++size)
+    {
+        Buffer buffer(size, 0);
+
+        bool status = expectException(buffer, [] (ConstMemory memory)
+        {
+            hbs::readDictionaryArray(memory);
+        });
+
+        if (!status)
+        {
+            printLine("truncated dictionary array ({} bytes) : FAILED", size);
+            ++failed_count;
+        }
+    }
+
+    // file arrays whose decompressed records are truncated or have a hostile count
+    MemoryStream records;
+    LittleEndianStream stream = records;
+
+    stream.write32(1);
+    stream.write32(9);
+    stream.write("lorem.txt", 9);
+    stream.write64(1000);
+    stream.write32(0);
+    stream.write32(2);
+
+    for (int i = 0; i < 2; ++i)
+    {
+        stream.write32(0);
+        stream.write64(i * 500);
+        stream.write64(500);
+    }
+
+    auto makeFileArray = [] (Buffer& buffer, ConstMemory records)
+    {
+        Buffer compressed(zstd::bound(records.size));
+        size_t size = zstd::compress(compressed, records);
+
+        buffer.reset(24 + size);
+        LittleEndianPointer p = buffer.data();
+        p.write32(HBS_MAGIC2);
+        p.write32(HBS_VERSION);
+        p.write64(size);
+        p.write64(records.size);
+        std::memcpy(p, compressed.data(), size);
+    };
+
+    for (size_t size = 0; size < records.size(); ++size)
+    {
+        Buffer buffer;
+        makeFileArray(buffer, ConstMemory(records.data(), size));
+
+        bool status = expectException(buffer, [] (ConstMemory memory)
+        {
+            hbs::readFileArray(memory);
+        });
+
+        if (!status)
+        {
+            printLine("truncated file records ({} bytes) : FAILED", size);
+            ++failed_count;
+        }
+    }
+
+    {
+        Buffer hostile(records.data(), records.size());
+        LittleEndianPointer p = hostile.data();
+        p.write32(0xffffffff);
+
+        Buffer buffer;
+        makeFileArray(buffer, hostile);
+
+        bool status = expectException(buffer, [] (ConstMemory memory)
+        {
+            hbs::readFileArray(memory);
+        });
+
+        if (!status)
+        {
+            printLine("file record count : FAILED");
+            ++failed_count;
+        }
+    }
+
+    {
+        // the complete records must still parse
+        Buffer buffer;
+        makeFileArray(buffer, records);
+
+        std::vector<hbs::File> files = hbs::readFileArray(buffer);
+        if (files.size() != 1 || files[0].filename != "lorem.txt" || files[0].segments.size() != 2)
+        {
+            printLine("file records : FAILED");
+            ++failed_count;
+        }
+    }
+
+    // prefixes of a complete archive; the index at the end is lost
+    File file("data/ziptest/test.hbs");
+
+    for (size_t size = 0; size < file.size(); size += std::max(size_t(1), size / 8))
+    {
+        Buffer buffer(file.data(), size);
+
+        bool status = expectException(buffer, [] (ConstMemory memory)
+        {
+            hbs::readIndex(memory);
+        });
+
+        if (!status)
+        {
+            printLine("truncated test.hbs ({} bytes) : FAILED", size);
+            ++failed_count;
+        }
+    }
+
+    printLine("truncated hbs    : {}", failed_count ? "FAILED" : "PASSED");
+
+    return failed_count;
+}
+
+// minimal archive with stored (uncompressed) entries
+// flags: general purpose flags of the file entries; folder entries are stored without them
+void createStoredZip(Buffer& buffer, const std::vector<std::pair<std::string, std::string>>& entries, u16 flags = 0)
+{
+    MemoryStream central;
+    LittleEndianStream directory = central;
+
+    MemoryStream output;
+    LittleEndianStream stream = output;
+
+    for (auto& [name, content] : entries)
+    {
+        const u32 offset = u32(output.size());
+        const u32 crc = crc32(0, ConstMemory(reinterpret_cast<const u8*>(content.data()), content.length()));
+        const u32 size = u32(content.length());
+        const u16 entry_flags = name.ends_with('/') ? 0 : flags;
+
+        stream.write32(0x04034b50);
+        stream.write16(20); // version needed
+        stream.write16(entry_flags);
+        stream.write16(0);  // stored
+        stream.write16(0);  // time
+        stream.write16(0);  // date
+        stream.write32(crc);
+        stream.write32(size);
+        stream.write32(size);
+        stream.write16(u16(name.length()));
+        stream.write16(0);
+        stream.write(name.data(), name.length());
+        stream.write(content.data(), content.length());
+
+        directory.write32(0x02014b50);
+        directory.write16(20); // version used
+        directory.write16(20); // version needed
+        directory.write16(entry_flags);
+        directory.write16(0);  // stored
+        directory.write16(0);  // time
+        directory.write16(0);  // date
+        directory.write32(crc);
+        directory.write32(size);
+        directory.write32(size);
+        directory.write16(u16(name.length()));
+        directory.write16(0); // extra field
+        directory.write16(0); // comment
+        directory.write16(0); // disk start
+        directory.write16(0); // internal attributes
+        directory.write32(0); // external attributes
+        directory.write32(offset);
+        directory.write(name.data(), name.length());
+    }
+
+    const u32 dirOffset = u32(output.size());
+
+    stream.write(central.data(), central.size());
+    stream.write32(0x06054b50);
+    stream.write16(0);
+    stream.write16(0);
+    stream.write16(u16(entries.size()));
+    stream.write16(u16(entries.size()));
+    stream.write32(u32(central.size()));
+    stream.write32(dirOffset);
+    stream.write16(0);
+
+    buffer.reset(output.size());
+    std::memcpy(buffer.data(), output.data(), output.size());
+}
+
+int test_zip_index()
+{
+    int failed_count = 0;
+
+    auto check = [&] (bool status, const char* text)
+    {
+        if (!status)
+        {
+            printLine("zip index: {} : FAILED", text);
+            ++failed_count;
+        }
+    };
+
+    Buffer buffer;
+    createStoredZip(buffer,
+    {
+        { "readme.txt", "hello" },
+        { "data/a.txt", "first" },
+        { "data/nested/deep/b.txt", "nested" },
+        { "data/nested/c.txt", "abc" },
+        { "other/d.txt", "d" },
+        { "data/a.txt", "second" }, // duplicate: the last one wins
+    });
+
+    try
+    {
+        Path root(buffer, ".zip");
+
+        auto names = [] (const Path& path)
+        {
+            std::vector<std::string> result;
+            for (auto& node : path)
+            {
+                result.push_back(node.name);
+            }
+            std::sort(result.begin(), result.end());
+            return result;
+        };
+
+        check(names(root) == std::vector<std::string>({ "data/", "other/", "readme.txt" }), "root folder");
+        check(root.isFile("data/nested/deep/b.txt"), "nested path");
+        check(!root.isFile("data/nested/"), "folder is not a file");
+        check(!root.isFile("data/missing.txt"), "missing file");
+        check(root.getSize("data/nested/c.txt") == 3, "nested size");
+
+        Path data(root, "data/");
+        check(names(data) == std::vector<std::string>({ "a.txt", "nested/" }), "duplicate listed once");
+
+        Path nested(root, "data/nested/");
+        check(names(nested) == std::vector<std::string>({ "c.txt", "deep/" }), "nested folder");
+
+        File file(root, "data/a.txt");
+        check(file.size() == 6 && std::memcmp(file.data(), "second", 6) == 0, "duplicate insert");
+    }
+    catch (const mango::Exception& e)
+    {
+        printLine("zip index: exception: {}", e.what());
+        ++failed_count;
+    }
+
+    // interleaved folders: the folder created for a/z must not replace the stored a/
+    // entry; the created folders copy the header of the file so they are encrypted
+    Buffer interleaved;
+    createStoredZip(interleaved,
+    {
+        { "a/", "" },
+        { "a/x.txt", "x" },
+        { "b/y.txt", "y" },
+        { "a/z.txt", "z" },
+    }, 1);
+
+    try
+    {
+        Path root(interleaved, ".zip");
+
+        bool stored = false;
+        bool created = false;
+        size_t count = 0;
+
+        for (auto& node : root)
+        {
+            stored |= node.name == "a/" && node.isDirectory() && !node.isEncrypted();
+            created |= node.name == "b/" && node.isDirectory() && node.isEncrypted();
+            ++count;
+        }
+
+        check(count == 2, "interleaved folders listed once");
+        check(stored, "stored folder entry is kept");
+        check(created, "created folder entry");
+
+        Path a(root, "a/");
+        check(a.size() == 2 && root.isFile("a/z.txt"), "interleaved folder content");
+    }
+    catch (const mango::Exception& e)
+    {
+        printLine("zip index: interleaved: exception: {}", e.what());
+        ++failed_count;
+    }
+
+    // saturated entry count and no room for the ZIP64 locator before the end record
+    Buffer truncated(22, 0);
+    LittleEndianPointer p = truncated.data();
+    p.write32(0x06054b50);
+    p += 4;
+    p.write16(0xffff);
+    p.write16(0xffff);
+
+    try
+    {
+        Path path(truncated, ".zip");
+        check(path.empty(), "truncated zip64 locator");
+    }
+    catch (const mango::Exception&)
+    {
+    }
+
+    printLine("zip index        : {}", failed_count ? "FAILED" : "PASSED");
+
+    return failed_count;
+}
+
+// compressible test data which differs between files
+std::string createContent(size_t size, u32 seed)
+{
+    std::string text;
+    text.reserve(size);
+
+    while (text.length() < size)
+    {
+        seed = seed * 1664525 + 1013904223;
+        text += fmt::format("line {} of file {:08x}\n", text.length(), seed >> 8);
+    }
+
+    text.resize(size);
+    return text;
+}
+
+/*
+    Archive with eight small files sharing one zstd block and a file of five
+    segments, each in a block of its own; the blocks of the odd segments are
+    stored instead of compressed.
+*/
+
+const int g_small_file_count = 8;
+const size_t g_large_segments [] = { 7000, 5000, 9000, 3000, 6001 };
+
+std::string getSmallContent(int index)
+{
+    return createContent(1000 + index * 123, index + 1);
+}
+
+std::string getLargeContent()
+{
+    size_t size = 0;
+    for (size_t segment : g_large_segments)
+    {
+        size += segment;
+    }
+
+    return createContent(size, 0x1234);
+}
+
+void createHBS(Buffer& buffer)
+{
+    MemoryStream output;
+    LittleEndianStream stream = output;
+
+    stream.write32(HBS_MAGIC0);
+
+    std::vector<hbs::Block> blocks;
+    std::vector<hbs::File> files;
+
+    auto writeBlock = [&] (const std::string& content, bool compress)
+    {
+        hbs::Block block;
+        block.offset = output.size();
+        block.uncompressed = content.length();
+        block.method = compress ? Compressor::ZSTD : Compressor::NONE;
+        block.dictionary = 0;
+
+        ConstMemory source(reinterpret_cast<const u8*>(content.data()), content.length());
+
+        if (compress)
+        {
+            Buffer compressed(zstd::bound(source.size));
+            block.compressed = zstd::compress(compressed, source);
+            stream.write(compressed.data(), block.compressed);
+        }
+        else
+        {
+            block.compressed = source.size;
+            stream.write(source.address, source.size);
+        }
+
+        blocks.push_back(block);
+        return u32(blocks.size() - 1);
+    };
+
+    std::string shared;
+
+    for (int i = 0; i < g_small_file_count; ++i)
+    {
+        std::string content = getSmallContent(i);
+
+        hbs::File file;
+        file.filename = fmt::format("small/file-{}.txt", i);
+        file.size = content.length();
+        file.checksum = 0;
+        file.segments.push_back({ 0, shared.length(), content.length() });
+        files.push_back(file);
+
+        shared += content;
+    }
+
+    writeBlock(shared, true);
+
+    std::string large = getLargeContent();
+
+    hbs::File file;
+    file.filename = "large.txt";
+    file.size = large.length();
+    file.checksum = 0;
+
+    size_t offset = 0;
+
+    for (size_t i = 0; i < std::size(g_large_segments); ++i)
+    {
+        const size_t size = g_large_segments[i];
+        u32 block = writeBlock(large.substr(offset, size), (i & 1) == 0);
+        file.segments.push_back({ block, offset, size });
+        offset += size;
+    }
+
+    files.push_back(file);
+
+    const u64 block_offset = output.size();
+    hbs::writeBlockArray(stream, blocks);
+
+    const u64 file_offset = output.size();
+    hbs::writeFileArray(stream, files);
+
+    hbs::writeIndex(stream, block_offset, file_offset);
+
+    buffer.reset(output.size());
+    std::memcpy(buffer.data(), output.data(), output.size());
+}
+
+int test_hbs_concurrent_map()
+{
+    // the small files share one block; every map goes through the block cache
+    int failed_count = 0;
+
+    Buffer buffer;
+    createHBS(buffer);
+
+    try
+    {
+        Path path(buffer, ".hbs");
+
+        const hbs::CacheStatistics before = hbs::getCacheStatistics();
+
+        const int task_count = 16;
+        const int iterations = 20;
+
+        std::atomic<int> errors { 0 };
+
+        ConcurrentQueue queue;
+
+        for (int task = 0; task < task_count; ++task)
+        {
+            queue.enqueue([&, task]
+            {
+                for (int i = 0; i < iterations; ++i)
+                {
+                    const int index = (task + i) % g_small_file_count;
+                    const std::string expected = getSmallContent(index);
+
+                    try
+                    {
+                        File file(path, fmt::format("small/file-{}.txt", index));
+
+                        if (file.size() != expected.length() ||
+                            std::memcmp(file.data(), expected.data(), expected.length()))
+                        {
+                            ++errors;
+                        }
+                    }
+                    catch (const mango::Exception&)
+                    {
+                        ++errors;
+                    }
+                }
+            });
+        }
+
+        queue.wait();
+
+        const hbs::CacheStatistics after = hbs::getCacheStatistics();
+
+        const u64 hits = after.hits - before.hits;
+        const u64 misses = after.misses - before.misses;
+
+        if (errors)
+        {
+            printLine("hbs concurrent map: {} incorrect files : FAILED", int(errors));
+            ++failed_count;
+        }
+
+        // the shared block is decompressed once; the concurrent misses wait for it
+        if (misses != 1 || hits + misses != task_count * iterations)
+        {
+            printLine("hbs concurrent map: {} hits, {} misses : FAILED", hits, misses);
+            ++failed_count;
+        }
+
+        File file(path, "large.txt");
+        const std::string expected = getLargeContent();
+
+        if (file.size() != expected.length() || std::memcmp(file.data(), expected.data(), expected.length()))
+        {
+            printLine("hbs multi-segment map : FAILED");
+            ++failed_count;
+        }
+    }
+    catch (const mango::Exception& e)
+    {
+        printLine("hbs concurrent map: exception: {}", e.what());
+        ++failed_count;
+    }
+
+    printLine("hbs concurrent   : {}", failed_count ? "FAILED" : "PASSED");
+
+    return failed_count;
+}
+
+int test_hbs_stream()
+{
+    // small reads and seeks through the segment stream must match map()
+    int failed_count = 0;
+
+    Buffer buffer;
+    createHBS(buffer);
+
+    try
+    {
+        Path path(buffer, ".hbs");
+
+        for (const std::string filename : { "large.txt", "small/file-3.txt" })
+        {
+            File file(path, filename);
+            ConstMemory expected = file;
+
+            std::unique_ptr<Stream> stream = path.stream(filename);
+
+            if (stream->size() != expected.size)
+            {
+                printLine("hbs stream: \"{}\" size : FAILED", filename);
+                ++failed_count;
+                continue;
+            }
+
+            // sequential reads which straddle the segment boundaries
+            Buffer output(expected.size);
+            u64 offset = 0;
+
+            while (offset < expected.size)
+            {
+                u64 bytes = stream->read(output.data() + offset, 37);
+                if (!bytes)
+                {
+                    break;
+                }
+                offset += bytes;
+            }
+
+            if (offset != expected.size || std::memcmp(output.data(), expected.address, expected.size))
+            {
+                printLine("hbs stream: \"{}\" sequential : FAILED", filename);
+                ++failed_count;
+            }
+
+            // reading at the end returns nothing
+            u8 temp [64];
+
+            if (stream->read(temp, sizeof(temp)) != 0)
+            {
+                printLine("hbs stream: \"{}\" end of file : FAILED", filename);
+                ++failed_count;
+            }
+
+            // seeks back and forth over the segments
+            u32 seed = 7;
+
+            for (int i = 0; i < 200; ++i)
+            {
+                seed = seed * 1664525 + 1013904223;
+                const u64 position = (seed >> 8) % expected.size;
+                const u64 size = std::min(u64((seed >> 4) % sizeof(temp)), expected.size - position);
+
+                stream->seek(s64(position), Stream::SeekMode::Begin);
+                u64 bytes = stream->read(temp, size);
+
+                if (bytes != size || stream->offset() != position + size ||
+                    std::memcmp(temp, expected.address + position, size_t(size)))
+                {
+                    printLine("hbs stream: \"{}\" seek {} : FAILED", filename, position);
+                    ++failed_count;
+                    break;
+                }
+            }
+        }
+    }
+    catch (const mango::Exception& e)
+    {
+        printLine("hbs stream: exception: {}", e.what());
+        ++failed_count;
+    }
+
+    printLine("hbs stream       : {}", failed_count ? "FAILED" : "PASSED");
+
+    return failed_count;
+}
+
+// ISO 9660 directory record; returns the record length
+size_t writeIsoRecord(u8* p, const std::string& name, u32 extent, u32 size, bool directory)
+{
+    const size_t length = 33 + name.length() + (~name.length() & 1);
+
+    LittleEndianPointer le = p + 2;
+    le.write32(extent);
+    BigEndianPointer be = p + 6;
+    be.write32(extent);
+    le = p + 10;
+    le.write32(size);
+    be = p + 14;
+    be.write32(size);
+
+    p[0] = u8(length);
+    p[25] = directory ? 0x02 : 0x00;
+    p[32] = u8(name.length());
+    std::memcpy(p + 33, name.data(), name.length());
+
+    return length;
+}
+
+void createISO(Buffer& buffer)
+{
+    // sector 16: primary volume descriptor, 17: terminator, 18..20: directories, 21..: files
+    const u32 sector = 2048;
+
+    buffer.reset(24 * sector, 0);
+    u8* image = buffer.data();
+
+    auto directory = [&] (u32 extent, u32 parent, std::vector<std::tuple<std::string, u32, u32, bool>> entries)
+    {
+        u8* p = image + extent * sector;
+        p += writeIsoRecord(p, std::string(1, '\0'), extent, sector, true);
+        p += writeIsoRecord(p, std::string(1, '\1'), parent, sector, true);
+
+        for (auto& [name, location, size, is_directory] : entries)
+        {
+            p += writeIsoRecord(p, name, location, size, is_directory);
+        }
+    };
+
+    auto file = [&] (u32 extent, const char* text)
+    {
+        std::memcpy(image + extent * sector, text, std::strlen(text));
+    };
+
+    u8* pvd = image + 16 * sector;
+    pvd[0] = 1;
+    std::memcpy(pvd + 1, "CD001", 5);
+    pvd[6] = 1;
+    LittleEndianPointer(pvd + 128).write16(u16(sector));
+    BigEndianPointer(pvd + 130).write16(u16(sector));
+    writeIsoRecord(pvd + 156, std::string(1, '\0'), 18, sector, true);
+
+    u8* terminator = image + 17 * sector;
+    terminator[0] = 255;
+    std::memcpy(terminator + 1, "CD001", 5);
+    terminator[6] = 1;
+
+    directory(18, 18,
+    {
+        { "DOCS", 19, sector, true },
+        { "README.TXT;1", 21, 5, false },
+    });
+
+    directory(19, 18,
+    {
+        { "A.TXT;1", 22, 6, false },
+        { "SUB", 20, sector, true },
+    });
+
+    // LOOP links back to the root directory; the walk must not follow it again
+    directory(20, 19,
+    {
+        { "B.TXT;1", 23, 7, false },
+        { "LOOP", 18, sector, true },
+    });
+
+    file(21, "hello");
+    file(22, "first!");
+    file(23, "second!");
+}
+
+int test_iso_index()
+{
+    int failed_count = 0;
+
+    auto check = [&] (bool status, const char* text)
+    {
+        if (!status)
+        {
+            printLine("iso index: {} : FAILED", text);
+            ++failed_count;
+        }
+    };
+
+    auto names = [] (const Path& path)
+    {
+        std::vector<std::string> result;
+        for (auto& node : path)
+        {
+            result.push_back(node.name);
+        }
+        std::sort(result.begin(), result.end());
+        return result;
+    };
+
+    Buffer buffer;
+    createISO(buffer);
+
+    try
+    {
+        Path root(buffer, ".iso");
+
+        check(names(root) == std::vector<std::string>({ "DOCS/", "README.TXT" }), "root folder");
+        check(names(Path(root, "DOCS/")) == std::vector<std::string>({ "A.TXT", "SUB/" }), "folder");
+        check(names(Path(root, "DOCS/SUB/")) == std::vector<std::string>({ "B.TXT", "LOOP/" }), "nested folder");
+        check(Path(root, "DOCS/SUB/LOOP/").empty(), "directory cycle");
+
+        check(root.isFile("DOCS/SUB/B.TXT"), "nested file");
+        check(!root.isFile("DOCS/SUB/"), "folder is not a file");
+        check(!root.isFile("DOCS/C.TXT"), "missing file");
+        check(root.getSize("DOCS/A.TXT") == 6, "file size");
+
+        File file(root, "DOCS/SUB/B.TXT");
+        check(file.size() == 7 && std::memcmp(file.data(), "second!", 7) == 0, "file content");
+    }
+    catch (const mango::Exception& e)
+    {
+        printLine("iso index: exception: {}", e.what());
+        ++failed_count;
+    }
+
+    printLine("iso index        : {}", failed_count ? "FAILED" : "PASSED");
+
+    return failed_count;
+}
+
 int main()
 {
     const Test tests [] =
@@ -94,5 +895,11 @@ int main()
         }
     }
 
+    failed_count += test_truncated_hbs();
+    failed_count += test_zip_index();
+    failed_count += test_hbs_concurrent_map();
+    failed_count += test_hbs_stream();
+    failed_count += test_iso_index();
+
     return failed_count;
 }
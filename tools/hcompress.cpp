@@ -27,6 +27,11 @@ namespace
     constexpr u64 small_file_max_size = 64 * KB;
     constexpr u64 small_block_size = 2 * MB;
 
+    // zstd dictionary for small files; trained from about 100x its size of samples
+    constexpr u64 dictionary_max_size = 112 * KB;
+    constexpr u64 dictionary_sample_budget = 100 * dictionary_max_size;
+    constexpr size_t dictionary_min_samples = 16;
+
     constexpr size_t store_threshold_default = 95; // percent
     static constexpr int status_line_width = 60;
 
@@ -209,6 +214,7 @@ struct BlockMeta
     std::vector<Source> sources;
 
     bool store { false }; // store raw data as is, no compression
+    bool dictionary { false }; // compressed with the archive dictionary
     bool written { false };
 
     size_t file_index { ~size_t(0) };
@@ -568,7 +574,65 @@ void writeStoreNoCompression(const BlockMeta& work, const std::unordered_map<std
     }
 }
 
-void compress(State& state, const std::vector<std::string>& inputs, const std::string& archive, const std::string& compression, int level, size_t store_threshold, bool developer)
+static
+std::unique_ptr<zstd::Dictionary> trainDictionary(const State& state,
+    const std::unordered_map<std::string, std::string>& sources, int level)
+{
+    // the dictionary is trained from the small files which would be merged into blocks
+
+    std::vector<const FileInfo*> candidates;
+    u64 candidate_bytes = 0;
+
+    for (const FileInfo& node : state.files)
+    {
+        if (node.size && node.size <= small_file_max_size && isCompressible(node.name, node.size))
+        {
+            candidates.push_back(&node);
+            candidate_bytes += node.size;
+        }
+    }
+
+    if (candidates.size() < dictionary_min_samples)
+    {
+        printLine("[WARNING] Not enough small files to train a dictionary ({}).", candidates.size());
+        return nullptr;
+    }
+
+    u64 time0 = Time::ms();
+
+    // sample evenly over the files when they exceed the budget
+    const size_t stride = size_t((candidate_bytes + dictionary_sample_budget - 1) / dictionary_sample_budget);
+
+    Buffer samples;
+    std::vector<size_t> sample_sizes;
+
+    for (size_t i = 0; i < candidates.size(); i += stride)
+    {
+        const FileInfo& node = *candidates[i];
+        File file(sources.at(node.name));
+        samples.append(file.data(), file.size());
+        sample_sizes.push_back(file.size());
+    }
+
+    Buffer buffer(dictionary_max_size);
+
+    CompressionStatus status = zstd::train(buffer, samples, sample_sizes);
+    if (!status)
+    {
+        printLine("[WARNING] Dictionary training failed: {}", status.info);
+        return nullptr;
+    }
+
+    replaceLine("Trained {:0.1f} KB dictionary from {} files ({:0.1f} MB) in {:0.2f} seconds",
+        status.size / double(KB),
+        sample_sizes.size(),
+        samples.size() / double(MB),
+        (Time::ms() - time0) / 1000.0);
+
+    return std::make_unique<zstd::Dictionary>(ConstMemory(buffer, status.size), level);
+}
+
+void compress(State& state, const std::vector<std::string>& inputs, const std::string& archive, const std::string& compression, int level, size_t store_threshold, bool use_dictionary, bool developer)
 {
     Compressor compressor = getCompressor(compression);
 
@@ -612,6 +676,20 @@ void compress(State& state, const std::vector<std::string>& inputs, const std::s
         return a.size > b.size;
     });
 
+    std::unique_ptr<zstd::Dictionary> dictionary;
+
+    if (use_dictionary)
+    {
+        if (compressor.method != Compressor::ZSTD)
+        {
+            printLine("[WARNING] Dictionaries are only supported with zstd.");
+        }
+        else
+        {
+            dictionary = trainDictionary(state, sources, level);
+        }
+    }
+
     BlockManager manager;
     BlockMeta work;
     std::vector<size_t> store_small_files;
@@ -675,6 +753,15 @@ void compress(State& state, const std::vector<std::string>& inputs, const std::s
                 manager.flush(work);
             }
         }
+        else if (dictionary)
+        {
+            // the dictionary provides the context merging would; one block per file
+            // decompresses only the file which is accessed
+            manager.segment(0, node.size);
+            work.append({ node.name, 0, node.size });
+            work.dictionary = true;
+            manager.flush(work);
+        }
         else
         {
             // merge small files into one block
@@ -791,6 +878,7 @@ void compress(State& state, const std::vector<std::string>& inputs, const std::s
         desc.uncompressed = block.bytes;
         desc.compressed = size;
         desc.method = method;
+        desc.dictionary = block.dictionary ? 1 : 0;
         output.write(data, size);
         block.written = true;
 
@@ -906,7 +994,15 @@ void compress(State& state, const std::vector<std::string>& inputs, const std::s
                     size_t bound = compressor.bound(uncompressed.size);
                     dest.reset(bound);
 
-                    compressed.size = compressor.compress(dest, uncompressed, level);
+                    if (block.dictionary)
+                    {
+                        compressed.size = dictionary->compress(dest, uncompressed);
+                    }
+                    else
+                    {
+                        compressed.size = compressor.compress(dest, uncompressed, level);
+                    }
+
                     compressed.address = dest.data();
                 }
                 else
@@ -1011,6 +1107,16 @@ void compress(State& state, const std::vector<std::string>& inputs, const std::s
         level,
         state.total_bytes / (std::max(u64(1), compress_dt) * 1024));
 
+    // write dictionary data
+
+    u64 dictionary_data_offset = 0;
+
+    if (dictionary)
+    {
+        dictionary_data_offset = output.offset();
+        hbs::writeDictionaryArray(str, { dictionary->memory() });
+    }
+
     // write block data
 
     u64 block_data_offset = output.offset();
@@ -1023,7 +1129,7 @@ void compress(State& state, const std::vector<std::string>& inputs, const std::s
 
     // write index
 
-    hbs::writeIndex(str, block_data_offset, file_data_offset);
+    hbs::writeIndex(str, block_data_offset, file_data_offset, dictionary_data_offset);
 }
 
     struct CompressArgs
@@ -1033,6 +1139,7 @@ void compress(State& state, const std::vector<std::string>& inputs, const std::s
         std::string method = "zstd";
         int level = 6;
         size_t store_threshold = store_threshold_default;
+        bool dictionary = false;
         bool developer = false;
         bool verbose = false;
     };
@@ -1087,6 +1194,12 @@ void compress(State& state, const std::vector<std::string>& inputs, const std::s
                 args.store_threshold = 0;
             });
 
+        parser.flag("--dictionary", "train a zstd dictionary for small files",
+            [&]()
+            {
+                args.dictionary = true;
+            });
+
         parser.flag("--verbose", "verbose output",
             [&]()
             {
@@ -1140,7 +1253,7 @@ int main(int argc, const char* argv[])
 
     try
     {
-        compress(state, args.inputs, args.output, args.method, args.level, args.store_threshold, args.developer);
+        compress(state, args.inputs, args.output, args.method, args.level, args.store_threshold, args.dictionary, args.developer);
     }
     catch (Exception& e)
     {
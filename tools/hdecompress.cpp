@@ -20,7 +20,6 @@ namespace
 {
     constexpr u64 KB = 1 << 10;
     constexpr u64 MB = 1 << 20;
-    static constexpr u64 hbs_index_size = 24;
     static constexpr int status_line_width = 70;
 
     template <typename... T>
@@ -55,35 +54,34 @@ namespace
     };
 
     static
-    void readArchive(ConstMemory archive, std::vector<hbs::Block>& blocks, std::vector<hbs::File>& files)
+    void readArchive(ConstMemory archive,
+        std::vector<hbs::Block>& blocks,
+        std::vector<hbs::File>& files,
+        std::vector<std::unique_ptr<zstd::Dictionary>>& dictionaries)
     {
-        if (archive.size < hbs_index_size)
-        {
-            MANGO_EXCEPTION("[hdecompress] Archive is too small.");
-        }
+        hbs::Index index = hbs::readIndex(archive);
 
-        LittleEndianConstPointer p = archive.address;
-        u32 magic0 = p.read32();
-        if (magic0 != HBS_MAGIC0)
+        if (index.dictionary_offset)
         {
-            MANGO_EXCEPTION("[hdecompress] Incorrect archive identifier ({:#x}).", magic0);
+            ConstMemory memory = archive.slice(index.dictionary_offset, index.block_offset - index.dictionary_offset);
+
+            for (ConstMemory dictionary : hbs::readDictionaryArray(memory))
+            {
+                dictionaries.push_back(std::make_unique<zstd::Dictionary>(dictionary));
+            }
         }
 
-        u64 index_offset = archive.size - hbs_index_size;
-        p = archive.address + index_offset;
+        blocks = hbs::readBlockArray(archive.slice(index.block_offset, index.file_offset - index.block_offset));
+        files = hbs::readFileArray(archive.slice(index.file_offset, index.index_offset - index.file_offset));
 
-        u32 magic3 = p.read32();
-        if (magic3 != HBS_MAGIC3)
+        for (const hbs::Block& block : blocks)
         {
-            MANGO_EXCEPTION("[hdecompress] Incorrect index identifier ({:#x}).", magic3);
+            if (block.dictionary > dictionaries.size() || (block.dictionary && block.method != Compressor::ZSTD))
+            {
+                MANGO_EXCEPTION("[hdecompress] Block at offset {} has incorrect dictionary ({}).",
+                    block.offset, block.dictionary);
+            }
         }
-
-        p.read32(); // version
-        u64 block_offset = p.read64();
-        u64 file_offset = p.read64();
-
-        blocks = hbs::readBlockArray(ConstMemory(archive.address + block_offset, file_offset - block_offset));
-        files = hbs::readFileArray(ConstMemory(archive.address + file_offset, index_offset - file_offset));
     }
 
     static
@@ -405,7 +403,8 @@ namespace
         // 1. Read index
         std::vector<hbs::Block> blocks;
         std::vector<hbs::File> files;
-        readArchive(archive, blocks, files);
+        std::vector<std::unique_ptr<zstd::Dictionary>> dictionaries;
+        readArchive(archive, blocks, files, dictionaries);
 
         std::vector<std::vector<BlockUse>> block_uses(blocks.size());
         std::vector<std::unique_ptr<MultiFileExtract>> multi_states(files.size());
@@ -625,8 +624,17 @@ namespace
                     {
                         ConstMemory compressed(archive.address + block.offset, block.compressed);
                         Buffer buffer(block.uncompressed);
-                        Compressor compressor = getCompressor(Compressor::Method(block.method));
-                        compressor.decompress(buffer, compressed);
+
+                        if (block.dictionary)
+                        {
+                            dictionaries[block.dictionary - 1]->decompress(buffer, compressed);
+                        }
+                        else
+                        {
+                            Compressor compressor = getCompressor(Compressor::Method(block.method));
+                            compressor.decompress(buffer, compressed);
+                        }
+
                         owned = buffer.acquire();
                     }
 